@@ -0,0 +1,106 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Platform.h"
+#include "Memory.h"
+#include "Profiler.h"
+
+//This header file contains a simple bump allocator. Memory is handed out from large blocks and is only ever freed all at once
+//when the arena is destroyed, which makes allocating very cheap and keeps threads that each use their own arena from fighting
+//over the heap
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+//Every allocation is rounded up to this so that anything stored in the arena is properly aligned
+#define ARENA_ALIGNMENT 16
+
+typedef struct Arena_Block {
+	void* next;
+	int used;
+	int __size;
+	//Keeps data aligned for anything that is put into it
+	long long __align;
+	char data[];
+} Arena_Block;
+
+typedef struct Arena {
+	Arena_Block* blocks;
+	//Blocks left over from before the last arena_reset, which get handed out again before any new block is allocated
+	Arena_Block* spare;
+	long long bytesUsed;
+} Arena;
+
+void arena_init(Arena* arena) {
+	arena->blocks = NULL;
+	arena->spare = NULL;
+	arena->bytesUsed = 0;
+}
+
+void* arena_alloc(Arena* arena, int size) {
+	size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+	if (arena->blocks == NULL || arena->blocks->used + size > arena->blocks->__size) {
+		//Allocations bigger than a block get a block all to themselves
+		int blockSize = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+		Arena_Block* block = arena->spare;
+
+		if (block != NULL && block->__size >= blockSize) {
+			arena->spare = (Arena_Block*)block->next;
+		}
+		else {
+			profile_alloc(NULL, sizeof(Arena_Block) + blockSize);
+			block = (Arena_Block*)mem_alloc(sizeof(Arena_Block) + blockSize);
+
+			if (block == NULL) {
+				printf("Failed to allocate memory in arena_alloc\n");
+				exit(-1);
+			}
+
+			block->__size = blockSize;
+		}
+
+		block->used = 0;
+		block->next = arena->blocks;
+		arena->blocks = block;
+	}
+
+	void* ptr = arena->blocks->data + arena->blocks->used;
+	arena->blocks->used += size;
+	arena->bytesUsed += size;
+	return ptr;
+}
+
+//Throws away everything allocated from the arena but keeps its blocks, so the next round of allocations doesn't have to go back to
+//the heap for them
+void arena_reset(Arena* arena) {
+	while (arena->blocks != NULL) {
+		Arena_Block* next = (Arena_Block*)arena->blocks->next;
+		arena->blocks->next = arena->spare;
+		arena->spare = arena->blocks;
+		arena->blocks = next;
+	}
+	arena->bytesUsed = 0;
+}
+
+void arena_destroy(Arena* arena) {
+	Arena_Block* block = arena->blocks;
+	while (block != NULL) {
+		Arena_Block* next = (Arena_Block*)block->next;
+		mem_free(block);
+		block = next;
+	}
+
+	block = arena->spare;
+	while (block != NULL) {
+		Arena_Block* next = (Arena_Block*)block->next;
+		mem_free(block);
+		block = next;
+	}
+	arena->blocks = NULL;
+	arena->spare = NULL;
+	arena->bytesUsed = 0;
+}
+
+#endif
@@ -0,0 +1,696 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Strings.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "TypeChecker.h"
+#include "VM.h"
+#include "Platform.h"
+#include "Counters.h"
+#include <stdbool.h>
+
+//This header file contains the benchmarks for the lexer and parser, along with the generator for the programs they run on
+//
+//The generator is seeded with a fixed value, so the same shape and size always produce exactly the same program. Along with the
+//checksum of the program printed with every result, that makes numbers from different commits comparable as long as the machine
+//is the same. Every phase is run a few times first to warm up the caches before anything is measured, and the results are given
+//as percentiles over all of the repetitions instead of just an average, since a single slow run can throw an average off a lot
+//
+//When the hardware counters are available each phase also gets its cycles, instructions, branch misses and cache misses, both as
+//the median of one run and per MB of the program, which shows whether a change actually made the code friendlier to the processor
+//instead of just faster on one machine
+
+enum BENCH_SHAPES {
+	//A bit of every other shape
+	SHAPE_MIXED = 0,
+	//Lots of declarations with long names, and expressions made out of nothing but uses of them
+	SHAPE_IDENTIFIERS = 1,
+	//Expressions made out of nothing but int and float literals
+	SHAPE_LITERALS = 2,
+	//Expressions with parentheses nested very deep
+	SHAPE_NESTED = 3,
+	//Long string literals added together
+	SHAPE_STRINGS = 4,
+	//Many small functions, each called once at the top level
+	SHAPE_FUNCTIONS = 5,
+};
+
+#define NUM_BENCH_SHAPES 6
+
+char* bench_shape_names[] = { "mixed", "identifiers", "literals", "nested", "strings", "functions" };
+
+enum BENCH_PHASES {
+	//Normalizing the text and the first stage of the lexer
+	BENCH_LEX = 0,
+	//The second stage of the lexer, which finds the declarations and resolves every name against them
+	BENCH_RESOLVE = 1,
+	//parser, which leaves the function bodies for later
+	BENCH_PARSE = 2,
+	BENCH_PARSE_BODIES = 3,
+	//Running the compiled program in the virtual machine. Type checking and compiling it happen between this phase and the last one,
+	//but aren't measured
+	BENCH_RUN = 4,
+};
+
+#define NUM_BENCH_PHASES 5
+
+char* bench_phase_names[] = { "lex", "resolve", "parse", "parse-bodies", "run" };
+
+#define BENCH_SEED 12345
+#define BENCH_DEFAULT_SIZE (256 * 1024)
+#define BENCH_DEFAULT_WARMUP 3
+#define BENCH_DEFAULT_REPS 20
+//How deep the parentheses in the nested shape go
+#define BENCH_NEST_DEPTH 24
+
+typedef struct Bench_Options {
+	int shape;
+	int size;
+	int warmup;
+	int reps;
+	int json;
+	//Whether to read the hardware counters around every phase
+	int counters;
+} Bench_Options;
+
+typedef struct Bench_Stats {
+	double min;
+	double median;
+	double p90;
+	double p99;
+	double max;
+} Bench_Stats;
+
+typedef struct Bench_Result {
+	int shape;
+	int bytes;
+	unsigned long long checksum;
+	int tokens;
+	int nodes;
+	Bench_Stats phases[NUM_BENCH_PHASES];
+	//Whether any of the hardware counters could be read
+	int counted;
+	//The median of each hardware counter over every repetition, or COUNTER_UNAVAILABLE
+	long long counts[NUM_BENCH_PHASES][NUM_HARDWARE_COUNTERS];
+} Bench_Result;
+
+//Everything measured in one run of every phase
+typedef struct Bench_Sample {
+	double ms[NUM_BENCH_PHASES];
+	long long counts[NUM_BENCH_PHASES][NUM_HARDWARE_COUNTERS];
+} Bench_Sample;
+
+//A small generator of its own so the programs don't depend on how rand is implemented
+unsigned int bench_random(unsigned int* state) {
+	*state = *state * 1103515245 + 12345;
+	return (*state >> 16) & 0x7FFF;
+}
+
+void bench_append(string* out, char* text) {
+	for (int i = 0; text[i] != '\0'; i++) {
+		string_append(out, text[i]);
+	}
+}
+
+//Names are made out of letters that can't spell out a keyword, so a name can never be mistaken for one
+void bench_name(char* buffer, int size, char* prefix, int index) {
+	static char letters[] = "abcdeghjkqwxyz";
+	int a = index % 14;
+	int b = (index / 14) % 14;
+	snprintf(buffer, size, "%s%c%c_%d", prefix, letters[a], letters[b], index);
+}
+
+//Appends an expression made out of the given number of terms. Each term is either a use of one of the first count variables, or a
+//literal if there are none to use
+void bench_expression(string* out, unsigned int* state, int terms, int count, int literals) {
+	static char* ops[] = { " + ", " - ", " * ", " / " };
+	char buffer[64];
+
+	for (int i = 0; i < terms; i++) {
+		if (i > 0) {
+			bench_append(out, ops[bench_random(state) % 4]);
+		}
+
+		if (count > 0 && !literals) {
+			bench_name(buffer, sizeof(buffer), "q", bench_random(state) % count);
+		}
+		else {
+			snprintf(buffer, sizeof(buffer), "%d", (int)(bench_random(state) % 1000));
+		}
+		bench_append(out, buffer);
+	}
+}
+
+void bench_statement(string* out, unsigned int* state, int shape, int index) {
+	char buffer[256];
+
+	switch (shape) {
+	case SHAPE_IDENTIFIERS:
+		bench_name(buffer, sizeof(buffer), "q", index);
+		bench_append(out, "int ");
+		bench_append(out, buffer);
+		bench_append(out, " = ");
+		//The first declaration has nothing to use yet, so it gets literals instead
+		bench_expression(out, state, 6, index, false);
+		bench_append(out, ";\n");
+		break;
+	case SHAPE_LITERALS:
+		bench_name(buffer, sizeof(buffer), "k", index);
+		if (index % 2 == 0) {
+			bench_append(out, "int ");
+			bench_append(out, buffer);
+			bench_append(out, " = ");
+			bench_expression(out, state, 10, 0, true);
+		}
+		else {
+			bench_append(out, "float ");
+			bench_append(out, buffer);
+			bench_append(out, " = ");
+			for (int i = 0; i < 10; i++) {
+				snprintf(buffer, sizeof(buffer), "%s%d.%d", i == 0 ? "" : " + ", (int)(bench_random(state) % 1000), (int)(bench_random(state) % 1000));
+				bench_append(out, buffer);
+			}
+		}
+		bench_append(out, ";\n");
+		break;
+	case SHAPE_NESTED:
+		bench_name(buffer, sizeof(buffer), "d", index);
+		bench_append(out, "int ");
+		bench_append(out, buffer);
+		bench_append(out, " = ");
+		for (int i = 0; i < BENCH_NEST_DEPTH; i++) {
+			bench_append(out, "(");
+		}
+		bench_append(out, "1");
+		for (int i = 0; i < BENCH_NEST_DEPTH; i++) {
+			snprintf(buffer, sizeof(buffer), " + %d)", (int)(bench_random(state) % 100));
+			bench_append(out, buffer);
+		}
+		bench_append(out, ";\n");
+		break;
+	case SHAPE_STRINGS:
+		bench_name(buffer, sizeof(buffer), "w", index);
+		bench_append(out, "string ");
+		bench_append(out, buffer);
+		bench_append(out, " = ");
+		for (int i = 0; i < 3; i++) {
+			bench_append(out, i == 0 ? "\"" : " + \"");
+			//The text inside the quotes has operators and keywords in it on purpose, since the lexer has to skip over them
+			int len = 40 + bench_random(state) % 80;
+			for (int j = 0; j < len; j++) {
+				static char text[] = "the quick brown fox + int ; return ( ) { } jumps over the lazy dog ";
+				string_append(out, text[(j + index) % (sizeof(text) - 1)]);
+			}
+			bench_append(out, "\"");
+		}
+		bench_append(out, ";\n");
+		break;
+	case SHAPE_FUNCTIONS:
+		bench_name(buffer, sizeof(buffer), "h", index);
+		bench_append(out, "int ");
+		bench_append(out, buffer);
+		bench_append(out, "(int a, int b) {\n\tint c = a * b + ");
+		snprintf(buffer, sizeof(buffer), "%d", (int)(bench_random(state) % 100));
+		bench_append(out, buffer);
+		bench_append(out, ";\n\treturn c - a / 2;\n}\n");
+		bench_name(buffer, sizeof(buffer), "h", index);
+		bench_append(out, "int y");
+		bench_append(out, buffer);
+		bench_append(out, " = ");
+		bench_append(out, buffer);
+		snprintf(buffer, sizeof(buffer), "(%d, %d);\n", index % 10, index % 7 + 1);
+		bench_append(out, buffer);
+		break;
+	}
+}
+
+//Generates a program of the given shape that is at least size bytes long
+void bench_generate(string* out, int shape, int size) {
+	unsigned int state = BENCH_SEED + shape;
+	string_set(out, "");
+
+	//Each shape has its own names, so the mixed shape can just take turns between all of them
+	int counts[NUM_BENCH_SHAPES] = { 0 };
+	while (out->len < size) {
+		int next = shape == SHAPE_MIXED ? 1 + counts[SHAPE_MIXED] % (NUM_BENCH_SHAPES - 1) : shape;
+		bench_statement(out, &state, next, counts[next]);
+		counts[next]++;
+		counts[SHAPE_MIXED]++;
+	}
+}
+
+unsigned long long bench_checksum(string* text) {
+	unsigned long long hash = 14695981039346656037ULL;
+	for (int i = 0; i < text->len; i++) {
+		hash = (hash ^ (unsigned char)text->str[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+int bench_compare_double(const void* a, const void* b) {
+	double x = *(double*)a;
+	double y = *(double*)b;
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+int bench_compare_long_long(const void* a, const void* b) {
+	long long x = *(long long*)a;
+	long long y = *(long long*)b;
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+//Nearest rank percentile of samples that are already sorted
+double bench_percentile(double* samples, int count, double percent) {
+	int rank = (int)(percent / 100.0 * count + 0.999999);
+	if (rank < 1) {
+		rank = 1;
+	}
+	if (rank > count) {
+		rank = count;
+	}
+	return samples[rank - 1];
+}
+
+//The counters are started after the clock and stopped before it, so the time covers the same work even though reading them isn't free
+void bench_phase_start(Counters* counters, long long* start) {
+	*start = platform_time_ns();
+	if (counters != NULL) {
+		counters_start(counters);
+	}
+}
+
+void bench_phase_stop(Counters* counters, long long start, Bench_Sample* sample, int phase) {
+	if (counters != NULL) {
+		counters_stop(counters, sample->counts[phase]);
+	}
+	else {
+		for (int i = 0; i < NUM_HARDWARE_COUNTERS; i++) {
+			sample->counts[phase][i] = COUNTER_UNAVAILABLE;
+		}
+	}
+	sample->ms[phase] = (platform_time_ns() - start) / 1000000.0;
+}
+
+//Runs every phase once on a fresh copy of the program. counters is NULL when they aren't being read
+void bench_once(string* program, Counters* counters, Bench_Sample* sample, int* tokens, int* nodes) {
+	string input;
+	string_init(&input, program->str);
+	tokenList list;
+	tokenList_init(&list);
+	AST* ast;
+	AST_init(&ast);
+
+	//The diagnostics of a program with mistakes in it would end up being timed along with the parser, so they are kept out of the
+	//output. The generated programs don't have any
+	string errors;
+	string_init(&errors, NULL);
+	string* previousBuffer = diagnostics_buffer;
+	diagnostics_buffer = &errors;
+
+	long long start;
+	bench_phase_start(counters, &start);
+	lexer_normalize(&input);
+	lexer_scan(&list, &input, 0, input.len, NULL);
+	bench_phase_stop(counters, start, sample, BENCH_LEX);
+
+	bench_phase_start(counters, &start);
+	lexer_resolve(&list);
+	bench_phase_stop(counters, start, sample, BENCH_RESOLVE);
+
+	bench_phase_start(counters, &start);
+	parser(&list, &ast);
+	bench_phase_stop(counters, start, sample, BENCH_PARSE);
+
+	bench_phase_start(counters, &start);
+	parser_all_bodies(&list, &ast);
+	bench_phase_stop(counters, start, sample, BENCH_PARSE_BODIES);
+
+	typechecker(&list, &ast);
+	Program compiled;
+	compiler(&list, &ast, &compiled);
+	Image image;
+	image_from_program(&image, &compiled, &list);
+	VM vm;
+	vm_init(&vm, &image);
+
+	bench_phase_start(counters, &start);
+	vm_run(&vm);
+	bench_phase_stop(counters, start, sample, BENCH_RUN);
+
+	diagnostics_buffer = previousBuffer;
+
+	*tokens = list.len;
+	*nodes = AST_count_nodes(ast) - 1;
+
+	vm_destroy(&vm);
+	image_close(&image);
+	program_destroy(&compiled);
+	string_destroy(&errors);
+	AST_destroy_children(ast);
+	mem_free(ast);
+	tokenList_destroy_all(&list);
+	string_destroy(&input);
+}
+
+void bench_run(Bench_Options* options, Bench_Result* result) {
+	string program;
+	string_init(&program, NULL);
+	bench_generate(&program, options->shape, options->size);
+
+	result->shape = options->shape;
+	result->bytes = program.len;
+	result->checksum = bench_checksum(&program);
+	result->counted = false;
+
+	Counters opened;
+	Counters* counters = NULL;
+	if (options->counters && counters_open(&opened) > 0) {
+		counters = &opened;
+		result->counted = true;
+	}
+
+	Bench_Sample sample;
+	for (int i = 0; i < options->warmup; i++) {
+		bench_once(&program, counters, &sample, &result->tokens, &result->nodes);
+	}
+
+	int reps = options->reps < 1 ? 1 : options->reps;
+	double* samples = (double*)mem_alloc(NUM_BENCH_PHASES * reps * sizeof(double));
+	long long* countSamples = (long long*)mem_alloc(NUM_BENCH_PHASES * NUM_HARDWARE_COUNTERS * reps * sizeof(long long));
+
+	if (samples == NULL || countSamples == NULL) {
+		printf("Failed to allocate memory in bench_run\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < reps; i++) {
+		bench_once(&program, counters, &sample, &result->tokens, &result->nodes);
+		for (int j = 0; j < NUM_BENCH_PHASES; j++) {
+			samples[j * reps + i] = sample.ms[j];
+			for (int k = 0; k < NUM_HARDWARE_COUNTERS; k++) {
+				countSamples[(j * NUM_HARDWARE_COUNTERS + k) * reps + i] = sample.counts[j][k];
+			}
+		}
+	}
+
+	for (int j = 0; j < NUM_BENCH_PHASES; j++) {
+		double* phase = &samples[j * reps];
+		qsort(phase, reps, sizeof(double), bench_compare_double);
+		result->phases[j] = (Bench_Stats){ .min = phase[0], .median = bench_percentile(phase, reps, 50), .p90 = bench_percentile(phase, reps, 90),
+			.p99 = bench_percentile(phase, reps, 99), .max = phase[reps - 1] };
+
+		for (int k = 0; k < NUM_HARDWARE_COUNTERS; k++) {
+			long long* counts = &countSamples[(j * NUM_HARDWARE_COUNTERS + k) * reps];
+			qsort(counts, reps, sizeof(long long), bench_compare_long_long);
+			result->counts[j][k] = counts[(reps - 1) / 2];
+		}
+	}
+
+	if (counters != NULL) {
+		counters_close(counters);
+	}
+	else if (options->counters && !options->json) {
+		printf("Hardware counters are not available (%s), so only the times are measured\n", opened.error);
+	}
+
+	mem_free(countSamples);
+	mem_free(samples);
+	string_destroy(&program);
+}
+
+//Prints a count as text, or n/a if the counter wasn't available
+void bench_print_count(long long count, double divisor) {
+	if (count == COUNTER_UNAVAILABLE) {
+		printf(" %14s", "n/a");
+	}
+	else {
+		printf(" %14.0f", count / divisor);
+	}
+}
+
+//Throughput is worked out from the median, which is what should be compared between commits
+void bench_print(Bench_Options* options, Bench_Result* result) {
+	if (options->json) {
+		printf("{\"shape\":\"%s\",\"bytes\":%d,\"checksum\":\"%016llx\",\"tokens\":%d,\"nodes\":%d,\"reps\":%d,\"phases\":{", bench_shape_names[result->shape],
+			result->bytes, result->checksum, result->tokens, result->nodes, options->reps);
+		for (int i = 0; i < NUM_BENCH_PHASES; i++) {
+			Bench_Stats* s = &result->phases[i];
+			double seconds = s->median / 1000.0;
+			printf("%s\"%s\":{\"min_ms\":%.4f,\"median_ms\":%.4f,\"p90_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f,\"mb_per_sec\":%.2f,\"tokens_per_sec\":%.0f}",
+				i == 0 ? "" : ",", bench_phase_names[i], s->min, s->median, s->p90, s->p99, s->max,
+				seconds > 0 ? result->bytes / (1024.0 * 1024.0) / seconds : 0.0, seconds > 0 ? result->tokens / seconds : 0.0);
+		}
+		printf("}");
+
+		//Each counter is given as the median of one run, and per MB of the program. Counters that weren't available are null
+		if (result->counted) {
+			printf(",\"counters\":{");
+			for (int i = 0; i < NUM_BENCH_PHASES; i++) {
+				printf("%s\"%s\":{", i == 0 ? "" : ",", bench_phase_names[i]);
+				for (int j = 0; j < NUM_HARDWARE_COUNTERS; j++) {
+					long long count = result->counts[i][j];
+					if (count == COUNTER_UNAVAILABLE) {
+						printf("%s\"%s\":null", j == 0 ? "" : ",", counter_names[j]);
+					}
+					else {
+						printf("%s\"%s\":{\"total\":%lld,\"per_mb\":%.0f}", j == 0 ? "" : ",", counter_names[j], count,
+							count / (result->bytes / (1024.0 * 1024.0)));
+					}
+				}
+				printf("}");
+			}
+			printf("}");
+		}
+		else {
+			printf(",\"counters\":null");
+		}
+		printf("}\n");
+		return;
+	}
+
+	printf("%s: %d bytes, %d tokens, %d nodes, checksum %016llx, %d reps after %d warmup\n", bench_shape_names[result->shape], result->bytes,
+		result->tokens, result->nodes, result->checksum, options->reps, options->warmup);
+	printf("    %-14s %10s %10s %10s %10s %10s %10s %14s\n", "phase", "min ms", "median ms", "p90 ms", "p99 ms", "max ms", "MB/s", "tokens/s");
+	for (int i = 0; i < NUM_BENCH_PHASES; i++) {
+		Bench_Stats* s = &result->phases[i];
+		double seconds = s->median / 1000.0;
+		printf("    %-14s %10.3f %10.3f %10.3f %10.3f %10.3f %10.2f %14.0f\n", bench_phase_names[i], s->min, s->median, s->p90, s->p99, s->max,
+			seconds > 0 ? result->bytes / (1024.0 * 1024.0) / seconds : 0.0, seconds > 0 ? result->tokens / seconds : 0.0);
+	}
+
+	if (!result->counted) {
+		return;
+	}
+
+	//The same table twice, first for one run and then per MB of the program
+	for (int table = 0; table < 2; table++) {
+		double divisor = table == 0 ? 1.0 : result->bytes / (1024.0 * 1024.0);
+		printf("    %-14s", table == 0 ? "per run" : "per MB");
+		for (int i = 0; i < NUM_HARDWARE_COUNTERS; i++) {
+			printf(" %14s", counter_names[i]);
+		}
+		printf(" %8s\n", "IPC");
+
+		for (int i = 0; i < NUM_BENCH_PHASES; i++) {
+			printf("    %-14s", bench_phase_names[i]);
+			for (int j = 0; j < NUM_HARDWARE_COUNTERS; j++) {
+				bench_print_count(result->counts[i][j], divisor);
+			}
+
+			long long cycles = result->counts[i][COUNTER_CYCLES];
+			long long instructions = result->counts[i][COUNTER_INSTRUCTIONS];
+			if (cycles > 0 && instructions != COUNTER_UNAVAILABLE) {
+				printf(" %8.2f\n", (double)instructions / cycles);
+			}
+			else {
+				printf(" %8s\n", "n/a");
+			}
+		}
+	}
+}
+
+//Returns the shape with the given name, or -1 if there isn't one
+int bench_find_shape(char* name) {
+	for (int i = 0; i < NUM_BENCH_SHAPES; i++) {
+		if (strcmp(name, bench_shape_names[i]) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+//How many of the most common opcode pairs --pairs prints
+#define BENCH_TOP_PAIRS 12
+
+//Compiles the program and adds up how many times each opcode comes right before each other opcode in the code of every function.
+//counts is indexed by first opcode * NUM_BYTECODES + second opcode. Returns how many instructions there are in total
+long long bench_count_pairs(string* program, long long* counts) {
+	string input;
+	string_init(&input, program->str);
+	tokenList list;
+	tokenList_init(&list);
+	AST* ast;
+	AST_init(&ast);
+
+	lexer(&list, &input);
+	parser(&list, &ast);
+	parser_all_bodies(&list, &ast);
+	typechecker(&list, &ast);
+	Program compiled;
+	compiler(&list, &ast, &compiled);
+
+	long long total = 0;
+	memset(counts, 0, NUM_BYTECODES * NUM_BYTECODES * sizeof(long long));
+	for (int i = 0; i < compiled.numFunctions; i++) {
+		Vector_Int* code = &compiled.functions[i].code;
+		int prev = -1;
+		for (int j = 0; j < code->len; j += 1 + bytecode_operands[code->vec[j]]) {
+			if (prev != -1) {
+				counts[prev * NUM_BYTECODES + code->vec[j]]++;
+			}
+			prev = code->vec[j];
+			total++;
+		}
+	}
+
+	program_destroy(&compiled);
+	AST_destroy_children(ast);
+	mem_free(ast);
+	tokenList_destroy_all(&list);
+	string_destroy(&input);
+	return total;
+}
+
+void bench_print_pairs(long long* counts, long long total) {
+	printf("  %8s %7s  %s\n", "count", "share", "pair");
+	for (int k = 0; k < BENCH_TOP_PAIRS; k++) {
+		int best = -1;
+		for (int i = 0; i < NUM_BYTECODES * NUM_BYTECODES; i++) {
+			if (counts[i] > 0 && (best == -1 || counts[i] > counts[best])) {
+				best = i;
+			}
+		}
+		if (best == -1) {
+			break;
+		}
+
+		printf("  %8lld %6.1f%%  %s %s\n", counts[best], 100.0 * counts[best] / total, bytecode_names[best / NUM_BYTECODES],
+			bytecode_names[best % NUM_BYTECODES]);
+		counts[best] = 0;
+	}
+}
+
+//Prints the most common pairs of opcodes in the code for the generated program, first as the compiler makes it and then after the
+//peephole pass. The first list is what the superinstructions are picked from, and the second shows what is left to fuse
+void bench_pairs(Bench_Options* options) {
+	string program;
+	string_init(&program, NULL);
+	bench_generate(&program, options->shape, options->size);
+
+	long long* counts = (long long*)mem_alloc(NUM_BYTECODES * NUM_BYTECODES * sizeof(long long));
+
+	if (counts == NULL) {
+		printf("Failed to allocate memory in bench_pairs\n");
+		exit(-1);
+	}
+
+	int enabled = bytecode_peephole_enabled;
+	bytecode_peephole_enabled = false;
+	long long before = bench_count_pairs(&program, counts);
+	printf("Opcode pairs for %s (%d bytes), without the peephole pass: %lld instructions\n", bench_shape_names[options->shape],
+		program.len, before);
+	bench_print_pairs(counts, before);
+
+	bytecode_peephole_enabled = true;
+	long long after = bench_count_pairs(&program, counts);
+	printf("With the peephole pass: %lld instructions (%.1f%% fewer)\n", after, before > 0 ? 100.0 * (before - after) / before : 0.0);
+	bench_print_pairs(counts, after);
+	printf("\n");
+
+	bytecode_peephole_enabled = enabled;
+	mem_free(counts);
+	string_destroy(&program);
+}
+
+//Runs the benchmarks from the command line arguments after --bench, which are the name of a shape (or all), followed by any of
+//--size <bytes>, --reps <count>, --warmup <count>, --json, --no-counters to skip the hardware counters, --write <path> to save
+//the generated program instead of timing it, and --pairs to print the most common opcode pairs of its bytecode instead.
+//Returns the exit code
+int bench_main(int argc, char** argv) {
+	Bench_Options options = { .shape = -1, .size = BENCH_DEFAULT_SIZE, .warmup = BENCH_DEFAULT_WARMUP, .reps = BENCH_DEFAULT_REPS, .json = false,
+		.counters = true };
+	char* writePath = NULL;
+	int all = false;
+	int pairs = false;
+
+	for (int i = 0; i < argc; i++) {
+		if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+			options.size = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+			options.reps = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+			options.warmup = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--json") == 0) {
+			options.json = true;
+		}
+		else if (strcmp(argv[i], "--no-counters") == 0) {
+			options.counters = false;
+		}
+		else if (strcmp(argv[i], "--write") == 0 && i + 1 < argc) {
+			writePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--pairs") == 0) {
+			pairs = true;
+		}
+		else if (strcmp(argv[i], "all") == 0) {
+			all = true;
+		}
+		else if (bench_find_shape(argv[i]) != -1) {
+			options.shape = bench_find_shape(argv[i]);
+		}
+		else {
+			printf("Unknown benchmark argument %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (options.shape == -1 && !all) {
+		options.shape = SHAPE_MIXED;
+	}
+
+	if (writePath != NULL) {
+		string program;
+		string_init(&program, NULL);
+		bench_generate(&program, options.shape == -1 ? SHAPE_MIXED : options.shape, options.size);
+		string_write_file(writePath, &program);
+		printf("Wrote %d bytes to %s\n", program.len, writePath);
+		string_destroy(&program);
+		return 0;
+	}
+
+	for (int shape = 0; shape < NUM_BENCH_SHAPES; shape++) {
+		if (!all && shape != options.shape) {
+			continue;
+		}
+
+		options.shape = shape;
+		if (pairs) {
+			bench_pairs(&options);
+			continue;
+		}
+
+		Bench_Result result;
+		bench_run(&options, &result);
+		bench_print(&options, &result);
+	}
+	return 0;
+}
+
+#endif
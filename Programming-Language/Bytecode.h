@@ -0,0 +1,825 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Lexer.h"
+#include "Parser.h"
+#include "Vectors.h"
+#include "Value.h"
+#include "Diagnostics.h"
+#include <stdbool.h>
+
+//This header file contains the bytecode the AST gets compiled into, and the compiler that does it
+//
+//The bytecode is for a stack machine. Every instruction is an opcode followed by its operands, all stored as ints in the code of
+//a function. The top level statements of the program are compiled into function 0, and every function definition gets the next
+//index in the order the definitions appear in the file
+//
+//The compiler relies on the type checker having already run, since the arithmetic instructions are picked from the specialized
+//operation stored in each node
+
+//IMPORTANT: The order of these must match the order of bytecode_names, bytecode_operands, and bytecode_operand_kinds
+enum BYTECODE {
+	//operand: index into the constants of the function
+	BC_CONST = 0,
+	//operand: local slot
+	BC_LOAD_LOCAL = 1,
+	BC_STORE_LOCAL = 2,
+	//operand: global slot
+	BC_LOAD_GLOBAL = 3,
+	BC_STORE_GLOBAL = 4,
+	BC_INT_ADD = 5,
+	BC_INT_SUBTRACT = 6,
+	BC_INT_MULTIPLY = 7,
+	BC_INT_DIVIDE = 8,
+	BC_FLOAT_ADD = 9,
+	BC_FLOAT_SUBTRACT = 10,
+	BC_FLOAT_MULTIPLY = 11,
+	BC_FLOAT_DIVIDE = 12,
+	BC_STRING_CONCAT = 13,
+	//operands: function index, number of arguments. Every call leaves a value on the stack, which is VALUE_VOID for void functions
+	BC_CALL = 14,
+	BC_RETURN = 15,
+	BC_RETURN_VOID = 16,
+	BC_POP = 17,
+
+	//Everything from here on is only made by the peephole pass, out of the instructions above. The arithmetic ones with a constant
+	//do the operation with the value on top of the stack and the constant, and are in the same order as the plain arithmetic ones
+	//operand: index into the constants of the function
+	BC_INT_ADD_CONST = 18,
+	BC_INT_SUBTRACT_CONST = 19,
+	BC_INT_MULTIPLY_CONST = 20,
+	BC_INT_DIVIDE_CONST = 21,
+	BC_FLOAT_ADD_CONST = 22,
+	BC_FLOAT_SUBTRACT_CONST = 23,
+	BC_FLOAT_MULTIPLY_CONST = 24,
+	BC_FLOAT_DIVIDE_CONST = 25,
+	//operands: two local slots, or two global slots, which are pushed in order
+	BC_LOAD_LOCAL_2 = 26,
+	BC_LOAD_GLOBAL_2 = 27,
+	//operands: local slot, index into the constants. Pushes the local plus the constant
+	BC_LOCAL_INT_ADD_CONST = 28,
+	//operands: local slot, index into the constants. Adds the constant to the local, and leaves the stack alone
+	BC_INCREMENT_LOCAL = 29,
+	//operand: local slot, or global slot. Stores the value on top of the stack without popping it
+	BC_STORE_LOCAL_KEEP = 30,
+	BC_STORE_GLOBAL_KEEP = 31,
+
+	//The whole body of an extern function. Calls the C function the function is named after with the parameters of the function, and
+	//pushes what it returns (VALUE_VOID for void)
+	//operands: index into the constants of the signature as an int (see bytecode_signature), index into the constants of the path of
+	//the library as a string, which is empty for the C standard library
+	BC_FOREIGN = 32,
+};
+
+#define NUM_BYTECODES 33
+
+char* bytecode_names[] = {
+	"CONST", "LOAD_LOCAL", "STORE_LOCAL", "LOAD_GLOBAL", "STORE_GLOBAL",
+	"INT_ADD", "INT_SUBTRACT", "INT_MULTIPLY", "INT_DIVIDE",
+	"FLOAT_ADD", "FLOAT_SUBTRACT", "FLOAT_MULTIPLY", "FLOAT_DIVIDE",
+	"STRING_CONCAT", "CALL", "RETURN", "RETURN_VOID", "POP",
+	"INT_ADD_CONST", "INT_SUBTRACT_CONST", "INT_MULTIPLY_CONST", "INT_DIVIDE_CONST",
+	"FLOAT_ADD_CONST", "FLOAT_SUBTRACT_CONST", "FLOAT_MULTIPLY_CONST", "FLOAT_DIVIDE_CONST",
+	"LOAD_LOCAL_2", "LOAD_GLOBAL_2", "LOCAL_INT_ADD_CONST", "INCREMENT_LOCAL", "STORE_LOCAL_KEEP", "STORE_GLOBAL_KEEP",
+	"FOREIGN",
+};
+
+int bytecode_operands[] = {
+	1, 1, 1, 1, 1,
+	0, 0, 0, 0,
+	0, 0, 0, 0,
+	0, 2, 0, 0, 0,
+	1, 1, 1, 1,
+	1, 1, 1, 1,
+	2, 2, 2, 2, 1, 1,
+	2,
+};
+
+//What each operand of an instruction refers to, so that the image builder knows which operands to move into the constant pool of the
+//image, and the VM knows what to check them against when it loads a function
+enum BYTECODE_OPERAND_KINDS {
+	OPERAND_NONE = 0,
+	OPERAND_CONSTANT = 1,
+	OPERAND_LOCAL = 2,
+	OPERAND_GLOBAL = 3,
+	OPERAND_FUNCTION = 4,
+	//The number of arguments of a call, which has to match the number of parameters of the function
+	OPERAND_ARGUMENTS = 5,
+};
+
+int bytecode_operand_kinds[][2] = {
+	{ OPERAND_CONSTANT }, { OPERAND_LOCAL }, { OPERAND_LOCAL }, { OPERAND_GLOBAL }, { OPERAND_GLOBAL },
+	{ 0 }, { 0 }, { 0 }, { 0 },
+	{ 0 }, { 0 }, { 0 }, { 0 },
+	{ 0 }, { OPERAND_FUNCTION, OPERAND_ARGUMENTS }, { 0 }, { 0 }, { 0 },
+	{ OPERAND_CONSTANT }, { OPERAND_CONSTANT }, { OPERAND_CONSTANT }, { OPERAND_CONSTANT },
+	{ OPERAND_CONSTANT }, { OPERAND_CONSTANT }, { OPERAND_CONSTANT }, { OPERAND_CONSTANT },
+	{ OPERAND_LOCAL, OPERAND_LOCAL }, { OPERAND_GLOBAL, OPERAND_GLOBAL },
+	{ OPERAND_LOCAL, OPERAND_CONSTANT }, { OPERAND_LOCAL, OPERAND_CONSTANT }, { OPERAND_LOCAL }, { OPERAND_GLOBAL },
+	{ OPERAND_CONSTANT, OPERAND_CONSTANT },
+};
+
+//The most parameters an extern function can have, which is as far as the call stubs in FFI.h go
+#define FOREIGN_MAX_PARAMS 3
+
+//The signature of an extern function is packed into a single int, with 2 bits for the number of parameters, then 2 bits for the return
+//type, and then 2 bits for the type of each parameter. The types are indices into the keywords list like everywhere else
+static inline int bytecode_signature_params(int signature) {
+	return signature & 3;
+}
+
+static inline int bytecode_signature_return(int signature) {
+	return (signature >> 2) & 3;
+}
+
+static inline int bytecode_signature_param(int signature, int index) {
+	return (signature >> (4 + 2 * index)) & 3;
+}
+
+//The value a declared string variable starts with when it isn't given one. Like the keyword strings, this must never be altered
+string bytecode_empty_string = { .str = "", .len = 0, .__size = 1 };
+
+typedef struct Value_List {
+	Value* values;
+	int len;
+	int __size;
+} Value_List;
+
+void Value_List_init(Value_List* list) {
+	list->values = NULL;
+	list->len = 0;
+	list->__size = 1;
+}
+
+int Value_List_append(Value_List* list, Value val) {
+	if (list->len + 1 >= list->__size) {
+		list->__size *= 2;
+
+		profile_alloc(list->values, list->__size * sizeof(Value));
+		Value* test = (Value*)mem_realloc(list->values, list->__size * sizeof(Value));
+
+		if (test == NULL) {
+			printf("Failed to allocate memory in Value_List_append\n");
+			exit(-1);
+		}
+
+		list->values = test;
+	}
+
+	list->values[list->len] = val;
+	list->len++;
+	return 0;
+}
+
+void Value_List_destroy(Value_List* list) {
+	mem_free(list->values);
+	list->values = NULL;
+	list->len = 0;
+	list->__size = 1;
+}
+
+typedef struct Function {
+	//The index of the function identifier in the token list, or -1 for the top level statements
+	int token_index;
+	int numParams;
+	//Includes the parameters, which always take up the first slots
+	int numLocals;
+	Vector_Int code;
+	//For each int of the code, the token index of the statement it was compiled from, or -1 for the return at the end of the
+	//function. Used by the profiler to tell which line of the source an instruction belongs to. This isn't kept in the cache, so it
+	//is empty for a program loaded from there
+	Vector_Int origins;
+	Value_List constants;
+	//For each constant, the index of the literal token it came from, or -1 if it didn't come from one. The cache uses this to write
+	//string constants as the token their string belongs to
+	Vector_Int constantTokens;
+	//Errors found while compiling this function, kept here so that they can be printed in order after compiling in parallel
+	int numErrors;
+	string diagnostics;
+	//For a function imported from another module, the index of that module in the build and the index of the function in the
+	//program of that module. Both are -1 for functions defined in this program. Calls to an imported function go through its
+	//entry here, the same way an import table works
+	int module;
+	int remoteIndex;
+} Function;
+
+typedef struct Program {
+	Function* functions;
+	int numFunctions;
+	//The token indices of the declarations of the global variables, in slot order
+	Vector_Int globals;
+	//The order the code of the functions goes into an image in, which is set from a profile. When it is empty the functions go in
+	//their own order
+	Vector_Int layout;
+	//When functions are compiled in parallel, the nodes of the function bodies parsed by each worker are allocated from that
+	//worker's arena, and the arenas are kept here. This means the AST can't be used once the program is destroyed
+	Arena* arenas;
+	int numArenas;
+} Program;
+
+void function_init(Function* fn, int token_index) {
+	fn->token_index = token_index;
+	fn->numParams = 0;
+	fn->numLocals = 0;
+	fn->numErrors = 0;
+	fn->module = -1;
+	fn->remoteIndex = -1;
+	Vector_Int_Init(&fn->code);
+	Vector_Int_Init(&fn->origins);
+	Value_List_init(&fn->constants);
+	Vector_Int_Init(&fn->constantTokens);
+	string_init(&fn->diagnostics, NULL);
+}
+
+void function_destroy(Function* fn) {
+	Vector_Int_Destroy(&fn->code);
+	Vector_Int_Destroy(&fn->origins);
+	Value_List_destroy(&fn->constants);
+	Vector_Int_Destroy(&fn->constantTokens);
+	string_destroy(&fn->diagnostics);
+}
+
+//Adds a constant to the function and returns its index. token_index is the literal the constant came from, or -1
+int function_add_constant(Function* fn, Value val, int token_index) {
+	Value_List_append(&fn->constants, val);
+	Vector_Int_Append(&fn->constantTokens, token_index);
+	return fn->constants.len - 1;
+}
+
+//Returns true if the identifier at token_index is where a variable gets declared, which is when it comes right after a type keyword
+int bytecode_is_declaration(tokenList* list, int token_index) {
+	return token_index > 0 && list->tokens[token_index - 1].type == KEYWORD && is_keyword_variable_type(list->tokens[token_index - 1].val);
+}
+
+//Sets up the function table and the global variables of the program. This has to be done before any function is compiled, since
+//calls and uses of globals are resolved against these, and doing it up front means functions can then be compiled in any order
+void program_init(Program* program, tokenList* list, AST** ast) {
+	int numFunctions = 1;
+	for (int i = 0; i < (**ast).list.len; i++) {
+		int type = ((AST*)(**ast).list.arr)[i].type;
+		if (type == AST_FUNCTION_DEFINITION || type == AST_FUNCTION_IMPORT || type == AST_FUNCTION_EXTERN) {
+			numFunctions++;
+		}
+	}
+
+	program->functions = (Function*)mem_alloc(numFunctions * sizeof(Function));
+
+	if (program->functions == NULL) {
+		printf("Failed to allocate memory in program_init\n");
+		exit(-1);
+	}
+
+	program->numFunctions = numFunctions;
+	program->arenas = NULL;
+	program->numArenas = 0;
+	Vector_Int_Init(&program->globals);
+	Vector_Int_Init(&program->layout);
+	function_init(&program->functions[0], -1);
+
+	int index = 1;
+	for (int i = 0; i < (**ast).list.len; i++) {
+		AST* node = &((AST*)(**ast).list.arr)[i];
+
+		if (node->type == AST_FUNCTION_DEFINITION || node->type == AST_FUNCTION_IMPORT || node->type == AST_FUNCTION_EXTERN) {
+			function_init(&program->functions[index], node->token_index);
+			index++;
+		}
+		else if (node->type == AST_ASSIGN && node->list.len > 0) {
+			int variable = ((AST*)node->list.arr)[0].token_index;
+			if (bytecode_is_declaration(list, variable)) {
+				Vector_Int_Append(&program->globals, variable);
+			}
+		}
+		else if (node->type == AST_IDENTIFIER_VARIABLE && bytecode_is_declaration(list, node->token_index)) {
+			Vector_Int_Append(&program->globals, node->token_index);
+		}
+	}
+}
+
+void program_destroy(Program* program) {
+	for (int i = 0; i < program->numFunctions; i++) {
+		function_destroy(&program->functions[i]);
+	}
+	mem_free(program->functions);
+	Vector_Int_Destroy(&program->globals);
+	Vector_Int_Destroy(&program->layout);
+
+	for (int i = 0; i < program->numArenas; i++) {
+		arena_destroy(&program->arenas[i]);
+	}
+	mem_free(program->arenas);
+	program->arenas = NULL;
+	program->numArenas = 0;
+	program->functions = NULL;
+	program->numFunctions = 0;
+}
+
+//Returns the index of the function with the same name as the identifier at token_index, or -1 if there isn't one
+int program_find_function(Program* program, tokenList* list, int token_index) {
+	for (int i = 1; i < program->numFunctions; i++) {
+		if (token_name_equal(list, program->functions[i].token_index, token_index)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+typedef struct Compiler {
+	tokenList* tokens;
+	Program* program;
+	Function* function;
+	//The token indices of the names of the local variables, in slot order
+	Vector_Int locals;
+	//The token index of the statement being compiled
+	int origin;
+} Compiler;
+
+void compiler_error(Compiler* c, int token_index, char* message) {
+	diagnostics_error(c->tokens, "Compile", token_index, message);
+	c->function->numErrors++;
+}
+
+void compiler_emit(Compiler* c, int code) {
+	Vector_Int_Append(&c->function->code, code);
+	Vector_Int_Append(&c->function->origins, c->origin);
+}
+
+void compiler_emit_operand(Compiler* c, int code, int operand) {
+	compiler_emit(c, code);
+	compiler_emit(c, operand);
+}
+
+void compiler_emit_const(Compiler* c, Value val, int token_index) {
+	compiler_emit_operand(c, BC_CONST, function_add_constant(c->function, val, token_index));
+}
+
+//Looks up a variable by name, searching the locals from the most recently declared one and then the globals. Sets global to whether
+//the slot returned is a global slot. Returns -1 if there is no variable with that name
+int compiler_resolve(Compiler* c, int token_index, int* global) {
+	for (int i = c->locals.len - 1; i >= 0; i--) {
+		if (token_name_equal(c->tokens, c->locals.vec[i], token_index)) {
+			*global = false;
+			return i;
+		}
+	}
+
+	for (int i = 0; i < c->program->globals.len; i++) {
+		if (token_name_equal(c->tokens, c->program->globals.vec[i], token_index)) {
+			*global = true;
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+//Declares the variable if token_index is a declaration inside of a function, and then stores the value on top of the stack in it
+void compiler_store(Compiler* c, int token_index) {
+	//Globals already have their slots from program_init
+	if (c->function->token_index != -1 && bytecode_is_declaration(c->tokens, token_index)) {
+		Vector_Int_Append(&c->locals, token_index);
+		c->function->numLocals = c->locals.len;
+	}
+
+	int global;
+	int slot = compiler_resolve(c, token_index, &global);
+	if (slot == -1) {
+		compiler_error(c, token_index, "Assignment to an undeclared variable");
+		return;
+	}
+
+	compiler_emit_operand(c, global ? BC_STORE_GLOBAL : BC_STORE_LOCAL, slot);
+}
+
+void compiler_expression(Compiler* c, AST* node) {
+	switch (node->type) {
+	case AST_LITERAL:
+		compiler_emit_const(c, value_from_token(c->tokens->tokens[node->token_index]), node->token_index);
+		return;
+	case AST_IDENTIFIER_VARIABLE: {
+		int global;
+		int slot = compiler_resolve(c, node->token_index, &global);
+		if (slot == -1) {
+			compiler_error(c, node->token_index, "Use of an undeclared variable");
+			return;
+		}
+		compiler_emit_operand(c, global ? BC_LOAD_GLOBAL : BC_LOAD_LOCAL, slot);
+		return;
+	}
+	case AST_FUNCTION_CALL: {
+		int index = program_find_function(c->program, c->tokens, node->token_index);
+		if (index == -1) {
+			compiler_error(c, node->token_index, "Call to a function that has no definition");
+			return;
+		}
+
+		for (int i = 0; i < node->list.len; i++) {
+			compiler_expression(c, &((AST*)node->list.arr)[i]);
+		}
+		compiler_emit(c, BC_CALL);
+		compiler_emit(c, index);
+		compiler_emit(c, node->list.len);
+		return;
+	}
+	case AST_ADD:
+	case AST_SUBTRACT:
+	case AST_MULTIPLY:
+	case AST_DIVIDE:
+		if (node->list.len != 2) {
+			compiler_error(c, node->token_index, "Operator is missing an operand");
+			return;
+		}
+
+		compiler_expression(c, &((AST*)node->list.arr)[0]);
+		compiler_expression(c, &((AST*)node->list.arr)[1]);
+
+		//The specialized operations and the arithmetic bytecodes are in the same order, so the opcode can be worked out directly
+		if (node->op >= OP_INT_ADD && node->op <= OP_STRING_CONCAT) {
+			compiler_emit(c, BC_INT_ADD + node->op - OP_INT_ADD);
+		}
+		else {
+			compiler_error(c, node->token_index, "Operator has no type. The type checker has to run before compiling");
+		}
+		return;
+	default:
+		compiler_error(c, node->token_index, "Node can't be compiled as an expression");
+	}
+}
+
+void compiler_statement(Compiler* c, AST* node) {
+	switch (node->type) {
+	case AST_ASSIGN:
+		compiler_expression(c, &((AST*)node->list.arr)[1]);
+		compiler_store(c, ((AST*)node->list.arr)[0].token_index);
+		return;
+	case AST_IDENTIFIER_VARIABLE:
+		//A declaration without a value starts out with the zero value for its type
+		if (bytecode_is_declaration(c->tokens, node->token_index)) {
+			int type = token_identifier_type(c->tokens->tokens[node->token_index]);
+			if (type == KEYWORD_FLOAT) {
+				compiler_emit_const(c, value_from_float(0.0), -1);
+			}
+			else if (type == KEYWORD_STRING) {
+				compiler_emit_const(c, value_from_string(&bytecode_empty_string), -1);
+			}
+			else {
+				compiler_emit_const(c, value_from_int(0), -1);
+			}
+			compiler_store(c, node->token_index);
+			return;
+		}
+		break;
+	case AST_RETURN:
+		if (node->list.len > 0) {
+			compiler_expression(c, &((AST*)node->list.arr)[0]);
+			compiler_emit(c, BC_RETURN);
+		}
+		else {
+			compiler_emit(c, BC_RETURN_VOID);
+		}
+		return;
+	case AST_FUNCTION_DEFINITION:
+	case AST_FUNCTION_PARAMETER:
+	case AST_FUNCTION_IMPORT:
+	case AST_FUNCTION_EXTERN:
+	case AST_IMPORT:
+		return;
+	case AST_UNPARSED_BODY:
+		compiler_error(c, node->token_index, "Function body has to be parsed before it can be compiled");
+		return;
+	}
+
+	//Anything else is an expression whose value isn't used
+	compiler_expression(c, node);
+	compiler_emit(c, BC_POP);
+}
+
+//The peephole pass
+//
+//Once a function is compiled, its code is rewritten a few instructions at a time. The instructions are copied into new code one at
+//a time, and after each one the last couple of instructions of the new code are checked against the patterns in peephole_match,
+//over and over until none of them match. Matching against the new code instead of the old code means a pattern can match
+//instructions that another pattern made, which is how LOAD_LOCAL, CONST, INT_ADD, STORE_LOCAL ends up as a single INCREMENT_LOCAL
+//
+//The instructions that get fused were picked by counting how often each pair of opcodes comes up next to each other in the code for
+//the benchmark programs (--bench --pairs prints these counts). A constant going straight into an arithmetic operation was by far
+//the most common pair, at close to a third of all of them, followed by two loads of variables in a row. Once those were fused, most
+//of what was left was arithmetic on constants, so that gets worked out by the pass as well
+//
+//There are no jumps in the bytecode, so instructions next to each other always run one right after the other and can always be
+//combined, and nothing after a return can ever run. Once there are jumps, a pattern must not match across an instruction that a jump
+//lands on, and the code after a return has to be kept when something jumps into it
+
+//Turned off by the benchmarks to count the pairs of the code as the compiler makes it
+int bytecode_peephole_enabled = true;
+
+typedef struct Peephole {
+	Function* fn;
+	Vector_Int code;
+	Vector_Int origins;
+	//Where each instruction of the new code starts
+	Vector_Int starts;
+} Peephole;
+
+//Returns the instruction that is back instructions from the end of the new code, or NULL if there aren't that many
+int* peephole_last(Peephole* p, int back) {
+	if (p->starts.len <= back) {
+		return NULL;
+	}
+	return &p->code.vec[p->starts.vec[p->starts.len - 1 - back]];
+}
+
+//Removes the last count instructions from the new code
+void peephole_drop(Peephole* p, int count) {
+	p->code.len = p->starts.vec[p->starts.len - count];
+	p->origins.len = p->code.len;
+	p->starts.len -= count;
+}
+
+void peephole_emit(Peephole* p, int opcode, int a, int b, int origin) {
+	Vector_Int_Append(&p->starts, p->code.len);
+	Vector_Int_Append(&p->code, opcode);
+	if (bytecode_operands[opcode] > 0) {
+		Vector_Int_Append(&p->code, a);
+	}
+	if (bytecode_operands[opcode] > 1) {
+		Vector_Int_Append(&p->code, b);
+	}
+	while (p->origins.len < p->code.len) {
+		Vector_Int_Append(&p->origins, origin);
+	}
+}
+
+//Replaces the last two instructions of the new code with one instruction, which belongs to the statement the first one came from
+void peephole_fuse(Peephole* p, int opcode, int a, int b) {
+	int origin = p->origins.vec[p->starts.vec[p->starts.len - 2]];
+	peephole_drop(p, 2);
+	peephole_emit(p, opcode, a, b, origin);
+}
+
+//Works out the arithmetic instruction with a constant operand on a value, the same way the VM would
+Value peephole_fold(int opcode, Value a, Value b) {
+	switch (opcode) {
+	case BC_INT_ADD_CONST:
+		return value_int_add(a, b);
+	case BC_INT_SUBTRACT_CONST:
+		return value_int_subtract(a, b);
+	case BC_INT_MULTIPLY_CONST:
+		return value_int_multiply(a, b);
+	case BC_INT_DIVIDE_CONST:
+		return value_int_divide(a, b);
+	case BC_FLOAT_ADD_CONST:
+		return value_float_add(a, b);
+	case BC_FLOAT_SUBTRACT_CONST:
+		return value_float_subtract(a, b);
+	case BC_FLOAT_MULTIPLY_CONST:
+		return value_float_multiply(a, b);
+	default:
+		return value_float_divide(a, b);
+	}
+}
+
+//Checks the patterns against the last two instructions of the new code. Returns true if one of them matched and changed it
+int peephole_match(Peephole* p) {
+	int* last = peephole_last(p, 0);
+	int* prev = peephole_last(p, 1);
+	if (prev == NULL) {
+		return false;
+	}
+
+	int op = last[0];
+	int prevOp = prev[0];
+
+	//A constant that is only used by the arithmetic right after it becomes an operand of the arithmetic
+	if (prevOp == BC_CONST && op >= BC_INT_ADD && op <= BC_FLOAT_DIVIDE) {
+		peephole_fuse(p, BC_INT_ADD_CONST + op - BC_INT_ADD, prev[1], 0);
+		return true;
+	}
+
+	//Arithmetic on two constants is worked out now. Every arithmetic operation gives the same answer for the same operands every
+	//time (dividing by 0 included), so this can't change what the program does
+	if (prevOp == BC_CONST && op >= BC_INT_ADD_CONST && op <= BC_FLOAT_DIVIDE_CONST) {
+		Value folded = peephole_fold(op, p->fn->constants.values[prev[1]], p->fn->constants.values[last[1]]);
+		peephole_fuse(p, BC_CONST, function_add_constant(p->fn, folded, -1), 0);
+		return true;
+	}
+
+	if (prevOp == BC_LOAD_LOCAL && op == BC_INT_ADD_CONST) {
+		peephole_fuse(p, BC_LOCAL_INT_ADD_CONST, prev[1], last[1]);
+		return true;
+	}
+
+	//x = x + constant
+	if (prevOp == BC_LOCAL_INT_ADD_CONST && op == BC_STORE_LOCAL && prev[1] == last[1]) {
+		peephole_fuse(p, BC_INCREMENT_LOCAL, prev[1], prev[2]);
+		return true;
+	}
+
+	//Loading a variable and storing it straight back into itself does nothing
+	if (((prevOp == BC_LOAD_LOCAL && op == BC_STORE_LOCAL) || (prevOp == BC_LOAD_GLOBAL && op == BC_STORE_GLOBAL)) && prev[1] == last[1]) {
+		peephole_drop(p, 2);
+		return true;
+	}
+
+	//Storing a variable and then loading it again only needs the store to leave the value where it was
+	if (prevOp == BC_STORE_LOCAL && op == BC_LOAD_LOCAL && prev[1] == last[1]) {
+		peephole_fuse(p, BC_STORE_LOCAL_KEEP, prev[1], 0);
+		return true;
+	}
+	if (prevOp == BC_STORE_GLOBAL && op == BC_LOAD_GLOBAL && prev[1] == last[1]) {
+		peephole_fuse(p, BC_STORE_GLOBAL_KEEP, prev[1], 0);
+		return true;
+	}
+
+	//Storing the same value into the same variable twice, which is what storing into a variable and then assigning it to itself
+	//turns into once the load has been fused into the first store
+	if (((prevOp == BC_STORE_LOCAL_KEEP && op == BC_STORE_LOCAL) || (prevOp == BC_STORE_GLOBAL_KEEP && op == BC_STORE_GLOBAL)) && prev[1] == last[1]) {
+		peephole_fuse(p, op, last[1], 0);
+		return true;
+	}
+
+	//A value that is popped as soon as it is pushed, which is what an expression statement without a call in it comes out as
+	if (op == BC_POP && (prevOp == BC_CONST || prevOp == BC_LOAD_LOCAL || prevOp == BC_LOAD_GLOBAL)) {
+		peephole_drop(p, 2);
+		return true;
+	}
+
+	if (prevOp == BC_LOAD_LOCAL && op == BC_LOAD_LOCAL) {
+		peephole_fuse(p, BC_LOAD_LOCAL_2, prev[1], last[1]);
+		return true;
+	}
+	if (prevOp == BC_LOAD_GLOBAL && op == BC_LOAD_GLOBAL) {
+		peephole_fuse(p, BC_LOAD_GLOBAL_2, prev[1], last[1]);
+		return true;
+	}
+
+	return false;
+}
+
+//Runs the peephole pass over the code of a function
+void bytecode_peephole(Function* fn) {
+	Peephole p;
+	p.fn = fn;
+	Vector_Int_Init(&p.code);
+	Vector_Int_Init(&p.origins);
+	Vector_Int_Init(&p.starts);
+
+	for (int i = 0; i < fn->code.len; i += 1 + bytecode_operands[fn->code.vec[i]]) {
+		int* instruction = &fn->code.vec[i];
+		int operands = bytecode_operands[instruction[0]];
+		int origin = i < fn->origins.len ? fn->origins.vec[i] : -1;
+		peephole_emit(&p, instruction[0], operands > 0 ? instruction[1] : 0, operands > 1 ? instruction[2] : 0, origin);
+
+		while (peephole_match(&p)) {
+		}
+
+		if (instruction[0] == BC_RETURN || instruction[0] == BC_RETURN_VOID) {
+			break;
+		}
+	}
+
+	Vector_Int_Destroy(&fn->code);
+	Vector_Int_Destroy(&fn->origins);
+	fn->code = p.code;
+	fn->origins = p.origins;
+	Vector_Int_Destroy(&p.starts);
+}
+
+//Compiles the body of an extern function, which calls the C function and returns what it gave back. The parameters are already locals
+void compiler_extern(Compiler* c, AST* node) {
+	if (c->function->numParams > FOREIGN_MAX_PARAMS) {
+		compiler_error(c, node->token_index, "Extern functions can't have more than 3 parameters");
+		return;
+	}
+
+	int signature = c->function->numParams | (token_identifier_type(c->tokens->tokens[node->token_index]) << 2);
+	for (int i = 0; i < c->function->numParams; i++) {
+		AST* param = &((AST*)node->list.arr)[i];
+		signature |= token_identifier_type(c->tokens->tokens[param->token_index]) << (4 + 2 * i);
+	}
+
+	//The path of the library is the string right before the return type, if there is one
+	Value library = value_from_string(&bytecode_empty_string);
+	int libraryToken = -1;
+	token before = c->tokens->tokens[node->token_index - 2];
+	if (before.type == LITERAL && before.mdata == STRING_LITERAL) {
+		library = value_from_token(before);
+		libraryToken = node->token_index - 2;
+	}
+
+	compiler_emit(c, BC_FOREIGN);
+	compiler_emit(c, function_add_constant(c->function, value_from_int(signature), -1));
+	compiler_emit(c, function_add_constant(c->function, library, libraryToken));
+	compiler_emit(c, BC_RETURN);
+}
+
+//Compiles the function at the given index of the program. node is the function definition, or the root node for function 0. Only
+//the function being compiled is changed, so different functions can be compiled on different threads at the same time
+void compiler_function(tokenList* list, Program* program, int index, AST* node) {
+	Compiler c = { .tokens = list, .program = program, .function = &program->functions[index], .origin = -1 };
+	Vector_Int_Init(&c.locals);
+	//Nothing after a return can run, so the body stops being compiled there and the code always ends with the return
+	int returned = false;
+
+	for (int i = 0; i < node->list.len && !returned; i++) {
+		AST* child = &((AST*)node->list.arr)[i];
+
+		if (child->type == AST_FUNCTION_PARAMETER) {
+			Vector_Int_Append(&c.locals, child->token_index);
+			c.function->numParams++;
+			c.function->numLocals = c.locals.len;
+		}
+		else {
+			c.origin = child->token_index;
+			compiler_statement(&c, child);
+			returned = child->type == AST_RETURN;
+		}
+	}
+
+	if (node->type == AST_FUNCTION_EXTERN) {
+		c.origin = node->token_index;
+		compiler_extern(&c, node);
+		returned = true;
+	}
+
+	//Only the top level statements and void functions can fall off the end, which returns nothing. The type checker already turned
+	//away any other function without a return, so this is only reached if it was skipped
+	if (!returned) {
+		c.origin = -1;
+		if (node->type == AST_ROOT || token_identifier_type(list->tokens[node->token_index]) == KEYWORD_VOID) {
+			compiler_emit(&c, BC_RETURN_VOID);
+		}
+		else {
+			compiler_error(&c, node->token_index, "Not all paths of the function return a value");
+		}
+	}
+	Vector_Int_Destroy(&c.locals);
+
+	if (bytecode_peephole_enabled) {
+		bytecode_peephole(c.function);
+	}
+}
+
+//Compiles every function in the program one after another. Returns the number of errors found
+int compiler(tokenList* list, AST** ast, Program* program) {
+	profiler_begin(PHASE_COMPILE);
+	int errors = 0;
+	int index = 1;
+
+	program_init(program, list, ast);
+	compiler_function(list, program, 0, *ast);
+	errors += program->functions[0].numErrors;
+
+	for (int i = 0; i < (**ast).list.len; i++) {
+		AST* node = &((AST*)(**ast).list.arr)[i];
+		if (node->type == AST_FUNCTION_DEFINITION || node->type == AST_FUNCTION_EXTERN) {
+			compiler_function(list, program, index, node);
+			errors += program->functions[index].numErrors;
+			index++;
+		}
+		else if (node->type == AST_FUNCTION_IMPORT) {
+			//Imported functions have an entry so that calls can be resolved, but their code lives in their own module
+			index++;
+		}
+	}
+
+	profiler_end();
+	return errors;
+}
+
+//Prints the bytecode of a function in a readable form
+void function_disassemble(Function* fn, tokenList* list) {
+	char name[128];
+	if (fn->token_index == -1) {
+		printf("<top level>");
+	}
+	else {
+		token_to_text(list->tokens[fn->token_index], name, sizeof(name));
+		printf("%s", name);
+	}
+	printf(" (params: %d, locals: %d)\n", fn->numParams, fn->numLocals);
+
+	if (fn->module != -1) {
+		printf("    imported from module %d, function %d\n", fn->module, fn->remoteIndex);
+		return;
+	}
+
+	for (int i = 0; i < fn->code.len; i += 1 + bytecode_operands[fn->code.vec[i]]) {
+		int code = fn->code.vec[i];
+		printf("%4d  %-16s", i, bytecode_names[code]);
+		for (int j = 0; j < bytecode_operands[code]; j++) {
+			printf(" %d", fn->code.vec[i + 1 + j]);
+		}
+
+		if (code == BC_CONST) {
+			printf("    ; ");
+			value_print(fn->constants.values[fn->code.vec[i + 1]]);
+		}
+		printf("\n");
+	}
+}
+
+#endif
@@ -0,0 +1,528 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Platform.h"
+#include "Strings.h"
+#include "Lexer.h"
+#include "Bytecode.h"
+#include <stdbool.h>
+
+//This header file contains the on disk compilation cache
+//
+//Every compiled file is stored under a key made from a hash of its source, the version of the compiler, and the flags it was
+//compiled with, so a file that hasn't changed since the last time it was compiled can skip the lexer and parser entirely and be
+//loaded straight from the cache. An entry holds the tokens, the bytecode and constants of every function, and the global variables
+//of the program
+//
+//The cache keeps an index file with the size of every entry and when it was last used. When the total size goes over the limit,
+//the entries that were used least recently are deleted until it fits again. The index also keeps the hit and miss counts across runs
+//
+//The file name of an entry only comes from a 64 bit hash, so an entry also records the length of the source and a second hash of it
+//made a different way, and a lookup only hits if those match too. Two sources would have to collide on both hashes at the same
+//length to load the wrong program
+//
+//Everything is written in the byte order of the machine, since the cache is only ever read back on the machine that wrote it
+
+//This has to change whenever a change to the compiler would make it produce different tokens or bytecode for the same source
+#define COMPILER_VERSION "0.3.0"
+//This has to change whenever the layout of the entry or index files changes
+#define CACHE_FORMAT_VERSION 2
+#define CACHE_MAGIC 0x43434C50
+#define CACHE_DEFAULT_MAX_BYTES (256LL * 1024 * 1024)
+#define CACHE_MAX_PATH 4096
+
+//What a compiled file is looked up by. hash names the entry, and check and sourceLen are kept in the entry to tell apart two sources
+//that happen to have the same hash
+typedef struct Cache_Key {
+	unsigned long long hash;
+	unsigned long long check;
+	int sourceLen;
+} Cache_Key;
+
+typedef struct Cache_Entry {
+	unsigned long long key;
+	long long size;
+	//The value of the clock of the cache the last time this entry was stored or loaded
+	long long lastUsed;
+} Cache_Entry;
+
+typedef struct Cache_Stats {
+	long long hits;
+	long long misses;
+	long long stores;
+	long long evictions;
+} Cache_Stats;
+
+typedef struct Cache {
+	string dir;
+	Cache_Entry* entries;
+	int len;
+	int __size;
+	//Counts up every time an entry is used, which is what orders the entries for eviction
+	long long clock;
+	long long totalBytes;
+	long long maxBytes;
+	Cache_Stats stats;
+} Cache;
+
+//64 bit FNV-1a hash, which can be continued from a previous hash to combine several pieces of data into a single key
+unsigned long long cache_hash(unsigned long long hash, void* data, int len) {
+	unsigned char* bytes = (unsigned char*)data;
+	for (int i = 0; i < len; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+//A 64 bit hash that has nothing in common with FNV-1a (the finalizer of splitmix64 run over each 8 bytes), so that data colliding
+//under one of them is no more likely to collide under the other
+unsigned long long cache_check_hash(unsigned long long hash, void* data, int len) {
+	unsigned char* bytes = (unsigned char*)data;
+	for (int i = 0; i < len; i += 8) {
+		unsigned long long chunk = 0;
+		memcpy(&chunk, bytes + i, len - i < 8 ? len - i : 8);
+		hash += chunk + 0x9E3779B97F4A7C15ULL;
+		hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBULL;
+		hash ^= hash >> 31;
+	}
+	return hash;
+}
+
+//flags should describe any option that changes the output of the compiler
+Cache_Key cache_key(string* source, char* flags) {
+	Cache_Key key;
+	key.hash = 14695981039346656037ULL;
+	key.hash = cache_hash(key.hash, source->str, source->len);
+	key.hash = cache_hash(key.hash, COMPILER_VERSION, (int)strlen(COMPILER_VERSION));
+	key.hash = cache_hash(key.hash, flags, (int)strlen(flags));
+
+	key.check = (unsigned long long)source->len;
+	key.check = cache_check_hash(key.check, source->str, source->len);
+	key.check = cache_check_hash(key.check, COMPILER_VERSION, (int)strlen(COMPILER_VERSION));
+	key.check = cache_check_hash(key.check, flags, (int)strlen(flags));
+	key.sourceLen = source->len;
+	return key;
+}
+
+void cache_entry_path(Cache* cache, unsigned long long key, char* out, int size) {
+	snprintf(out, size, "%s%c%016llx.plc", cache->dir.str, PATH_SEPARATOR, key);
+}
+
+void cache_index_path(Cache* cache, char* out, int size) {
+	snprintf(out, size, "%s%cindex.bin", cache->dir.str, PATH_SEPARATOR);
+}
+
+void cache_write_int(FILE* fptr, int num) {
+	fwrite(&num, sizeof(int), 1, fptr);
+}
+
+void cache_write_long(FILE* fptr, long long num) {
+	fwrite(&num, sizeof(long long), 1, fptr);
+}
+
+void cache_write_string(FILE* fptr, string* str) {
+	cache_write_int(fptr, str->len);
+	fwrite(str->str, sizeof(char), str->len, fptr);
+}
+
+//The read functions set ok to false if the file ends early instead of exiting, since a damaged entry should just count as a miss
+int cache_read_int(FILE* fptr, int* ok) {
+	int num = 0;
+	if (fread(&num, sizeof(int), 1, fptr) != 1) {
+		*ok = false;
+	}
+	return num;
+}
+
+long long cache_read_long(FILE* fptr, int* ok) {
+	long long num = 0;
+	if (fread(&num, sizeof(long long), 1, fptr) != 1) {
+		*ok = false;
+	}
+	return num;
+}
+
+//Returns how many bytes of the file are left after the current position, given the size of the whole file
+long long cache_remaining(FILE* fptr, long long fileSize) {
+	long long position = ftell(fptr);
+	return position < 0 || position > fileSize ? 0 : fileSize - position;
+}
+
+//Returns a heap allocated string like the ones the lexer puts in tokens. fileSize is the size of the whole file, and a length that
+//runs past the end of it means the entry is damaged, so nothing gets allocated for it
+string* cache_read_string(FILE* fptr, long long fileSize, int* ok) {
+	int len = cache_read_int(fptr, ok);
+	if (!*ok || len < 0 || len > cache_remaining(fptr, fileSize)) {
+		*ok = false;
+		return NULL;
+	}
+
+	string* str = (string*)mem_alloc(sizeof(string));
+	char* buffer = (char*)mem_alloc((len + 1) * sizeof(char));
+
+	if (str == NULL || buffer == NULL) {
+		printf("Failed to allocate memory in cache_read_string\n");
+		exit(-1);
+	}
+
+	if (fread(buffer, sizeof(char), len, fptr) != (size_t)len) {
+		*ok = false;
+	}
+	buffer[len] = '\0';
+	str->str = buffer;
+	str->len = len;
+	str->__size = len + 1;
+	return str;
+}
+
+int cache_find(Cache* cache, unsigned long long key) {
+	for (int i = 0; i < cache->len; i++) {
+		if (cache->entries[i].key == key) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+void cache_add_entry(Cache* cache, Cache_Entry entry) {
+	if (cache->len + 1 >= cache->__size) {
+		cache->__size *= 2;
+
+		Cache_Entry* test = (Cache_Entry*)mem_realloc(cache->entries, cache->__size * sizeof(Cache_Entry));
+
+		if (test == NULL) {
+			printf("Failed to allocate memory in cache_add_entry\n");
+			exit(-1);
+		}
+
+		cache->entries = test;
+	}
+
+	cache->entries[cache->len] = entry;
+	cache->len++;
+	cache->totalBytes += entry.size;
+}
+
+void cache_remove_entry(Cache* cache, int index) {
+	char path[CACHE_MAX_PATH];
+	cache_entry_path(cache, cache->entries[index].key, path, sizeof(path));
+	remove(path);
+
+	cache->totalBytes -= cache->entries[index].size;
+	cache->entries[index] = cache->entries[cache->len - 1];
+	cache->len--;
+}
+
+//Deletes the least recently used entries until the cache fits under its size limit
+void cache_evict(Cache* cache) {
+	while (cache->totalBytes > cache->maxBytes && cache->len > 0) {
+		int oldest = 0;
+		for (int i = 1; i < cache->len; i++) {
+			if (cache->entries[i].lastUsed < cache->entries[oldest].lastUsed) {
+				oldest = i;
+			}
+		}
+
+		cache_remove_entry(cache, oldest);
+		cache->stats.evictions++;
+	}
+}
+
+//Opens the cache in the given directory, creating the directory if needed. Returns false if the directory can't be used, in which
+//case every lookup will just miss
+int cache_open(Cache* cache, char* dir, long long maxBytes) {
+	string_init(&cache->dir, dir);
+	cache->entries = NULL;
+	cache->len = 0;
+	cache->__size = 1;
+	cache->clock = 0;
+	cache->totalBytes = 0;
+	cache->maxBytes = maxBytes > 0 ? maxBytes : CACHE_DEFAULT_MAX_BYTES;
+	memset(&cache->stats, 0, sizeof(Cache_Stats));
+
+	if (!platform_make_directory(dir)) {
+		return false;
+	}
+
+	char path[CACHE_MAX_PATH];
+	cache_index_path(cache, path, sizeof(path));
+	FILE* fptr = fopen(path, "rb");
+	if (fptr == NULL) {
+		return true;
+	}
+
+	int ok = true;
+	if (cache_read_int(fptr, &ok) != CACHE_MAGIC || cache_read_int(fptr, &ok) != CACHE_FORMAT_VERSION) {
+		//An index from another version of the cache is ignored, and its entries will be overwritten as files get compiled again
+		fclose(fptr);
+		return true;
+	}
+
+	cache->clock = cache_read_long(fptr, &ok);
+	cache->stats.hits = cache_read_long(fptr, &ok);
+	cache->stats.misses = cache_read_long(fptr, &ok);
+	cache->stats.stores = cache_read_long(fptr, &ok);
+	cache->stats.evictions = cache_read_long(fptr, &ok);
+	int count = cache_read_int(fptr, &ok);
+
+	for (int i = 0; i < count && ok; i++) {
+		Cache_Entry entry;
+		entry.key = (unsigned long long)cache_read_long(fptr, &ok);
+		entry.size = cache_read_long(fptr, &ok);
+		entry.lastUsed = cache_read_long(fptr, &ok);
+		if (ok) {
+			cache_add_entry(cache, entry);
+		}
+	}
+
+	fclose(fptr);
+
+	//The limit might be lower than the last time the cache was opened
+	cache_evict(cache);
+	return true;
+}
+
+//Writes the compiled version of a file into the cache under the given key
+void cache_store(Cache* cache, Cache_Key key, tokenList* list, Program* program) {
+	char path[CACHE_MAX_PATH];
+	cache_entry_path(cache, key.hash, path, sizeof(path));
+	FILE* fptr = fopen(path, "wb");
+	if (fptr == NULL) {
+		return;
+	}
+
+	cache_write_int(fptr, CACHE_MAGIC);
+	cache_write_int(fptr, CACHE_FORMAT_VERSION);
+	cache_write_long(fptr, (long long)key.hash);
+	cache_write_long(fptr, (long long)key.check);
+	cache_write_int(fptr, key.sourceLen);
+
+	//Tokens that point to strings have the string written out in place of the pointer
+	cache_write_int(fptr, list->len);
+	for (int i = 0; i < list->len; i++) {
+		token tok = list->tokens[i];
+		cache_write_int(fptr, tok.type);
+		cache_write_int(fptr, (int)tok.mdata);
+
+		if (tok.type == IDENTIFIER || tok.type == TYPE_UNDEFINED || (tok.type == LITERAL && tok.mdata == STRING_LITERAL)) {
+			cache_write_string(fptr, (string*)tok.val);
+		}
+		else {
+			cache_write_long(fptr, tok.val);
+		}
+	}
+
+	cache_write_int(fptr, program->globals.len);
+	for (int i = 0; i < program->globals.len; i++) {
+		cache_write_int(fptr, program->globals.vec[i]);
+	}
+
+	cache_write_int(fptr, program->numFunctions);
+	for (int i = 0; i < program->numFunctions; i++) {
+		Function* fn = &program->functions[i];
+		cache_write_int(fptr, fn->token_index);
+		cache_write_int(fptr, fn->numParams);
+		cache_write_int(fptr, fn->numLocals);
+		cache_write_int(fptr, fn->module);
+		cache_write_int(fptr, fn->remoteIndex);
+
+		cache_write_int(fptr, fn->code.len);
+		fwrite(fn->code.vec, sizeof(int), fn->code.len, fptr);
+
+		//String constants point at the string of a token, so they are written as the index of that token, or -1 for the empty
+		//string that declared string variables start with
+		cache_write_int(fptr, fn->constants.len);
+		for (int j = 0; j < fn->constants.len; j++) {
+			Value val = fn->constants.values[j];
+			if (value_is_string(val)) {
+				cache_write_int(fptr, 1);
+				cache_write_int(fptr, fn->constantTokens.vec[j]);
+			}
+			else {
+				cache_write_int(fptr, 0);
+				cache_write_long(fptr, (long long)val);
+			}
+		}
+	}
+
+	long long size = ftell(fptr);
+	fclose(fptr);
+
+	int existing = cache_find(cache, key.hash);
+	if (existing != -1) {
+		cache->totalBytes -= cache->entries[existing].size;
+		cache->entries[existing].size = size;
+		cache->entries[existing].lastUsed = cache->clock++;
+		cache->totalBytes += size;
+	}
+	else {
+		cache_add_entry(cache, (Cache_Entry) { .key = key.hash, .size = size, .lastUsed = cache->clock++ });
+	}
+	cache->stats.stores++;
+
+	cache_evict(cache);
+}
+
+//Loads the compiled version of a file from the cache into an empty token list and program. Returns true on a hit. On a miss
+//(including an entry that turns out to be damaged), list and program are left empty
+int cache_load(Cache* cache, Cache_Key key, tokenList* list, Program* program) {
+	program->functions = NULL;
+	program->numFunctions = 0;
+	program->arenas = NULL;
+	program->numArenas = 0;
+	Vector_Int_Init(&program->globals);
+	Vector_Int_Init(&program->layout);
+
+	int index = cache_find(cache, key.hash);
+	char path[CACHE_MAX_PATH];
+	cache_entry_path(cache, key.hash, path, sizeof(path));
+	FILE* fptr = index == -1 ? NULL : fopen(path, "rb");
+
+	if (fptr == NULL) {
+		cache->stats.misses++;
+		return false;
+	}
+
+	fseek(fptr, 0, SEEK_END);
+	long long fileSize = ftell(fptr);
+	fseek(fptr, 0, SEEK_SET);
+
+	int ok = fileSize > 0;
+	if (cache_read_int(fptr, &ok) != CACHE_MAGIC || cache_read_int(fptr, &ok) != CACHE_FORMAT_VERSION
+		|| (unsigned long long)cache_read_long(fptr, &ok) != key.hash || (unsigned long long)cache_read_long(fptr, &ok) != key.check
+		|| cache_read_int(fptr, &ok) != key.sourceLen) {
+		ok = false;
+	}
+
+	int numTokens = ok ? cache_read_int(fptr, &ok) : 0;
+	for (int i = 0; i < numTokens && ok; i++) {
+		token tok;
+		tok.type = (enum TYPE)cache_read_int(fptr, &ok);
+		tok.mdata = (unsigned int)cache_read_int(fptr, &ok);
+
+		if (tok.type == IDENTIFIER || tok.type == TYPE_UNDEFINED || (tok.type == LITERAL && tok.mdata == STRING_LITERAL)) {
+			tok.val = (long long)cache_read_string(fptr, fileSize, &ok);
+			//There is no string to free for a token whose string couldn't be read, so it is left out of the list
+			if (tok.val == 0) {
+				break;
+			}
+		}
+		else {
+			tok.val = cache_read_long(fptr, &ok);
+		}
+		tokenList_append(list, tok);
+	}
+
+	int numGlobals = ok ? cache_read_int(fptr, &ok) : 0;
+	for (int i = 0; i < numGlobals && ok; i++) {
+		Vector_Int_Append(&program->globals, cache_read_int(fptr, &ok));
+	}
+
+	//Every function takes up at least 7 ints, so a count that couldn't fit in the rest of the file means the entry is damaged
+	int numFunctions = ok ? cache_read_int(fptr, &ok) : 0;
+	if (numFunctions < 0 || numFunctions > cache_remaining(fptr, fileSize) / (7 * (long long)sizeof(int))) {
+		ok = false;
+	}
+	if (ok && numFunctions > 0) {
+		program->functions = (Function*)mem_alloc(numFunctions * sizeof(Function));
+
+		if (program->functions == NULL) {
+			printf("Failed to allocate memory in cache_load\n");
+			exit(-1);
+		}
+	}
+
+	for (int i = 0; i < numFunctions && ok; i++) {
+		Function* fn = &program->functions[i];
+		function_init(fn, cache_read_int(fptr, &ok));
+		program->numFunctions++;
+		fn->numParams = cache_read_int(fptr, &ok);
+		fn->numLocals = cache_read_int(fptr, &ok);
+		fn->module = cache_read_int(fptr, &ok);
+		fn->remoteIndex = cache_read_int(fptr, &ok);
+
+		int codeLen = cache_read_int(fptr, &ok);
+		for (int j = 0; j < codeLen && ok; j++) {
+			Vector_Int_Append(&fn->code, cache_read_int(fptr, &ok));
+		}
+
+		int numConstants = cache_read_int(fptr, &ok);
+		for (int j = 0; j < numConstants && ok; j++) {
+			if (cache_read_int(fptr, &ok) == 1) {
+				int tokenIndex = cache_read_int(fptr, &ok);
+				if (tokenIndex >= 0 && tokenIndex < list->len && list->tokens[tokenIndex].type == LITERAL
+					&& list->tokens[tokenIndex].mdata == STRING_LITERAL) {
+					function_add_constant(fn, value_from_string((string*)list->tokens[tokenIndex].val), tokenIndex);
+				}
+				else {
+					function_add_constant(fn, value_from_string(&bytecode_empty_string), -1);
+				}
+			}
+			else {
+				function_add_constant(fn, (Value)cache_read_long(fptr, &ok), -1);
+			}
+		}
+	}
+
+	fclose(fptr);
+
+	if (!ok) {
+		//A damaged entry is thrown out so it gets written again
+		program_destroy(program);
+		Vector_Int_Init(&program->globals);
+		Vector_Int_Init(&program->layout);
+		tokenList_destroy_all(list);
+		cache_remove_entry(cache, index);
+		cache->stats.misses++;
+		return false;
+	}
+
+	cache->entries[index].lastUsed = cache->clock++;
+	cache->stats.hits++;
+	return true;
+}
+
+void cache_print_stats(Cache* cache) {
+	long long lookups = cache->stats.hits + cache->stats.misses;
+	printf("Cache hits: %lld | misses: %lld | hit rate: %.1f%%\n", cache->stats.hits, cache->stats.misses,
+		lookups > 0 ? 100.0 * cache->stats.hits / lookups : 0.0);
+	printf("Cache stores: %lld | evictions: %lld\n", cache->stats.stores, cache->stats.evictions);
+	printf("Cache entries: %d | size: %lld / %lld bytes\n", cache->len, cache->totalBytes, cache->maxBytes);
+}
+
+//Writes the index back out and frees the cache
+void cache_close(Cache* cache) {
+	char path[CACHE_MAX_PATH];
+	cache_index_path(cache, path, sizeof(path));
+	FILE* fptr = fopen(path, "wb");
+
+	if (fptr != NULL) {
+		cache_write_int(fptr, CACHE_MAGIC);
+		cache_write_int(fptr, CACHE_FORMAT_VERSION);
+		cache_write_long(fptr, cache->clock);
+		cache_write_long(fptr, cache->stats.hits);
+		cache_write_long(fptr, cache->stats.misses);
+		cache_write_long(fptr, cache->stats.stores);
+		cache_write_long(fptr, cache->stats.evictions);
+		cache_write_int(fptr, cache->len);
+		for (int i = 0; i < cache->len; i++) {
+			cache_write_long(fptr, (long long)cache->entries[i].key);
+			cache_write_long(fptr, cache->entries[i].size);
+			cache_write_long(fptr, cache->entries[i].lastUsed);
+		}
+		fclose(fptr);
+	}
+
+	mem_free(cache->entries);
+	string_destroy(&cache->dir);
+	cache->entries = NULL;
+	cache->len = 0;
+	cache->__size = 1;
+}
+
+#endif
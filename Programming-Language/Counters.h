@@ -0,0 +1,174 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Platform.h"
+#include <stdbool.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+//This header file contains the hardware performance counters used by the benchmarks
+//
+//On Linux the counters come from perf_event_open, and only count what the current thread does in user space, so they work with the
+//default perf_event_paranoid setting without needing root. Each counter is opened on its own instead of as a group, since some
+//machines (virtual machines especially) are missing a few of them, and a group fails completely if any one of its counters can't be
+//opened. When there are more counters than the processor can count at once the kernel takes turns between them, so every count is
+//scaled up by how much of the time it was actually being counted
+//
+//Anywhere else, or when the kernel won't give out any counters at all, every counter just reads as unavailable and the benchmarks
+//carry on with only the times
+
+enum HARDWARE_COUNTERS {
+	COUNTER_CYCLES = 0,
+	COUNTER_INSTRUCTIONS = 1,
+	COUNTER_BRANCH_MISSES = 2,
+	//Reads that missed the level 1 data cache
+	COUNTER_L1_MISSES = 3,
+	//Reads that missed the last level cache, and had to go all the way to memory
+	COUNTER_LLC_MISSES = 4,
+};
+
+#define NUM_HARDWARE_COUNTERS 5
+
+//What a counter reads as when it couldn't be opened, or was never given any time to count
+#define COUNTER_UNAVAILABLE -1
+
+char* counter_names[] = { "cycles", "instructions", "branch-misses", "l1d-misses", "llc-misses" };
+
+typedef struct Counters {
+	//The file descriptor of each counter, or -1 if it couldn't be opened
+	int fds[NUM_HARDWARE_COUNTERS];
+	//How many of the counters could be opened
+	int available;
+	//Why the first counter that failed couldn't be opened
+	char error[128];
+} Counters;
+
+#ifdef __linux__
+int counters_open_one(struct perf_event_attr* attr) {
+	attr->size = sizeof(struct perf_event_attr);
+	attr->disabled = 1;
+	attr->exclude_kernel = 1;
+	attr->exclude_hv = 1;
+	attr->read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (int)syscall(SYS_perf_event_open, attr, 0, -1, -1, 0);
+}
+#endif
+
+//Opens every counter it can. Returns how many were opened
+int counters_open(Counters* counters) {
+	counters->available = 0;
+	counters->error[0] = '\0';
+	for (int i = 0; i < NUM_HARDWARE_COUNTERS; i++) {
+		counters->fds[i] = -1;
+	}
+
+#ifdef __linux__
+	for (int i = 0; i < NUM_HARDWARE_COUNTERS; i++) {
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+
+		switch (i) {
+		case COUNTER_CYCLES:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_CPU_CYCLES;
+			break;
+		case COUNTER_INSTRUCTIONS:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+			break;
+		case COUNTER_BRANCH_MISSES:
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+			break;
+		case COUNTER_L1_MISSES:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			break;
+		case COUNTER_LLC_MISSES:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			break;
+		}
+
+		counters->fds[i] = counters_open_one(&attr);
+		if (counters->fds[i] == -1) {
+			if (counters->error[0] == '\0') {
+				snprintf(counters->error, sizeof(counters->error), "%s: %s", counter_names[i], strerror(errno));
+			}
+		}
+		else {
+			counters->available++;
+		}
+	}
+#else
+	snprintf(counters->error, sizeof(counters->error), "hardware counters are only supported on Linux");
+#endif
+
+	return counters->available;
+}
+
+//Resets every counter to 0 and starts counting
+void counters_start(Counters* counters) {
+#ifdef __linux__
+	for (int i = 0; i < NUM_HARDWARE_COUNTERS; i++) {
+		if (counters->fds[i] != -1) {
+			ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+#endif
+}
+
+//Stops counting, and writes how much each counter counted since counters_start into values
+void counters_stop(Counters* counters, long long* values) {
+	for (int i = 0; i < NUM_HARDWARE_COUNTERS; i++) {
+		values[i] = COUNTER_UNAVAILABLE;
+	}
+
+#ifdef __linux__
+	for (int i = 0; i < NUM_HARDWARE_COUNTERS; i++) {
+		if (counters->fds[i] != -1) {
+			ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+		}
+	}
+
+	for (int i = 0; i < NUM_HARDWARE_COUNTERS; i++) {
+		//The count, followed by how long the counter was enabled and how long it was actually counting
+		unsigned long long data[3];
+		if (counters->fds[i] == -1 || read(counters->fds[i], data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+			continue;
+		}
+
+		if (data[2] < data[1]) {
+			values[i] = (long long)((double)data[0] * (double)data[1] / (double)data[2]);
+		}
+		else {
+			values[i] = (long long)data[0];
+		}
+	}
+#endif
+}
+
+void counters_close(Counters* counters) {
+#ifdef __linux__
+	for (int i = 0; i < NUM_HARDWARE_COUNTERS; i++) {
+		if (counters->fds[i] != -1) {
+			close(counters->fds[i]);
+		}
+	}
+#endif
+	for (int i = 0; i < NUM_HARDWARE_COUNTERS; i++) {
+		counters->fds[i] = -1;
+	}
+	counters->available = 0;
+}
+
+#endif
@@ -3,294 +3,695 @@
 
 #include "Parser.h"
 #include "Lexer.h"
+#include "Terminal.h"
 #include <math.h>
+#include <ctype.h>
+#include <stdarg.h>
 
 //This header file contains useful functions for debugging the compiler itself
+//
+//The navigators wait for a key with terminal_read_key, so they don't use any CPU while nothing is being pressed. Every key redraws
+//the screen as a single frame that is built up in a string and written out all at once, and a frame only ever has one page of
+//tokens or nodes on it, so moving around is just as fast in a file with millions of tokens as it is in a small one
+//
+//Searching the tokens goes through an index that is built once when the token navigator opens. It has a sorted list of the tokens
+//of every kind and of every identifier name, so finding the next match is a binary search instead of a walk over the whole list
+
+//How many rows of the screen the navigators use for things other than the page (titles, details, status lines, and the prompt)
+#define TOKEN_NAVIGATOR_CHROME 7
+#define AST_NAVIGATOR_CHROME 18
+//The fewest rows a page will have, even on a tiny screen
+#define NAVIGATOR_MIN_ROWS 3
+
+void frame_begin(string* frame) {
+	frame->len = 0;
+	if (frame->str != NULL) {
+		frame->str[0] = '\0';
+	}
+	//Clear the screen and set cursor position to home
+	string_concat(frame, &(string){.str = "\x1b[2J\x1b[0;0H", .len = 10, .__size = 11});
+}
 
-//This is to make the process of debugging the AST easier to see if it is working properly
-//This function assumes you are entering the root node of the AST
-int AST_navigator(tokenList* list, AST** ast) {
-	int shouldExit = false;
-	int layer = 0;
-	int node = 0;
+void frame_printf(string* frame, char* format, ...) {
+	char buffer[512];
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
 
-	//Clear the screen and set cursor position to home
-	printf("\x1b[2J\x1b[0;0H");
+	if (len >= (int)sizeof(buffer)) {
+		len = sizeof(buffer) - 1;
+	}
+	for (int i = 0; i < len; i++) {
+		string_append(frame, buffer[i]);
+	}
+}
 
-	printf("Current Node:\n");
-	AST_print(list, ast);
+void frame_flush(string* frame) {
+	fwrite(frame->str, sizeof(char), frame->len, stdout);
+	fflush(stdout);
+}
 
-	printf("\n\nLayer: %d | Column: %d\n", layer, (**ast).position);
+//Same as token_to_text, but with newlines and the rest of the control characters turned into spaces so that it fits on one row
+void debug_token_text(token tok, char* buffer, int size) {
+	int len = token_to_text(tok, buffer, size);
+	for (int i = 0; i < len; i++) {
+		if ((unsigned char)buffer[i] < 32) {
+			buffer[i] = ' ';
+		}
+	}
+}
 
-	while (!shouldExit) {
-		int errorMessage = 0;
-		if (GetAsyncKeyState(VK_ESCAPE) & 0x01) {
-			shouldExit = true;
-			continue;
+//Writes the same thing token_interpret_mdata prints into buffer
+void debug_token_mdata(token tok, char* buffer, int size) {
+	if (tok.type == IDENTIFIER) {
+		if (token_is_function(tok)) {
+			snprintf(buffer, size, "FUNCTION (RETURN TYPE: %s)", keywords[token_identifier_type(tok)].str);
+		}
+		else {
+			snprintf(buffer, size, "%s", keywords[tok.mdata].str);
 		}
+		return;
+	}
 
-		if (GetAsyncKeyState(VK_UP) & 0x01) {
-			//Clear the screen and set cursor position to home
-			printf("\x1b[2J\x1b[0;0H");
+	switch (tok.mdata) {
+	case (enum LITERAL)INT_LITERAL:
+		snprintf(buffer, size, "INT_LITERAL");
+		break;
+	case (enum LITERAL)FLOAT_LITERAL:
+		snprintf(buffer, size, "FLOAT_LITERAL");
+		break;
+	case (enum LITERAL)STRING_LITERAL:
+		snprintf(buffer, size, "STRING_LITERAL");
+		break;
+	default:
+		snprintf(buffer, size, "NONE");
+		break;
+	}
+}
 
-			if (!AST_ascend(ast)) {
-				errorMessage = 1;
-			}
-			else {
-				layer--;
-				node = (**ast).position;
+//Reads a line of text on the last row of the screen into buffer. Returns false if it was cancelled with escape
+int debug_prompt(char* label, char* buffer, int size) {
+	int len = 0;
+	buffer[0] = '\0';
 
-				if ((**ast).prevNode != NULL) {
-					printf("Parent Node:\n");
-					AST_print(list, (AST**)(&(**ast).prevNode));
-				}
+	while (true) {
+		printf("\r\x1b[K%s%s", label, buffer);
+		int key = terminal_read_key();
+		if (key == KEY_ENTER) {
+			return true;
+		}
+		else if (key == KEY_ESCAPE) {
+			return false;
+		}
+		else if (key == KEY_BACKSPACE) {
+			if (len > 0) {
+				len--;
+				buffer[len] = '\0';
 			}
+		}
+		else if (key >= 32 && key < 127 && len + 1 < size) {
+			buffer[len] = (char)key;
+			len++;
+			buffer[len] = '\0';
+		}
+	}
+}
 
-			//This is done for formatting purposes so that things look nice
-			if (layer != 0) {
-				printf("\n");
-			}
+//Returns the number in text, or -1 if it isn't a number
+int debug_parse_index(char* text) {
+	if (text[0] == '\0') {
+		return -1;
+	}
 
-			printf("Current Node:\n");
-			AST_print(list, ast);
+	long long num = 0;
+	for (int i = 0; text[i] != '\0'; i++) {
+		if (!isdigit((unsigned char)text[i]) || num > 2147483647) {
+			return -1;
+		}
+		num = num * 10 + text[i] - '0';
+	}
+	return num > 2147483647 ? -1 : (int)num;
+}
 
-			printf("\n\nLayer: %d | Column: %d\n", layer, node);
+typedef struct Token_Index_Name {
+	//The name of the first token with this name. It belongs to the token, so it isn't freed along with the index
+	string* name;
+	//Every token with this name, in order
+	Vector_Int tokens;
+} Token_Index_Name;
+
+typedef struct Token_Index {
+	//Every token of each kind, in order
+	Vector_Int kinds[NUM_TOKEN_TYPES];
+	Token_Index_Name* names;
+	int numNames;
+	//Open addressing hash table of the names, the same as Image_Table. Each slot holds an index into names plus one, so that 0
+	//means the slot is empty
+	int* slots;
+	int __size;
+} Token_Index;
+
+unsigned long long token_index_hash(char* str, int len) {
+	unsigned long long hash = 14695981039346656037ULL;
+	for (int i = 0; i < len; i++) {
+		hash ^= (unsigned char)str[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
 
-			if (errorMessage == 1) {
-				printf("\n\x1b[31mCannot Ascend any further; Root Node Reached\x1b[0m\n\n");
-			}
+//Returns the slot the name is in, or the empty slot it would go in if it isn't in the table
+int token_index_slot(Token_Index* index, char* str, int len) {
+	int slot = (int)(token_index_hash(str, len) & (index->__size - 1));
+	while (index->slots[slot] != 0) {
+		string* existing = index->names[index->slots[slot] - 1].name;
+		if (existing->len == len && memcmp(existing->str, str, len) == 0) {
+			break;
 		}
-		else if (GetAsyncKeyState(VK_DOWN) & 0x01) {
-			//Clear the screen and set cursor position to home
-			printf("\x1b[2J\x1b[0;0H");
+		slot = (slot + 1) & (index->__size - 1);
+	}
+	return slot;
+}
 
-			//For simplicity, this function will always descend down to the first node in the list
-			if (!AST_descend(ast, 0)) {
-				errorMessage = 1;
-			}
-			else {
-				layer++;
-				node = 0;
+void token_index_init(Token_Index* index, tokenList* list) {
+	for (int i = 0; i < NUM_TOKEN_TYPES; i++) {
+		Vector_Int_Init(&index->kinds[i]);
+	}
 
-				printf("Parent Node:\n");
-				AST_print(list, (AST**)(&(**ast).prevNode));
-			}
+	//There can't be more names than there are tokens with names, so the table is sized for that up front and never has to grow
+	int named = 0;
+	for (int i = 0; i < list->len; i++) {
+		if (list->tokens[i].type == IDENTIFIER || list->tokens[i].type == TYPE_UNDEFINED) {
+			named++;
+		}
+	}
 
-			//This is done for formatting purposes so that things look nice
-			if (layer != 0) {
-				printf("\n");
-			}
-			printf("Current Node:\n");
-			AST_print(list, ast);
+	index->__size = 16;
+	while (index->__size < named * 2) {
+		index->__size *= 2;
+	}
+	index->slots = (int*)mem_calloc(index->__size, sizeof(int));
+	index->names = (Token_Index_Name*)mem_alloc((named + 1) * sizeof(Token_Index_Name));
+	index->numNames = 0;
 
-			printf("\n\nLayer: %d | Column: %d\n", layer, (**ast).position);
+	if (index->slots == NULL || index->names == NULL) {
+		printf("Failed to allocate memory in token_index_init\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < list->len; i++) {
+		token tok = list->tokens[i];
+		if (tok.type >= 0 && tok.type < NUM_TOKEN_TYPES) {
+			Vector_Int_Append(&index->kinds[tok.type], i);
+		}
 
-			if (errorMessage == 1) {
-				printf("\n\x1b[31mCannot descend any further\x1b[0m\n\n");
+		if (tok.type == IDENTIFIER || tok.type == TYPE_UNDEFINED) {
+			string* name = (string*)tok.val;
+			int slot = token_index_slot(index, name->str, name->len);
+			if (index->slots[slot] == 0) {
+				index->names[index->numNames].name = name;
+				Vector_Int_Init(&index->names[index->numNames].tokens);
+				index->numNames++;
+				index->slots[slot] = index->numNames;
 			}
+			Vector_Int_Append(&index->names[index->slots[slot] - 1].tokens, i);
 		}
-		else if (GetAsyncKeyState(VK_LEFT) & 0x01) {
-			//Clear the screen and set cursor position to home
-			printf("\x1b[2J\x1b[0;0H");
+	}
+}
 
-			if ((AST*)((**ast).prevNode) != NULL) {
-				if ((**ast).position - 1 < 0) {
-					errorMessage = 1;
-				}
-				else {
-					node--;
-					//This looks complicated, but all it is doing is setting the current node to be equal to the next node in the list
-					//What complicates this process is that this list is stored in the previous node, so you have to get the node from the list
-					//in the previous node, and since void pointers had to be used that means anywhere a void pointer shows up it has to be cast
-					//to an AST pointer in order for the code to work correctly so the program knows how to retrieve the data from the AST
-					//structure properly
-					*ast = &(((AST*)(((AST*)(**ast).prevNode)->list.arr))[node]);
-				}
+void token_index_destroy(Token_Index* index) {
+	for (int i = 0; i < NUM_TOKEN_TYPES; i++) {
+		Vector_Int_Destroy(&index->kinds[i]);
+	}
+	for (int i = 0; i < index->numNames; i++) {
+		Vector_Int_Destroy(&index->names[i].tokens);
+	}
+	mem_free(index->names);
+	mem_free(index->slots);
+	index->names = NULL;
+	index->slots = NULL;
+	index->numNames = 0;
+}
 
-				printf("Parent Node:\n");
-				AST_print(list, (AST**)(&(**ast).prevNode));
+//Returns the tokens that match the search, or NULL if nothing does. A search that is the name of a kind of token (like identifier or
+//punctuator, in any case) finds every token of that kind, and anything else finds the identifiers with exactly that name
+Vector_Int* token_index_search(Token_Index* index, char* query) {
+	for (int i = 0; i < NUM_TOKEN_TYPES; i++) {
+		int j = 0;
+		while (query[j] != '\0' && token_type_names[i][j] != '\0' && toupper((unsigned char)query[j]) == token_type_names[i][j]) {
+			j++;
+		}
+		if (query[j] == '\0' && token_type_names[i][j] == '\0') {
+			return index->kinds[i].len > 0 ? &index->kinds[i] : NULL;
+		}
+	}
 
-				printf("\nCurrent Node:\n");
-				AST_print(list, ast);
+	int slot = token_index_slot(index, query, (int)strlen(query));
+	if (index->slots[slot] == 0) {
+		return NULL;
+	}
+	return &index->names[index->slots[slot] - 1].tokens;
+}
 
-				printf("\n\nLayer: %d | Column: %d\n", layer, (**ast).position);
+//Returns the position of the first match that is at least value, or matches->len if there isn't one
+int debug_lower_bound(Vector_Int* matches, int value) {
+	int low = 0;
+	int high = matches->len;
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (matches->vec[mid] < value) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return low;
+}
 
-				if (errorMessage == 1) {
-					printf("\n\x1b[31mCannot move left anymore; First node in list reached\x1b[0m\n\n");
-				}
-			}
-			else {
-				printf("Current Node:\n");
-				AST_print(list, ast);
+//The next match after index, going back around to the first one after the last
+int debug_next_match(Vector_Int* matches, int index) {
+	int pos = debug_lower_bound(matches, index + 1);
+	return matches->vec[pos == matches->len ? 0 : pos];
+}
 
-				printf("\n\nLayer: %d | Column: %d\n", layer, (**ast).position);
+int debug_previous_match(Vector_Int* matches, int index) {
+	int pos = debug_lower_bound(matches, index) - 1;
+	return matches->vec[pos < 0 ? matches->len - 1 : pos];
+}
 
-				printf("\n\x1b[31mCannot move left; This is the only node in the list\x1b[0m\n");
-			}
+void Token_navigator_render(string* frame, tokenList* list, int current, int top, int rows, Vector_Int* matches, char* query, char* message) {
+	char text[64];
+	char mdata[64];
+
+	frame_begin(frame);
+	frame_printf(frame, "-------------- Token Navigator --------------\n");
+	frame_printf(frame, "%10s  %-10s  %-32s  %s\n", "INDEX", "TYPE", "TOKEN", "MDATA");
+
+	for (int i = top; i < top + rows && i < list->len; i++) {
+		token tok = list->tokens[i];
+		debug_token_text(tok, text, sizeof(text));
+		debug_token_mdata(tok, mdata, sizeof(mdata));
+		frame_printf(frame, "%s%10d  %-10s  %-32.32s  %s%s\n", i == current ? "\x1b[7m" : "", i,
+			tok.type >= 0 && tok.type < NUM_TOKEN_TYPES ? token_type_names[tok.type] : "ERROR", text, mdata, i == current ? "\x1b[0m" : "");
+	}
+
+	frame_printf(frame, "\nIndex: %d of %d", current, list->len);
+	if (matches != NULL) {
+		int pos = debug_lower_bound(matches, current);
+		if (pos < matches->len && matches->vec[pos] == current) {
+			frame_printf(frame, " | %s: match %d of %d", query, pos + 1, matches->len);
+		}
+		else {
+			frame_printf(frame, " | %s: %d matches", query, matches->len);
 		}
-		else if (GetAsyncKeyState(VK_RIGHT) & 0x01) {
-			//Clear the screen and set cursor position to home
-			printf("\x1b[2J\x1b[0;0H");
+	}
+	frame_printf(frame, "\n");
 
-			if ((AST*)((**ast).prevNode) != NULL) {
-				if ((**ast).position + 1 >= ((AST*)((**ast).prevNode))->list.len) {
-					errorMessage = 1;
-				}
-				else {
-					node++;
-					*ast = &(((AST*)(((AST*)(**ast).prevNode)->list.arr))[node]);
-				}
+	if (message != NULL) {
+		frame_printf(frame, "\x1b[31m%s\x1b[0m\n", message);
+	}
+	else {
+		frame_printf(frame, "\n");
+	}
+	frame_printf(frame, "arrows, page up/down, home/end: move | g: go to index | /: search kind or name | n/p: next/previous match | esc: exit\n");
+	frame_flush(frame);
+}
+
+int Token_navigator(tokenList* list) {
+	if (list->len == 0) {
+		printf("\x1b[31mThe token list is empty\x1b[0m\n");
+		return 0;
+	}
 
-				printf("Parent Node:\n");
-				AST_print(list, (AST**)(&(**ast).prevNode));
+	terminal_begin();
 
-				printf("\nCurrent Node:\n");
-				AST_print(list, ast);
+	Token_Index index;
+	token_index_init(&index, list);
+	string frame;
+	string_init(&frame, NULL);
 
-				printf("\n\nLayer: %d | Column: %d\n", layer, (**ast).position);
+	int current = 0;
+	//The first token on the page
+	int top = 0;
+	Vector_Int* matches = NULL;
+	char query[64] = "";
+	char input[64];
+	char* message = NULL;
+	bool shouldContinue = true;
 
-				if (errorMessage == 1) {
-					printf("\n\x1b[31mCannot move right anymore; Last node in list reached\x1b[0m\n\n");
-				}
-			}
-			else {
+	while (shouldContinue) {
+		int rows = terminal_rows() - TOKEN_NAVIGATOR_CHROME;
+		if (rows < NAVIGATOR_MIN_ROWS) {
+			rows = NAVIGATOR_MIN_ROWS;
+		}
 
-				printf("Current Node:\n");
-				AST_print(list, ast);
+		//The page only moves when the current token goes off of it
+		if (current < top) {
+			top = current;
+		}
+		else if (current >= top + rows) {
+			top = current - rows + 1;
+		}
 
-				printf("\n\nLayer: %d | Column: %d\n", layer, (**ast).position);
+		Token_navigator_render(&frame, list, current, top, rows, matches, query, message);
+		message = NULL;
 
-				printf("\n\x1b[31mCannot move right; This is the only node in the list\x1b[0m\n\n");
+		int key = terminal_read_key();
+		switch (key) {
+		case KEY_ESCAPE:
+			shouldContinue = false;
+			break;
+		case KEY_RIGHT:
+		case KEY_DOWN:
+			if (current + 1 < list->len) {
+				current++;
 			}
+			else {
+				message = "You have reached the end of the token list";
+			}
+			break;
+		case KEY_LEFT:
+		case KEY_UP:
+			if (current - 1 >= 0) {
+				current--;
+			}
+			else {
+				message = "You are at the first element in the token list";
+			}
+			break;
+		case KEY_PAGE_DOWN:
+			current = current + rows < list->len ? current + rows : list->len - 1;
+			break;
+		case KEY_PAGE_UP:
+			current = current - rows >= 0 ? current - rows : 0;
+			break;
+		case KEY_HOME:
+			current = 0;
+			break;
+		case KEY_END:
+			current = list->len - 1;
+			break;
+		case 'g':
+			if (debug_prompt("Go to token index: ", input, sizeof(input))) {
+				int target = debug_parse_index(input);
+				if (target < 0 || target >= list->len) {
+					message = "That index is outside of the token list";
+				}
+				else {
+					current = target;
+				}
+			}
+			break;
+		case '/':
+			if (debug_prompt("Search for a token kind or identifier name: ", input, sizeof(input))) {
+				matches = token_index_search(&index, input);
+				if (matches == NULL) {
+					message = "Nothing matches that search";
+					query[0] = '\0';
+				}
+				else {
+					snprintf(query, sizeof(query), "%s", input);
+					//The search starts from the current token, so the current token counts if it matches
+					current = debug_next_match(matches, current - 1);
+				}
+			}
+			break;
+		case 'n':
+		case 'p':
+		case 'N':
+			if (matches == NULL) {
+				message = "Nothing has been searched for yet";
+			}
+			else {
+				current = key == 'n' ? debug_next_match(matches, current) : debug_previous_match(matches, current);
+			}
+			break;
 		}
 	}
 
+	string_destroy(&frame);
+	token_index_destroy(&index);
+	terminal_end();
 	return 0;
 }
 
-int Token_navigator(tokenList* list) {
-	int index = 0;
-	bool shouldContinue = true;
+//Writes a one line description of the node into buffer, for the rows of the page
+void debug_node_summary(tokenList* list, AST* node, char* buffer, int size) {
+	char text[64] = "-";
+	if (node->token_index >= 0 && node->token_index < list->len) {
+		debug_token_text(list->tokens[node->token_index], text, sizeof(text));
+	}
 
-	//Clear the screen and set cursor position to home
-	printf("\x1b[2J\x1b[0;0H");
+	snprintf(buffer, size, "%-20s  %-24.24s  %-10s  %d", node->type >= 0 && node->type < NUM_AST_TYPES ? AST_type_names[node->type] : "ERROR",
+		text, node->valueType != -1 ? keywords[node->valueType].str : "-", node->list.len);
+}
+
+//The same details AST_print prints, but into the frame
+void debug_node_details(string* frame, tokenList* list, AST* node) {
+	char text[64];
+	char mdata[64];
+	if (node->token_index >= 0 && node->token_index < list->len) {
+		token tok = list->tokens[node->token_index];
+		debug_token_text(tok, text, sizeof(text));
+		debug_token_mdata(tok, mdata, sizeof(mdata));
+		frame_printf(frame, "TYPE: %s\nTOKEN: %s\nMDATA: %s\n", tok.type >= 0 && tok.type < NUM_TOKEN_TYPES ? token_type_names[tok.type] : "ERROR",
+			text, mdata);
+	}
+	else {
+		frame_printf(frame, "TYPE: ERROR\nTOKEN: ERROR\nMDATA: NONE\n");
+	}
 
-	tokenList_print_individual(list->tokens[index]);
-	printf("\nIndex: %d\n\n", index);
+	frame_printf(frame, "UREL: %s\n", node->upRelation >= 0 && node->upRelation < NUM_UP_RELATIONS ? AST_relation_names[node->upRelation] : "ERROR");
+	frame_printf(frame, "AST TYPE: %s\n", node->type >= 0 && node->type < NUM_AST_TYPES ? AST_type_names[node->type] : "ERROR");
+	if (node->valueType != -1) {
+		frame_printf(frame, "VALUE TYPE: %s\n", keywords[node->valueType].str);
+	}
+	if (node->op > OP_NONE && node->op < NUM_AST_OPS) {
+		frame_printf(frame, "OP: %s\n", AST_op_names[node->op]);
+	}
+}
 
-	while (shouldContinue) {
-		if (GetAsyncKeyState(VK_ESCAPE) & 0x01) {
-			shouldContinue = false;
-			continue;
+void AST_navigator_render(string* frame, tokenList* list, AST* node, int top, int rows, char* message) {
+	char summary[128];
+	AST* parent = (AST*)node->prevNode;
+	//Without a parent the node is the only one in its list
+	AST* siblings = parent != NULL ? (AST*)parent->list.arr : node;
+	int count = parent != NULL ? parent->list.len : 1;
+
+	int layer = 0;
+	for (AST* above = parent; above != NULL; above = (AST*)above->prevNode) {
+		layer++;
+	}
+
+	frame_begin(frame);
+	frame_printf(frame, "--------------- AST Navigator ---------------\n");
+	if (parent != NULL) {
+		debug_node_summary(list, parent, summary, sizeof(summary));
+		frame_printf(frame, "Parent Node: %s\n", summary);
+	}
+	else {
+		frame_printf(frame, "Parent Node: none\n");
+	}
+	frame_printf(frame, "%10s  %-20s  %-24s  %-10s  %s\n", "COLUMN", "AST TYPE", "TOKEN", "VALUE TYPE", "CHILDREN");
+
+	for (int i = top; i < top + rows && i < count; i++) {
+		debug_node_summary(list, &siblings[i], summary, sizeof(summary));
+		frame_printf(frame, "%s%10d  %s%s\n", &siblings[i] == node ? "[7m" : "", i, summary, &siblings[i] == node ? "[0m" : "");
+	}
+
+	frame_printf(frame, "\nCurrent Node:\n");
+	debug_node_details(frame, list, node);
+	frame_printf(frame, "\nLayer: %d | Column: %d of %d | Children: %d\n", layer, node->position, count, node->list.len);
+
+	if (message != NULL) {
+		frame_printf(frame, "[31m%s[0m\n", message);
+	}
+	else {
+		frame_printf(frame, "\n");
+	}
+	frame_printf(frame, "up/down: parent/first child | left/right, page up/down, home/end: siblings | g: go to column | d: descend into child | esc: exit\n");
+	frame_flush(frame);
+}
+
+//This is to make the process of debugging the AST easier to see if it is working properly
+//This function assumes you are entering the root node of the AST. The node passed in isn't changed, so it is still the root after
+int AST_navigator(tokenList* list, AST** ast) {
+	terminal_begin();
+
+	string frame;
+	string_init(&frame, NULL);
+	char input[64];
+	char* message = NULL;
+	AST* node = *ast;
+	int top = 0;
+	bool shouldExit = false;
+
+	while (!shouldExit) {
+		int rows = terminal_rows() - AST_NAVIGATOR_CHROME;
+		if (rows < NAVIGATOR_MIN_ROWS) {
+			rows = NAVIGATOR_MIN_ROWS;
 		}
 
-		if (GetAsyncKeyState(VK_RIGHT) & 0x01) {
-			if (index + 1 < list->len) {
-				index++;
-				//Clear the screen and set cursor position to home
-				printf("\x1b[2J\x1b[0;0H");
-				tokenList_print_individual(list->tokens[index]);
-				printf("\nIndex: %d\n\n", index);
+		AST* parent = (AST*)node->prevNode;
+		AST* siblings = parent != NULL ? (AST*)parent->list.arr : NULL;
+		int count = parent != NULL ? parent->list.len : 1;
+		int column = parent != NULL ? node->position : 0;
+
+		if (column < top) {
+			top = column;
+		}
+		else if (column >= top + rows) {
+			top = column - rows + 1;
+		}
+
+		AST_navigator_render(&frame, list, node, top, rows, message);
+		message = NULL;
+
+		//The column to move to among the siblings, if the key moves sideways
+		int target = -1;
+		int key = terminal_read_key();
+		switch (key) {
+		case KEY_ESCAPE:
+			shouldExit = true;
+			break;
+		case KEY_UP:
+			if (parent == NULL) {
+				message = "Cannot Ascend any further; Root Node Reached";
 			}
 			else {
-				printf("\x1b[2J\x1b[0;0H");
-				tokenList_print_individual(list->tokens[index]);
-				printf("\nIndex: %d\n\n", index);
-				printf("\x1b[31mYou have reached the end of the token list\x1b[0m\n\n");
+				node = parent;
+				//The page of the new siblings gets worked out again from the top
+				top = 0;
 			}
-		}
-		else if (GetAsyncKeyState(VK_LEFT) & 0x01) {
-			if (index - 1 >= 0) {
-				index--;
-				//Clear the screen and set cursor position to home
-				printf("\x1b[2J\x1b[0;0H");
-				tokenList_print_individual(list->tokens[index]);
-				printf("\nIndex: %d\n\n", index);
+			break;
+		case KEY_DOWN:
+			//This always descends to the first node in the list, and d descends into any of the others
+			if (!AST_descend(&node, 0)) {
+				message = "Cannot descend any further";
 			}
 			else {
-				printf("\x1b[2J\x1b[0;0H");
-				tokenList_print_individual(list->tokens[index]);
-				printf("\nIndex: %d\n\n", index);
-				printf("\x1b[31mYou are at the first element in the token list\x1b[0m\n\n");
+				top = 0;
 			}
+			break;
+		case 'd':
+			if (debug_prompt("Descend into the child at column: ", input, sizeof(input))) {
+				int child = debug_parse_index(input);
+				if (child < 0 || !AST_descend(&node, child)) {
+					message = "The current node doesn't have a child at that column";
+				}
+				else {
+					top = 0;
+				}
+			}
+			break;
+		case KEY_LEFT:
+			if (count == 1) {
+				message = "Cannot move left; This is the only node in the list";
+			}
+			else if (column == 0) {
+				message = "Cannot move left anymore; First node in list reached";
+			}
+			else {
+				target = column - 1;
+			}
+			break;
+		case KEY_RIGHT:
+			if (count == 1) {
+				message = "Cannot move right; This is the only node in the list";
+			}
+			else if (column + 1 >= count) {
+				message = "Cannot move right anymore; Last node in list reached";
+			}
+			else {
+				target = column + 1;
+			}
+			break;
+		case KEY_PAGE_UP:
+			target = column - rows >= 0 ? column - rows : 0;
+			break;
+		case KEY_PAGE_DOWN:
+			target = column + rows < count ? column + rows : count - 1;
+			break;
+		case KEY_HOME:
+			target = 0;
+			break;
+		case KEY_END:
+			target = count - 1;
+			break;
+		case 'g':
+			if (debug_prompt("Go to the sibling at column: ", input, sizeof(input))) {
+				target = debug_parse_index(input);
+				if (target < 0 || target >= count) {
+					message = "There isn't a node at that column";
+					target = -1;
+				}
+			}
+			break;
+		}
+
+		if (target != -1 && siblings != NULL) {
+			node = &siblings[target];
 		}
 	}
 
+	string_destroy(&frame);
+	terminal_end();
 	return 0;
 }
 
 void Debug_navigator_options(int num) {
-	switch (num) {
-	case 0:
-		printf("-------------- Debug Navigator --------------\n");
-		printf("| Token Navigator  <---                     |\n");
-		printf("| AST Navigator                             |\n");
-		printf("| Exit Program                              |\n");
-		printf("---------------------------------------------\n");
-		break;
-	case 1:
-		printf("-------------- Debug Navigator --------------\n");
-		printf("| Token Navigator                           |\n");
-		printf("| AST Navigator    <---                     |\n");
-		printf("| Exit Program                              |\n");
-		printf("---------------------------------------------\n");
-		break;
-	case 2:
-		printf("-------------- Debug Navigator --------------\n");
-		printf("| Token Navigator                           |\n");
-		printf("| AST Navigator                             |\n");
-		printf("| Exit Program     <---                     |\n");
-		printf("---------------------------------------------\n");
+	char* options[] = { "Token Navigator", "AST Navigator", "Exit Program" };
+
+	string frame;
+	string_init(&frame, NULL);
+	frame_begin(&frame);
+	frame_printf(&frame, "-------------- Debug Navigator --------------\n");
+	for (int i = 0; i < 3; i++) {
+		frame_printf(&frame, "| %-16s %-24s |\n", options[i], i == num ? "<---" : "");
 	}
+	frame_printf(&frame, "---------------------------------------------\n");
+	frame_flush(&frame);
+	string_destroy(&frame);
 }
 
 int Debug_navigator(tokenList* list, AST** ast) {
-	printf("\x1b[2J\x1b[0;0H");
-	printf("-------------- Debug Navigator --------------\n");
-	printf("| Token Navigator  <---                     |\n");
-	printf("| AST Navigator                             |\n");
-	printf("| Exit Program                              |\n");
-	printf("---------------------------------------------\n");
+	terminal_begin();
+	Debug_navigator_options(0);
 
 	bool shouldContinue = true;
 	int index = 0;
 
 	while (shouldContinue) {
-		if (GetAsyncKeyState(VK_UP) & 0x01) {
-			printf("\x1b[2J\x1b[0;0H");
+		int key = terminal_read_key();
+		//Escape leaves the same way exit program does, which also covers stdin being closed
+		if (key == KEY_ESCAPE) {
+			shouldContinue = false;
+		}
+		else if (key == KEY_UP) {
 			index = index - 1;
 			if (index < 0) {
 				index = 2;
 			}
 			Debug_navigator_options(index);
 		}
-		else if (GetAsyncKeyState(VK_DOWN) & 0x01) {
-			printf("\x1b[2J\x1b[0;0H");
+		else if (key == KEY_DOWN) {
 			index = (index + 1) % 3;
 			Debug_navigator_options(index);
 		}
 
-		if (GetAsyncKeyState(VK_RETURN) & 0x01) {
+		if (key == KEY_ENTER) {
 			switch (index) {
 			case 0:
 				Token_navigator(list);
-				printf("\x1b[2J\x1b[0;0H");
-				printf("-------------- Debug Navigator --------------\n");
-				printf("| Token Navigator  <---                     |\n");
-				printf("| AST Navigator                             |\n");
-				printf("| Exit Program                              |\n");
-				printf("---------------------------------------------\n");
 				index = 0;
+				Debug_navigator_options(index);
 				break;
 			case 1:
 				AST_navigator(list, ast);
-				printf("\x1b[2J\x1b[0;0H");
-				printf("-------------- Debug Navigator --------------\n");
-				printf("| Token Navigator  <---                     |\n");
-				printf("| AST Navigator                             |\n");
-				printf("| Exit Program                              |\n");
-				printf("---------------------------------------------\n");
 				index = 0;
+				Debug_navigator_options(index);
 				break;
 			case 2:
 				shouldContinue = false;
@@ -298,7 +699,9 @@ int Debug_navigator(tokenList* list, AST** ast) {
 			}
 		}
 	}
-}
 
+	terminal_end();
+	return 0;
+}
 
 #endif
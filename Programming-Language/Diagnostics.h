@@ -0,0 +1,49 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "Strings.h"
+#include "Lexer.h"
+#include "Platform.h"
+
+//This header file contains the function the compiler passes use to report errors
+//
+//Normally errors are printed straight away, but when several threads are compiling at once their errors would get mixed
+//together in whatever order the threads happened to run in. Setting diagnostics_buffer makes the errors on the current thread
+//collect in that string instead, so they can be printed afterwards in a fixed order
+THREAD_LOCAL string* diagnostics_buffer = NULL;
+
+void diagnostics_printf(char* format, ...) {
+	char message[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+	if (diagnostics_buffer == NULL) {
+		printf("%s", message);
+		return;
+	}
+
+	string temp = { .str = message, .len = (int)strlen(message), .__size = (int)sizeof(message) };
+	if (diagnostics_buffer->str == NULL) {
+		//string_concat expects there to be a buffer it can grow, so an empty string needs a starting buffer
+		string_set(diagnostics_buffer, "");
+	}
+	string_concat(diagnostics_buffer, &temp);
+}
+
+//Reports an error at the given token, printing out the text of the token underneath the message
+void diagnostics_error(tokenList* list, char* kind, int token_index, char* message) {
+	char text[128];
+	diagnostics_printf("\x1b[31m%s error at token %d: %s\x1b[0m\n", kind, token_index, message);
+
+	if (token_index >= 0 && token_index < list->len) {
+		token_to_text(list->tokens[token_index], text, sizeof(text));
+		diagnostics_printf("TOKEN: %s\n", text);
+	}
+}
+
+#endif
@@ -0,0 +1,800 @@
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Platform.h"
+#include "Strings.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "TypeChecker.h"
+#include "Inliner.h"
+#include "Bytecode.h"
+#include "ParallelCompiler.h"
+#include "Module.h"
+#include "Cache.h"
+#include "Image.h"
+#include "VM.h"
+#include "VMProfile.h"
+#include "Tier.h"
+#include "PGO.h"
+#include "ThreadPool.h"
+#include "Arena.h"
+#include <stdbool.h>
+
+//This header file contains the batch driver, which compiles a whole list of files in one process
+//
+//Starting the compiler up once per file means paying for a new thread pool and a fresh heap every time, and for lots of small files
+//that ends up costing more than the compiling does. The driver keeps everything that doesn't depend on the file around between
+//files instead. The thread pool is made once, every worker keeps its arena (the blocks are reset and handed out again for the next
+//file instead of going back to the heap), and the cache, when there is one, stays open for the whole batch. The keyword and operator
+//tables of the lexer are plain globals, so they were always shared
+//
+//Files that import other files go through the module build in Module.h, on the same thread pool, and are run with a VM for each
+//module. Everything else is compiled straight into a single program with the parallel compiler
+//
+//The files can be given on the command line, or listed in a manifest with one path on each line. Blank lines and lines starting
+//with # are skipped, and relative paths in a manifest are relative to the directory the manifest is in
+//
+//With --vm-profile every program is run with the profiler in VMProfile.h and its flat profile is printed after it. A profiled file
+//is always compiled instead of loaded from the cache, since the profile needs the positions of the tokens and where each instruction
+//came from to add the counts up by line, and neither of those is kept in the cache
+//
+//With --tiered every program is run by the tiered runner in Tier.h instead of being compiled first, so functions are only parsed and
+//compiled once they are called. Nothing is compiled ahead of time, so there is nothing for the cache to load or store
+//
+//With --pgo-record every program that runs has its call counts added to its profile in the profile directory (see PGO.h), and with
+//--pgo-use the next build reads them back to decide what to inline, what order the code of the functions goes in, and which functions
+//the tiered runner compiles right away. Either way the file is compiled instead of loaded from the cache, since a cached program was
+//built without the profile. A profile is recorded from code that wasn't built with one, since inlining changes which calls are made
+//
+//With --emit-image every program that compiles is also written out as an image (see Image.h) named after its file, and with
+//--run-image the files are images like those, which are mapped in and run without being compiled at all
+
+//What happened to a file
+enum DRIVER_STATUS {
+	DRIVER_OK = 0,
+	//The file had errors in it
+	DRIVER_FAILED = 1,
+	//The file couldn't be opened
+	DRIVER_MISSING = 2,
+};
+
+char* driver_status_names[] = { "ok", "FAIL", "MISSING" };
+
+typedef struct Driver_Options {
+	//Runs every program that compiled after compiling it
+	int run;
+	//Only prints the files that didn't compile, along with the summary
+	int quiet;
+	int workers;
+	//The directory of the cache, or NULL to not use one
+	char* cacheDir;
+	//Profiles every program that runs, taking a sample every sampleUs microseconds if that isn't 0, and writes the stacks of all of
+	//them to the file at collapsedPath if that isn't NULL
+	int profile;
+	int sampleUs;
+	char* collapsedPath;
+	//Runs every program with the tiered runner, compiling a function once it has been called more than tierThreshold times
+	int tiered;
+	int tierThreshold;
+	//The directory to add the profile of every run to, and the directory to read the profiles used to build each file from
+	char* pgoRecordDir;
+	char* pgoUseDir;
+	//The heap limit of the collector of every program that runs, or 0 for the default, and whether to print what the collector did
+	long long heapLimit;
+	int gcStats;
+	//Whether the compiler runs the peephole optimizer over the bytecode
+	int peephole;
+	//The directory to write the image of every program that compiles to, or NULL to not write them
+	char* imageDir;
+	//Runs every file as an image instead of compiling it
+	int runImage;
+	//Prints every global variable of a program after running it
+	int printGlobals;
+} Driver_Options;
+
+typedef struct Driver_Stats {
+	int files;
+	int counts[3];
+	int errors;
+	int cacheHits;
+	int modules;
+	//How many files were built with a profile, and how many profiles were recorded
+	int profiled;
+	int recorded;
+	long long bytes;
+	long long tokens;
+	long long instructions;
+	long long ns;
+} Driver_Stats;
+
+typedef struct Driver {
+	Driver_Options options;
+	ThreadPool pool;
+	//One for every worker of the pool. Every program compiled by the driver borrows these
+	Arena* arenas;
+	Cache cache;
+	int cached;
+	Driver_Stats stats;
+	//Open while compiling when there is a collapsedPath
+	FILE* collapsed;
+} Driver;
+
+void driver_init(Driver* driver, Driver_Options* options) {
+	driver->options = *options;
+	memset(&driver->stats, 0, sizeof(Driver_Stats));
+	driver->collapsed = NULL;
+
+	threadpool_init(&driver->pool, options->workers);
+	driver->arenas = (Arena*)mem_alloc(driver->pool.numWorkers * sizeof(Arena));
+
+	if (driver->arenas == NULL) {
+		printf("Failed to allocate memory in driver_init\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < driver->pool.numWorkers; i++) {
+		arena_init(&driver->arenas[i]);
+	}
+
+	driver->cached = false;
+	if (options->cacheDir != NULL) {
+		driver->cached = cache_open(&driver->cache, options->cacheDir, 0);
+		if (!driver->cached) {
+			printf("Could not open the cache at %s, so everything will be compiled\n", options->cacheDir);
+			cache_close(&driver->cache);
+		}
+	}
+}
+
+void driver_destroy(Driver* driver) {
+	if (driver->cached) {
+		cache_close(&driver->cache);
+		driver->cached = false;
+	}
+
+	for (int i = 0; i < driver->pool.numWorkers; i++) {
+		arena_destroy(&driver->arenas[i]);
+	}
+	mem_free(driver->arenas);
+	driver->arenas = NULL;
+	threadpool_destroy(&driver->pool);
+}
+
+//Returns true if the file has an import statement in it. This has to be checked before parsing, since the parser doesn't know about
+//the functions of the imported files until the module build adds them
+int driver_has_imports(tokenList* list) {
+	for (int i = 0; i < list->len; i++) {
+		if (list->tokens[i].type == KEYWORD && list->tokens[i].val == KEYWORD_IMPORT) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//Adds the counts of a run to the profile of the file with the given key, and saves it
+void driver_record_profile(Driver* driver, unsigned long long key, VM_Profile* counts, Image* image) {
+	char path[PGO_MAX_PATH];
+	pgo_path(driver->options.pgoRecordDir, key, path, sizeof(path));
+
+	PGO_Profile profile;
+	pgo_init(&profile);
+	pgo_load(&profile, path);
+	pgo_record(&profile, counts, image);
+	if (pgo_save(&profile, path)) {
+		driver->stats.recorded++;
+	}
+	else {
+		printf("Could not write the profile %s\n", path);
+	}
+	pgo_destroy(&profile);
+}
+
+//Reads the profile of the file with the given key into an empty profile. Returns false if there isn't one
+int driver_load_profile(Driver* driver, unsigned long long key, PGO_Profile* profile) {
+	char path[PGO_MAX_PATH];
+	pgo_path(driver->options.pgoUseDir, key, path, sizeof(path));
+	return pgo_load(profile, path) && profile->runs > 0;
+}
+
+//Parses and checks every function body up front, so the inliner can see all of them, and then inlines with the profile. Returns the
+//number of errors found
+int driver_inline_profiled(tokenList* list, AST** ast, PGO_Profile* profile) {
+	int errors = parser_all_bodies(list, ast);
+	if (errors == 0) {
+		errors += typechecker(list, ast);
+	}
+	if (errors == 0) {
+		inliner_profiled(list, ast, profile);
+	}
+	return errors;
+}
+
+//Sets up a VM that is about to run a program the way the options say
+void driver_start_vm(Driver* driver, VM* vm) {
+	if (driver->options.heapLimit > 0) {
+		gc_set_heap_limit(&vm->gc, driver->options.heapLimit);
+	}
+}
+
+//Prints what the options ask for about a VM that has finished running a program, and adds its instructions to the stats
+void driver_finish_vm(Driver* driver, VM* vm) {
+	if (driver->options.printGlobals) {
+		vm_print_globals(vm);
+	}
+	if (driver->options.gcStats) {
+		gc_print_stats(&vm->gc);
+	}
+	driver->stats.instructions += vm->instructions;
+}
+
+//Runs a compiled program, and profiles it if the options say to. positions and source are only used by the profile, and key by
+//recording the profile. Returns false if it stopped with a runtime error
+int driver_run(Driver* driver, char* path, unsigned long long key, Program* program, tokenList* list, Vector_Int* positions,
+	string* source) {
+	Image image;
+	if (!image_from_program(&image, program, list)) {
+		return false;
+	}
+
+	VM vm;
+	vm_init(&vm, &image);
+	driver_start_vm(driver, &vm);
+	VM_Profile profile;
+	int counted = driver->options.profile || driver->options.pgoRecordDir != NULL;
+	if (counted) {
+		vm_profile_init(&profile, &image, driver->options.sampleUs);
+		vm.profile = &profile;
+		vm_profile_start(&profile);
+	}
+
+	int ok = vm_run(&vm);
+
+	if (counted) {
+		vm_profile_stop(&profile);
+		if (driver->options.profile) {
+			vm_profile_print(&profile, &image, path, program, list, positions, source);
+		}
+		if (driver->collapsed != NULL) {
+			vm_profile_write_collapsed(&profile, &image, path, driver->collapsed);
+		}
+		//A run that stopped part way through would make the code after where it stopped look like it never runs
+		if (ok && driver->options.pgoRecordDir != NULL) {
+			driver_record_profile(driver, key, &profile, &image);
+		}
+		vm_profile_destroy(&profile);
+	}
+	driver_finish_vm(driver, &vm);
+	vm_destroy(&vm);
+	image_close(&image);
+	return ok;
+}
+
+//Runs the image at path. Returns false if it couldn't be opened or stopped with a runtime error
+int driver_run_image(Driver* driver, char* path) {
+	Image image;
+	if (!image_open(&image, path)) {
+		printf("%s isn't an image, or it is damaged\n", path);
+		return false;
+	}
+
+	VM vm;
+	vm_init(&vm, &image);
+	driver_start_vm(driver, &vm);
+	int ok = vm_run(&vm);
+	driver_finish_vm(driver, &vm);
+	vm_destroy(&vm);
+	image_close(&image);
+	return ok;
+}
+
+//Writes the image of a compiled program into the image directory, named after the file it came from. Returns false if it couldn't
+//be written
+int driver_emit_image(Driver* driver, char* path, Program* program, tokenList* list) {
+	char* name = path;
+	for (char* c = path; *c != '\0'; c++) {
+		if (*c == '/' || *c == PATH_SEPARATOR) {
+			name = c + 1;
+		}
+	}
+
+	char out[CACHE_MAX_PATH];
+	snprintf(out, sizeof(out), "%s%c%s.img", driver->options.imageDir, PATH_SEPARATOR, name);
+	return image_write(program, list, out);
+}
+
+//Runs a file with the tiered runner, using the profile if it isn't NULL. Returns the number of errors found, counting a runtime error
+//as one
+int driver_run_tiered(Driver* driver, tokenList* list, PGO_Profile* profile) {
+	AST* ast;
+	AST_init(&ast);
+	int errors = parser(list, &ast);
+
+	if (errors == 0) {
+		Program program;
+		Tier tier;
+		if (!tier_init(&tier, list, &ast, &program, driver->options.tierThreshold)) {
+			errors++;
+		}
+		else {
+			if (profile != NULL) {
+				tier_use_profile(&tier, profile);
+			}
+			driver_start_vm(driver, &tier.vm);
+			if (!tier_run(&tier)) {
+				errors++;
+			}
+			if (!driver->options.quiet) {
+				tier_print_stats(&tier);
+			}
+			driver_finish_vm(driver, &tier.vm);
+			tier_destroy(&tier);
+			program_destroy(&program);
+		}
+	}
+
+	AST_destroy_children(ast);
+	mem_free(ast);
+	return errors;
+}
+
+//Compiles a file that imports other files with the module build. Sets tokens to how many tokens all of the modules had between them.
+//Returns the number of errors found
+int driver_build(Driver* driver, char* path, int* tokens) {
+	Build build;
+	build_init(&build, &driver->pool);
+	int errors = build_run(&build, path);
+
+	driver->stats.modules += build.len;
+	*tokens = 0;
+	for (int i = 0; i < build.len; i++) {
+		*tokens += build.modules[i].ownTokens != -1 ? build.modules[i].ownTokens : build.modules[i].tokens.len;
+	}
+
+	//Only the plain VM can run more than one module for now
+	if (errors == 0 && (driver->options.tiered || driver->options.profile || driver->options.pgoRecordDir != NULL
+		|| driver->options.imageDir != NULL)) {
+		printf("%s imports other files, which --tiered, the profiler, --pgo-record, and --emit-image can't be used with yet\n", path);
+		errors++;
+	}
+
+	if (errors == 0 && driver->options.run) {
+		Build_Link link;
+		if (!build_link(&link, &build)) {
+			errors++;
+		}
+		else {
+			for (int i = 0; i < link.len; i++) {
+				driver_start_vm(driver, &link.vms[i]);
+			}
+			if (!build_link_run(&link)) {
+				errors++;
+			}
+
+			//The globals and collector of the file itself are what gets printed, but every module ran instructions
+			driver_finish_vm(driver, &link.vms[0]);
+			for (int i = 1; i < link.len; i++) {
+				driver->stats.instructions += link.vms[i].instructions;
+			}
+		}
+		build_link_destroy(&link);
+	}
+
+	build_destroy(&build);
+	return errors;
+}
+
+//Writes the options that change what the compiler makes out of a file, which go into the key of the file in the cache. The profiles
+//aren't in here since a file built with a profile never goes through the cache
+void driver_cache_flags(Driver* driver, char* out, int size) {
+	snprintf(out, size, "peephole=%d", driver->options.peephole ? 1 : 0);
+}
+
+//Adds up how a file went and prints a line saying so. start is when the file was started on. Returns the status of the file
+int driver_finish_file(Driver* driver, char* path, long long start, int tokens, int errors, int hit) {
+	long long ns = platform_time_ns() - start;
+	driver->stats.ns += ns;
+	driver->stats.tokens += tokens;
+	driver->stats.errors += errors;
+
+	int status = errors == 0 ? DRIVER_OK : DRIVER_FAILED;
+	driver->stats.counts[status]++;
+
+	if (status != DRIVER_OK || !driver->options.quiet) {
+		printf("%-7s %s (%d tokens, %.2f ms%s", driver_status_names[status], path, tokens, ns / 1000000.0, hit ? ", cached" : "");
+		if (errors > 0) {
+			printf(", %d error%s", errors, errors == 1 ? "" : "s");
+		}
+		printf(")\n");
+	}
+	return status;
+}
+
+//Compiles (and maybe runs) a single file, and prints a line saying how it went
+int driver_compile_file(Driver* driver, char* path) {
+	long long start = platform_time_ns();
+	driver->stats.files++;
+
+	//string_load_file gives up on the whole process when a file can't be opened, which one missing file in a batch shouldn't do
+	FILE* fptr = fopen(path, "rb");
+	if (fptr == NULL) {
+		driver->stats.counts[DRIVER_MISSING]++;
+		printf("%-7s %s\n", driver_status_names[DRIVER_MISSING], path);
+		return DRIVER_MISSING;
+	}
+	fclose(fptr);
+
+	//An image has no source or tokens, it just gets run
+	if (driver->options.runImage) {
+		return driver_finish_file(driver, path, start, 0, driver_run_image(driver, path) ? 0 : 1, false);
+	}
+
+	string source;
+	string_init(&source, NULL);
+	string_load_file(path, &source);
+	driver->stats.bytes += source.len;
+
+	tokenList list;
+	tokenList_init(&list);
+	Vector_Int positions;
+	Vector_Int_Init(&positions);
+	Program program;
+	int errors = 0;
+	int hit = false;
+	int tokens = 0;
+	//The cache and the profiles both go by the source of the file, before the lexer has touched it. A profile belongs to the source
+	//no matter how it was built, so its name leaves the flags out
+	int pgo = driver->options.pgoRecordDir != NULL || driver->options.pgoUseDir != NULL;
+	unsigned long long key = pgo ? cache_key(&source, "").hash : 0;
+	char flags[64];
+	driver_cache_flags(driver, flags, sizeof(flags));
+	Cache_Key cacheKey = driver->cached ? cache_key(&source, flags) : (Cache_Key) { 0 };
+	bytecode_peephole_enabled = driver->options.peephole;
+
+	PGO_Profile profile;
+	pgo_init(&profile);
+	int profiled = driver->options.pgoUseDir != NULL && driver_load_profile(driver, key, &profile);
+	driver->stats.profiled += profiled;
+
+	if (driver->cached && !driver->options.profile && !driver->options.tiered && !pgo) {
+		hit = cache_load(&driver->cache, cacheKey, &list, &program);
+	}
+
+	if (hit) {
+		driver->stats.cacheHits++;
+		tokens = list.len;
+		if (driver->options.imageDir != NULL && !driver_emit_image(driver, path, &program, &list)) {
+			errors++;
+		}
+		if (errors == 0 && driver->options.run && !driver_run(driver, path, key, &program, &list, &positions, &source)) {
+			errors++;
+		}
+		program_destroy(&program);
+	}
+	else {
+		if (driver->options.profile) {
+			//The same as lexer, but keeping where every token is
+			lexer_normalize(&source);
+			lexer_scan(&list, &source, 0, source.len, &positions);
+			lexer_resolve(&list);
+		}
+		else {
+			lexer(&list, &source);
+		}
+		tokens = list.len;
+
+		if (driver_has_imports(&list)) {
+			//The module build lexes every file itself, including this one
+			errors += driver_build(driver, path, &tokens);
+		}
+		else if (driver->options.tiered) {
+			errors += driver_run_tiered(driver, &list, profiled ? &profile : NULL);
+		}
+		else {
+			AST* ast;
+			AST_init(&ast);
+			errors += parser(&list, &ast);
+			if (errors == 0 && profiled) {
+				errors += driver_inline_profiled(&list, &ast, &profile);
+			}
+
+			int compiled = errors == 0;
+			if (compiled) {
+				errors += compiler_parallel_arenas(&list, &ast, &program, &driver->pool, driver->arenas);
+				if (profiled) {
+					pgo_layout(&profile, &program, &list);
+				}
+
+				if (errors == 0 && driver->cached && !driver->options.profile && !pgo) {
+					cache_store(&driver->cache, cacheKey, &list, &program);
+				}
+				if (errors == 0 && driver->options.imageDir != NULL && !driver_emit_image(driver, path, &program, &list)) {
+					errors++;
+				}
+				if (errors == 0 && driver->options.run && !driver_run(driver, path, key, &program, &list, &positions, &source)) {
+					errors++;
+				}
+			}
+
+			//The nodes of the function bodies live in the arenas, so the tree has to go before the arenas are handed back
+			AST_destroy_children(ast);
+			mem_free(ast);
+			if (compiled) {
+				program.arenas = NULL;
+				program.numArenas = 0;
+				program_destroy(&program);
+			}
+		}
+	}
+
+	tokenList_destroy_all(&list);
+	Vector_Int_Destroy(&positions);
+	string_destroy(&source);
+	pgo_destroy(&profile);
+	return driver_finish_file(driver, path, start, tokens, errors, hit);
+}
+
+//Compiles every file listed in the manifest at path. Returns false if the manifest couldn't be opened
+int driver_compile_manifest(Driver* driver, char* path) {
+	FILE* fptr = fopen(path, "rb");
+	if (fptr == NULL) {
+		printf("Could not open the manifest %s\n", path);
+		return false;
+	}
+
+	//Everything up to and including the last separator in the path of the manifest
+	int dirLen = 0;
+	for (int i = 0; path[i] != '\0'; i++) {
+		if (path[i] == '/' || path[i] == PATH_SEPARATOR) {
+			dirLen = i + 1;
+		}
+	}
+
+	char line[MODULE_MAX_PATH];
+	char full[MODULE_MAX_PATH * 2];
+	while (fgets(line, sizeof(line), fptr) != NULL) {
+		int start = 0;
+		while (line[start] == ' ' || line[start] == '\t') {
+			start++;
+		}
+		int end = (int)strlen(line);
+		while (end > start && (line[end - 1] == '\n' || line[end - 1] == '\r' || line[end - 1] == ' ' || line[end - 1] == '\t')) {
+			end--;
+		}
+		line[end] = '\0';
+
+		if (end == start || line[start] == '#') {
+			continue;
+		}
+
+		char* entry = &line[start];
+		int absolute = entry[0] == '/' || entry[0] == PATH_SEPARATOR || (entry[0] != '\0' && entry[1] == ':');
+		if (absolute) {
+			snprintf(full, sizeof(full), "%s", entry);
+		}
+		else {
+			snprintf(full, sizeof(full), "%.*s%s", dirLen, path, entry);
+		}
+		driver_compile_file(driver, full);
+	}
+
+	fclose(fptr);
+	return true;
+}
+
+void driver_print_summary(Driver* driver) {
+	Driver_Stats* stats = &driver->stats;
+	double seconds = stats->ns / 1000000000.0;
+
+	printf("\nFiles: %d | ok: %d | failed: %d | missing: %d | errors: %d\n", stats->files, stats->counts[DRIVER_OK],
+		stats->counts[DRIVER_FAILED], stats->counts[DRIVER_MISSING], stats->errors);
+	if (stats->modules > 0) {
+		printf("Modules built for files with imports: %d\n", stats->modules);
+	}
+	printf("Bytes: %lld | tokens: %lld | time: %.2f ms | workers: %d\n", stats->bytes, stats->tokens, stats->ns / 1000000.0,
+		driver->pool.numWorkers);
+	if (seconds > 0) {
+		printf("Throughput: %.2f MB/s | %.0f tokens/s | %.1f files/s\n", stats->bytes / (1024.0 * 1024.0) / seconds,
+			stats->tokens / seconds, stats->files / seconds);
+	}
+	if (driver->options.run) {
+		printf("VM instructions: %lld\n", stats->instructions);
+	}
+	if (driver->options.pgoUseDir != NULL) {
+		printf("Files built with a profile: %d\n", stats->profiled);
+	}
+	if (driver->options.pgoRecordDir != NULL) {
+		printf("Profiles recorded: %d\n", stats->recorded);
+	}
+	if (driver->cached) {
+		cache_print_stats(&driver->cache);
+	}
+}
+
+void driver_usage() {
+	printf("Usage: --batch [options] [files...]\n");
+	printf("  --manifest <path>  Compile every file listed in the manifest (one per line, # starts a comment)\n");
+	printf("  --run              Run every program that compiles\n");
+	printf("  --cache <dir>      Load and store the compiled files in the cache in dir\n");
+	printf("  --workers <n>      How many threads to compile with (all of the cores by default)\n");
+	printf("  --quiet            Only print the files that didn't compile\n");
+	printf("  --vm-profile       Run every program with the profiler and print its flat profile\n");
+	printf("  --vm-sample <us>   Also take a sample of what is running every us microseconds of CPU time (not on Windows)\n");
+	printf("  --collapsed <path> Write the stacks of every profiled program to path, for flame graph tools\n");
+	printf("  --tiered           Run every program without compiling it first, compiling each function once it gets called enough\n");
+	printf("  --tier-threshold <n> How many calls a function runs without being compiled with --tiered (%d by default)\n",
+		TIER_DEFAULT_THRESHOLD);
+	printf("  --pgo-record <dir> Run every program and add its call counts to its profile in dir\n");
+	printf("  --pgo-use <dir>    Build every file with its profile in dir, if it has one\n");
+	printf("  --heap-limit <bytes> Collect all of the strings of a running program at once when it has more than this live (%d by default)\n",
+		GC_DEFAULT_HEAP_LIMIT);
+	printf("  --gc-stats         Print what the collector did after running every program\n");
+	printf("  --no-peephole      Compile without the peephole optimizer\n");
+	printf("  --emit-image <dir> Write the image of every program that compiles to dir (not with --tiered or imports)\n");
+	printf("  --run-image        Run every file as an image written by --emit-image, without compiling anything\n");
+	printf("  --print-globals    Print every global variable of a program after running it\n");
+}
+
+//Reads the options out of the arguments, so that they apply to every file no matter where they were given. Returns how many files and
+//manifests there are, or -1 if there is an option that isn't known
+int driver_parse_options(int argc, char** argv, Driver_Options* options) {
+	int numInputs = 0;
+	for (int i = 0; i < argc; i++) {
+		if (strcmp(argv[i], "--run") == 0) {
+			options->run = true;
+		}
+		else if (strcmp(argv[i], "--quiet") == 0) {
+			options->quiet = true;
+		}
+		else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+			options->workers = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+			options->cacheDir = argv[++i];
+		}
+		//Asking for any part of the profile means running with the profiler
+		else if (strcmp(argv[i], "--vm-profile") == 0) {
+			options->run = true;
+			options->profile = true;
+		}
+		else if (strcmp(argv[i], "--vm-sample") == 0 && i + 1 < argc) {
+			options->sampleUs = atoi(argv[++i]);
+			options->run = true;
+			options->profile = true;
+		}
+		else if (strcmp(argv[i], "--collapsed") == 0 && i + 1 < argc) {
+			options->collapsedPath = argv[++i];
+			options->run = true;
+			options->profile = true;
+		}
+		else if (strcmp(argv[i], "--tiered") == 0) {
+			options->tiered = true;
+			options->run = true;
+		}
+		else if (strcmp(argv[i], "--tier-threshold") == 0 && i + 1 < argc) {
+			options->tierThreshold = atoi(argv[++i]);
+			options->tiered = true;
+			options->run = true;
+		}
+		else if (strcmp(argv[i], "--pgo-record") == 0 && i + 1 < argc) {
+			options->pgoRecordDir = argv[++i];
+			options->run = true;
+		}
+		else if (strcmp(argv[i], "--pgo-use") == 0 && i + 1 < argc) {
+			options->pgoUseDir = argv[++i];
+		}
+		else if (strcmp(argv[i], "--heap-limit") == 0 && i + 1 < argc) {
+			options->heapLimit = atoll(argv[++i]);
+			options->run = true;
+		}
+		else if (strcmp(argv[i], "--gc-stats") == 0) {
+			options->gcStats = true;
+			options->run = true;
+		}
+		else if (strcmp(argv[i], "--no-peephole") == 0) {
+			options->peephole = false;
+		}
+		else if (strcmp(argv[i], "--emit-image") == 0 && i + 1 < argc) {
+			options->imageDir = argv[++i];
+		}
+		else if (strcmp(argv[i], "--run-image") == 0) {
+			options->runImage = true;
+			options->run = true;
+		}
+		else if (strcmp(argv[i], "--print-globals") == 0) {
+			options->printGlobals = true;
+			options->run = true;
+		}
+		else if (strcmp(argv[i], "--manifest") == 0 && i + 1 < argc) {
+			i++;
+			numInputs++;
+		}
+		else if (strncmp(argv[i], "--", 2) == 0) {
+			printf("Unknown option %s\n", argv[i]);
+			return -1;
+		}
+		else {
+			numInputs++;
+		}
+	}
+
+	//The profiler counts instructions by where they are in the code of the image, and the tiered runner gives the VM code of its own
+	if (options->tiered && options->profile) {
+		printf("--tiered can't be used with the profiler yet\n");
+		return -1;
+	}
+	if (options->pgoRecordDir != NULL && (options->tiered || options->pgoUseDir != NULL)) {
+		printf("--pgo-record has to be used on its own build, without --tiered or --pgo-use\n");
+		return -1;
+	}
+	//There is nothing to compile, profile, or write out when the files are already images
+	if (options->runImage && (options->tiered || options->profile || options->pgoRecordDir != NULL || options->imageDir != NULL)) {
+		printf("--run-image can't be used with --tiered, the profiler, --pgo-record, or --emit-image\n");
+		return -1;
+	}
+	return numInputs;
+}
+
+//Compiles every file and manifest in the arguments, then prints the summary. Returns 0 if every file compiled
+int driver_compile_args(Driver* driver, int argc, char** argv) {
+	int ok = true;
+	if (driver->options.collapsedPath != NULL) {
+		driver->collapsed = fopen(driver->options.collapsedPath, "wb");
+		if (driver->collapsed == NULL) {
+			printf("Could not open %s to write the stacks to\n", driver->options.collapsedPath);
+		}
+	}
+	if (driver->options.pgoRecordDir != NULL && !platform_make_directory(driver->options.pgoRecordDir)) {
+		printf("Could not create the profile directory %s\n", driver->options.pgoRecordDir);
+	}
+	if (driver->options.imageDir != NULL && !platform_make_directory(driver->options.imageDir)) {
+		printf("Could not create the image directory %s\n", driver->options.imageDir);
+	}
+
+	for (int i = 0; i < argc; i++) {
+		if (strcmp(argv[i], "--workers") == 0 || strcmp(argv[i], "--cache") == 0 || strcmp(argv[i], "--vm-sample") == 0 ||
+			strcmp(argv[i], "--collapsed") == 0 || strcmp(argv[i], "--tier-threshold") == 0 ||
+			strcmp(argv[i], "--pgo-record") == 0 || strcmp(argv[i], "--pgo-use") == 0 || strcmp(argv[i], "--heap-limit") == 0 ||
+			strcmp(argv[i], "--emit-image") == 0) {
+			i++;
+		}
+		else if (strcmp(argv[i], "--manifest") == 0) {
+			ok &= driver_compile_manifest(driver, argv[++i]);
+		}
+		else if (strncmp(argv[i], "--", 2) != 0) {
+			driver_compile_file(driver, argv[i]);
+		}
+	}
+
+	if (driver->collapsed != NULL) {
+		fclose(driver->collapsed);
+		driver->collapsed = NULL;
+	}
+
+	driver_print_summary(driver);
+	return !ok || driver->stats.counts[DRIVER_OK] != driver->stats.files ? 1 : 0;
+}
+
+//The entry point for --batch. Returns 0 if every file compiled
+int driver_main(int argc, char** argv) {
+	Driver_Options options = { .run = false, .quiet = false, .workers = 0, .cacheDir = NULL, .profile = false, .sampleUs = 0,
+		.collapsedPath = NULL, .tiered = false, .tierThreshold = TIER_DEFAULT_THRESHOLD, .pgoRecordDir = NULL, .pgoUseDir = NULL,
+		.heapLimit = 0, .gcStats = false, .peephole = true, .imageDir = NULL, .runImage = false, .printGlobals = false };
+	if (driver_parse_options(argc, argv, &options) <= 0) {
+		driver_usage();
+		return 1;
+	}
+
+	Driver driver;
+	driver_init(&driver, &options);
+	int result = driver_compile_args(&driver, argc, argv);
+	driver_destroy(&driver);
+
+	//Only prints anything in builds with MEMORY_TRACKING defined
+	memory_report(stdout);
+	return result;
+}
+
+#endif
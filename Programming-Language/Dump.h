@@ -0,0 +1,447 @@
+#ifndef DUMP_H
+#define DUMP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Strings.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Platform.h"
+#include <stdbool.h>
+
+//This header file contains the dumps of the token list and the AST, for diffing the output of the compiler between versions
+//
+//Everything is formatted by hand into one large buffer, and the buffer is written to a file descriptor whenever it fills up, so a
+//dump of millions of tokens is a handful of write calls instead of a few printf calls per token. The only thing that still goes
+//through snprintf is float literals, since getting those exactly the same as %lf by hand isn't worth it
+//
+//There are three formats:
+//	verbose - the same text tokenList_print and AST_print have always printed
+//	compact - one line per token or node, which is what should be diffed. Strings are quoted with their escapes written out so that
+//	          a string literal can't spill onto the next line
+//	binary  - fixed little endian records (described above dump_tokens and dump_ast) for tools that want to read the dump back in
+
+enum DUMP_FORMATS {
+	DUMP_VERBOSE = 0,
+	DUMP_COMPACT = 1,
+	DUMP_BINARY = 2,
+};
+
+#define NUM_DUMP_FORMATS 3
+
+char* dump_format_names[] = { "verbose", "compact", "binary" };
+
+#define DUMP_BUFFER_SIZE (1 << 20)
+//Bumped whenever the binary records change
+#define DUMP_VERSION 1
+
+typedef struct Dump {
+	char* buffer;
+	int len;
+	int fd;
+	//Set once a write fails, after which nothing else is written
+	int failed;
+} Dump;
+
+//Anything already printed to stdout is flushed first, so that a dump to stdout comes out after it instead of in the middle of it
+void dump_init(Dump* dump, int fd) {
+	fflush(stdout);
+	dump->buffer = (char*)mem_alloc(DUMP_BUFFER_SIZE);
+	dump->len = 0;
+	dump->fd = fd;
+	dump->failed = false;
+
+	if (dump->buffer == NULL) {
+		printf("Failed to allocate memory in dump_init\n");
+		exit(-1);
+	}
+}
+
+void dump_flush(Dump* dump) {
+	if (dump->len > 0 && !dump->failed && !platform_write(dump->fd, dump->buffer, dump->len)) {
+		dump->failed = true;
+	}
+	dump->len = 0;
+}
+
+//Writes out whatever is left and frees the buffer. Returns false if any of the writes failed
+int dump_destroy(Dump* dump) {
+	dump_flush(dump);
+	mem_free(dump->buffer);
+	dump->buffer = NULL;
+	return !dump->failed;
+}
+
+static inline void dump_reserve(Dump* dump, int len) {
+	if (dump->len + len > DUMP_BUFFER_SIZE) {
+		dump_flush(dump);
+	}
+}
+
+void dump_bytes(Dump* dump, void* data, long long len) {
+	//Anything too big to be worth copying goes straight out
+	if (len > DUMP_BUFFER_SIZE / 2) {
+		dump_flush(dump);
+		if (!dump->failed && !platform_write(dump->fd, data, len)) {
+			dump->failed = true;
+		}
+		return;
+	}
+
+	dump_reserve(dump, (int)len);
+	memcpy(dump->buffer + dump->len, data, len);
+	dump->len += (int)len;
+}
+
+static inline void dump_char(Dump* dump, char c) {
+	dump_reserve(dump, 1);
+	dump->buffer[dump->len++] = c;
+}
+
+void dump_text(Dump* dump, char* text) {
+	dump_bytes(dump, text, strlen(text));
+}
+
+void dump_int(Dump* dump, long long num) {
+	char digits[24];
+	int len = 0;
+	//Done as unsigned so that the smallest long long can be negated
+	unsigned long long value = num < 0 ? 0ULL - (unsigned long long)num : (unsigned long long)num;
+	do {
+		digits[len++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value > 0);
+
+	dump_reserve(dump, len + 1);
+	if (num < 0) {
+		dump->buffer[dump->len++] = '-';
+	}
+	while (len > 0) {
+		dump->buffer[dump->len++] = digits[--len];
+	}
+}
+
+void dump_float(Dump* dump, double num) {
+	char buffer[512];
+	int len = snprintf(buffer, sizeof(buffer), "%lf", num);
+	dump_bytes(dump, buffer, len < (int)sizeof(buffer) ? len : (int)sizeof(buffer) - 1);
+}
+
+void dump_u8(Dump* dump, unsigned char num) {
+	dump_char(dump, (char)num);
+}
+
+void dump_u32(Dump* dump, unsigned int num) {
+	dump_reserve(dump, 4);
+	for (int i = 0; i < 4; i++) {
+		dump->buffer[dump->len++] = (char)((num >> (i * 8)) & 0xFF);
+	}
+}
+
+void dump_u64(Dump* dump, unsigned long long num) {
+	dump_reserve(dump, 8);
+	for (int i = 0; i < 8; i++) {
+		dump->buffer[dump->len++] = (char)((num >> (i * 8)) & 0xFF);
+	}
+}
+
+//Writes the string between quotes, with backslashes, quotes and the control characters escaped
+void dump_quoted(Dump* dump, string* str) {
+	dump_char(dump, '"');
+	for (int i = 0; i < str->len; i++) {
+		char c = str->str[i];
+		switch (c) {
+		case '\n':
+			dump_bytes(dump, "\\n", 2);
+			break;
+		case '\t':
+			dump_bytes(dump, "\\t", 2);
+			break;
+		case '\\':
+			dump_bytes(dump, "\\\\", 2);
+			break;
+		case '"':
+			dump_bytes(dump, "\\\"", 2);
+			break;
+		default:
+			if ((unsigned char)c < 32) {
+				char hex[] = "0123456789abcdef";
+				char escape[4] = { '\\', 'x', hex[(c >> 4) & 0xF], hex[c & 0xF] };
+				dump_bytes(dump, escape, 4);
+			}
+			else {
+				dump_char(dump, c);
+			}
+			break;
+		}
+	}
+	dump_char(dump, '"');
+}
+
+//Returns true if the value of the token is a pointer to a string
+static inline int dump_token_has_string(token tok) {
+	return tok.type == IDENTIFIER || tok.type == TYPE_UNDEFINED || (tok.type == LITERAL && tok.mdata == STRING_LITERAL);
+}
+
+//The same text token_interpret_val prints. Strings are quoted in the compact format
+void dump_token_text(Dump* dump, token tok, int quote) {
+	string* str;
+	switch (tok.type) {
+	case (enum TYPE)OPERATOR:
+		dump_bytes(dump, operators[tok.val].str, operators[tok.val].len);
+		break;
+	case (enum TYPE)LITERAL:
+		if (tok.mdata == INT_LITERAL) {
+			dump_int(dump, tok.val);
+		}
+		else if (tok.mdata == FLOAT_LITERAL) {
+			//val holds the bits of the double
+			double num;
+			memcpy(&num, &tok.val, sizeof(double));
+			dump_float(dump, num);
+		}
+		else if (tok.mdata == STRING_LITERAL) {
+			str = (string*)tok.val;
+			if (quote) {
+				dump_quoted(dump, str);
+			}
+			else {
+				dump_bytes(dump, str->str, str->len);
+			}
+		}
+		break;
+	case (enum TYPE)KEYWORD:
+		dump_bytes(dump, keywords[tok.val].str, keywords[tok.val].len);
+		break;
+	case (enum TYPE)PUNCTUATOR:
+		dump_bytes(dump, punctuators[tok.val].str, punctuators[tok.val].len);
+		break;
+	case (enum TYPE)IDENTIFIER:
+	case (enum TYPE)TYPE_UNDEFINED:
+		str = (string*)tok.val;
+		dump_bytes(dump, str->str, str->len);
+		break;
+	default:
+		dump_text(dump, "ERROR");
+		break;
+	}
+}
+
+//The same text token_interpret_mdata prints
+void dump_token_mdata(Dump* dump, token tok) {
+	if (tok.type == IDENTIFIER) {
+		if (token_is_function(tok)) {
+			dump_text(dump, "FUNCTION (RETURN TYPE: ");
+			dump_text(dump, keywords[token_identifier_type(tok)].str);
+			dump_char(dump, ')');
+		}
+		else {
+			dump_text(dump, keywords[tok.mdata].str);
+		}
+		return;
+	}
+
+	switch (tok.mdata) {
+	case (enum LITERAL)INT_LITERAL:
+		dump_text(dump, "INT_LITERAL");
+		break;
+	case (enum LITERAL)FLOAT_LITERAL:
+		dump_text(dump, "FLOAT_LITERAL");
+		break;
+	case (enum LITERAL)STRING_LITERAL:
+		dump_text(dump, "STRING_LITERAL");
+		break;
+	default:
+		dump_text(dump, "NONE");
+		break;
+	}
+}
+
+static inline char* dump_token_type_name(token tok) {
+	return tok.type >= 0 && tok.type < NUM_TOKEN_TYPES ? token_type_names[tok.type] : "ERROR";
+}
+
+//The binary format starts with the bytes PLTK, the version and the number of tokens as 32 bit numbers, and then one record per
+//token: the type as a byte, the mdata as 32 bits, and then either the length of the string as 32 bits followed by its characters
+//(for identifiers, undefined tokens and string literals) or the 64 bit value
+void dump_tokens(Dump* dump, tokenList* list, int format) {
+	if (format == DUMP_BINARY) {
+		dump_bytes(dump, "PLTK", 4);
+		dump_u32(dump, DUMP_VERSION);
+		dump_u32(dump, list->len);
+	}
+
+	for (int i = 0; i < list->len; i++) {
+		token tok = list->tokens[i];
+		switch (format) {
+		case DUMP_VERBOSE:
+			dump_text(dump, "TYPE: ");
+			dump_text(dump, dump_token_type_name(tok));
+			dump_text(dump, "\nTOKEN: ");
+			dump_token_text(dump, tok, false);
+			dump_text(dump, "\nMDATA: ");
+			dump_token_mdata(dump, tok);
+			dump_bytes(dump, "\n\n", 2);
+			break;
+		case DUMP_COMPACT:
+			dump_int(dump, i);
+			dump_char(dump, ' ');
+			dump_text(dump, dump_token_type_name(tok));
+			dump_char(dump, ' ');
+			dump_token_text(dump, tok, true);
+			dump_char(dump, ' ');
+			dump_token_mdata(dump, tok);
+			dump_char(dump, '\n');
+			break;
+		case DUMP_BINARY:
+			dump_u8(dump, (unsigned char)tok.type);
+			dump_u32(dump, tok.mdata);
+			if (dump_token_has_string(tok)) {
+				string* str = (string*)tok.val;
+				dump_u32(dump, str->len);
+				dump_bytes(dump, str->str, str->len);
+			}
+			else {
+				dump_u64(dump, (unsigned long long)tok.val);
+			}
+			break;
+		}
+	}
+}
+
+typedef struct Dump_AST_Data {
+	Dump* dump;
+	tokenList* list;
+	int format;
+} Dump_AST_Data;
+
+int dump_ast_visit(AST_Visitor* visitor, AST* node) {
+	Dump_AST_Data* data = (Dump_AST_Data*)visitor->data;
+	Dump* dump = data->dump;
+	int hasToken = node->token_index >= 0 && node->token_index < data->list->len;
+	token tok = hasToken ? data->list->tokens[node->token_index] : (token){ 0 };
+	char* typeName = node->type >= 0 && node->type < NUM_AST_TYPES ? AST_type_names[node->type] : "ERROR";
+
+	switch (data->format) {
+	case DUMP_VERBOSE:
+		if (hasToken) {
+			dump_text(dump, "TYPE: ");
+			dump_text(dump, dump_token_type_name(tok));
+			dump_text(dump, "\nTOKEN: ");
+			dump_token_text(dump, tok, false);
+			dump_text(dump, "\nMDATA: ");
+			dump_token_mdata(dump, tok);
+			dump_char(dump, '\n');
+		}
+		else {
+			dump_text(dump, "TYPE: ERROR\nTOKEN: ERROR\nMDATA: NONE\n");
+		}
+		dump_text(dump, "UREL: ");
+		dump_text(dump, node->upRelation >= 0 && node->upRelation < NUM_UP_RELATIONS ? AST_relation_names[node->upRelation] : "ERROR");
+		dump_text(dump, "\nAST TYPE: ");
+		dump_text(dump, typeName);
+		dump_char(dump, '\n');
+		if (node->valueType != -1) {
+			dump_text(dump, "VALUE TYPE: ");
+			dump_text(dump, keywords[node->valueType].str);
+			dump_char(dump, '\n');
+		}
+		if (node->op > OP_NONE && node->op < NUM_AST_OPS) {
+			dump_text(dump, "OP: ");
+			dump_text(dump, AST_op_names[node->op]);
+			dump_char(dump, '\n');
+		}
+		dump_char(dump, '\n');
+		break;
+	case DUMP_COMPACT:
+		//Indented two spaces per level, so the shape of the tree shows in a diff
+		for (int i = 0; i < visitor->depth; i++) {
+			dump_bytes(dump, "  ", 2);
+		}
+		dump_text(dump, typeName);
+		if (hasToken) {
+			dump_char(dump, ' ');
+			dump_token_text(dump, tok, true);
+		}
+		if (node->valueType != -1) {
+			dump_text(dump, " : ");
+			dump_text(dump, keywords[node->valueType].str);
+		}
+		if (node->op > OP_NONE && node->op < NUM_AST_OPS) {
+			dump_text(dump, " [");
+			dump_text(dump, AST_op_names[node->op]);
+			dump_char(dump, ']');
+		}
+		dump_char(dump, '\n');
+		break;
+	case DUMP_BINARY:
+		dump_u8(dump, (unsigned char)node->type);
+		dump_u8(dump, (unsigned char)node->upRelation);
+		dump_u32(dump, (unsigned int)node->token_index);
+		dump_u32(dump, (unsigned int)node->valueType);
+		dump_u8(dump, (unsigned char)node->op);
+		dump_u32(dump, node->list.len);
+		break;
+	}
+	return VISIT_CONTINUE;
+}
+
+//The nodes are dumped in pre-order. The binary format starts with the bytes PLAS, the version and the number of nodes as 32 bit
+//numbers, and then one record per node: the type and relation as bytes, the token index and value type as 32 bits (-1 when there
+//isn't one), the op as a byte, and the number of children as 32 bits, which is all it takes to rebuild the shape of the tree
+void dump_ast(Dump* dump, tokenList* list, AST* ast, int format) {
+	if (format == DUMP_BINARY) {
+		dump_bytes(dump, "PLAS", 4);
+		dump_u32(dump, DUMP_VERSION);
+		dump_u32(dump, AST_count_nodes(ast));
+	}
+
+	Dump_AST_Data data = { .dump = dump, .list = list, .format = format };
+	AST_Visitor visitor;
+	AST_visitor_init(&visitor, dump_ast_visit, &data);
+	AST_visit(&visitor, ast, VISIT_PRE_ORDER);
+	AST_visitor_destroy(&visitor);
+}
+
+//Returns the format with the given name, or -1 if there isn't one
+int dump_find_format(char* name) {
+	for (int i = 0; i < NUM_DUMP_FORMATS; i++) {
+		if (strcmp(name, dump_format_names[i]) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+//Dumps the tokens (and the AST after them if ast isn't NULL) to the file at path, or to stdout if path is NULL. Returns false if the
+//file couldn't be written
+int dump_to_file(char* path, tokenList* list, AST* ast, int format) {
+	int fd = path == NULL ? 1 : platform_open_write(path);
+	if (fd == -1) {
+		printf("Failed to open %s for the dump\n", path);
+		return false;
+	}
+
+	Dump dump;
+	dump_init(&dump, fd);
+	dump_tokens(&dump, list, format);
+	if (ast != NULL) {
+		dump_ast(&dump, list, ast, format);
+	}
+	int result = dump_destroy(&dump);
+
+	if (path != NULL) {
+		platform_close(fd);
+	}
+	return result;
+}
+
+void tokenList_print(tokenList* list) {
+	Dump dump;
+	dump_init(&dump, 1);
+	dump_tokens(&dump, list, DUMP_VERBOSE);
+	dump_destroy(&dump);
+}
+
+#endif
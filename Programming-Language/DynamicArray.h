@@ -3,6 +3,8 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include "Profiler.h"
+#include "Memory.h"
 
 typedef struct Vector {
 	void* arr;
@@ -54,7 +56,8 @@ int vector_append(Vector* vec, void* val, double decimal_num) {
 	if (vec->len + 1 >= vec->__size) {
 		vec->__size *= 2;
 
-		void* test = (void*)realloc(vec->arr, vec->__size * vec->__element_size);
+		profile_alloc(vec->arr, vec->__size * vec->__element_size);
+		void* test = (void*)mem_realloc(vec->arr, vec->__size * vec->__element_size);
 
 		if (test == NULL) {
 			printf("Failed to allocate memory in vector_append function\n");
@@ -78,7 +81,7 @@ int vector_pop(Vector* vec) {
 			vec->__size = 1;
 		}
 
-		void* test = (void*)realloc(vec->arr, vec->__size * vec->__element_size);
+		void* test = (void*)mem_realloc(vec->arr, vec->__size * vec->__element_size);
 
 		if (test == NULL) {
 			printf("Failed to allocate memory for vector_pop function\n");
@@ -97,7 +100,7 @@ int vector_pop(Vector* vec) {
 //be pointed to by pointers in each individual element. An example where this would potentially come up is with
 //lists of lists
 int vector_destroy(Vector* vec) {
-	free(vec->arr);
+	mem_free(vec->arr);
 	vec->arr = NULL;
 	vec->len = 0;
 	vec->__size = 1;
@@ -0,0 +1,200 @@
+#ifndef FFI_H
+#define FFI_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Platform.h"
+#include "Strings.h"
+#include "Lexer.h"
+#include "Value.h"
+#include "GC.h"
+#include "Bytecode.h"
+#include <stdbool.h>
+
+//This header file contains the calls from a program into C functions declared with extern
+//
+//Calling a C function means putting the arguments where the C calling convention wants them, which depends on their types. Instead
+//of working that out on every call, there is a call stub for every signature an extern function can have, made by the macros below.
+//Each stub casts the address of the function to the right function pointer type, unboxes the arguments straight into the call, and
+//boxes what comes back, so the C compiler does all of the calling convention work ahead of time. The stub for a signature is picked
+//once when the function is first called, along with looking the function up in its library, and after that a call is just the stub
+//
+//An int is a C int, a float is a C double, and a string is a const char* that the C function must not keep or change. A string that
+//comes back is copied into a new string, since the VM has no idea who owns it
+
+//A call stub. fn is the address of the C function, and args are the parameters of the extern function, which are its locals
+typedef Value(*FFI_Stub)(GC* gc, void* fn, Value* args);
+
+//The C type, how to unbox an argument, and how to box the result for each of the types, named by their first letter
+#define FFI_TYPE_i int
+#define FFI_TYPE_f double
+#define FFI_TYPE_s const char*
+#define FFI_TYPE_v void
+
+#define FFI_ARG_i(val) value_as_int(val)
+#define FFI_ARG_f(val) value_as_float(val)
+#define FFI_ARG_s(val) ffi_string_arg(val)
+
+#define FFI_RETURN_i(call) return value_from_int(call)
+#define FFI_RETURN_f(call) return value_from_float(call)
+#define FFI_RETURN_s(call) return ffi_string_return(gc, call)
+#define FFI_RETURN_v(call) call; return VALUE_VOID
+
+static inline const char* ffi_string_arg(Value val) {
+	string* str = value_as_string(val);
+	return str->str != NULL ? str->str : "";
+}
+
+static inline Value ffi_string_return(GC* gc, const char* str) {
+	if (str == NULL) {
+		str = "";
+	}
+	return gc_string_new(gc, (char*)str, (int)strlen(str));
+}
+
+//Only the stubs returning a string use gc, and only the ones with parameters use args
+#define FFI_STUB0(r) \
+	static Value ffi_stub_##r(GC* gc, void* fn, Value* args) { \
+		(void)gc; \
+		(void)args; \
+		FFI_RETURN_##r(((FFI_TYPE_##r(*)(void))fn)()); \
+	}
+#define FFI_STUB1(r, a) \
+	static Value ffi_stub_##r##_##a(GC* gc, void* fn, Value* args) { \
+		(void)gc; \
+		FFI_RETURN_##r(((FFI_TYPE_##r(*)(FFI_TYPE_##a))fn)(FFI_ARG_##a(args[0]))); \
+	}
+#define FFI_STUB2(r, a, b) \
+	static Value ffi_stub_##r##_##a##b(GC* gc, void* fn, Value* args) { \
+		(void)gc; \
+		FFI_RETURN_##r(((FFI_TYPE_##r(*)(FFI_TYPE_##a, FFI_TYPE_##b))fn)(FFI_ARG_##a(args[0]), FFI_ARG_##b(args[1]))); \
+	}
+#define FFI_STUB3(r, a, b, c) \
+	static Value ffi_stub_##r##_##a##b##c(GC* gc, void* fn, Value* args) { \
+		(void)gc; \
+		FFI_RETURN_##r(((FFI_TYPE_##r(*)(FFI_TYPE_##a, FFI_TYPE_##b, FFI_TYPE_##c))fn)(FFI_ARG_##a(args[0]), FFI_ARG_##b(args[1]), \
+			FFI_ARG_##c(args[2]))); \
+	}
+
+//Every combination of parameters for one return type, with the first parameter changing the slowest. The table below has to list the
+//stubs in the same order
+#define FFI_STUBS1(r) FFI_STUB1(r, i) FFI_STUB1(r, f) FFI_STUB1(r, s)
+#define FFI_STUBS2_FROM(r, a) FFI_STUB2(r, a, i) FFI_STUB2(r, a, f) FFI_STUB2(r, a, s)
+#define FFI_STUBS2(r) FFI_STUBS2_FROM(r, i) FFI_STUBS2_FROM(r, f) FFI_STUBS2_FROM(r, s)
+#define FFI_STUBS3_FROM2(r, a, b) FFI_STUB3(r, a, b, i) FFI_STUB3(r, a, b, f) FFI_STUB3(r, a, b, s)
+#define FFI_STUBS3_FROM(r, a) FFI_STUBS3_FROM2(r, a, i) FFI_STUBS3_FROM2(r, a, f) FFI_STUBS3_FROM2(r, a, s)
+#define FFI_STUBS3(r) FFI_STUBS3_FROM(r, i) FFI_STUBS3_FROM(r, f) FFI_STUBS3_FROM(r, s)
+#define FFI_STUBS(r) FFI_STUB0(r) FFI_STUBS1(r) FFI_STUBS2(r) FFI_STUBS3(r)
+
+FFI_STUBS(i)
+FFI_STUBS(f)
+FFI_STUBS(s)
+FFI_STUBS(v)
+
+#define FFI_NAMES1(r) ffi_stub_##r##_i, ffi_stub_##r##_f, ffi_stub_##r##_s
+#define FFI_NAMES2_FROM(r, a) ffi_stub_##r##_##a##i, ffi_stub_##r##_##a##f, ffi_stub_##r##_##a##s
+#define FFI_NAMES2(r) FFI_NAMES2_FROM(r, i), FFI_NAMES2_FROM(r, f), FFI_NAMES2_FROM(r, s)
+#define FFI_NAMES3_FROM2(r, a, b) ffi_stub_##r##_##a##b##i, ffi_stub_##r##_##a##b##f, ffi_stub_##r##_##a##b##s
+#define FFI_NAMES3_FROM(r, a) FFI_NAMES3_FROM2(r, a, i), FFI_NAMES3_FROM2(r, a, f), FFI_NAMES3_FROM2(r, a, s)
+#define FFI_NAMES3(r) FFI_NAMES3_FROM(r, i), FFI_NAMES3_FROM(r, f), FFI_NAMES3_FROM(r, s)
+#define FFI_NAMES(r) ffi_stub_##r, FFI_NAMES1(r), FFI_NAMES2(r), FFI_NAMES3(r)
+
+//1 + 3 + 9 + 27 parameter lists for each return type
+#define FFI_NUM_STUBS 40
+
+//Indexed by the return type and then by the parameters (see ffi_stub). The rows are in the same order as the keywords list
+static const FFI_Stub ffi_stubs[4][FFI_NUM_STUBS] = {
+	{ FFI_NAMES(i) },
+	{ FFI_NAMES(f) },
+	{ FFI_NAMES(s) },
+	{ FFI_NAMES(v) },
+};
+
+//Where the stubs with each number of parameters start in a row of the table
+static const int ffi_stub_offsets[FOREIGN_MAX_PARAMS + 1] = { 0, 1, 4, 13 };
+
+//Returns the stub for a signature made by the compiler, or NULL if it isn't one an extern function can have
+FFI_Stub ffi_stub(int signature) {
+	int numParams = bytecode_signature_params(signature);
+	if (numParams > FOREIGN_MAX_PARAMS || (signature >> (4 + 2 * numParams)) != 0) {
+		return NULL;
+	}
+
+	//The types of the parameters are the digits of a base 3 number, since int, float, and string are the first three keywords
+	int index = 0;
+	for (int i = 0; i < numParams; i++) {
+		int type = bytecode_signature_param(signature, i);
+		if (type == KEYWORD_VOID) {
+			return NULL;
+		}
+		index = index * 3 + type;
+	}
+	return ffi_stubs[bytecode_signature_return(signature)][ffi_stub_offsets[numParams] + index];
+}
+
+//The libraries a program has opened, so each one is only opened once no matter how many extern functions come from it
+typedef struct FFI_Libraries {
+	//The path each library was opened with, which is empty for the C standard library
+	char** names;
+	void** handles;
+	int len;
+	int __size;
+} FFI_Libraries;
+
+void ffi_libraries_init(FFI_Libraries* libs) {
+	libs->names = NULL;
+	libs->handles = NULL;
+	libs->len = 0;
+	libs->__size = 0;
+}
+
+//Returns the handle of the library at path, opening it if this is the first time it was asked for. An empty path means the C standard
+//library. Returns NULL if the library couldn't be opened
+void* ffi_open(FFI_Libraries* libs, string* path) {
+	for (int i = 0; i < libs->len; i++) {
+		if (strcmp(libs->names[i], path->str) == 0) {
+			return libs->handles[i];
+		}
+	}
+
+	void* handle = platform_open_library(path->len == 0 ? NULL : path->str);
+	if (handle == NULL) {
+		return NULL;
+	}
+
+	if (libs->len >= libs->__size) {
+		libs->__size = libs->__size == 0 ? 4 : libs->__size * 2;
+		libs->names = (char**)mem_realloc(libs->names, libs->__size * sizeof(char*));
+		libs->handles = (void**)mem_realloc(libs->handles, libs->__size * sizeof(void*));
+
+		if (libs->names == NULL || libs->handles == NULL) {
+			printf("Failed to allocate memory in ffi_open\n");
+			exit(-1);
+		}
+	}
+
+	char* name = (char*)mem_alloc((path->len + 1) * sizeof(char));
+	if (name == NULL) {
+		printf("Failed to allocate memory in ffi_open\n");
+		exit(-1);
+	}
+	memcpy(name, path->str, (path->len + 1) * sizeof(char));
+
+	libs->names[libs->len] = name;
+	libs->handles[libs->len] = handle;
+	libs->len++;
+	return handle;
+}
+
+void ffi_libraries_destroy(FFI_Libraries* libs) {
+	for (int i = 0; i < libs->len; i++) {
+		platform_close_library(libs->handles[i]);
+		mem_free(libs->names[i]);
+	}
+	mem_free(libs->names);
+	mem_free(libs->handles);
+	ffi_libraries_init(libs);
+}
+
+#endif
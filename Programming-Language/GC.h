@@ -0,0 +1,342 @@
+#ifndef GC_H
+#define GC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Strings.h"
+#include "Value.h"
+#include <stdbool.h>
+
+//This header file contains the garbage collector for string values created while a program is running
+//
+//The collector is an incremental mark and sweep collector. Instead of stopping the program for a whole collection, every
+//allocation does a small, bounded amount of marking or sweeping, so no single pause grows with the size of the heap
+//
+//Strings don't point to anything, so marking only has to go over the roots (the stack of whatever is running the program).
+//Because the program keeps running while the roots are being marked, any string value stored into a root while the collector
+//is marking has to be passed to gc_write_barrier, otherwise it could be stored into a root that was already scanned and get
+//freed while still in use. Strings allocated during a collection are allocated already marked so they always survive it
+//
+//Every string value handed to the collector must have been created by one of the gc_string functions, since the collector
+//keeps its bookkeeping right next to the string. String literals owned by the token list should be brought in with
+//gc_string_literal, which pins the copy so it is never freed
+
+//How many roots or objects a single step of the collector looks at before letting the program continue
+#define GC_STEP_WORK 256
+//Once a collection finishes, the next one starts when the heap has grown to this many times the size of what survived
+#define GC_GROWTH_FACTOR 2
+//The heap is never allowed to trigger a collection below this many bytes, so small programs never have to collect at all
+#define GC_MIN_THRESHOLD (1024 * 1024)
+//The default for the hard limit. Going over it finishes the current collection and runs a full one right away. If more than the limit
+//is still in use after that, the limit is raised to this many times what survived, the same way the threshold is, so a program that
+//really needs that much doesn't pay for a full collection on every allocation
+#define GC_DEFAULT_HEAP_LIMIT (64 * 1024 * 1024)
+
+enum GC_PHASES {
+	GC_IDLE = 0,
+	GC_MARK = 1,
+	GC_SWEEP = 2,
+};
+
+typedef struct GC_String {
+	//This must be the first member so that a pointer to the string in a value is also a pointer to the whole object
+	string str;
+	void* next;
+	//Compared against the mark of the collector. Which value means marked flips every collection so that nothing ever has to
+	//go back and clear the marks
+	unsigned char mark;
+	unsigned char pinned;
+} GC_String;
+
+typedef struct GC_Roots {
+	//These point at the array and length of whoever owns the roots, since the array can be reallocated as it grows
+	Value** arr;
+	int* len;
+} GC_Roots;
+
+typedef struct GC_Stats {
+	long long bytesLive;
+	long long bytesPeak;
+	long long bytesTotal;
+	long long numAllocations;
+	long long numFreed;
+	long long numCollections;
+	//How many of the collections were full ones forced by going over the heap limit
+	long long numForced;
+	long long numSteps;
+	long long pauseTotal;
+	//The longest any single step took, in nanoseconds
+	long long pauseMax;
+} GC_Stats;
+
+typedef struct GC {
+	GC_String* objects;
+	GC_Roots* roots;
+	int numRoots;
+	int __rootsSize;
+	int phase;
+	unsigned char mark;
+	//Where marking left off: the index of the root range, and the index inside of it
+	int markRoot;
+	int markIndex;
+	//Where sweeping left off, which is the next pointer that points to the object to look at next
+	GC_String** sweep;
+	long long threshold;
+	long long heapLimit;
+	//The limit that is actually checked, which is the heap limit unless more than that survived the last collection
+	long long limit;
+	GC_Stats stats;
+} GC;
+
+long long gc_time_ns() {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void gc_init(GC* gc) {
+	gc->objects = NULL;
+	gc->roots = NULL;
+	gc->numRoots = 0;
+	gc->__rootsSize = 1;
+	gc->phase = GC_IDLE;
+	gc->mark = 0;
+	gc->markRoot = 0;
+	gc->markIndex = 0;
+	gc->sweep = NULL;
+	gc->threshold = GC_MIN_THRESHOLD;
+	gc->heapLimit = GC_DEFAULT_HEAP_LIMIT;
+	gc->limit = GC_DEFAULT_HEAP_LIMIT;
+	memset(&gc->stats, 0, sizeof(GC_Stats));
+}
+
+void gc_set_heap_limit(GC* gc, long long bytes) {
+	gc->heapLimit = bytes;
+	gc->limit = bytes;
+}
+
+//Registers a range of values that the collector should treat as roots
+void gc_add_roots(GC* gc, Value** arr, int* len) {
+	if (gc->numRoots + 1 >= gc->__rootsSize) {
+		gc->__rootsSize *= 2;
+
+		GC_Roots* test = (GC_Roots*)mem_realloc(gc->roots, gc->__rootsSize * sizeof(GC_Roots));
+
+		if (test == NULL) {
+			printf("Failed to allocate memory in gc_add_roots\n");
+			exit(-1);
+		}
+
+		gc->roots = test;
+	}
+
+	gc->roots[gc->numRoots] = (GC_Roots){ .arr = arr, .len = len };
+	gc->numRoots++;
+}
+
+long long gc_object_size(GC_String* obj) {
+	return sizeof(GC_String) + obj->str.__size;
+}
+
+static inline void gc_mark_value(GC* gc, Value val) {
+	if (value_is_string(val)) {
+		((GC_String*)value_as_string(val))->mark = gc->mark;
+	}
+}
+
+static inline void gc_write_barrier(GC* gc, Value val) {
+	if (gc->phase == GC_MARK) {
+		gc_mark_value(gc, val);
+	}
+}
+
+void gc_begin_cycle(GC* gc) {
+	//Flipping the mark makes every existing object unmarked without having to touch any of them
+	gc->mark = !gc->mark;
+	gc->phase = GC_MARK;
+	gc->markRoot = 0;
+	gc->markIndex = 0;
+}
+
+//Does up to work units of marking or sweeping. Returns true when there is nothing left to do in the current collection
+int gc_step(GC* gc, int work) {
+	long long start = gc_time_ns();
+
+	while (work > 0 && gc->phase == GC_MARK) {
+		if (gc->markRoot >= gc->numRoots) {
+			gc->phase = GC_SWEEP;
+			gc->sweep = &gc->objects;
+			break;
+		}
+
+		GC_Roots* range = &gc->roots[gc->markRoot];
+		if (gc->markIndex >= *range->len) {
+			gc->markRoot++;
+			gc->markIndex = 0;
+			continue;
+		}
+
+		gc_mark_value(gc, (*range->arr)[gc->markIndex]);
+		gc->markIndex++;
+		work--;
+	}
+
+	while (work > 0 && gc->phase == GC_SWEEP) {
+		GC_String* obj = *gc->sweep;
+		if (obj == NULL) {
+			gc->phase = GC_IDLE;
+			gc->stats.numCollections++;
+
+			gc->threshold = gc->stats.bytesLive * GC_GROWTH_FACTOR;
+			if (gc->threshold < GC_MIN_THRESHOLD) {
+				gc->threshold = GC_MIN_THRESHOLD;
+			}
+			gc->limit = gc->stats.bytesLive > gc->heapLimit ? gc->stats.bytesLive * GC_GROWTH_FACTOR : gc->heapLimit;
+			break;
+		}
+
+		if (obj->mark != gc->mark && !obj->pinned) {
+			*gc->sweep = (GC_String*)obj->next;
+			gc->stats.bytesLive -= gc_object_size(obj);
+			gc->stats.numFreed++;
+			mem_free(obj->str.str);
+			mem_free(obj);
+		}
+		else {
+			gc->sweep = (GC_String**)&obj->next;
+		}
+		work--;
+	}
+
+	long long pause = gc_time_ns() - start;
+	gc->stats.numSteps++;
+	gc->stats.pauseTotal += pause;
+	if (pause > gc->stats.pauseMax) {
+		gc->stats.pauseMax = pause;
+	}
+
+	return gc->phase == GC_IDLE;
+}
+
+//Finishes the current collection (if there is one) and then runs a whole collection without stopping
+void gc_collect(GC* gc) {
+	while (gc->phase != GC_IDLE) {
+		gc_step(gc, GC_STEP_WORK);
+	}
+
+	gc_begin_cycle(gc);
+	while (gc->phase != GC_IDLE) {
+		gc_step(gc, GC_STEP_WORK);
+	}
+}
+
+//Takes ownership of a buffer of len characters allocated with malloc (with room for the null terminator) and returns a string value
+Value gc_string_take(GC* gc, char* buffer, int len) {
+	if (gc->stats.bytesLive > gc->limit) {
+		gc->stats.numForced++;
+		gc_collect(gc);
+	}
+	else if (gc->phase != GC_IDLE) {
+		gc_step(gc, GC_STEP_WORK);
+	}
+	else if (gc->stats.bytesLive > gc->threshold) {
+		gc_begin_cycle(gc);
+		gc_step(gc, GC_STEP_WORK);
+	}
+
+	GC_String* obj = (GC_String*)mem_alloc(sizeof(GC_String));
+
+	if (obj == NULL) {
+		printf("Failed to allocate memory in gc_string_take\n");
+		exit(-1);
+	}
+
+	obj->str.str = buffer;
+	obj->str.len = len;
+	obj->str.__size = len + 1;
+	obj->str.str[len] = '\0';
+	obj->pinned = false;
+	//Anything allocated in the middle of a collection is treated as already marked. When the collector is idle this is the
+	//same mark everything else has, and the flip at the start of the next collection unmarks it
+	obj->mark = gc->mark;
+	obj->next = gc->objects;
+	gc->objects = obj;
+
+	gc->stats.bytesLive += gc_object_size(obj);
+	gc->stats.bytesTotal += gc_object_size(obj);
+	gc->stats.numAllocations++;
+	if (gc->stats.bytesLive > gc->stats.bytesPeak) {
+		gc->stats.bytesPeak = gc->stats.bytesLive;
+	}
+
+	return value_from_string(&obj->str);
+}
+
+Value gc_string_new(GC* gc, char* str, int len) {
+	char* buffer = (char*)mem_alloc((len + 1) * sizeof(char));
+
+	if (buffer == NULL) {
+		printf("Failed to allocate memory in gc_string_new\n");
+		exit(-1);
+	}
+
+	memcpy(buffer, str, len * sizeof(char));
+	return gc_string_take(gc, buffer, len);
+}
+
+//Copies a string that is owned by something else (like a string literal token) into a pinned string that is never collected
+Value gc_string_literal(GC* gc, string* str) {
+	Value val = gc_string_new(gc, str->str != NULL ? str->str : "", str->len);
+	((GC_String*)value_as_string(val))->pinned = true;
+	return val;
+}
+
+Value gc_string_concat(GC* gc, Value a, Value b) {
+	string* first = value_as_string(a);
+	string* second = value_as_string(b);
+	char* buffer = (char*)mem_alloc((first->len + second->len + 1) * sizeof(char));
+
+	if (buffer == NULL) {
+		printf("Failed to allocate memory in gc_string_concat\n");
+		exit(-1);
+	}
+
+	memcpy(buffer, first->str, first->len * sizeof(char));
+	memcpy(buffer + first->len, second->str, second->len * sizeof(char));
+	return gc_string_take(gc, buffer, first->len + second->len);
+}
+
+void gc_print_stats(GC* gc) {
+	printf("GC live bytes: %lld\n", gc->stats.bytesLive);
+	printf("GC peak bytes: %lld\n", gc->stats.bytesPeak);
+	printf("GC total bytes allocated: %lld\n", gc->stats.bytesTotal);
+	printf("GC allocations: %lld | freed: %lld\n", gc->stats.numAllocations, gc->stats.numFreed);
+	printf("GC collections: %lld | forced by the heap limit: %lld | steps: %lld\n", gc->stats.numCollections, gc->stats.numForced,
+		gc->stats.numSteps);
+	if (gc->limit > gc->heapLimit) {
+		printf("GC heap is over its limit of %lld bytes, which was raised to %lld bytes\n", gc->heapLimit, gc->limit);
+	}
+	printf("GC total pause: %lld ns | max pause: %lld ns\n", gc->stats.pauseTotal, gc->stats.pauseMax);
+}
+
+//Frees every string the collector owns, including pinned ones
+void gc_destroy(GC* gc) {
+	GC_String* obj = gc->objects;
+	while (obj != NULL) {
+		GC_String* next = (GC_String*)obj->next;
+		mem_free(obj->str.str);
+		mem_free(obj);
+		obj = next;
+	}
+
+	mem_free(gc->roots);
+	gc->objects = NULL;
+	gc->roots = NULL;
+	gc->numRoots = 0;
+	gc->__rootsSize = 1;
+	gc->phase = GC_IDLE;
+}
+
+#endif
@@ -0,0 +1,568 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Platform.h"
+#include "Strings.h"
+#include "Lexer.h"
+#include "Value.h"
+#include "Bytecode.h"
+#include <stdbool.h>
+
+//This header file contains the precompiled image format, which is a whole compiled program in a single file that can be run
+//without the lexer, the parser, or the compiler
+//
+//Everything in an image is found through offsets from the start of the file instead of pointers, so the file can be mapped
+//straight into memory and used as is, with no parsing and nothing to fix up. Only the header is read when an image is opened, and
+//the code and constants of a function aren't touched until the function is first called, so the operating system only ever reads
+//in the parts of the file that are actually used
+//
+//Layout of an image (every section starts on an 8 byte boundary):
+//  Image_Header
+//  Image_Function[numFunctions]    function 0 is the top level statements, like in a Program
+//  Value[numConstants]             one constant pool shared by every function, with duplicates merged
+//  int[codeLen]                    the bytecode of every function, one after another
+//  Image_String[numStrings]        one string pool with duplicates merged, for string constants and the names of things
+//  int[numGlobals]                 the string index of the name of every global, in slot order
+//  char[]                          the characters of every string, each followed by a null terminator
+//
+//The code is the same as the code of the Program it came from, except that every operand that points at a constant (see
+//bytecode_operand_kinds) is an index into the shared constant pool instead of the constants of the function. A string constant can't hold a pointer, so in the pool it is a string
+//value whose payload is an index into the string pool instead. Whatever runs the image turns those into real strings when it
+//loads the function that uses them
+//
+//Like the cache, an image is in the byte order of the machine that made it
+
+#define IMAGE_MAGIC 0x474D4950
+//This has to change whenever the layout of an image or the meaning of the bytecode changes
+#define IMAGE_VERSION 3
+
+typedef struct Image_Header {
+	unsigned int magic;
+	unsigned int version;
+	//The size of the whole image in bytes, which is checked against the size of the file
+	long long size;
+	int numFunctions;
+	int numConstants;
+	int numStrings;
+	int numGlobals;
+	int codeLen;
+	int padding;
+	//Offsets of each section from the start of the image
+	long long functions;
+	long long constants;
+	long long code;
+	long long strings;
+	long long globals;
+	long long characters;
+} Image_Header;
+
+typedef struct Image_Function {
+	//Index into the string pool, or -1 for the top level statements
+	int name;
+	int numParams;
+	int numLocals;
+	//The most values the function ever has on the stack above its locals, worked out when the image is made so that whatever runs
+	//it can check for running out of stack once per call instead of on every push
+	int maxStack;
+	//Index into the code section
+	int code;
+	int codeLen;
+} Image_Function;
+
+typedef struct Image_String {
+	//Offset into the characters section
+	int offset;
+	int len;
+} Image_String;
+
+typedef struct Image {
+	void* data;
+	long long size;
+	//Whether data came from platform_map_file, otherwise it was allocated with malloc
+	int mapped;
+	//These point into data. They are worked out from the offsets in the header when the image is opened
+	Image_Header* header;
+	Image_Function* functions;
+	Value* constants;
+	int* code;
+	Image_String* strings;
+	int* globals;
+	char* characters;
+} Image;
+
+//The buffer an image is built in before it is written out
+typedef struct Image_Builder {
+	unsigned char* data;
+	long long len;
+	long long __size;
+	//Whether functions imported from other modules are let in. Their entries have no code, and whatever runs the image has to call
+	//them in their own module instead (see Module.h)
+	int imports;
+} Image_Builder;
+
+//Open addressing hash table used to merge duplicate constants and strings while building. Each slot holds an index into the pool
+//plus one, so that 0 means the slot is empty
+typedef struct Image_Table {
+	int* slots;
+	int __size;
+} Image_Table;
+
+static inline Value image_string_constant(int index) {
+	return VALUE_QNAN | VALUE_TAG_STRING | ((Value)index & VALUE_PAYLOAD_MASK);
+}
+
+static inline int image_constant_string_index(Value val) {
+	return (int)(val & VALUE_PAYLOAD_MASK);
+}
+
+static inline char* image_string(Image* image, int index) {
+	return image->characters + image->strings[index].offset;
+}
+
+static inline int* image_function_code(Image* image, int index) {
+	return image->code + image->functions[index].code;
+}
+
+void image_builder_init(Image_Builder* builder) {
+	builder->data = NULL;
+	builder->len = 0;
+	builder->__size = 1;
+	builder->imports = false;
+}
+
+void image_builder_append(Image_Builder* builder, void* data, long long len) {
+	while (builder->len + len >= builder->__size) {
+		builder->__size *= 2;
+
+		profile_alloc(builder->data, builder->__size);
+		unsigned char* test = (unsigned char*)mem_realloc(builder->data, builder->__size);
+
+		if (test == NULL) {
+			printf("Failed to allocate memory in image_builder_append\n");
+			exit(-1);
+		}
+
+		builder->data = test;
+	}
+
+	//An empty section can come from an empty list, which might not have an array at all
+	if (len > 0) {
+		memcpy(builder->data + builder->len, data, len);
+	}
+	builder->len += len;
+}
+
+//Pads the builder with zeros up to the next 8 byte boundary and returns the offset of the section that starts there
+long long image_builder_section(Image_Builder* builder) {
+	long long zero = 0;
+	if (builder->len % 8 != 0) {
+		image_builder_append(builder, &zero, 8 - builder->len % 8);
+	}
+	return builder->len;
+}
+
+void image_table_init(Image_Table* table, int count) {
+	table->__size = 16;
+	while (table->__size < count * 2) {
+		table->__size *= 2;
+	}
+
+	table->slots = (int*)mem_calloc(table->__size, sizeof(int));
+
+	if (table->slots == NULL) {
+		printf("Failed to allocate memory in image_table_init\n");
+		exit(-1);
+	}
+}
+
+void image_table_destroy(Image_Table* table) {
+	mem_free(table->slots);
+	table->slots = NULL;
+	table->__size = 0;
+}
+
+unsigned long long image_hash(void* data, int len) {
+	unsigned char* bytes = (unsigned char*)data;
+	unsigned long long hash = 14695981039346656037ULL;
+	for (int i = 0; i < len; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+//Returns the index of the string in the pool, adding it if it isn't already there. The table has to have room for every string
+//that could be added, which image_build makes sure of by counting them first
+int image_add_string(Image_Table* table, string_list* pool, char* str, int len) {
+	int slot = (int)(image_hash(str, len) & (table->__size - 1));
+	while (table->slots[slot] != 0) {
+		string* existing = &pool->strings[table->slots[slot] - 1];
+		if (existing->len == len && memcmp(existing->str, str, len) == 0) {
+			return table->slots[slot] - 1;
+		}
+		slot = (slot + 1) & (table->__size - 1);
+	}
+
+	string copy = { .str = (char*)mem_alloc((len + 1) * sizeof(char)), .len = len, .__size = len + 1 };
+
+	if (copy.str == NULL) {
+		printf("Failed to allocate memory in image_add_string\n");
+		exit(-1);
+	}
+
+	memcpy(copy.str, str, len * sizeof(char));
+	copy.str[len] = '\0';
+	string_list_append(pool, copy);
+	table->slots[slot] = pool->len;
+	return pool->len - 1;
+}
+
+//Constants are merged by their bits, so an int and a float with the same value stay separate
+int image_add_constant(Image_Table* table, Value_List* pool, Value val) {
+	int slot = (int)(image_hash(&val, sizeof(Value)) & (table->__size - 1));
+	while (table->slots[slot] != 0) {
+		if (pool->values[table->slots[slot] - 1] == val) {
+			return table->slots[slot] - 1;
+		}
+		slot = (slot + 1) & (table->__size - 1);
+	}
+
+	Value_List_append(pool, val);
+	table->slots[slot] = pool->len;
+	return pool->len - 1;
+}
+
+//Adds the name of the identifier token to the string pool
+int image_add_name(Image_Table* table, string_list* pool, tokenList* list, int token_index) {
+	char name[256];
+	token_to_text(list->tokens[token_index], name, sizeof(name));
+	return image_add_string(table, pool, name, (int)strlen(name));
+}
+
+//Returns how much the instruction changes the number of values on the stack
+int image_stack_effect(int* instruction) {
+	switch (instruction[0]) {
+	case BC_CONST:
+	case BC_LOAD_LOCAL:
+	case BC_LOAD_GLOBAL:
+	case BC_LOCAL_INT_ADD_CONST:
+	case BC_FOREIGN:
+		return 1;
+	case BC_LOAD_LOCAL_2:
+	case BC_LOAD_GLOBAL_2:
+		return 2;
+	case BC_CALL:
+		return 1 - instruction[2];
+	case BC_RETURN_VOID:
+	case BC_INT_ADD_CONST:
+	case BC_INT_SUBTRACT_CONST:
+	case BC_INT_MULTIPLY_CONST:
+	case BC_INT_DIVIDE_CONST:
+	case BC_FLOAT_ADD_CONST:
+	case BC_FLOAT_SUBTRACT_CONST:
+	case BC_FLOAT_MULTIPLY_CONST:
+	case BC_FLOAT_DIVIDE_CONST:
+	case BC_INCREMENT_LOCAL:
+	case BC_STORE_LOCAL_KEEP:
+	case BC_STORE_GLOBAL_KEEP:
+		return 0;
+	default:
+		//Everything else takes one more value off the stack than it puts back
+		return -1;
+	}
+}
+
+//Works out how many values a function pushes onto the stack at most. There are no jumps in the bytecode, so this is just the
+//highest point the stack reaches going through the code in order
+int image_max_stack(Function* fn) {
+	int depth = 0;
+	int max = 0;
+	for (int i = 0; i < fn->code.len; i += 1 + bytecode_operands[fn->code.vec[i]]) {
+		depth += image_stack_effect(fn->code.vec + i);
+		if (depth > max) {
+			max = depth;
+		}
+	}
+	return max;
+}
+
+//Builds the image of a compiled program into the builder. Returns false if the program can't be turned into an image, which is the
+//case for programs that call functions imported from other modules unless the builder lets them in, since an image holds a single
+//program
+int image_build(Image_Builder* builder, Program* program, tokenList* list) {
+	int numStrings = program->numFunctions + program->globals.len;
+	int numConstants = 0;
+	int codeLen = 0;
+	for (int i = 0; i < program->numFunctions; i++) {
+		if (program->functions[i].module != -1 && !builder->imports) {
+			printf("Can't build an image of a program that imports functions from other modules\n");
+			return false;
+		}
+
+		numStrings += program->functions[i].constants.len;
+		numConstants += program->functions[i].constants.len;
+		codeLen += program->functions[i].code.len;
+	}
+
+	Image_Table stringTable;
+	Image_Table constantTable;
+	image_table_init(&stringTable, numStrings);
+	image_table_init(&constantTable, numConstants);
+
+	string_list strings;
+	string_list_init(&strings);
+	Value_List constants;
+	Value_List_init(&constants);
+
+	Image_Function* functions = (Image_Function*)mem_alloc(program->numFunctions * sizeof(Image_Function));
+	int* code = (int*)mem_alloc((codeLen + 1) * sizeof(int));
+	int* globals = (int*)mem_alloc((program->globals.len + 1) * sizeof(int));
+
+	if (functions == NULL || code == NULL || globals == NULL) {
+		printf("Failed to allocate memory in image_build\n");
+		exit(-1);
+	}
+
+	//The code goes in in the order of the layout when there is one, so the functions that run the most sit next to each other. The
+	//functions themselves stay in their own order since calls refer to them by index
+	codeLen = 0;
+	for (int n = 0; n < program->numFunctions; n++) {
+		int i = program->layout.len == program->numFunctions ? program->layout.vec[n] : n;
+		Function* fn = &program->functions[i];
+		functions[i].name = fn->token_index == -1 ? -1 : image_add_name(&stringTable, &strings, list, fn->token_index);
+		functions[i].numParams = fn->numParams;
+		functions[i].numLocals = fn->numLocals;
+		functions[i].maxStack = image_max_stack(fn);
+		functions[i].code = codeLen;
+		functions[i].codeLen = fn->code.len;
+
+		for (int j = 0; j < fn->code.len; j += 1 + bytecode_operands[fn->code.vec[j]]) {
+			for (int k = 0; k <= bytecode_operands[fn->code.vec[j]]; k++) {
+				code[codeLen + j + k] = fn->code.vec[j + k];
+			}
+
+			//Constants are moved into the pool shared by the whole image, so the operands that point at them have to be changed
+			for (int k = 0; k < bytecode_operands[fn->code.vec[j]]; k++) {
+				if (bytecode_operand_kinds[fn->code.vec[j]][k] != OPERAND_CONSTANT) {
+					continue;
+				}
+
+				Value val = fn->constants.values[fn->code.vec[j + 1 + k]];
+				if (value_is_string(val)) {
+					string* str = value_as_string(val);
+					int index = image_add_string(&stringTable, &strings, str->str != NULL ? str->str : "", str->len);
+					val = image_string_constant(index);
+				}
+				code[codeLen + j + 1 + k] = image_add_constant(&constantTable, &constants, val);
+			}
+		}
+		codeLen += fn->code.len;
+	}
+
+	for (int i = 0; i < program->globals.len; i++) {
+		globals[i] = image_add_name(&stringTable, &strings, list, program->globals.vec[i]);
+	}
+
+	Image_Header header;
+	memset(&header, 0, sizeof(Image_Header));
+	header.magic = IMAGE_MAGIC;
+	header.version = IMAGE_VERSION;
+	header.numFunctions = program->numFunctions;
+	header.numConstants = constants.len;
+	header.numStrings = strings.len;
+	header.numGlobals = program->globals.len;
+	header.codeLen = codeLen;
+
+	//The header is written once to hold its place, and then again at the end once all of the offsets are known
+	image_builder_append(builder, &header, sizeof(Image_Header));
+	header.functions = image_builder_section(builder);
+	image_builder_append(builder, functions, program->numFunctions * sizeof(Image_Function));
+	header.constants = image_builder_section(builder);
+	image_builder_append(builder, constants.values, constants.len * sizeof(Value));
+	header.code = image_builder_section(builder);
+	image_builder_append(builder, code, codeLen * sizeof(int));
+
+	header.strings = image_builder_section(builder);
+	int offset = 0;
+	for (int i = 0; i < strings.len; i++) {
+		Image_String entry = { .offset = offset, .len = strings.strings[i].len };
+		image_builder_append(builder, &entry, sizeof(Image_String));
+		offset += strings.strings[i].len + 1;
+	}
+
+	header.globals = image_builder_section(builder);
+	image_builder_append(builder, globals, program->globals.len * sizeof(int));
+
+	header.characters = image_builder_section(builder);
+	for (int i = 0; i < strings.len; i++) {
+		image_builder_append(builder, strings.strings[i].len > 0 ? strings.strings[i].str : "", strings.strings[i].len);
+		image_builder_append(builder, "", 1);
+	}
+
+	image_builder_section(builder);
+	header.size = builder->len;
+	memcpy(builder->data, &header, sizeof(Image_Header));
+
+	mem_free(functions);
+	mem_free(code);
+	mem_free(globals);
+	Value_List_destroy(&constants);
+	string_list_destroy(&strings);
+	image_table_destroy(&stringTable);
+	image_table_destroy(&constantTable);
+	return true;
+}
+
+//Checks that every section and every index in the image stays inside of the image, so that a damaged or truncated file is caught
+//here instead of crashing whatever runs it. The header and the function, string, and global tables are looked at, the code is
+//checked by whatever runs it as each function is loaded
+int image_validate(Image* image) {
+	Image_Header* header = (Image_Header*)image->data;
+	if (image->size < (long long)sizeof(Image_Header) || header->magic != IMAGE_MAGIC || header->version != IMAGE_VERSION
+		|| header->size != image->size || header->numFunctions < 1) {
+		return false;
+	}
+
+	long long sections[][2] = {
+		{ header->functions, (long long)header->numFunctions * sizeof(Image_Function) },
+		{ header->constants, (long long)header->numConstants * sizeof(Value) },
+		{ header->code, (long long)header->codeLen * sizeof(int) },
+		{ header->strings, (long long)header->numStrings * sizeof(Image_String) },
+		{ header->globals, (long long)header->numGlobals * sizeof(int) },
+	};
+
+	for (int i = 0; i < (int)(sizeof(sections) / sizeof(sections[0])); i++) {
+		if (sections[i][0] < (long long)sizeof(Image_Header) || sections[i][0] % 8 != 0 || sections[i][1] < 0
+			|| sections[i][0] + sections[i][1] > image->size) {
+			return false;
+		}
+	}
+
+	if (header->characters < (long long)sizeof(Image_Header) || header->characters > image->size) {
+		return false;
+	}
+
+	Image_Function* functions = (Image_Function*)((char*)image->data + header->functions);
+	for (int i = 0; i < header->numFunctions; i++) {
+		if (functions[i].code < 0 || functions[i].codeLen < 0 || (long long)functions[i].code + functions[i].codeLen > header->codeLen
+			|| functions[i].name < -1 || functions[i].name >= header->numStrings || functions[i].numLocals < functions[i].numParams) {
+			return false;
+		}
+	}
+
+	//Every string has to fit in the characters section along with its null terminator, since strings are used straight out of the image
+	char* characters = (char*)image->data + header->characters;
+	long long charactersLen = image->size - header->characters;
+	Image_String* strings = (Image_String*)((char*)image->data + header->strings);
+	for (int i = 0; i < header->numStrings; i++) {
+		if (strings[i].offset < 0 || strings[i].len < 0 || (long long)strings[i].offset + strings[i].len >= charactersLen
+			|| characters[strings[i].offset + strings[i].len] != '\0') {
+			return false;
+		}
+	}
+
+	int* globals = (int*)((char*)image->data + header->globals);
+	for (int i = 0; i < header->numGlobals; i++) {
+		if (globals[i] < 0 || globals[i] >= header->numStrings) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//Sets up the image from data that already holds a whole image. Returns false if the data isn't a valid image
+int image_from_data(Image* image, void* data, long long size, int mapped) {
+	image->data = data;
+	image->size = size;
+	image->mapped = mapped;
+
+	if (!image_validate(image)) {
+		return false;
+	}
+
+	char* base = (char*)data;
+	image->header = (Image_Header*)base;
+	image->functions = (Image_Function*)(base + image->header->functions);
+	image->constants = (Value*)(base + image->header->constants);
+	image->code = (int*)(base + image->header->code);
+	image->strings = (Image_String*)(base + image->header->strings);
+	image->globals = (int*)(base + image->header->globals);
+	image->characters = base + image->header->characters;
+	return true;
+}
+
+//Writes the image of a compiled program to a file. Returns false if it couldn't be built or written
+int image_write(Program* program, tokenList* list, char* path) {
+	Image_Builder builder;
+	image_builder_init(&builder);
+
+	if (!image_build(&builder, program, list)) {
+		mem_free(builder.data);
+		return false;
+	}
+
+	FILE* fptr = fopen(path, "wb");
+	if (fptr == NULL) {
+		printf("Failed to open %s for writing\n", path);
+		mem_free(builder.data);
+		return false;
+	}
+
+	int written = fwrite(builder.data, 1, builder.len, fptr) == (size_t)builder.len;
+	fclose(fptr);
+	mem_free(builder.data);
+	return written;
+}
+
+//Maps an image file into memory. Returns false if the file can't be opened or isn't a valid image
+int image_open(Image* image, char* path) {
+	long long size = 0;
+	void* data = platform_map_file(path, &size);
+	if (data == NULL) {
+		return false;
+	}
+
+	if (!image_from_data(image, data, size, true)) {
+		platform_unmap_file(data, size);
+		return false;
+	}
+	return true;
+}
+
+//Builds an image of a compiled program straight into memory, which is how a program that was just compiled gets run without going
+//through a file. imports says whether functions imported from other modules are let in
+int image_from_program_imports(Image* image, Program* program, tokenList* list, int imports) {
+	profiler_begin(PHASE_IMAGE);
+	Image_Builder builder;
+	image_builder_init(&builder);
+	builder.imports = imports;
+
+	if (!image_build(&builder, program, list) || !image_from_data(image, builder.data, builder.len, false)) {
+		mem_free(builder.data);
+		profiler_end();
+		return false;
+	}
+	profiler_end();
+	return true;
+}
+
+int image_from_program(Image* image, Program* program, tokenList* list) {
+	return image_from_program_imports(image, program, list, false);
+}
+
+void image_close(Image* image) {
+	if (image->mapped) {
+		platform_unmap_file(image->data, image->size);
+	}
+	else {
+		mem_free(image->data);
+	}
+	image->data = NULL;
+	image->size = 0;
+}
+
+#endif
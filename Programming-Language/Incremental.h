@@ -0,0 +1,1003 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Platform.h"
+#include "Strings.h"
+#include "Vectors.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Diagnostics.h"
+#include <stdbool.h>
+
+//This header file contains the incremental lexer and parser used for editing a file that is already open
+//
+//A document keeps the text of the file along with its tokens, where each token came from in the text, and its AST. When the text
+//is edited, only the part of the text around the edit is lexed again. Lexing starts right after the last keyword, operator, or
+//punctuator that ends before the edit (since the lexer is always in the same state after one of those), and stops at the first one
+//after the edit that comes out exactly the same as it was before, which is where the new tokens line up with the old ones again.
+//The new tokens are spliced in place of the old ones, and the tokens after them only have their positions moved
+//
+//The second stage of the lexer decides whether a token is an identifier by looking for a declaration of the same name anywhere in
+//the file, so an edit can change tokens far away from it. To avoid looking through the whole file on every edit, the document keeps
+//a table of every name with how many times it is declared with each type and how many other tokens use it. Only when an edit
+//changes what the uses of a name resolve to, and there actually are uses, are the tokens of the file searched for them
+//
+//The parser keeps track of the tokens each top level item (statement, import, or function definition) covers. After an edit, the
+//items that overlapped the edited tokens are parsed again until the parser lines up with the start of an old item, and the same
+//is done for the item around any token that was changed because of a declaration. Function bodies are left unparsed like usual,
+//so an edit inside of a function only costs parsing its header
+//
+//--edit <file> <script> opens a file as a document and replays the edits in the script on it (see document_main), which is how the
+//document is driven from the command line and checked against lexing and parsing the edited text from scratch
+//
+//An edit that adds or removes tokens moves the token indices of every item after it, and of every node of those items. Those are
+//left behind and caught up lazily the same way the positions are, so the AST of a document has to be brought up to date with
+//document_settle before anything else looks at it
+
+//Declarations are counted separately for every type and for whether the name is a function, since that is all the mdata of an
+//identifier can hold
+#define DOCUMENT_NUM_VARIANTS (NUM_VARIABLE_TYPES * 2)
+//How many keywords, operators, or punctuators after an edit are tried as the point where the tokens line up again
+#define DOCUMENT_SYNC_ATTEMPTS 4
+
+typedef struct Document_Name {
+	//Owned by the table. The str of an empty slot is NULL
+	string name;
+	int declarations[DOCUMENT_NUM_VARIANTS];
+	//How many tokens use the name without declaring it
+	int uses;
+	//The mdata the uses of the name have, or -1 if they are TYPE_UNDEFINED because the name isn't declared anywhere
+	long long resolved;
+	//Set while an edit is being processed if the declarations of the name changed
+	int touched;
+} Document_Name;
+
+typedef struct Document_Item {
+	//The range of tokens the item covers, from start up to but not including end
+	int start;
+	int end;
+	//How many nodes the item added to the root of the AST
+	int numNodes;
+	int numErrors;
+} Document_Item;
+
+typedef struct Document {
+	string text;
+	tokenList tokens;
+	//The start and end of every token in the text, as pairs. The positions of the tokens from shiftFrom on are behind by shiftDelta,
+	//since moving them along after every edit would mean touching the whole rest of the file. Use document_start and document_end
+	//to get the actual positions
+	Vector_Int positions;
+	int shiftFrom;
+	int shiftDelta;
+	AST* ast;
+	Document_Item* items;
+	int numItems;
+	int __itemsSize;
+	//The items from itemShiftFrom on, along with the token indices of their nodes, are behind by itemShiftDelta tokens. Use
+	//document_item_start and document_item_end to get the actual range of an item
+	int itemShiftFrom;
+	int itemShiftDelta;
+	//Open addressing hash table of every name used in the document
+	Document_Name* names;
+	int numNames;
+	int __namesSize;
+	Vector_Int touchedNames;
+	int numErrors;
+	//The syntax errors found the last time the document was parsed, which for an edit only covers the items that were parsed again
+	string diagnostics;
+	//How many tokens were lexed and how many items were parsed by the last edit
+	int lastTokensLexed;
+	int lastItemsParsed;
+} Document;
+
+static inline int document_is_hard(token tok) {
+	return tok.type == KEYWORD || tok.type == OPERATOR || tok.type == PUNCTUATOR;
+}
+
+static inline int document_is_name(token tok) {
+	return tok.type == IDENTIFIER || tok.type == TYPE_UNDEFINED;
+}
+
+static inline int document_start(Document* doc, int index) {
+	return doc->positions.vec[index * 2] + (index >= doc->shiftFrom ? doc->shiftDelta : 0);
+}
+
+static inline int document_end(Document* doc, int index) {
+	return doc->positions.vec[index * 2 + 1] + (index >= doc->shiftFrom ? doc->shiftDelta : 0);
+}
+
+//Moves the point the positions start being behind from to the token at index, which only touches the tokens in between. Edits
+//close to each other, like when typing, end up only moving the positions of the tokens between them
+void document_move_shift(Document* doc, int index) {
+	for (int i = doc->shiftFrom * 2; i < index * 2; i++) {
+		doc->positions.vec[i] += doc->shiftDelta;
+	}
+	for (int i = index * 2; i < doc->shiftFrom * 2; i++) {
+		doc->positions.vec[i] -= doc->shiftDelta;
+	}
+	doc->shiftFrom = index;
+}
+
+static inline int document_item_start(Document* doc, int index) {
+	return doc->items[index].start + (index >= doc->itemShiftFrom ? doc->itemShiftDelta : 0);
+}
+
+static inline int document_item_end(Document* doc, int index) {
+	return doc->items[index].end + (index >= doc->itemShiftFrom ? doc->itemShiftDelta : 0);
+}
+
+//Returns true if the token at index is where a name is declared, which is when it comes right after a variable type keyword
+static inline int document_is_declaration(tokenList* list, int index) {
+	return index > 0 && list->tokens[index - 1].type == KEYWORD && is_keyword_variable_type(list->tokens[index - 1].val);
+}
+
+static inline int document_variant(token tok) {
+	return token_identifier_type(tok) + (token_is_function(tok) ? NUM_VARIABLE_TYPES : 0);
+}
+
+static inline long long document_variant_mdata(int variant) {
+	if (variant >= NUM_VARIABLE_TYPES) {
+		return (variant - NUM_VARIABLE_TYPES) ^ (1U << (sizeof(unsigned int) * 8 - 1));
+	}
+	return variant;
+}
+
+void document_free_token(token tok) {
+	if (document_is_name(tok) || (tok.type == LITERAL && tok.mdata == STRING_LITERAL)) {
+		string_destroy((string*)tok.val);
+		mem_free((string*)tok.val);
+	}
+}
+
+static inline int document_name_equal(string* a, string* b) {
+	return a->len == b->len && (a->len == 0 || memcmp(a->str, b->str, a->len) == 0);
+}
+
+unsigned long long document_hash(string* str) {
+	unsigned long long hash = 14695981039346656037ULL;
+	for (int i = 0; i < str->len; i++) {
+		hash ^= (unsigned char)str->str[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+int document_find_slot(Document_Name* names, int size, string* name) {
+	int slot = (int)(document_hash(name) & (size - 1));
+	while (names[slot].name.str != NULL) {
+		if (document_name_equal(&names[slot].name, name)) {
+			return slot;
+		}
+		slot = (slot + 1) & (size - 1);
+	}
+	return slot;
+}
+
+void document_grow_names(Document* doc) {
+	int size = doc->__namesSize * 2;
+	Document_Name* names = (Document_Name*)mem_calloc(size, sizeof(Document_Name));
+
+	if (names == NULL) {
+		printf("Failed to allocate memory in document_grow_names\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < doc->__namesSize; i++) {
+		if (doc->names[i].name.str != NULL) {
+			names[document_find_slot(names, size, &doc->names[i].name)] = doc->names[i];
+		}
+	}
+
+	mem_free(doc->names);
+	doc->names = names;
+	doc->__namesSize = size;
+
+	//The touched names moved along with everything else
+	doc->touchedNames.len = 0;
+	for (int i = 0; i < size; i++) {
+		if (names[i].name.str != NULL && names[i].touched) {
+			Vector_Int_Append(&doc->touchedNames, i);
+		}
+	}
+}
+
+//Returns the table entry for the name of the token, adding one if there isn't one yet. The entry can move when another name is
+//added, so it should only be held onto until the next call
+Document_Name* document_name(Document* doc, token tok) {
+	string* name = (string*)tok.val;
+	int slot = document_find_slot(doc->names, doc->__namesSize, name);
+
+	if (doc->names[slot].name.str == NULL) {
+		if ((doc->numNames + 1) * 2 >= doc->__namesSize) {
+			document_grow_names(doc);
+			slot = document_find_slot(doc->names, doc->__namesSize, name);
+		}
+
+		memset(&doc->names[slot], 0, sizeof(Document_Name));
+		string_init(&doc->names[slot].name, NULL);
+		string_copy(&doc->names[slot].name, name);
+		doc->names[slot].resolved = -1;
+		doc->numNames++;
+	}
+
+	return &doc->names[slot];
+}
+
+void document_touch(Document* doc, Document_Name* entry) {
+	if (!entry->touched) {
+		entry->touched = true;
+		Vector_Int_Append(&doc->touchedNames, (int)(entry - doc->names));
+	}
+}
+
+//Works out what the uses of a name resolve to. Like the lexer, the first declaration of the name in the file wins, which only has to
+//be searched for when the name is declared with more than one type
+long long document_resolve_name(Document* doc, Document_Name* entry) {
+	int variant = -1;
+	for (int i = 0; i < DOCUMENT_NUM_VARIANTS; i++) {
+		if (entry->declarations[i] > 0) {
+			if (variant != -1) {
+				for (int j = 1; j < doc->tokens.len; j++) {
+					token tok = doc->tokens.tokens[j];
+					if (tok.type == IDENTIFIER && document_is_declaration(&doc->tokens, j) && document_name_equal((string*)tok.val, &entry->name)) {
+						return tok.mdata;
+					}
+				}
+			}
+			variant = i;
+		}
+	}
+
+	return variant == -1 ? -1 : document_variant_mdata(variant);
+}
+
+//Sets a token that uses a name to whatever the name resolves to
+void document_apply_name(token* tok, long long resolved) {
+	if (resolved == -1) {
+		tok->type = TYPE_UNDEFINED;
+		tok->mdata = -1;
+	}
+	else {
+		tok->type = IDENTIFIER;
+		tok->mdata = (unsigned int)resolved;
+	}
+}
+
+//Runs the second stage of the lexer on the tokens from start up to end, which have to have just come out of lexer_scan. Every name
+//whose declarations change is marked as touched
+void document_classify(Document* doc, int start, int end) {
+	tokenList* list = &doc->tokens;
+
+	for (int i = start; i < end; i++) {
+		if (lexer_declaration(list, i)) {
+			Document_Name* entry = document_name(doc, list->tokens[i]);
+			entry->declarations[document_variant(list->tokens[i])]++;
+			document_touch(doc, entry);
+		}
+	}
+}
+
+//Finishes classifying the tokens from start up to end that aren't declarations, once the names have been resolved
+void document_classify_uses(Document* doc, int start, int end) {
+	tokenList* list = &doc->tokens;
+
+	for (int i = start; i < end; i++) {
+		if (list->tokens[i].type != TYPE_UNDEFINED || lexer_number(&list->tokens[i])) {
+			continue;
+		}
+
+		Document_Name* entry = document_name(doc, list->tokens[i]);
+		entry->uses++;
+		document_apply_name(&list->tokens[i], entry->resolved);
+	}
+}
+
+//Resolves every touched name again. Any use of a name that now resolves differently is changed, and its index is appended to changed.
+//The tokens from skipStart up to skipEnd are left alone, since they haven't been classified yet
+void document_resolve_touched(Document* doc, int skipStart, int skipEnd, Vector_Int* changed) {
+	Vector_Int redo;
+	Vector_Int_Init(&redo);
+
+	for (int i = 0; i < doc->touchedNames.len; i++) {
+		Document_Name* entry = &doc->names[doc->touchedNames.vec[i]];
+		entry->touched = false;
+
+		long long resolved = document_resolve_name(doc, entry);
+		if (resolved != entry->resolved) {
+			entry->resolved = resolved;
+			if (entry->uses > 0) {
+				Vector_Int_Append(&redo, doc->touchedNames.vec[i]);
+			}
+		}
+	}
+	doc->touchedNames.len = 0;
+
+	if (redo.len > 0) {
+		tokenList* list = &doc->tokens;
+		for (int i = 0; i < list->len; i++) {
+			if (i >= skipStart && i < skipEnd) {
+				i = skipEnd - 1;
+				continue;
+			}
+
+			if (!document_is_name(list->tokens[i]) || document_is_declaration(list, i)) {
+				continue;
+			}
+
+			for (int j = 0; j < redo.len; j++) {
+				Document_Name* entry = &doc->names[redo.vec[j]];
+				if (document_name_equal((string*)list->tokens[i].val, &entry->name)) {
+					document_apply_name(&list->tokens[i], entry->resolved);
+					Vector_Int_Append(changed, i);
+					break;
+				}
+			}
+		}
+	}
+
+	Vector_Int_Destroy(&redo);
+}
+
+//Takes the tokens from start up to end out of the name table, before they are removed from the document
+void document_forget(Document* doc, int start, int end) {
+	tokenList* list = &doc->tokens;
+
+	for (int i = start; i < end; i++) {
+		if (!document_is_name(list->tokens[i])) {
+			continue;
+		}
+
+		Document_Name* entry = document_name(doc, list->tokens[i]);
+		if (list->tokens[i].type == IDENTIFIER && document_is_declaration(list, i)) {
+			entry->declarations[document_variant(list->tokens[i])]--;
+			document_touch(doc, entry);
+		}
+		else {
+			entry->uses--;
+		}
+	}
+}
+
+int document_shift_visit(AST_Visitor* visitor, AST* node) {
+	node->token_index += *(int*)visitor->data;
+	return VISIT_CONTINUE;
+}
+
+//Moves the point the items start being behind from to the item at index, the same way document_move_shift does for the positions.
+//Only the items in between and their nodes are touched
+void document_move_item_shift(Document* doc, int index) {
+	int from = index < doc->itemShiftFrom ? index : doc->itemShiftFrom;
+	int to = index < doc->itemShiftFrom ? doc->itemShiftFrom : index;
+	int delta = index < doc->itemShiftFrom ? -doc->itemShiftDelta : doc->itemShiftDelta;
+
+	if (delta != 0 && from < to) {
+		int child = 0;
+		for (int i = 0; i < from; i++) {
+			child += doc->items[i].numNodes;
+		}
+
+		AST_Visitor shift;
+		AST_visitor_init(&shift, document_shift_visit, &delta);
+		for (int i = from; i < to && i < doc->numItems; i++) {
+			doc->items[i].start += delta;
+			doc->items[i].end += delta;
+			for (int j = 0; j < doc->items[i].numNodes; j++) {
+				AST_visit(&shift, &((AST*)doc->ast->list.arr)[child], VISIT_PRE_ORDER);
+				child++;
+			}
+		}
+		AST_visitor_destroy(&shift);
+	}
+
+	doc->itemShiftFrom = index;
+	//Nothing is behind anymore once the point is past the last item
+	if (index >= doc->numItems) {
+		doc->itemShiftDelta = 0;
+	}
+}
+
+//Brings the token indices of every item and every node of the AST up to date
+void document_settle(Document* doc) {
+	document_move_item_shift(doc, doc->numItems);
+}
+
+//Points the children of the root from index from on back at it, and their children back at them. Nothing deeper is affected when
+//the list of the root moves, so this is all that is needed after splicing it
+void document_relink_root(AST* root, int from) {
+	for (int i = from; i < root->list.len; i++) {
+		AST* child = &((AST*)root->list.arr)[i];
+		child->prevNode = root;
+		child->position = i;
+		for (int j = 0; j < child->list.len; j++) {
+			((AST*)child->list.arr)[j].prevNode = child;
+		}
+	}
+}
+
+void document_reserve_items(Document* doc, int count) {
+	if (count + 1 >= doc->__itemsSize) {
+		while (count + 1 >= doc->__itemsSize) {
+			doc->__itemsSize *= 2;
+		}
+
+		Document_Item* test = (Document_Item*)mem_realloc(doc->items, doc->__itemsSize * sizeof(Document_Item));
+
+		if (test == NULL) {
+			printf("Failed to allocate memory in document_reserve_items\n");
+			exit(-1);
+		}
+
+		doc->items = test;
+	}
+}
+
+//Returns the index of the item holding the token, or numItems if the token comes after every item
+int document_find_item(Document* doc, int token_index) {
+	int low = 0;
+	int high = doc->numItems;
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (document_item_end(doc, mid) <= token_index) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+//Parses the tokens starting at start again, replacing the items from i0 up to i1. Parsing keeps going past regionEnd until it reaches
+//the start of an old item (swallowing any old items it runs past), or the end of the tokens
+void document_reparse(Document* doc, int start, int i0, int i1, int regionEnd) {
+	//The items before i1 are about to be thrown out or left alone, so everything that is behind starts at i1 from here on
+	document_move_item_shift(doc, i1);
+
+	Parser p = { .tokens = &doc->tokens, .index = start, .num_errors = 0 };
+	AST scratch = parser_node(AST_ROOT, -1, UREL_IRRELEVENT);
+	Document_Item* parsed = NULL;
+	int numParsed = 0;
+	int __parsedSize = 1;
+
+	string* previousBuffer = diagnostics_buffer;
+	diagnostics_buffer = &doc->diagnostics;
+
+	while (p.index < doc->tokens.len) {
+		if (p.index >= regionEnd) {
+			while (i1 < doc->numItems && document_item_start(doc, i1) < p.index) {
+				i1++;
+			}
+			if (i1 < doc->numItems && document_item_start(doc, i1) == p.index) {
+				break;
+			}
+		}
+
+		Document_Item item = { .start = p.index, .numNodes = scratch.list.len, .numErrors = p.num_errors };
+		parser_item(&p, &scratch);
+		if (p.index > doc->tokens.len) {
+			p.index = doc->tokens.len;
+		}
+		item.end = p.index;
+		item.numNodes = scratch.list.len - item.numNodes;
+		item.numErrors = p.num_errors - item.numErrors;
+
+		if (numParsed + 1 >= __parsedSize) {
+			__parsedSize *= 2;
+			Document_Item* test = (Document_Item*)mem_realloc(parsed, __parsedSize * sizeof(Document_Item));
+
+			if (test == NULL) {
+				printf("Failed to allocate memory in document_reparse\n");
+				exit(-1);
+			}
+
+			parsed = test;
+		}
+		parsed[numParsed] = item;
+		numParsed++;
+	}
+
+	diagnostics_buffer = previousBuffer;
+
+	if (p.index >= doc->tokens.len) {
+		i1 = doc->numItems;
+	}
+
+	//Swap the old items and their nodes out for the new ones
+	int c0 = 0;
+	for (int i = 0; i < i0; i++) {
+		c0 += doc->items[i].numNodes;
+	}
+	int c1 = c0;
+	for (int i = i0; i < i1; i++) {
+		c1 += doc->items[i].numNodes;
+		doc->numErrors -= doc->items[i].numErrors;
+	}
+
+	AST_List* rootList = &doc->ast->list;
+	for (int i = c0; i < c1; i++) {
+		AST_destroy_children(&((AST*)rootList->arr)[i]);
+	}
+
+	int newLen = rootList->len - (c1 - c0) + scratch.list.len;
+	AST* oldChildren = (AST*)rootList->arr;
+	if (newLen + 1 >= rootList->__size) {
+		while (newLen + 1 >= rootList->__size) {
+			rootList->__size *= 2;
+		}
+
+		AST* test = (AST*)mem_realloc(rootList->arr, rootList->__size * sizeof(AST));
+
+		if (test == NULL) {
+			printf("Failed to allocate memory in document_reparse\n");
+			exit(-1);
+		}
+
+		rootList->arr = test;
+	}
+
+	AST* children = (AST*)rootList->arr;
+	memmove(&children[c0 + scratch.list.len], &children[c1], (rootList->len - c1) * sizeof(AST));
+	if (scratch.list.len > 0) {
+		memcpy(&children[c0], scratch.list.arr, scratch.list.len * sizeof(AST));
+	}
+	rootList->len = newLen;
+
+	//Only the nodes that moved need to be pointed back at their parents
+	if (children != oldChildren) {
+		document_relink_root(doc->ast, 0);
+	}
+	else if (c1 - c0 != scratch.list.len) {
+		document_relink_root(doc->ast, c0 + scratch.list.len);
+	}
+	for (int i = c0; i < c0 + scratch.list.len; i++) {
+		children[i].prevNode = doc->ast;
+		children[i].position = i;
+		AST_relink(&children[i]);
+	}
+	AST_List_destroy(&scratch.list);
+
+	document_reserve_items(doc, doc->numItems - (i1 - i0) + numParsed);
+	memmove(&doc->items[i0 + numParsed], &doc->items[i1], (doc->numItems - i1) * sizeof(Document_Item));
+	for (int i = 0; i < numParsed; i++) {
+		doc->items[i0 + i] = parsed[i];
+		doc->numErrors += parsed[i].numErrors;
+	}
+	doc->numItems = doc->numItems - (i1 - i0) + numParsed;
+	doc->lastItemsParsed += numParsed;
+	//The new items are up to date, and the old ones after them are still as far behind as they were
+	doc->itemShiftFrom = i0 + numParsed;
+	if (doc->itemShiftFrom >= doc->numItems) {
+		doc->itemShiftDelta = 0;
+	}
+
+	mem_free(parsed);
+}
+
+//Sets up a document for the given text. Returns the number of syntax errors found
+int document_open(Document* doc, char* text) {
+	string_init(&doc->text, text);
+	if (doc->text.str == NULL) {
+		string_set(&doc->text, "");
+	}
+	lexer_normalize(&doc->text);
+
+	tokenList_init(&doc->tokens);
+	Vector_Int_Init(&doc->positions);
+	doc->shiftFrom = 0;
+	doc->shiftDelta = 0;
+	Vector_Int_Init(&doc->touchedNames);
+	string_init(&doc->diagnostics, NULL);
+	AST_init(&doc->ast);
+	doc->items = NULL;
+	doc->numItems = 0;
+	doc->__itemsSize = 1;
+	doc->itemShiftFrom = 0;
+	doc->itemShiftDelta = 0;
+	doc->__namesSize = 1024;
+	doc->numNames = 0;
+	doc->numErrors = 0;
+	doc->names = (Document_Name*)mem_calloc(doc->__namesSize, sizeof(Document_Name));
+
+	if (doc->names == NULL) {
+		printf("Failed to allocate memory in document_open\n");
+		exit(-1);
+	}
+
+	lexer_scan(&doc->tokens, &doc->text, 0, doc->text.len, &doc->positions);
+
+	Vector_Int changed;
+	Vector_Int_Init(&changed);
+	document_classify(doc, 0, doc->tokens.len);
+	document_resolve_touched(doc, 0, doc->tokens.len, &changed);
+	document_classify_uses(doc, 0, doc->tokens.len);
+	Vector_Int_Destroy(&changed);
+
+	doc->lastTokensLexed = doc->tokens.len;
+	doc->lastItemsParsed = 0;
+	document_reparse(doc, 0, 0, 0, 0);
+	return doc->numErrors;
+}
+
+//Replaces removeLen characters of the text starting at offset with insert, and brings the tokens and the AST up to date. Returns the
+//number of syntax errors in the whole document afterwards
+int document_edit(Document* doc, int offset, int removeLen, char* insert) {
+	if (offset < 0 || offset > doc->text.len) {
+		return doc->numErrors;
+	}
+	if (removeLen < 0 || offset + removeLen > doc->text.len) {
+		removeLen = doc->text.len - offset;
+	}
+
+	doc->lastTokensLexed = 0;
+	doc->lastItemsParsed = 0;
+	string_destroy(&doc->diagnostics);
+
+	//The inserted text is normalized the same way the whole file was when it was opened
+	string added;
+	string_init(&added, insert);
+	if (added.str == NULL) {
+		string_set(&added, "");
+	}
+	lexer_normalize(&added);
+
+	int charDelta = added.len - removeLen;
+	int newLen = doc->text.len + charDelta;
+	if (newLen + 1 > doc->text.__size) {
+		doc->text.__size = (newLen + 1) * 2;
+		char* test = (char*)mem_realloc(doc->text.str, doc->text.__size * sizeof(char));
+
+		if (test == NULL) {
+			printf("Failed to allocate memory in document_edit\n");
+			exit(-1);
+		}
+
+		doc->text.str = test;
+	}
+	memmove(doc->text.str + offset + added.len, doc->text.str + offset + removeLen, doc->text.len - offset - removeLen);
+	memcpy(doc->text.str + offset, added.str, added.len);
+	doc->text.len = newLen;
+	doc->text.str[newLen] = '\0';
+	string_destroy(&added);
+
+	tokenList* list = &doc->tokens;
+	int oldCount = list->len;
+
+	//Find the last token that definitely isn't affected by the edit, which is a keyword, operator, or punctuator that ends before the
+	//edit starts. It has to end strictly before the edit, since whether something is a keyword depends on the character after it
+	int low = 0;
+	int high = oldCount;
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (document_end(doc, mid) < offset) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	int restart = low - 1;
+	while (restart >= 0 && (!document_is_hard(list->tokens[restart]) || document_end(doc, restart) >= offset)) {
+		restart--;
+	}
+	int a = restart + 1;
+	int scanFrom = restart >= 0 ? document_end(doc, restart) : 0;
+
+	//The first keyword, operator, or punctuator that starts after the edit is where the tokens should line up again
+	int sync = a;
+	while (sync < oldCount && (!document_is_hard(list->tokens[sync]) || document_start(doc, sync) < offset + removeLen)) {
+		sync++;
+	}
+
+	tokenList fresh;
+	tokenList_init(&fresh);
+	Vector_Int freshPositions;
+	Vector_Int_Init(&freshPositions);
+	int bOld = oldCount;
+	int synced = false;
+
+	//If the keyword, operator, or punctuator doesn't come out the same (like when a quote is added and everything after it is now inside
+	//of a string), the next few are tried before giving up and lexing everything after the restart point again
+	for (int attempt = 0; attempt < DOCUMENT_SYNC_ATTEMPTS && sync < oldCount; attempt++) {
+		int scanTo = document_end(doc, sync) + charDelta;
+		int open = lexer_scan(&fresh, &doc->text, scanFrom, scanTo, &freshPositions);
+
+		token last = fresh.len > 0 ? fresh.tokens[fresh.len - 1] : (token) { .type = TYPE_UNDEFINED };
+		if (!open && fresh.len > 0 && last.type == list->tokens[sync].type && last.val == list->tokens[sync].val
+			&& freshPositions.vec[freshPositions.len - 1] == scanTo) {
+			bOld = sync + 1;
+			synced = true;
+			break;
+		}
+
+		for (int i = 0; i < fresh.len; i++) {
+			document_free_token(fresh.tokens[i]);
+		}
+		fresh.len = 0;
+		freshPositions.len = 0;
+
+		sync++;
+		while (sync < oldCount && !document_is_hard(list->tokens[sync])) {
+			sync++;
+		}
+	}
+
+	if (!synced) {
+		lexer_scan(&fresh, &doc->text, scanFrom, doc->text.len, &freshPositions);
+	}
+
+	doc->lastTokensLexed = fresh.len;
+
+	//Splice the new tokens in place of the old ones
+	document_forget(doc, a, bOld);
+	for (int i = a; i < bOld; i++) {
+		document_free_token(list->tokens[i]);
+	}
+
+	int bNew = a + fresh.len;
+	int tokenDelta = bNew - bOld;
+	tokenList_splice(list, a, bOld - a, fresh.tokens, fresh.len);
+	document_move_shift(doc, bOld);
+	Vector_Int_Splice(&doc->positions, a * 2, (bOld - a) * 2, freshPositions.vec, freshPositions.len);
+	doc->shiftFrom = bNew;
+	doc->shiftDelta += charDelta;
+	tokenList_destroy(&fresh);
+	Vector_Int_Destroy(&freshPositions);
+
+	Vector_Int changed;
+	Vector_Int_Init(&changed);
+	document_classify(doc, a, bNew);
+	document_resolve_touched(doc, a, bNew, &changed);
+	document_classify_uses(doc, a, bNew);
+
+	//Parse the items around the new tokens again. The items after them are behind by the tokens that were added or removed, which
+	//only gets caught up on when something needs them
+	int i0 = document_find_item(doc, a - 1 < 0 ? 0 : a - 1);
+	int parseStart = i0 < doc->numItems && document_item_start(doc, i0) < a ? document_item_start(doc, i0) : a;
+	if (a == 0) {
+		i0 = 0;
+		parseStart = 0;
+	}
+
+	int i1 = i0;
+	while (i1 < doc->numItems && document_item_start(doc, i1) < bOld) {
+		i1++;
+	}
+
+	document_move_item_shift(doc, i1);
+	if (i1 < doc->numItems) {
+		doc->itemShiftDelta += tokenDelta;
+	}
+
+	document_reparse(doc, parseStart, i0, i1, bNew);
+
+	//Items that use a name whose declaration changed are parsed again too. The changed tokens are in order, so each item only gets
+	//parsed once
+	int lastItem = -1;
+	for (int i = 0; i < changed.len; i++) {
+		int item = document_find_item(doc, changed.vec[i]);
+		if (item < doc->numItems && item != lastItem) {
+			document_reparse(doc, document_item_start(doc, item), item, item + 1, document_item_end(doc, item));
+			lastItem = document_find_item(doc, changed.vec[i]);
+		}
+	}
+	Vector_Int_Destroy(&changed);
+
+	return doc->numErrors;
+}
+
+//Returns true if the tokens are the same, comparing the tokens that have a string by the text of the string
+int document_tokens_equal(tokenList* a, tokenList* b) {
+	if (a->len != b->len) {
+		return false;
+	}
+
+	for (int i = 0; i < a->len; i++) {
+		token x = a->tokens[i];
+		token y = b->tokens[i];
+		if (x.type != y.type || x.mdata != y.mdata) {
+			return false;
+		}
+
+		if (document_is_name(x) || (x.type == LITERAL && x.mdata == STRING_LITERAL)) {
+			if (!document_name_equal((string*)x.val, (string*)y.val)) {
+				return false;
+			}
+		}
+		else if (x.val != y.val) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//Returns true if the trees are the same. The nodes of a are also checked to point back at their parents, since the document
+//splices nodes in and out of its tree by hand
+int document_nodes_equal(AST* a, AST* b) {
+	if (a->type != b->type || a->token_index != b->token_index || a->upRelation != b->upRelation || a->valueType != b->valueType
+		|| a->op != b->op || a->list.len != b->list.len) {
+		return false;
+	}
+
+	for (int i = 0; i < a->list.len; i++) {
+		AST* x = &((AST*)a->list.arr)[i];
+		if (x->prevNode != a || x->position != i || !document_nodes_equal(x, &((AST*)b->list.arr)[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//Lexes and parses the text of the document from scratch and returns true if the tokens, the AST, and the number of syntax errors all
+//come out the same as they are in the document
+int document_matches_full(Document* doc) {
+	document_settle(doc);
+
+	string text;
+	string_init(&text, doc->text.str);
+	tokenList list;
+	tokenList_init(&list);
+	AST* ast;
+	AST_init(&ast);
+
+	string diagnostics;
+	string_init(&diagnostics, NULL);
+	string* previousBuffer = diagnostics_buffer;
+	diagnostics_buffer = &diagnostics;
+	lexer(&list, &text);
+	int errors = parser(&list, &ast);
+	diagnostics_buffer = previousBuffer;
+
+	int same = errors == doc->numErrors && document_tokens_equal(&doc->tokens, &list) && document_nodes_equal(doc->ast, ast);
+
+	AST_destroy_children(ast);
+	mem_free(ast);
+	tokenList_destroy_all(&list);
+	string_destroy(&text);
+	string_destroy(&diagnostics);
+	return same;
+}
+
+void document_destroy(Document* doc) {
+	for (int i = 0; i < doc->tokens.len; i++) {
+		document_free_token(doc->tokens.tokens[i]);
+	}
+	tokenList_destroy(&doc->tokens);
+	Vector_Int_Destroy(&doc->positions);
+	Vector_Int_Destroy(&doc->touchedNames);
+
+	AST_destroy_children(doc->ast);
+	mem_free(doc->ast);
+	mem_free(doc->items);
+
+	for (int i = 0; i < doc->__namesSize; i++) {
+		if (doc->names[i].name.str != NULL) {
+			string_destroy(&doc->names[i].name);
+		}
+	}
+	mem_free(doc->names);
+
+	string_destroy(&doc->text);
+	string_destroy(&doc->diagnostics);
+}
+
+//Turns the escapes \n, \t, and \\ in the text of an edit into the characters they stand for, in place
+void document_unescape(char* text) {
+	int out = 0;
+	for (int i = 0; text[i] != '\0'; i++) {
+		if (text[i] == '\\' && text[i + 1] != '\0') {
+			i++;
+			text[out++] = text[i] == 'n' ? '\n' : text[i] == 't' ? '\t' : text[i];
+		}
+		else {
+			text[out++] = text[i];
+		}
+	}
+	text[out] = '\0';
+}
+
+//The entry point for --edit <file> <script> [--check]. Every line of the script is an edit of the form "<offset> <remove> <text>",
+//which replaces remove characters at offset with the rest of the line after a single space (with \n, \t, and \\ as escapes). Blank
+//lines and lines starting with # are skipped. Each edit prints how much of the document it had to lex and parse again, and once
+//every edit is done the document is compared against lexing and parsing its text from scratch (after every edit with --check).
+//Returns 0 if the document always matched
+int document_main(int argc, char** argv) {
+	int check = false;
+	char* paths[2] = { NULL, NULL };
+	int numPaths = 0;
+	for (int i = 0; i < argc; i++) {
+		if (strcmp(argv[i], "--check") == 0) {
+			check = true;
+		}
+		else if (numPaths < 2) {
+			paths[numPaths++] = argv[i];
+		}
+	}
+
+	if (numPaths < 2) {
+		printf("Usage: --edit <file> <script> [--check]\n");
+		return 1;
+	}
+
+	FILE* fptr = fopen(paths[0], "rb");
+	FILE* script = fopen(paths[1], "rb");
+	if (fptr == NULL || script == NULL) {
+		printf("Could not open %s\n", fptr == NULL ? paths[0] : paths[1]);
+		if (fptr != NULL) {
+			fclose(fptr);
+		}
+		if (script != NULL) {
+			fclose(script);
+		}
+		return 1;
+	}
+	fclose(fptr);
+
+	string text;
+	string_init(&text, NULL);
+	string_load_file(paths[0], &text);
+	Document doc;
+	int errors = document_open(&doc, text.str != NULL ? text.str : "");
+	string_destroy(&text);
+	printf("Opened %s: %d tokens, %d items, %d error%s\n", paths[0], doc.tokens.len, doc.numItems, errors, errors == 1 ? "" : "s");
+
+	int result = 0;
+	int numEdits = 0;
+	long long totalNs = 0;
+	char line[4096];
+	while (fgets(line, sizeof(line), script) != NULL) {
+		int len = (int)strlen(line);
+		while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+			line[--len] = '\0';
+		}
+		if (len == 0 || line[0] == '#') {
+			continue;
+		}
+
+		int offset;
+		int removeLen;
+		int consumed = 0;
+		if (sscanf(line, "%d %d%n", &offset, &removeLen, &consumed) != 2) {
+			printf("Could not read the edit \"%s\"\n", line);
+			result = 1;
+			continue;
+		}
+		char* insert = line + consumed;
+		if (*insert == ' ') {
+			insert++;
+		}
+		document_unescape(insert);
+
+		long long start = platform_time_ns();
+		errors = document_edit(&doc, offset, removeLen, insert);
+		long long ns = platform_time_ns() - start;
+		totalNs += ns;
+		numEdits++;
+
+		printf("Edit %d: %d error%s | %d tokens lexed | %d items parsed | %.3f ms\n", numEdits, errors, errors == 1 ? "" : "s",
+			doc.lastTokensLexed, doc.lastItemsParsed, ns / 1000000.0);
+		if (check && !document_matches_full(&doc)) {
+			printf("Edit %d doesn't match lexing and parsing the text from scratch\n", numEdits);
+			result = 1;
+		}
+	}
+	fclose(script);
+
+	printf("%d edit%s in %.3f ms\n", numEdits, numEdits == 1 ? "" : "s", totalNs / 1000000.0);
+	if (document_matches_full(&doc)) {
+		printf("The document matches lexing and parsing the text from scratch\n");
+	}
+	else {
+		printf("The document doesn't match lexing and parsing the text from scratch\n");
+		result = 1;
+	}
+
+	document_destroy(&doc);
+	memory_report(stdout);
+	return result;
+}
+
+#endif
@@ -0,0 +1,465 @@
+#ifndef INLINER_H
+#define INLINER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Lexer.h"
+#include "Parser.h"
+#include "PGO.h"
+#include <stdbool.h>
+
+//This header file contains the function inlining pass, which replaces calls to small functions with a copy of the function body
+//
+//Only functions whose body is a single return statement are inlined, since the body then becomes a plain expression and the
+//parameters can be swapped out for the argument expressions without having to worry about local variables clashing with the
+//names used at the call site
+//
+//When there is a profile from earlier runs, it decides what happens to the calls it knows about. A call that never ran isn't inlined,
+//and a call that ran a lot is inlined even if the callee is bigger than the normal limit, using a budget of its own. Calls that the
+//profile doesn't know about go through the normal cost model
+
+//The largest body (in AST nodes) that a function can have and still be considered for inlining
+#define INLINE_MAX_CALLEE_SIZE 16
+//Roughly what a call costs compared to a single node, which is the benefit that inlining gets to weigh against code growth
+#define INLINE_CALL_COST 6
+//How many inlined bodies can be nested inside of each other through calls made from already inlined code
+#define INLINE_MAX_DEPTH 4
+//How many nodes a single top level function (or the top level statements) is allowed to grow by in total
+#define INLINE_GROWTH_BUDGET 256
+
+typedef struct Inline_Candidate {
+	//The function definition node in the root node's list
+	AST* definition;
+	//The expression returned by the function, or NULL if the function can't be inlined
+	AST* expr;
+	int size;
+	int num_params;
+} Inline_Candidate;
+
+typedef struct Inliner {
+	tokenList* tokens;
+	//One entry for every function definition found in the root node
+	Inline_Candidate* candidates;
+	int num_candidates;
+	//The functions currently being expanded, starting with the function whose body is being walked. A call to anything in
+	//this stack is recursive and won't be inlined
+	int stack[INLINE_MAX_DEPTH + 1];
+	int depth;
+	//How many more nodes the current function is allowed to grow by
+	int budget;
+	int num_inlined;
+	int num_rejected;
+	//The profile from earlier runs, or NULL if there isn't one
+	PGO_Profile* profile;
+	//The name of the function whose body is being walked, the depth its own calls are at, and how many calls it has made to each
+	//candidate so far, which is how a call is matched up with the call site in the profile
+	char caller[PGO_MAX_NAME];
+	int base;
+	int* which;
+	//How many times the call being looked at ran in the profile, or -1 if the profile doesn't know
+	long long count;
+	//How many more nodes the current function is allowed to grow by from inlining hot calls
+	int hot_budget;
+	int num_hot;
+	int num_cold;
+} Inliner;
+
+//Returns the index of the candidate with the same name as the function identifier at token_index, or -1 if there isn't one
+int inliner_find_candidate(Inliner* inl, int token_index) {
+	for (int i = 0; i < inl->num_candidates; i++) {
+		if (token_name_equal(inl->tokens, inl->candidates[i].definition->token_index, token_index)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+//Returns which parameter of the candidate the identifier at token_index refers to, or -1 if it isn't a parameter
+int inliner_param_index(Inliner* inl, Inline_Candidate* cand, int token_index) {
+	for (int i = 0; i < cand->num_params; i++) {
+		AST* param = &((AST*)cand->definition->list.arr)[i];
+		if (token_name_equal(inl->tokens, param->token_index, token_index)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+typedef struct Inline_Uses {
+	Inliner* inl;
+	Inline_Candidate* cand;
+	int* uses;
+} Inline_Uses;
+
+int inliner_count_uses_visit(AST_Visitor* visitor, AST* node) {
+	Inline_Uses* data = (Inline_Uses*)visitor->data;
+	int param = inliner_param_index(data->inl, data->cand, node->token_index);
+	if (param != -1) {
+		data->uses[param]++;
+	}
+	return VISIT_CONTINUE;
+}
+
+//Counts how many times each parameter is used in the given expression
+void inliner_count_uses(Inliner* inl, Inline_Candidate* cand, AST* node, int* uses) {
+	Inline_Uses data = { .inl = inl, .cand = cand, .uses = uses };
+	AST_Visitor visitor;
+	AST_visitor_init(&visitor, NULL, &data);
+	AST_visitor_on(&visitor, AST_IDENTIFIER_VARIABLE, inliner_count_uses_visit);
+	AST_visit(&visitor, node, VISIT_PRE_ORDER);
+	AST_visitor_destroy(&visitor);
+}
+
+int inliner_side_effect_visit(AST_Visitor* visitor, AST* node) {
+	(void)visitor;
+	(void)node;
+	return VISIT_STOP;
+}
+
+//Returns true if evaluating the expression could do more than compute a value, in which case it can't be duplicated or dropped
+int inliner_has_side_effects(AST* node) {
+	AST_Visitor visitor;
+	AST_visitor_init(&visitor, NULL, NULL);
+	AST_visitor_on(&visitor, AST_FUNCTION_CALL, inliner_side_effect_visit);
+	AST_visitor_on(&visitor, AST_ASSIGN, inliner_side_effect_visit);
+	int finished = AST_visit(&visitor, node, VISIT_PRE_ORDER);
+	AST_visitor_destroy(&visitor);
+	return !finished;
+}
+
+typedef struct Inline_Order {
+	Inliner* inl;
+	Inline_Candidate* cand;
+	AST* args;
+	//The next parameter whose argument has to be evaluated
+	int next;
+} Inline_Order;
+
+//A literal argument gives the same value wherever it ends up, so it doesn't matter where it is used or how many times
+int inliner_arg_is_literal(AST* arg) {
+	return arg->type == AST_LITERAL;
+}
+
+void inliner_order_skip_literals(Inline_Order* order) {
+	while (order->next < order->cand->num_params && inliner_arg_is_literal(&order->args[order->next])) {
+		order->next++;
+	}
+}
+
+int inliner_order_visit(AST_Visitor* visitor, AST* node) {
+	Inline_Order* order = (Inline_Order*)visitor->data;
+
+	//A call in the body runs after every argument at the call site, so every argument has to have been used by now
+	if (node->type == AST_FUNCTION_CALL) {
+		return order->next < order->cand->num_params ? VISIT_STOP : VISIT_CONTINUE;
+	}
+
+	int param = inliner_param_index(order->inl, order->cand, node->token_index);
+	if (param == -1 || inliner_arg_is_literal(&order->args[param])) {
+		return VISIT_CONTINUE;
+	}
+	if (param != order->next) {
+		return VISIT_STOP;
+	}
+	order->next++;
+	inliner_order_skip_literals(order);
+	return VISIT_CONTINUE;
+}
+
+//Returns true if the inlined body would evaluate the arguments in the same order the call does. The arguments are all evaluated
+//before the call, left to right, but in the body each one is evaluated wherever its parameter is used. Once something has a side
+//effect, either an argument or a call in the body, every argument that isn't a literal has to be used exactly once, in the order of
+//the parameters, and before any call in the body, or else the side effects could happen in a different order or change what another
+//argument reads
+int inliner_keeps_order(Inliner* inl, Inline_Candidate* cand, AST* call) {
+	AST* args = (AST*)call->list.arr;
+	int side_effects = inliner_has_side_effects(cand->expr);
+	for (int i = 0; i < cand->num_params && !side_effects; i++) {
+		side_effects = inliner_has_side_effects(&args[i]);
+	}
+	if (!side_effects) {
+		return true;
+	}
+
+	Inline_Order order = { .inl = inl, .cand = cand, .args = args, .next = 0 };
+	inliner_order_skip_literals(&order);
+
+	//The operands of an expression are evaluated before the expression itself, so a post-order walk goes in the order of evaluation
+	AST_Visitor visitor;
+	AST_visitor_init(&visitor, NULL, &order);
+	AST_visitor_on(&visitor, AST_IDENTIFIER_VARIABLE, inliner_order_visit);
+	AST_visitor_on(&visitor, AST_FUNCTION_CALL, inliner_order_visit);
+	int finished = AST_visit(&visitor, cand->expr, VISIT_POST_ORDER);
+	AST_visitor_destroy(&visitor);
+	return finished && order.next == cand->num_params;
+}
+
+typedef struct Inline_Substitute {
+	Inliner* inl;
+	Inline_Candidate* cand;
+	AST* args;
+	AST_Copy copy;
+} Inline_Substitute;
+
+int inliner_substitute_visit(AST_Visitor* visitor, AST* node) {
+	Inline_Substitute* data = (Inline_Substitute*)visitor->data;
+	AST* dest = AST_copy_place(&data->copy, node, visitor->depth);
+	if (node->type != AST_IDENTIFIER_VARIABLE) {
+		return VISIT_CONTINUE;
+	}
+
+	int param = inliner_param_index(data->inl, data->cand, node->token_index);
+	if (param != -1) {
+		AST_copy(dest, &data->args[param]);
+		dest->upRelation = node->upRelation;
+	}
+	return VISIT_CONTINUE;
+}
+
+//Copies the candidate's return expression into dest, replacing every use of a parameter with a copy of the matching argument
+void inliner_substitute(Inliner* inl, Inline_Candidate* cand, AST* dest, AST* src, AST* args) {
+	Inline_Substitute data = { .inl = inl, .cand = cand, .args = args };
+	AST_copy_init(&data.copy, dest);
+	AST_Visitor visitor;
+	AST_visitor_init(&visitor, inliner_substitute_visit, &data);
+	AST_visit(&visitor, src, VISIT_PRE_ORDER);
+	AST_visitor_destroy(&visitor);
+	AST_copy_destroy(&data.copy);
+}
+
+//Finds the returned expression of a function whose body is a single return statement, and leaves expr as NULL otherwise
+void inliner_candidate_expr(Inline_Candidate* cand) {
+	AST* def = cand->definition;
+	int num_statements = 0;
+	AST* statement = NULL;
+
+	cand->num_params = 0;
+	cand->expr = NULL;
+	for (int j = 0; j < def->list.len; j++) {
+		AST* child = &((AST*)def->list.arr)[j];
+		if (child->type == AST_FUNCTION_PARAMETER) {
+			cand->num_params++;
+		}
+		else {
+			num_statements++;
+			statement = child;
+		}
+	}
+
+	if (num_statements == 1 && statement->type == AST_RETURN && statement->list.len == 1) {
+		cand->expr = &((AST*)statement->list.arr)[0];
+	}
+}
+
+//This is the cost model. Returns true if the call is worth replacing with the body of the candidate
+int inliner_should_inline(Inliner* inl, int cand_index, AST* call) {
+	Inline_Candidate* cand = &inl->candidates[cand_index];
+
+	if (inl->depth > INLINE_MAX_DEPTH) {
+		return false;
+	}
+
+	//A call that never ran would only make the code bigger
+	if (inl->count == 0) {
+		inl->num_cold++;
+		return false;
+	}
+	int hot = inl->count > 0 && pgo_is_hot(inl->profile, inl->count);
+
+	for (int i = 0; i < inl->depth; i++) {
+		if (inl->stack[i] == cand_index) {
+			return false;
+		}
+	}
+
+	//A call from code that is being inlined means the body of the callee is needed, so this is where a body that was skipped by
+	//the parser finally gets parsed
+	if (cand->expr == NULL && parser_function_body(inl->tokens, cand->definition) == 0) {
+		inliner_candidate_expr(cand);
+	}
+
+	if (cand->expr == NULL || call->list.len != cand->num_params) {
+		return false;
+	}
+
+	//The size is measured again every time since the body of the candidate may have had calls inlined into it already
+	cand->size = AST_count_nodes(cand->expr);
+	if (cand->size > (hot ? PGO_HOT_CALLEE_SIZE : INLINE_MAX_CALLEE_SIZE)) {
+		return false;
+	}
+
+	int* uses = (int*)mem_calloc(cand->num_params + 1, sizeof(int));
+
+	if (uses == NULL) {
+		printf("Failed to allocate memory in inliner_should_inline\n");
+		exit(-1);
+	}
+
+	inliner_count_uses(inl, cand, cand->expr, uses);
+
+	//The call node and its arguments go away, and the body comes in with every parameter use replaced by the argument
+	int old_size = 1;
+	int new_size = cand->size;
+	int should_inline = true;
+	for (int i = 0; i < cand->num_params; i++) {
+		AST* arg = &((AST*)call->list.arr)[i];
+		int arg_size = AST_count_nodes(arg);
+
+		//An argument with side effects has to be evaluated exactly once, which can't be guaranteed if the parameter is used
+		//any other number of times
+		if (uses[i] != 1 && inliner_has_side_effects(arg)) {
+			should_inline = false;
+			break;
+		}
+
+		old_size += arg_size;
+		new_size += uses[i] * arg_size - uses[i];
+	}
+	mem_free(uses);
+
+	if (should_inline && !inliner_keeps_order(inl, cand, call)) {
+		should_inline = false;
+	}
+
+	int growth = new_size - old_size;
+	int* budget = hot ? &inl->hot_budget : &inl->budget;
+	if (!should_inline || growth - INLINE_CALL_COST > *budget) {
+		return false;
+	}
+
+	*budget -= growth > 0 ? growth : 0;
+	inl->num_hot += hot;
+	return true;
+}
+
+void inliner_visit(Inliner* inl, AST* node);
+
+int inliner_call_visit(AST_Visitor* visitor, AST* node) {
+	Inliner* inl = (Inliner*)visitor->data;
+	if (!token_is_function(inl->tokens->tokens[node->token_index])) {
+		return VISIT_CONTINUE;
+	}
+
+	int cand_index = inliner_find_candidate(inl, node->token_index);
+	if (cand_index == -1) {
+		return VISIT_CONTINUE;
+	}
+
+	//Only the calls that were in the function to begin with are in the profile, not the ones that came in with inlined code
+	inl->count = -1;
+	if (inl->profile != NULL && inl->depth == inl->base) {
+		char callee[PGO_MAX_NAME];
+		pgo_function_name(inl->tokens, inl->candidates[cand_index].definition->token_index, callee, sizeof(callee));
+		inl->count = pgo_call_count(inl->profile, inl->caller, callee, inl->which[cand_index]);
+		inl->which[cand_index]++;
+	}
+
+	if (!inliner_should_inline(inl, cand_index, node)) {
+		inl->num_rejected++;
+		return VISIT_CONTINUE;
+	}
+
+	//The walk is already done with the arguments, and the node itself stays where it is in the list of its parent, so it can be
+	//replaced in place
+	AST replacement;
+	inliner_substitute(inl, &inl->candidates[cand_index], &replacement, inl->candidates[cand_index].expr, (AST*)node->list.arr);
+	replacement.upRelation = node->upRelation;
+	replacement.prevNode = node->prevNode;
+	replacement.position = node->position;
+
+	AST_destroy_children(node);
+	*node = replacement;
+	AST_relink(node);
+	inl->num_inlined++;
+
+	//The inlined body can contain calls of its own, so it gets walked again with the callee on the stack so that recursion
+	//is caught and the depth is bounded
+	inl->stack[inl->depth] = cand_index;
+	inl->depth++;
+	inliner_visit(inl, node);
+	inl->depth--;
+	return VISIT_CONTINUE;
+}
+
+//Inlines the calls in node and everything under it. The walk is post-order so that the arguments of a call are already as small as
+//they can get when the cost of inlining the call is measured
+void inliner_visit(Inliner* inl, AST* node) {
+	AST_Visitor visitor;
+	AST_visitor_init(&visitor, NULL, inl);
+	AST_visitor_on(&visitor, AST_FUNCTION_CALL, inliner_call_visit);
+	AST_visit(&visitor, node, VISIT_POST_ORDER);
+	AST_visitor_destroy(&visitor);
+}
+
+//Runs the inlining pass over the whole AST, using the profile from earlier runs if it isn't NULL. Returns the number of calls that
+//were inlined
+int inliner_profiled(tokenList* list, AST** ast, PGO_Profile* profile) {
+	profiler_begin(PHASE_INLINE);
+	Inliner inl;
+	inl.tokens = list;
+	inl.num_candidates = 0;
+	inl.num_inlined = 0;
+	inl.num_rejected = 0;
+	inl.num_hot = 0;
+	inl.num_cold = 0;
+	inl.depth = 0;
+	inl.profile = profile;
+	inl.count = -1;
+	inl.candidates = (Inline_Candidate*)mem_alloc(((**ast).list.len + 1) * sizeof(Inline_Candidate));
+	//The top level statements are all one function, so their count of calls carries on across the function definitions between them
+	int* top_which = (int*)mem_calloc((**ast).list.len + 1, sizeof(int));
+	int* function_which = (int*)mem_calloc((**ast).list.len + 1, sizeof(int));
+
+	if (inl.candidates == NULL || top_which == NULL || function_which == NULL) {
+		printf("Failed to allocate memory in inliner\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < (**ast).list.len; i++) {
+		AST* def = &((AST*)(**ast).list.arr)[i];
+		if (def->type != AST_FUNCTION_DEFINITION) {
+			continue;
+		}
+
+		Inline_Candidate cand = { .definition = def, .expr = NULL, .size = 0, .num_params = 0 };
+		inliner_candidate_expr(&cand);
+		inl.candidates[inl.num_candidates] = cand;
+		inl.num_candidates++;
+	}
+
+	//Each function gets its own growth budget so that one function with a lot of calls can't use up the budget of the others
+	for (int i = 0; i < (**ast).list.len; i++) {
+		AST* node = &((AST*)(**ast).list.arr)[i];
+
+		inl.budget = INLINE_GROWTH_BUDGET;
+		inl.hot_budget = PGO_HOT_BUDGET;
+		inl.depth = 0;
+		inl.which = top_which;
+		snprintf(inl.caller, sizeof(inl.caller), "-");
+		if (node->type == AST_FUNCTION_DEFINITION) {
+			inl.stack[0] = inliner_find_candidate(&inl, node->token_index);
+			inl.depth = 1;
+			inl.which = function_which;
+			memset(function_which, 0, ((**ast).list.len + 1) * sizeof(int));
+			pgo_function_name(list, node->token_index, inl.caller, sizeof(inl.caller));
+		}
+		inl.base = inl.depth;
+
+		inliner_visit(&inl, node);
+		node->prevNode = *ast;
+		node->position = i;
+	}
+
+	mem_free(inl.candidates);
+	mem_free(top_which);
+	mem_free(function_which);
+	profiler_end();
+	return inl.num_inlined;
+}
+
+//Runs the inlining pass over the whole AST. Returns the number of calls that were inlined
+int inliner(tokenList* list, AST** ast) {
+	return inliner_profiled(list, ast, NULL);
+}
+
+#endif
@@ -25,6 +25,10 @@ enum TYPE {
 	TYPE_UNDEFINED = 5,
 };
 
+#define NUM_TOKEN_TYPES 6
+
+char* token_type_names[] = { "OPERATOR", "LITERAL", "IDENTIFIER", "KEYWORD", "PUNCTUATOR", "UNDEFINED" };
+
 enum LITERAL {
 	INT_LITERAL = 0,
 	FLOAT_LITERAL = 1,
@@ -38,6 +42,30 @@ enum KEYWORD {
 	KEYWORD_FLOAT = 1,
 	KEYWORD_STRING = 2,
 	KEYWORD_VOID = 3,
+	KEYWORD_RETURN = 4,
+	KEYWORD_IMPORT = 5,
+	KEYWORD_EXTERN = 6,
+};
+
+//IMPORTANT: The order of these must match the order of the operators string list
+enum OPERATOR {
+	OPERATOR_ADD = 0,
+	OPERATOR_SUBTRACT = 1,
+	OPERATOR_MULTIPLY = 2,
+	OPERATOR_DIVIDE = 3,
+	OPERATOR_ASSIGN = 4,
+	OPERATOR_LESS = 5,
+	OPERATOR_GREATER = 6,
+};
+
+//IMPORTANT: The order of these must match the order of the punctuators string list
+enum PUNCTUATOR {
+	PUNCTUATOR_SEMICOLON = 0,
+	PUNCTUATOR_OPEN_PAREN = 1,
+	PUNCTUATOR_CLOSE_PAREN = 2,
+	PUNCTUATOR_OPEN_BRACE = 3,
+	PUNCTUATOR_CLOSE_BRACE = 4,
+	PUNCTUATOR_COMMA = 5,
 };
 
 //It is important that no altering string operations are done to these, as
@@ -66,6 +94,8 @@ string keywords[] = {
 	{.str = "string", .len = 6, .__size = 7},
 	{.str = "void", .len = 4, .__size = 5},
 	{.str = "return", .len = 6, .__size = 7},
+	{.str = "import", .len = 6, .__size = 7},
+	{.str = "extern", .len = 6, .__size = 7},
 };
 
 //It is important that no altering string operations are done to these, as
@@ -103,17 +133,30 @@ void tokenList_init(tokenList* list) {
 }
 
 void tokenList_destroy(tokenList* list) {
-	free(list->tokens);
+	mem_free(list->tokens);
 	list->len = 0;
 	list->__size = 1;
 	list->tokens = NULL;
 }
 
+//Frees the strings held by the identifier, undefined, and string literal tokens along with the list itself
+void tokenList_destroy_all(tokenList* list) {
+	for (int i = 0; i < list->len; i++) {
+		token tok = list->tokens[i];
+		if (tok.type == IDENTIFIER || tok.type == TYPE_UNDEFINED || (tok.type == LITERAL && tok.mdata == STRING_LITERAL)) {
+			string_destroy((string*)tok.val);
+			mem_free((string*)tok.val);
+		}
+	}
+	tokenList_destroy(list);
+}
+
 int tokenList_append(tokenList* list, token tok) {
 	if (list->len + 1 >= list->__size) {
 		list->__size *= 2;
 
-		token* test = (token*)realloc(list->tokens, list->__size * sizeof(token));
+		profile_alloc(list->tokens, list->__size * sizeof(token));
+		token* test = (token*)mem_realloc(list->tokens, list->__size * sizeof(token));
 
 		if (test == NULL) {
 			printf("Failed to allocate memory in tokenList_append\n");
@@ -133,7 +176,7 @@ int tokenList_pop(tokenList* list) {
 	if (list->len - 1 <= list->__size / 2) {
 		list->__size /= 2;
 
-		token* test = (token*)realloc(list->tokens, list->__size * sizeof(token));
+		token* test = (token*)mem_realloc(list->tokens, list->__size * sizeof(token));
 
 		if (test == NULL) {
 			printf("Failed to allocate memory in tokenList_pop\n");
@@ -150,7 +193,8 @@ void tokenList_insert(tokenList* list, int index, token tok) {
 	if (list->len + 1 >= list->__size) {
 		list->__size *= 2;
 
-		token* test = (token*)realloc(list->tokens, list->__size * sizeof(token));
+		profile_alloc(list->tokens, list->__size * sizeof(token));
+		token* test = (token*)mem_realloc(list->tokens, list->__size * sizeof(token));
 
 		if (test == NULL) {
 			printf("Failed to allocate memory in tokenList_append\n");
@@ -177,7 +221,7 @@ void tokenList_remove(tokenList* list, int index) {
 	if (list->len - 1 <= list->__size / 2) {
 		list->__size /= 2;
 
-		token* test = (token*)realloc(list->tokens, list->__size * sizeof(token));
+		token* test = (token*)mem_realloc(list->tokens, list->__size * sizeof(token));
 
 		if (test == NULL) {
 			printf("Failed to allocate memory in tokenList_pop\n");
@@ -194,27 +238,39 @@ void tokenList_remove(tokenList* list, int index) {
 	list->len--;
 }
 
+//Replaces the removeCount tokens starting at index with the insertCount tokens in insert, moving everything after them only once
+void tokenList_splice(tokenList* list, int index, int removeCount, token* insert, int insertCount) {
+	int newLen = list->len - removeCount + insertCount;
+	if (newLen + 1 >= list->__size) {
+		while (newLen + 1 >= list->__size) {
+			list->__size *= 2;
+		}
+
+		profile_alloc(list->tokens, list->__size * sizeof(token));
+		token* test = (token*)mem_realloc(list->tokens, list->__size * sizeof(token));
+
+		if (test == NULL) {
+			printf("Failed to allocate memory in tokenList_splice\n");
+			exit(-1);
+		}
+
+		list->tokens = test;
+	}
+
+	if (removeCount != insertCount) {
+		memmove(&list->tokens[index + insertCount], &list->tokens[index + removeCount], (list->len - index - removeCount) * sizeof(token));
+	}
+	if (insertCount > 0) {
+		memcpy(&list->tokens[index], insert, insertCount * sizeof(token));
+	}
+	list->len = newLen;
+}
+
 void token_interpret_type(token tok) {
-	switch (tok.type) {
-	case (enum TYPE)OPERATOR:
-		printf("TYPE: OPERATOR\n");
-		break;
-	case (enum TYPE)LITERAL:
-		printf("TYPE: LITERAL\n");
-		break;
-	case (enum TYPE)IDENTIFIER:
-		printf("TYPE: IDENTIFIER\n");
-		break;
-	case (enum TYPE)KEYWORD:
-		printf("TYPE: KEYWORD\n");
-		break;
-	case (enum TYPE)PUNCTUATOR:
-		printf("TYPE: PUNCTUATOR\n");
-		break;
-	case (enum TYPE)TYPE_UNDEFINED:
-		printf("TYPE: UNDEFINED\n");
-		break;
-	default:
+	if (tok.type >= 0 && tok.type < NUM_TOKEN_TYPES) {
+		printf("TYPE: %s\n", token_type_names[tok.type]);
+	}
+	else {
 		printf("TYPE: ERROR\n");
 	}
 }
@@ -235,7 +291,7 @@ void token_interpret_val(token tok) {
 			printf("TOKEN: %lld\n", tok.val);
 		}
 		else if (tok.mdata == FLOAT_LITERAL) {
-			temp = *(double*)(&tok.val);
+			memcpy(&temp, &tok.val, sizeof(double));
 			printf("TOKEN: %lf\n", temp);
 		}
 		break;
@@ -259,6 +315,48 @@ void token_interpret_val(token tok) {
 	}
 }
 
+//Writes the text of the token into buffer (the same text token_interpret_val prints), truncating it if it doesn't fit in size
+//characters. Returns the number of characters written, not counting the null terminator
+int token_to_text(token tok, char* buffer, int size) {
+	int written;
+	switch (tok.type) {
+	case (enum TYPE)OPERATOR:
+		written = snprintf(buffer, size, "%s", operators[tok.val].str);
+		break;
+	case (enum TYPE)LITERAL:
+		if (tok.mdata == INT_LITERAL) {
+			written = snprintf(buffer, size, "%lld", tok.val);
+		}
+		else if (tok.mdata == FLOAT_LITERAL) {
+			double num;
+			memcpy(&num, &tok.val, sizeof(double));
+			written = snprintf(buffer, size, "%lf", num);
+		}
+		else {
+			written = snprintf(buffer, size, "%s", ((string*)tok.val)->str);
+		}
+		break;
+	case (enum TYPE)KEYWORD:
+		written = snprintf(buffer, size, "%s", keywords[tok.val].str);
+		break;
+	case (enum TYPE)PUNCTUATOR:
+		written = snprintf(buffer, size, "%s", punctuators[tok.val].str);
+		break;
+	case (enum TYPE)IDENTIFIER:
+	case (enum TYPE)TYPE_UNDEFINED:
+		written = snprintf(buffer, size, "%s", ((string*)tok.val)->str);
+		break;
+	default:
+		written = snprintf(buffer, size, "ERROR");
+		break;
+	}
+
+	if (written >= size) {
+		written = size - 1;
+	}
+	return written;
+}
+
 void token_interpret_mdata(token tok) {
 	if (tok.type == IDENTIFIER) {
 		if (tok.mdata >> (sizeof(unsigned int) * 8 - 1) == 1) {
@@ -288,21 +386,29 @@ void token_interpret_mdata(token tok) {
 	}
 }
 
-void tokenList_print(tokenList* list) {
-	for (int i = 0; i < list->len; i++) {
-		token_interpret_type(list->tokens[i]);
-		token_interpret_val(list->tokens[i]);
-		token_interpret_mdata(list->tokens[i]);
-		printf("\n");
-	}
-}
-
 void tokenList_print_individual(token tok) {
 	token_interpret_type(tok);
 	token_interpret_val(tok);
 	token_interpret_mdata(tok);
 }
 
+//Returns true if the token is an identifier that the lexer marked as a function by setting the leftmost bit of its mdata
+int token_is_function(token tok) {
+	return tok.type == IDENTIFIER && tok.mdata >> (sizeof(unsigned int) * 8 - 1) == 1;
+}
+
+//Returns the variable type of an identifier (or the return type if it is a function) as an index into the keywords list
+int token_identifier_type(token tok) {
+	return (tok.mdata << 1) >> 1;
+}
+
+//Returns true if the tokens at index1 and index2 are identifiers with the same name
+int token_name_equal(tokenList* list, int index1, int index2) {
+	string* name1 = (string*)list->tokens[index1].val;
+	string* name2 = (string*)list->tokens[index2].val;
+	return name1->len == name2->len && strcmp(name1->str, name2->str) == 0;
+}
+
 // Returns true if current index is a keyword of the language
 int lexer_is_keyword(string* str, int index, int index2) {
 	if (index == 0) {
@@ -326,24 +432,50 @@ int is_keyword_variable_type(int type) {
 	}
 }
 
-int lexer(tokenList* list, string* input) {
-	string s1, s2;
-	// Some files include the /r character that returns the cursor back to the start of the line
-	// In order to make parsing easier, this character will be removed
-	string_init(&s1, "\r");
-	string_init(&s2, NULL);
-	while (string_find_replace(input, &s1, &s2));
-
-	// This function will not work if tabs aren't removed because it relies on checking if the previous characters are spaces,
-	// so I will replace tabs with a single space to make this function work
-	string_set(&s1, "\t");
-	string_set(&s2, " ");
-	while (string_find_replace(input, &s1, &s2));
-
-	printf("%s\n\n", input->str);
-
-	string* tempstr = (string*)malloc(sizeof(string));
+//Gets rid of the characters the rest of the lexer can't deal with, in a single pass over the input
+int lexer_normalize(string* input) {
+	int len = 0;
+	for (int i = 0; i < input->len; i++) {
+		// Some files include the /r character that returns the cursor back to the start of the line
+		// In order to make parsing easier, this character will be removed
+		if (input->str[i] == '\r') {
+			continue;
+		}
+
+		// The lexer will not work if tabs aren't removed because it relies on checking if the previous characters are spaces,
+		// so I will replace tabs with a single space to make it work
+		input->str[len] = input->str[i] == '\t' ? ' ' : input->str[i];
+		len++;
+	}
+
+	input->len = len;
+	if (input->str != NULL) {
+		input->str[len] = '\0';
+	}
+	return 0;
+}
+
+//Adds a token along with where it came from in the input, if the caller wants to know that
+void lexer_add_token(tokenList* list, Vector_Int* positions, token tok, int start, int end) {
+	tokenList_append(list, tok);
+	if (positions != NULL) {
+		Vector_Int_Append(positions, start);
+		Vector_Int_Append(positions, end);
+	}
+}
+
+//This is the first stage of the lexer. It goes through the characters of input from index from up to index to and appends the
+//keywords, operators, punctuators, and string literals it finds, with everything else appended as TYPE_UNDEFINED tokens for the
+//second stage to figure out. The scan has to start somewhere that isn't inside of a string literal or the middle of a token
+//
+//If positions isn't NULL, the start and end (one past the last character) of every token in the input are appended to it as pairs.
+//Returns true if the scan ended inside of a string literal that was never closed
+int lexer_scan(tokenList* list, string* input, int from, int to, Vector_Int* positions) {
+	string* tempstr = (string*)mem_alloc(sizeof(string));
 	string_init(tempstr, NULL);
+	//Where the characters picked up by tempstr start and end in the input
+	int tempStart = 0;
+	int tempEnd = 0;
 
 	//Used to determine if currently inside a quote by using the modulus operator
 	int quoteCounter = 0;
@@ -353,7 +485,7 @@ int lexer(tokenList* list, string* input) {
 	int quoteIndices[2];
 
 	// This is the main loop that iterates through the given string and does the actual lexing
-	for (int i = 0; i < input->len; i++) {
+	for (int i = from; i < to; i++) {
 		prevQuoteCounter = quoteCounter;
 		// Skip over white space and newlines to save time
 		if (input->str[i] == ' ' || input->str[i] == '\n') {
@@ -370,10 +502,10 @@ int lexer(tokenList* list, string* input) {
 		if (quoteCounter % 2 == 0 && prevQuoteCounter % 2 == 1) {
 			//Needs to be allocated on heap since this data needs to be persistent
 			//Clean up will be handled later on
-			string* s1 = (string*)malloc(sizeof(string));
+			string* s1 = (string*)mem_alloc(sizeof(string));
 			string_init(s1, NULL);
 			string_substr(s1, input, quoteIndices[0] + 1, quoteIndices[1]);
-			tokenList_append(list, (token) { .type = LITERAL, .val = (long long)s1, .mdata = STRING_LITERAL });
+			lexer_add_token(list, positions, (token) { .type = LITERAL, .val = (long long)s1, .mdata = STRING_LITERAL }, quoteIndices[0], quoteIndices[1] + 1);
 		}
 
 		//Only check for keywords, operators, etc. if not currently inside of a string
@@ -383,14 +515,14 @@ int lexer(tokenList* list, string* input) {
 					if (tempstr->str != NULL) {
 						//Needs to be allocated on heap since this data needs to be persistent
 						//Clean up will be handled later on
-						string* s2 = (string*)malloc(sizeof(string));
+						string* s2 = (string*)mem_alloc(sizeof(string));
 						string_init(s2, NULL);
 						string_copy(s2, tempstr);
 						string_destroy(tempstr);
-						tokenList_append(list, (token) { .type = TYPE_UNDEFINED, .val = (long long)s2, .mdata = -1 });
+						lexer_add_token(list, positions, (token) { .type = TYPE_UNDEFINED, .val = (long long)s2, .mdata = -1 }, tempStart, tempEnd);
 					}
 
-					tokenList_append(list, (token) { .type = KEYWORD, .val = j, .mdata = -1 });
+					lexer_add_token(list, positions, (token) { .type = KEYWORD, .val = j, .mdata = -1 }, i, i + keywords[j].len);
 					//Subtract one to account for the addition of i at the end of the iteration
 					i = i + keywords[j].len - 1;
 					goto exit_if1;
@@ -402,14 +534,14 @@ int lexer(tokenList* list, string* input) {
 					if (tempstr->str != NULL) {
 						//Needs to be allocated on heap since this data needs to be persistent
 						//Clean up will be handled later on
-						string* s3 = (string*)malloc(sizeof(string));
+						string* s3 = (string*)mem_alloc(sizeof(string));
 						string_init(s3, NULL);
 						string_copy(s3, tempstr);
 						string_destroy(tempstr);
-						tokenList_append(list, (token) { .type = TYPE_UNDEFINED, .val = (long long)s3, .mdata = -1 });
+						lexer_add_token(list, positions, (token) { .type = TYPE_UNDEFINED, .val = (long long)s3, .mdata = -1 }, tempStart, tempEnd);
 					}
 
-					tokenList_append(list, (token) { .type = OPERATOR, .val = j, .mdata = -1 });
+					lexer_add_token(list, positions, (token) { .type = OPERATOR, .val = j, .mdata = -1 }, i, i + operators[j].len);
 					//Subtract one to account for the addition of i at the end of the iteration
 					i = i + operators[j].len - 1;
 					goto exit_if1;
@@ -421,14 +553,14 @@ int lexer(tokenList* list, string* input) {
 					if (tempstr->str != NULL) {
 						//Needs to be allocated on heap since this data needs to be persistent
 						//Clean up will be handled later on
-						string* s7 = (string*)malloc(sizeof(string));
+						string* s7 = (string*)mem_alloc(sizeof(string));
 						string_init(s7, NULL);
 						string_copy(s7, tempstr);
 						string_destroy(tempstr);
-						tokenList_append(list, (token) { .type = TYPE_UNDEFINED, .val = (long long)s7, .mdata = -1 });
+						lexer_add_token(list, positions, (token) { .type = TYPE_UNDEFINED, .val = (long long)s7, .mdata = -1 }, tempStart, tempEnd);
 					}
 
-					tokenList_append(list, (token) { .type = PUNCTUATOR, .val = j, .mdata = -1 });
+					lexer_add_token(list, positions, (token) { .type = PUNCTUATOR, .val = j, .mdata = -1 }, i, i + punctuators[j].len);
 					//Subtract one to account for the addition of i at the end of the iteration
 					i = i + punctuators[j].len - 1;
 					goto exit_if1;
@@ -437,6 +569,10 @@ int lexer(tokenList* list, string* input) {
 
 			//tempstr picks up all the characters not identified as keywords, operators, etc. by the lexer that are also not strings
 			//since strings are handled separately, and will be appended as an unidentified token that will be determined by the parser
+			if (tempstr->str == NULL) {
+				tempStart = i;
+			}
+			tempEnd = i + 1;
 			string_append(tempstr, input->str[i]);
 
 		exit_if1:
@@ -447,10 +583,117 @@ int lexer(tokenList* list, string* input) {
 	//Make sure that any extra characters picked up by tempstr are added as a token
 	//Also, for a reason I haven't been able to figure out, if the text file ends with a string tempstr.str isn't NULL
 	//which is why this if statement checks if the most recent token is a string so that a bad token isn't added to the list
-	if (list->len > 0 && tempstr->str != NULL && list->tokens[list->len - 1].type != LITERAL && list->tokens[list->len - 1].mdata != STRING_LITERAL) {
-		tokenList_append(list, (token) { .type = TYPE_UNDEFINED, .val = (long long)tempstr, .mdata = -1 });
+	//A scan that starts partway through the input comes right after a token that isn't a string, even if it hasn't added any itself
+	int afterString = list->len > 0 ? list->tokens[list->len - 1].type == LITERAL || list->tokens[list->len - 1].mdata == STRING_LITERAL : from == 0;
+	if (tempstr->str != NULL && !afterString) {
+		lexer_add_token(list, positions, (token) { .type = TYPE_UNDEFINED, .val = (long long)tempstr, .mdata = -1 }, tempStart, tempEnd);
+	}
+	else {
+		string_destroy(tempstr);
+		mem_free(tempstr);
+	}
+
+	return quoteCounter % 2 == 1;
+}
+
+//If the token at index i is a TYPE_UNDEFINED token right after a variable type keyword, then according to the heuristic I am using
+//that would make it the declaration of an identifier. Marks it as an identifier and returns true if it is
+int lexer_declaration(tokenList* list, int i) {
+	if (i < 1 || list->tokens[i].type != TYPE_UNDEFINED || list->tokens[i - 1].type != KEYWORD || !is_keyword_variable_type(list->tokens[i - 1].val)) {
+		return false;
+	}
+
+	list->tokens[i].type = IDENTIFIER;
+
+	//The mdata of the identifier will identify what type the identifier is (int, string, float, etc.). The way I have things set
+	//up this corresponds to being the .val of the keyword token, which itself corresponds to an index in the keywords string list
+	list->tokens[i].mdata = list->tokens[i - 1].val;
+
+	//Check to see if the next token is a parentheses punctuator because that would indicate the current identifier is
+	//actually a function identifier, which needs to be specially identified. To do this, function identifiers will have
+	//their leftmost bit set to 1 in order to differentiate them from regular identifiers, while still preserving the type
+	//information because that indicates what the return type is
+	if (i < list->len - 1) {
+		if (list->tokens[i + 1].type == PUNCTUATOR && list->tokens[i + 1].val == PUNCTUATOR_OPEN_PAREN) {
+			//This sets the leftmost bit to be 1
+			list->tokens[i].mdata = list->tokens[i].mdata ^ (1 << (sizeof(unsigned int) * 8 - 1));
+		}
+	}
+	return true;
+}
+
+//Turns a TYPE_UNDEFINED token that is made up of only digits (and possibly a decimal point) into an int or float literal. Returns
+//true if it was a number
+int lexer_number(token* tok) {
+	string* str = (string*)tok->val;
+
+	int int_count = 0;
+	for (int j = 0; j < str->len; j++) {
+		if (str->str[j] >= 48 && str->str[j] <= 57) {
+			int_count++;
+		}
+		else {
+			break;
+		}
+	}
+
+	if (int_count == str->len) {
+		//Make copy of string in token before freeing contents of that token to make space for the integer
+		string s4;
+		string_init(&s4, str->str);
+
+		//Free the string pointer inside the string
+		string_destroy(str);
+		//Free the actual struct since it was allocated on the heap
+		mem_free(str);
+
+		tok->val = atoll(s4.str);
+		tok->type = LITERAL;
+		tok->mdata = INT_LITERAL;
+
+		string_destroy(&s4);
+		return true;
+	}
+
+	int float_count = 0;
+	for (int j = 0; j < str->len; j++) {
+		if ((str->str[j] >= 48 && str->str[j] <= 57) || str->str[j] == '.') {
+			float_count++;
+		}
+		else {
+			break;
+		}
 	}
 
+	if (str->len == float_count) {
+		//Make copy of string in token before freeing contents of that token to make space for the integer
+		string s5;
+		string_init(&s5, str->str);
+
+		//Free the string pointer inside the string
+		string_destroy(str);
+		//Free the actual struct since it was allocated on the heap
+		mem_free(str);
+
+		double temp_double = atof(s5.str);
+
+		//Copy the bits of the double into val as they are, the same way token_to_text and the dumper read them back out
+		memcpy(&tok->val, &temp_double, sizeof(double));
+		tok->type = LITERAL;
+		tok->mdata = FLOAT_LITERAL;
+
+		string_destroy(&s5);
+		return true;
+	}
+
+	return false;
+}
+
+//The second stage of the lexer. Finds every declaration, and then turns the tokens the first stage couldn't figure out into
+//identifiers of the declared names, ints, or floats
+void lexer_resolve(tokenList* list) {
+	profiler_begin(PHASE_LEX_DECLARATIONS);
+
 	//This list will contain the identifiers found from the tokens output from the code above
 	string_list identifiers;
 	string_list_init(&identifiers);
@@ -462,27 +705,12 @@ int lexer(tokenList* list, string* input) {
 	//The reason the loop starts at 1 is because it has to look at the previous element, and if that happened at index 0
 	//an index out of bounds error would occur
 	for (int i = 1; i < list->len; i++) {
-		//If the current token type is undefined and the previous type is a keyword that is also a variable type, then according
-		//to the heuristic I am using that would make the current token an identifier
-		if (list->tokens[i].type == TYPE_UNDEFINED && list->tokens[i - 1].type == KEYWORD && is_keyword_variable_type(list->tokens[i - 1].val)) {
+		if (lexer_declaration(list, i)) {
 			string_list_append(&identifiers, *((string*)list->tokens[i].val));
-			Vector_Int_Append(&identifiers_type, list->tokens[i - 1].val);
-			list->tokens[i].type = IDENTIFIER;
-
-			//The mdata of the identifier will identify what type the identifier is (int, string, float, etc.). The way I have things set
-			//up this corresponds to being the .val of the keyword token, which itself corresponds to an index in the keywords string list
-			list->tokens[i].mdata = list->tokens[i - 1].val;
-
-			//Check to see if the next token is a parentheses punctuator because that would indicate the current identifier is
-			//actually a function identifier, which needs to be specially identified. To do this, function identifiers will have
-			//their leftmost bit set to 1 in order to differentiate them from regular identifiers, while still preserving the type
-			//information because that indicates what the return type is
-			if (i < list->len - 1) {
-				if (list->tokens[i + 1].type == PUNCTUATOR && list->tokens[i + 1].val == 1) {
-					//This sets the leftmost bit to be 1
-					list->tokens[i].mdata = list->tokens[i].mdata ^ (1 << (sizeof(unsigned int) * 8 - 1));
-				}
-			}
+
+			//The type is appended after the function check so that the function bit carries over to every later use of the
+			//identifier, which is what lets later passes like the inliner pick out call sites
+			Vector_Int_Append(&identifiers_type, list->tokens[i].mdata);
 		}
 	}
 
@@ -491,84 +719,44 @@ int lexer(tokenList* list, string* input) {
 
 	//This loop properly identifies int_literals, float_literals, and identifiers from the remaining tokens that
 	//were marked as TYPE_UNDEFINED because they could not be determined in the first stage of the lexer
+	profiler_begin(PHASE_LEX_RESOLVE);
 	for (int i = 0; i < list->len; i++) {
 		if (list->tokens[i].type == TYPE_UNDEFINED) {
 			for (int j = 0; j < identifiers.len; j++) {
-				int identifier_index = string_find((string*)list->tokens[i].val, &identifiers.strings[j]);
-
-				if (identifier_index != -1) {
+				//This has to be an exact match. string_find also matches when the identifier only shows up somewhere inside of the
+				//token, which would make a token like name resolve to an earlier identifier like a
+				string* candidate = (string*)list->tokens[i].val;
+				if (candidate->len == identifiers.strings[j].len && strcmp(candidate->str, identifiers.strings[j].str) == 0) {
 					list->tokens[i].type = IDENTIFIER;
 					list->tokens[i].mdata = identifiers_type.vec[j];
 					break;
 				}
 			}
 
-			int int_count = 0;
-			for (int j = 0; j < ((string*)list->tokens[i].val)->len; j++) {
-				if (((string*)list->tokens[i].val)->str[j] >= 48 && ((string*)list->tokens[i].val)->str[j] <= 57) {
-					int_count++;
-				}
-				else {
-					break;
-				}
-			}
-
-			if (int_count == ((string*)list->tokens[i].val)->len) {
-				//Make copy of string in token before freeing contents of that token to make space for the integer
-				string s4;
-				string_init(&s4, ((string*)list->tokens[i].val)->str);
-
-				//Free the string pointer inside the string
-				string_destroy((string*)list->tokens[i].val);
-				//Free the actual struct since it was allocated on the heap
-				free((string*)list->tokens[i].val);
-
-				list->tokens[i].val = atoll(s4.str);
-				list->tokens[i].type = LITERAL;
-				list->tokens[i].mdata = INT_LITERAL;
-
-				string_destroy(&s4);
-				continue;
-			}
-
-			int float_count = 0;
-			for (int j = 0; j < ((string*)list->tokens[i].val)->len; j++) {
-				string* temp_ptr = (string*)list->tokens[i].val;
-				if ((temp_ptr->str[j] >= 48 && temp_ptr->str[j] <= 57) || temp_ptr->str[j] == '.') {
-					float_count++;
-				}
-				else {
-					break;
-				}
-			}
-
-			if (((string*)list->tokens[i].val)->len == float_count) {
-				//Make copy of string in token before freeing contents of that token to make space for the integer
-				string s5;
-				string_init(&s5, ((string*)list->tokens[i].val)->str);
-
-				//Free the string pointer inside the string
-				string_destroy((string*)list->tokens[i].val);
-				//Free the actual struct since it was allocated on the heap
-				free((string*)list->tokens[i].val);
-
-				double temp_double = atof(s5.str);
-
-				//Cast temp_double pointer to long long pointer and then dereferen to preserve bits of float in long long
-				list->tokens[i].val = *(long long*)(&temp_double);
-				list->tokens[i].type = LITERAL;
-				list->tokens[i].mdata = FLOAT_LITERAL;
-
-				string_destroy(&s5);
-				continue;
-			}
+			lexer_number(&list->tokens[i]);
 		}
 	}
 
 	//The only thing that has to be freed are the pointers to the strings themselves, not the actual memory of each buffer of each string
 	//pointed to by identifiers.strings
-	free(identifiers.strings);
+	mem_free(identifiers.strings);
 	Vector_Int_Destroy(&identifiers_type);
+	profiler_end();
+}
+
+int lexer(tokenList* list, string* input) {
+	profiler_begin(PHASE_NORMALIZE);
+	lexer_normalize(input);
+	profile_count(&profiler.sourceBytes, input->len);
+	profiler_end();
+
+	profiler_begin(PHASE_LEX_SCAN);
+	lexer_scan(list, input, 0, input->len, NULL);
+	profile_count(&profiler.tokens, list->len);
+	profiler_end();
+
+	lexer_resolve(list);
+	return 0;
 }
 
-#endif
\ No newline at end of file
+#endif
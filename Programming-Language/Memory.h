@@ -0,0 +1,399 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Platform.h"
+#include <stdbool.h>
+
+//This header file contains the allocator every container goes through. Everything should use mem_alloc, mem_calloc, mem_realloc,
+//and mem_free instead of calling malloc and friends directly
+//
+//Normally those are just malloc, calloc, realloc, and free, so they cost nothing. When MEMORY_TRACKING is defined (which the Debug
+//configurations do), they go through memory_allocator instead, which can be swapped out with memory_set_allocator and starts out
+//as the tracking allocator. The tracking allocator remembers every live allocation along with the line of code that made it, so
+//memory_report can print the high-water mark, how much memory each line is holding onto, and anything that was never freed
+//
+//The tracking allocator keeps its table on the side instead of putting a header in front of every allocation, so memory that is
+//handed to plain free by mistake just shows up as a leak instead of crashing
+
+typedef struct Allocator {
+	char* name;
+	void* (*alloc)(size_t size, char* file, int line);
+	void* (*resize)(void* ptr, size_t size, char* file, int line);
+	void (*release)(void* ptr);
+} Allocator;
+
+#ifdef MEMORY_TRACKING
+
+#ifdef _WIN32
+typedef SRWLOCK memory_lock_t;
+#define MEMORY_LOCK_INIT SRWLOCK_INIT
+#define memory_lock(lock) AcquireSRWLockExclusive(lock)
+#define memory_unlock(lock) ReleaseSRWLockExclusive(lock)
+#else
+#include <pthread.h>
+typedef pthread_mutex_t memory_lock_t;
+#define MEMORY_LOCK_INIT PTHREAD_MUTEX_INITIALIZER
+#define memory_lock(lock) pthread_mutex_lock(lock)
+#define memory_unlock(lock) pthread_mutex_unlock(lock)
+#endif
+
+//How many of the lines holding onto the most memory memory_report prints
+#define MEMORY_REPORT_SITES 20
+//A slot of the block table whose allocation was freed. It has to stay different from an empty slot so that lookups keep going
+#define MEMORY_TOMBSTONE ((void*)1)
+
+//A line of code that allocates memory
+typedef struct Memory_Site {
+	//The str of an empty slot is NULL. __FILE__ is a string literal, so it can be kept as is
+	char* file;
+	int line;
+	long long liveBytes;
+	long long liveBlocks;
+	long long peakBytes;
+	long long allocs;
+} Memory_Site;
+
+typedef struct Memory_Block {
+	void* ptr;
+	long long size;
+	int site;
+} Memory_Block;
+
+typedef struct Memory_Tracker {
+	//Open addressing hash table of every live allocation
+	Memory_Block* blocks;
+	//Includes tombstones, since they take up room in the table too
+	int numBlocks;
+	int __blocksSize;
+	//Open addressing hash table of every line that has allocated anything
+	Memory_Site* sites;
+	int numSites;
+	int __sitesSize;
+	long long liveBytes;
+	long long liveBlocks;
+	long long peakBytes;
+	long long allocs;
+	long long reallocs;
+	long long frees;
+} Memory_Tracker;
+
+Memory_Tracker memory_tracker = { 0 };
+memory_lock_t memory_tracker_lock = MEMORY_LOCK_INIT;
+
+static inline unsigned int memory_hash_pointer(void* ptr) {
+	unsigned long long bits = (unsigned long long)ptr >> 4;
+	return (unsigned int)((bits * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+//The tables of the tracker use plain malloc and free, since going through the allocator here would have it tracking itself
+void memory_grow_blocks(Memory_Tracker* tracker) {
+	int oldSize = tracker->__blocksSize;
+	Memory_Block* old = tracker->blocks;
+
+	//Only grow if the table is actually full of live blocks, otherwise rebuilding it at the same size clears out the tombstones
+	tracker->__blocksSize = oldSize == 0 ? 1024 : (tracker->liveBlocks * 2 >= oldSize ? oldSize * 2 : oldSize);
+	tracker->blocks = (Memory_Block*)calloc(tracker->__blocksSize, sizeof(Memory_Block));
+
+	if (tracker->blocks == NULL) {
+		printf("Failed to allocate memory in memory_grow_blocks\n");
+		exit(-1);
+	}
+
+	tracker->numBlocks = 0;
+	for (int i = 0; i < oldSize; i++) {
+		if (old[i].ptr == NULL || old[i].ptr == MEMORY_TOMBSTONE) {
+			continue;
+		}
+
+		unsigned int slot = memory_hash_pointer(old[i].ptr) & (tracker->__blocksSize - 1);
+		while (tracker->blocks[slot].ptr != NULL) {
+			slot = (slot + 1) & (tracker->__blocksSize - 1);
+		}
+		tracker->blocks[slot] = old[i];
+		tracker->numBlocks++;
+	}
+	free(old);
+}
+
+//Returns the slot of the block table holding ptr, or -1 if ptr isn't being tracked
+int memory_find_block(Memory_Tracker* tracker, void* ptr) {
+	if (tracker->__blocksSize == 0) {
+		return -1;
+	}
+
+	unsigned int slot = memory_hash_pointer(ptr) & (tracker->__blocksSize - 1);
+	while (tracker->blocks[slot].ptr != NULL) {
+		if (tracker->blocks[slot].ptr == ptr) {
+			return slot;
+		}
+		slot = (slot + 1) & (tracker->__blocksSize - 1);
+	}
+	return -1;
+}
+
+//Returns the index of the site for the given line, adding it if it isn't in the table yet
+int memory_find_site(Memory_Tracker* tracker, char* file, int line) {
+	if (tracker->numSites * 2 >= tracker->__sitesSize) {
+		int oldSize = tracker->__sitesSize;
+		Memory_Site* old = tracker->sites;
+
+		tracker->__sitesSize = oldSize == 0 ? 256 : oldSize * 2;
+		tracker->sites = (Memory_Site*)calloc(tracker->__sitesSize, sizeof(Memory_Site));
+
+		if (tracker->sites == NULL) {
+			printf("Failed to allocate memory in memory_find_site\n");
+			exit(-1);
+		}
+
+		//The blocks point at their sites by index, so they have to follow their sites to the new slots
+		int* moved = (int*)malloc((oldSize + 1) * sizeof(int));
+		if (moved == NULL) {
+			printf("Failed to allocate memory in memory_find_site\n");
+			exit(-1);
+		}
+
+		for (int i = 0; i < oldSize; i++) {
+			if (old[i].file != NULL) {
+				unsigned int slot = memory_hash_pointer(old[i].file) + old[i].line * 31;
+				slot &= tracker->__sitesSize - 1;
+				while (tracker->sites[slot].file != NULL) {
+					slot = (slot + 1) & (tracker->__sitesSize - 1);
+				}
+				tracker->sites[slot] = old[i];
+				moved[i] = slot;
+			}
+		}
+
+		for (int i = 0; i < tracker->__blocksSize; i++) {
+			if (tracker->blocks[i].ptr != NULL && tracker->blocks[i].ptr != MEMORY_TOMBSTONE) {
+				tracker->blocks[i].site = moved[tracker->blocks[i].site];
+			}
+		}
+		free(moved);
+		free(old);
+	}
+
+	unsigned int slot = (memory_hash_pointer(file) + line * 31) & (tracker->__sitesSize - 1);
+	while (tracker->sites[slot].file != NULL) {
+		if (tracker->sites[slot].file == file && tracker->sites[slot].line == line) {
+			return slot;
+		}
+		slot = (slot + 1) & (tracker->__sitesSize - 1);
+	}
+
+	tracker->sites[slot] = (Memory_Site){ .file = file, .line = line };
+	tracker->numSites++;
+	return slot;
+}
+
+//Both of these expect the lock to already be held
+void memory_track(Memory_Tracker* tracker, void* ptr, long long size, char* file, int line) {
+	if ((tracker->numBlocks + 1) * 4 >= tracker->__blocksSize * 3) {
+		memory_grow_blocks(tracker);
+	}
+
+	int site = memory_find_site(tracker, file, line);
+	unsigned int slot = memory_hash_pointer(ptr) & (tracker->__blocksSize - 1);
+	while (tracker->blocks[slot].ptr != NULL && tracker->blocks[slot].ptr != MEMORY_TOMBSTONE) {
+		slot = (slot + 1) & (tracker->__blocksSize - 1);
+	}
+	if (tracker->blocks[slot].ptr == NULL) {
+		tracker->numBlocks++;
+	}
+	tracker->blocks[slot] = (Memory_Block){ .ptr = ptr, .size = size, .site = site };
+
+	Memory_Site* s = &tracker->sites[site];
+	s->liveBytes += size;
+	s->liveBlocks++;
+	s->allocs++;
+	if (s->liveBytes > s->peakBytes) {
+		s->peakBytes = s->liveBytes;
+	}
+
+	tracker->liveBytes += size;
+	tracker->liveBlocks++;
+	if (tracker->liveBytes > tracker->peakBytes) {
+		tracker->peakBytes = tracker->liveBytes;
+	}
+}
+
+void memory_untrack(Memory_Tracker* tracker, void* ptr) {
+	int slot = memory_find_block(tracker, ptr);
+	if (slot == -1) {
+		return;
+	}
+
+	Memory_Block* block = &tracker->blocks[slot];
+	tracker->sites[block->site].liveBytes -= block->size;
+	tracker->sites[block->site].liveBlocks--;
+	tracker->liveBytes -= block->size;
+	tracker->liveBlocks--;
+	block->ptr = MEMORY_TOMBSTONE;
+}
+
+void* memory_tracking_alloc(size_t size, char* file, int line) {
+	void* ptr = malloc(size);
+	if (ptr != NULL) {
+		memory_lock(&memory_tracker_lock);
+		memory_track(&memory_tracker, ptr, size, file, line);
+		memory_tracker.allocs++;
+		memory_unlock(&memory_tracker_lock);
+	}
+	return ptr;
+}
+
+void* memory_tracking_resize(void* ptr, size_t size, char* file, int line) {
+	//The old block has to be untracked before realloc frees it, since another thread could be handed the same address and track it
+	//as soon as it is freed
+	Memory_Block old = { .ptr = NULL, .size = 0, .site = 0 };
+	if (ptr != NULL) {
+		memory_lock(&memory_tracker_lock);
+		int slot = memory_find_block(&memory_tracker, ptr);
+		if (slot != -1) {
+			old = memory_tracker.blocks[slot];
+			memory_untrack(&memory_tracker, ptr);
+		}
+		memory_unlock(&memory_tracker_lock);
+	}
+
+	void* moved = realloc(ptr, size);
+
+	memory_lock(&memory_tracker_lock);
+	if (moved == NULL) {
+		//The old block is still there, so it goes back to the line it was charged to. That isn't a new allocation from that line. A
+		//size of 0 frees the block instead
+		if (old.ptr != NULL && size != 0) {
+			Memory_Site site = memory_tracker.sites[old.site];
+			memory_track(&memory_tracker, ptr, old.size, site.file, site.line);
+			//Tracking it can move the sites around, so the block says where its site is now
+			int slot = memory_find_block(&memory_tracker, ptr);
+			memory_tracker.sites[memory_tracker.blocks[slot].site].allocs--;
+		}
+	}
+	else {
+		//The memory is charged to the line that resized it last, which for a container is its append function
+		if (ptr != NULL) {
+			memory_tracker.reallocs++;
+		}
+		else {
+			memory_tracker.allocs++;
+		}
+		memory_track(&memory_tracker, moved, size, file, line);
+	}
+	memory_unlock(&memory_tracker_lock);
+	return moved;
+}
+
+void memory_tracking_release(void* ptr) {
+	if (ptr == NULL) {
+		return;
+	}
+
+	memory_lock(&memory_tracker_lock);
+	memory_untrack(&memory_tracker, ptr);
+	memory_tracker.frees++;
+	memory_unlock(&memory_tracker_lock);
+	free(ptr);
+}
+
+Allocator memory_tracking_allocator = { .name = "tracking", .alloc = memory_tracking_alloc, .resize = memory_tracking_resize,
+	.release = memory_tracking_release };
+
+Allocator* memory_allocator = &memory_tracking_allocator;
+
+//Swaps the allocator used from now on. Anything allocated by the old one has to be freed before switching, since the new one won't
+//know where it came from
+void memory_set_allocator(Allocator* allocator) {
+	memory_allocator = allocator;
+}
+
+void* memory_calloc(size_t count, size_t size, char* file, int line) {
+	void* ptr = memory_allocator->alloc(count * size, file, line);
+	if (ptr != NULL) {
+		memset(ptr, 0, count * size);
+	}
+	return ptr;
+}
+
+#define mem_alloc(size) memory_allocator->alloc((size), __FILE__, __LINE__)
+#define mem_calloc(count, size) memory_calloc((count), (size), __FILE__, __LINE__)
+#define mem_realloc(ptr, size) memory_allocator->resize((ptr), (size), __FILE__, __LINE__)
+#define mem_free(ptr) memory_allocator->release(ptr)
+
+int memory_compare_sites(const void* a, const void* b) {
+	long long x = (*(Memory_Site**)a)->liveBytes;
+	long long y = (*(Memory_Site**)b)->liveBytes;
+	return x < y ? 1 : (x > y ? -1 : 0);
+}
+
+//Prints the high-water mark and totals, followed by the lines still holding onto the most memory. Called at shutdown, anything it
+//lists was leaked
+void memory_report(FILE* out) {
+	memory_lock(&memory_tracker_lock);
+	Memory_Tracker* tracker = &memory_tracker;
+
+	fprintf(out, "Memory peak: %lld bytes\n", tracker->peakBytes);
+	fprintf(out, "Memory live: %lld bytes in %lld blocks\n", tracker->liveBytes, tracker->liveBlocks);
+	fprintf(out, "Memory calls: %lld allocs, %lld reallocs, %lld frees\n", tracker->allocs, tracker->reallocs, tracker->frees);
+
+	Memory_Site** live = (Memory_Site**)malloc((tracker->numSites + 1) * sizeof(Memory_Site*));
+	if (live == NULL) {
+		printf("Failed to allocate memory in memory_report\n");
+		exit(-1);
+	}
+
+	int numLive = 0;
+	for (int i = 0; i < tracker->__sitesSize; i++) {
+		if (tracker->sites[i].file != NULL && tracker->sites[i].liveBlocks > 0) {
+			live[numLive] = &tracker->sites[i];
+			numLive++;
+		}
+	}
+	qsort(live, numLive, sizeof(Memory_Site*), memory_compare_sites);
+
+	for (int i = 0; i < numLive && i < MEMORY_REPORT_SITES; i++) {
+		fprintf(out, "    %lld bytes in %lld blocks (peak %lld, %lld allocs) from %s:%d\n", live[i]->liveBytes, live[i]->liveBlocks,
+			live[i]->peakBytes, live[i]->allocs, live[i]->file, live[i]->line);
+	}
+	if (numLive > MEMORY_REPORT_SITES) {
+		fprintf(out, "    and %d more lines\n", numLive - MEMORY_REPORT_SITES);
+	}
+
+	free(live);
+	memory_unlock(&memory_tracker_lock);
+}
+
+long long memory_peak_bytes() {
+	return memory_tracker.peakBytes;
+}
+
+long long memory_live_bytes() {
+	return memory_tracker.liveBytes;
+}
+
+#else
+
+//Without tracking everything goes straight to the C library
+#define mem_alloc(size) malloc(size)
+#define mem_calloc(count, size) calloc((count), (size))
+#define mem_realloc(ptr, size) realloc((ptr), (size))
+#define mem_free(ptr) free(ptr)
+
+void memory_report(FILE* out) {
+	(void)out;
+}
+
+long long memory_peak_bytes() {
+	return 0;
+}
+
+long long memory_live_bytes() {
+	return 0;
+}
+
+#endif
+
+#endif
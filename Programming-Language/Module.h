@@ -0,0 +1,536 @@
+#ifndef MODULE_H
+#define MODULE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Platform.h"
+#include "Strings.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "TypeChecker.h"
+#include "Bytecode.h"
+#include "Image.h"
+#include "VM.h"
+#include "ThreadPool.h"
+#include "Diagnostics.h"
+#include <stdbool.h>
+
+//This header file contains the module system and the build driver for programs made up of more than one file
+//
+//A file imports another with a top level statement like: import "math.txt";
+//The path is relative to the directory of the file doing the importing. Every function defined in the imported file can then be
+//called from the importing file. Each file is a module with its own tokens, AST, and program, so the names in one module never
+//leak into another except through imports
+//
+//The build runs in two stages, and both use the thread pool:
+//  1. Discovery: every newly found file is loaded and lexed in parallel, then the import statements are read out of the tokens
+//     to find more files, and this repeats until no new files turn up
+//  2. Compilation: the imports form a graph, and every module is given a level that is one higher than the highest level of the
+//     modules it imports. All of the modules of a level only depend on lower levels, so a whole level is compiled in parallel
+//     before moving on to the next one
+//
+//Running a build gives every module its own image and VM, so each one keeps its own globals. The modules run their top level
+//statements in the order of their levels, so everything a module imports has already been set up by the time it runs. A call to an
+//imported function goes through the call hook of the VM (see VM.h) to the VM of the module it comes from. Strings are copied into the
+//collector of the other VM on the way in and out, since each collector only knows about its own strings
+
+#define MODULE_MAX_PATH 4096
+
+typedef struct Module {
+	string path;
+	string source;
+	tokenList tokens;
+	AST* ast;
+	Program program;
+	//Indices of the modules this one imports, in the order they are imported
+	Vector_Int imports;
+	//For every AST_FUNCTION_IMPORT node, in the order they were added, the module the function comes from and its index in the
+	//program of that module
+	Vector_Int stubModules;
+	Vector_Int stubFunctions;
+	//How many of the tokens came from the file itself, before the copied headers of imported functions were added. Only these own
+	//their strings. -1 until the imports are added
+	int ownTokens;
+	//-1 until the levels are worked out
+	int level;
+	int numErrors;
+	string diagnostics;
+} Module;
+
+typedef struct Build {
+	Module* modules;
+	int len;
+	int __size;
+	ThreadPool* pool;
+	int numLevels;
+} Build;
+
+typedef struct Module_Task {
+	Build* build;
+	int index;
+} Module_Task;
+
+void build_init(Build* build, ThreadPool* pool) {
+	build->modules = NULL;
+	build->len = 0;
+	build->__size = 1;
+	build->pool = pool;
+	build->numLevels = 0;
+}
+
+//Returns the index of the module for the file at the given full path, adding it to the build if it isn't already a part of it
+int build_add_module(Build* build, char* fullPath) {
+	for (int i = 0; i < build->len; i++) {
+		if (strcmp(build->modules[i].path.str, fullPath) == 0) {
+			return i;
+		}
+	}
+
+	if (build->len + 1 >= build->__size) {
+		build->__size *= 2;
+
+		Module* test = (Module*)mem_realloc(build->modules, build->__size * sizeof(Module));
+
+		if (test == NULL) {
+			printf("Failed to allocate memory in build_add_module\n");
+			exit(-1);
+		}
+
+		build->modules = test;
+	}
+
+	Module* module = &build->modules[build->len];
+	string_init(&module->path, fullPath);
+	string_init(&module->source, NULL);
+	string_init(&module->diagnostics, NULL);
+	tokenList_init(&module->tokens);
+	AST_init(&module->ast);
+	Vector_Int_Init(&module->imports);
+	Vector_Int_Init(&module->stubModules);
+	Vector_Int_Init(&module->stubFunctions);
+	module->program.functions = NULL;
+	module->program.numFunctions = 0;
+	module->ownTokens = -1;
+	module->level = -1;
+	module->numErrors = 0;
+
+	build->len++;
+	return build->len - 1;
+}
+
+void module_load_task(void* arg, int worker) {
+	(void)worker;
+	Module_Task* task = (Module_Task*)arg;
+	Module* module = &task->build->modules[task->index];
+
+	string_load_file(module->path.str, &module->source);
+	lexer(&module->tokens, &module->source);
+}
+
+//Reads the import statements out of the tokens of the module and adds the files they point to to the build
+void build_scan_imports(Build* build, int index) {
+	char path[MODULE_MAX_PATH];
+	char fullPath[MODULE_MAX_PATH];
+	Module* module = &build->modules[index];
+
+	//Imported paths are relative to the directory of the importing file
+	int dirLen = module->path.len;
+	while (dirLen > 0 && module->path.str[dirLen - 1] != PATH_SEPARATOR && module->path.str[dirLen - 1] != '/') {
+		dirLen--;
+	}
+
+	for (int i = 0; i + 1 < module->tokens.len; i++) {
+		token tok = module->tokens.tokens[i];
+		token next = module->tokens.tokens[i + 1];
+		if (tok.type != KEYWORD || tok.val != KEYWORD_IMPORT || next.type != LITERAL || next.mdata != STRING_LITERAL) {
+			continue;
+		}
+
+		snprintf(path, sizeof(path), "%.*s%s", dirLen, module->path.str, ((string*)next.val)->str);
+		if (!platform_full_path(path, fullPath, sizeof(fullPath))) {
+			diagnostics_printf("\x1b[31mImport error in %s: could not find %s\x1b[0m\n", module->path.str, path);
+			module->numErrors++;
+			continue;
+		}
+
+		int imported = build_add_module(build, fullPath);
+		//build_add_module can move the modules, so the pointer has to be found again
+		module = &build->modules[index];
+		Vector_Int_Append(&module->imports, imported);
+	}
+}
+
+//Works out the level of a module from the levels of its imports. Returns false if the module imports itself through some chain of
+//imports, since a cycle means there is no order the modules can be built in
+int build_module_level(Build* build, int index, int* visiting) {
+	Module* module = &build->modules[index];
+	if (module->level != -1) {
+		return true;
+	}
+
+	if (visiting[index]) {
+		diagnostics_printf("\x1b[31mImport error: %s is part of an import cycle\x1b[0m\n", module->path.str);
+		module->numErrors++;
+		return false;
+	}
+
+	visiting[index] = true;
+	int level = 0;
+	for (int i = 0; i < module->imports.len; i++) {
+		int imported = module->imports.vec[i];
+		if (!build_module_level(build, imported, visiting)) {
+			visiting[index] = false;
+			return false;
+		}
+
+		if (build->modules[imported].level + 1 > level) {
+			level = build->modules[imported].level + 1;
+		}
+	}
+	visiting[index] = false;
+
+	module->level = level;
+	if (level + 1 > build->numLevels) {
+		build->numLevels = level + 1;
+	}
+	return true;
+}
+
+//Marks calls to imported functions as function identifiers. The lexer can only recognize the functions declared in the file it is
+//lexing, so calls to functions from other files are left as undefined tokens
+void module_resolve_names(Build* build, Module* module) {
+	for (int i = 0; i < module->tokens.len; i++) {
+		token* tok = &module->tokens.tokens[i];
+		if (tok->type != TYPE_UNDEFINED) {
+			continue;
+		}
+
+		string* name = (string*)tok->val;
+		for (int j = 0; j < module->imports.len && tok->type == TYPE_UNDEFINED; j++) {
+			Module* imported = &build->modules[module->imports.vec[j]];
+
+			for (int k = 0; k < imported->ast->list.len; k++) {
+				AST* def = &((AST*)imported->ast->list.arr)[k];
+				token header = imported->tokens.tokens[def->token_index];
+
+				if (def->type == AST_FUNCTION_DEFINITION && strcmp(((string*)header.val)->str, name->str) == 0) {
+					tok->type = IDENTIFIER;
+					tok->mdata = header.mdata;
+					break;
+				}
+			}
+		}
+	}
+}
+
+//Adds an AST_FUNCTION_IMPORT node for every function of every imported module. The header tokens of each function are copied onto
+//the end of the token list so that the type checker and compiler can treat an imported function the same as a local one. The
+//copied identifier tokens still point at the strings of the imported module, which stay alive as long as the build does
+void module_add_imports(Build* build, Module* module) {
+	module->ownTokens = module->tokens.len;
+	for (int j = 0; j < module->imports.len; j++) {
+		Module* imported = &build->modules[module->imports.vec[j]];
+		//Matches how program_init numbers the functions of the imported module
+		int functionIndex = 1;
+
+		for (int k = 0; k < imported->ast->list.len; k++) {
+			AST* def = &((AST*)imported->ast->list.arr)[k];
+			//Extern functions aren't shared with the modules that import this one, but they still take up a function index
+			if (def->type == AST_FUNCTION_IMPORT || def->type == AST_FUNCTION_EXTERN) {
+				functionIndex++;
+				continue;
+			}
+			if (def->type != AST_FUNCTION_DEFINITION) {
+				continue;
+			}
+
+			//The header goes from the return type keyword up to the closing parentheses
+			int start = def->token_index - 1;
+			int end = def->token_index;
+			while (end < imported->tokens.len && !(imported->tokens.tokens[end].type == PUNCTUATOR && imported->tokens.tokens[end].val == PUNCTUATOR_CLOSE_PAREN)) {
+				end++;
+			}
+
+			int base = module->tokens.len;
+			for (int t = start; t <= end && t < imported->tokens.len; t++) {
+				tokenList_append(&module->tokens, imported->tokens.tokens[t]);
+			}
+
+			AST stub = parser_node(AST_FUNCTION_IMPORT, base + 1, UREL_ROOT);
+			for (int p = 0; p < def->list.len; p++) {
+				AST* param = &((AST*)def->list.arr)[p];
+				if (param->type == AST_FUNCTION_PARAMETER) {
+					AST_List_append(&stub.list, parser_node(AST_FUNCTION_PARAMETER, base + param->token_index - start, UREL_IRRELEVENT));
+				}
+			}
+			AST_List_append(&module->ast->list, stub);
+			Vector_Int_Append(&module->stubModules, module->imports.vec[j]);
+			Vector_Int_Append(&module->stubFunctions, functionIndex);
+			functionIndex++;
+		}
+	}
+
+	AST_relink(module->ast);
+}
+
+void module_compile_task(void* arg, int worker) {
+	(void)worker;
+	Module_Task* task = (Module_Task*)arg;
+	Build* build = task->build;
+	Module* module = &build->modules[task->index];
+
+	diagnostics_buffer = &module->diagnostics;
+
+	module_resolve_names(build, module);
+	module->numErrors += parser(&module->tokens, &module->ast);
+	module->numErrors += parser_all_bodies(&module->tokens, &module->ast);
+	module_add_imports(build, module);
+
+	if (module->numErrors == 0) {
+		module->numErrors += typechecker(&module->tokens, &module->ast);
+	}
+
+	if (module->numErrors == 0) {
+		module->numErrors += compiler(&module->tokens, &module->ast, &module->program);
+
+		//Fill in where each imported function lives. The stubs are numbered by program_init the same as any other function, and
+		//they need their parameters so that calls to them can be checked
+		int index = 1;
+		int stub = 0;
+		for (int i = 0; i < module->ast->list.len; i++) {
+			AST* node = &((AST*)module->ast->list.arr)[i];
+			if (node->type == AST_FUNCTION_IMPORT) {
+				Function* fn = &module->program.functions[index];
+				fn->module = module->stubModules.vec[stub];
+				fn->remoteIndex = module->stubFunctions.vec[stub];
+				fn->numParams = node->list.len;
+				fn->numLocals = node->list.len;
+				stub++;
+			}
+			if (node->type == AST_FUNCTION_DEFINITION || node->type == AST_FUNCTION_IMPORT || node->type == AST_FUNCTION_EXTERN) {
+				index++;
+			}
+		}
+	}
+
+	diagnostics_buffer = NULL;
+}
+
+//Builds the program starting from the file at path and everything it imports. Returns the number of errors found
+int build_run(Build* build, char* path) {
+	char fullPath[MODULE_MAX_PATH];
+	if (!platform_full_path(path, fullPath, sizeof(fullPath))) {
+		printf("\x1b[31mCould not find %s\x1b[0m\n", path);
+		return 1;
+	}
+	build_add_module(build, fullPath);
+
+	//Discovery, one wave of newly found files at a time. The lexing and parsing happens on the workers, so the profiler can only
+	//time the stages as a whole
+	profiler_begin(PHASE_LOAD);
+	int loaded = 0;
+	while (loaded < build->len) {
+		int waveEnd = build->len;
+		Module_Task* tasks = (Module_Task*)mem_alloc((waveEnd - loaded) * sizeof(Module_Task));
+
+		if (tasks == NULL) {
+			printf("Failed to allocate memory in build_run\n");
+			exit(-1);
+		}
+
+		for (int i = loaded; i < waveEnd; i++) {
+			tasks[i - loaded] = (Module_Task){ .build = build, .index = i };
+			threadpool_submit(build->pool, module_load_task, &tasks[i - loaded]);
+		}
+		threadpool_wait(build->pool);
+		mem_free(tasks);
+
+		for (int i = loaded; i < waveEnd; i++) {
+			build_scan_imports(build, i);
+		}
+		loaded = waveEnd;
+	}
+
+	//Files that couldn't be found were already reported while scanning the imports
+	int errors = 0;
+	for (int i = 0; i < build->len; i++) {
+		errors += build->modules[i].numErrors;
+	}
+
+	int* visiting = (int*)mem_calloc(build->len, sizeof(int));
+	Module_Task* tasks = (Module_Task*)mem_alloc(build->len * sizeof(Module_Task));
+
+	if (visiting == NULL || tasks == NULL) {
+		printf("Failed to allocate memory in build_run\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < build->len; i++) {
+		if (!build_module_level(build, i, visiting)) {
+			errors++;
+		}
+	}
+	mem_free(visiting);
+
+	//Compilation, one level at a time
+	profiler_begin(PHASE_COMPILE);
+	for (int level = 0; level < build->numLevels && errors == 0; level++) {
+		for (int i = 0; i < build->len; i++) {
+			if (build->modules[i].level == level) {
+				tasks[i] = (Module_Task){ .build = build, .index = i };
+				threadpool_submit(build->pool, module_compile_task, &tasks[i]);
+			}
+		}
+		threadpool_wait(build->pool);
+
+		//A module that failed to compile would leave the modules that import it with nothing to call, so the build stops at the
+		//first level with an error
+		for (int i = 0; i < build->len; i++) {
+			if (build->modules[i].level == level) {
+				errors += build->modules[i].numErrors;
+			}
+		}
+	}
+	mem_free(tasks);
+	profiler_end();
+
+	for (int i = 0; i < build->len; i++) {
+		if (build->modules[i].diagnostics.str != NULL) {
+			printf("In %s:\n%s", build->modules[i].path.str, build->modules[i].diagnostics.str);
+		}
+	}
+
+	return errors;
+}
+
+//The images and VMs of the modules of a build that is being run, in the same order as the modules
+typedef struct Build_Link {
+	Build* build;
+	Image* images;
+	VM* vms;
+	//How many of the modules have an image and a VM so far
+	int len;
+} Build_Link;
+
+//Copies a value into the VM that it is being handed to. Strings belong to the collector of the VM that made them
+Value build_link_value(VM* to, Value val) {
+	if (!value_is_string(val)) {
+		return val;
+	}
+	string* str = value_as_string(val);
+	return gc_string_new(&to->gc, str->str != NULL ? str->str : "", str->len);
+}
+
+//The call hook of every VM of the build. Runs a function of the module the VM belongs to, or the function it imports from another one
+int build_link_call(VM* vm, int index) {
+	Build_Link* link = (Build_Link*)vm->callData;
+	int self = (int)(vm - link->vms);
+	Function* fn = &link->build->modules[self].program.functions[index];
+	if (fn->module == -1) {
+		return vm_call(vm, index);
+	}
+
+	VM* target = &link->vms[fn->module];
+	if (target->sp + fn->numParams >= VM_STACK_SIZE) {
+		vm_error(vm, "Stack overflow");
+		return false;
+	}
+
+	//The arguments stay on this stack until the call is over, and the ones already copied are roots of the other VM while the rest
+	//are copied
+	for (int i = 0; i < fn->numParams; i++) {
+		Value arg = build_link_value(target, vm->stack[vm->sp - fn->numParams + i]);
+		target->stack[target->sp++] = arg;
+	}
+	if (!vm_call(target, fn->remoteIndex)) {
+		return false;
+	}
+
+	Value result = target->stack[--target->sp];
+	vm->sp -= fn->numParams;
+	result = build_link_value(vm, result);
+	vm->stack[vm->sp++] = result;
+	return true;
+}
+
+//Makes an image and a VM for every module of a build that compiled without errors. Returns false if one of the images couldn't be made,
+//in which case build_link_destroy still has to be called
+int build_link(Build_Link* link, Build* build) {
+	link->build = build;
+	link->len = 0;
+	link->images = (Image*)mem_alloc((build->len + 1) * sizeof(Image));
+	link->vms = (VM*)mem_alloc((build->len + 1) * sizeof(VM));
+
+	if (link->images == NULL || link->vms == NULL) {
+		printf("Failed to allocate memory in build_link\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < build->len; i++) {
+		Module* module = &build->modules[i];
+		if (!image_from_program_imports(&link->images[i], &module->program, &module->tokens, true)) {
+			return false;
+		}
+		vm_init(&link->vms[i], &link->images[i]);
+		link->vms[i].call = build_link_call;
+		link->vms[i].callData = link;
+		link->len++;
+	}
+	return true;
+}
+
+//Runs the top level statements of every module, starting with the ones that don't import anything and ending with the file the build
+//started from. Returns false if a runtime error stopped the program
+int build_link_run(Build_Link* link) {
+	for (int level = 0; level < link->build->numLevels; level++) {
+		for (int i = 0; i < link->len; i++) {
+			if (link->build->modules[i].level == level && !vm_run(&link->vms[i])) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void build_link_destroy(Build_Link* link) {
+	for (int i = 0; i < link->len; i++) {
+		vm_destroy(&link->vms[i]);
+		image_close(&link->images[i]);
+	}
+	mem_free(link->images);
+	mem_free(link->vms);
+	link->images = NULL;
+	link->vms = NULL;
+	link->len = 0;
+}
+
+void build_destroy(Build* build) {
+	for (int i = 0; i < build->len; i++) {
+		Module* module = &build->modules[i];
+		if (module->program.functions != NULL) {
+			program_destroy(&module->program);
+		}
+		AST_destroy_children(module->ast);
+		mem_free(module->ast);
+
+		//The copied tokens at the end point at the strings of other modules, which free their own
+		if (module->ownTokens != -1) {
+			module->tokens.len = module->ownTokens;
+		}
+		tokenList_destroy_all(&module->tokens);
+		string_destroy(&module->source);
+		string_destroy(&module->path);
+		string_destroy(&module->diagnostics);
+		Vector_Int_Destroy(&module->imports);
+		Vector_Int_Destroy(&module->stubModules);
+		Vector_Int_Destroy(&module->stubFunctions);
+	}
+
+	mem_free(build->modules);
+	build->modules = NULL;
+	build->len = 0;
+	build->__size = 1;
+}
+
+#endif
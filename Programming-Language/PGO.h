@@ -0,0 +1,373 @@
+#ifndef PGO_H
+#define PGO_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Platform.h"
+#include "Strings.h"
+#include "Lexer.h"
+#include "Bytecode.h"
+#include "Image.h"
+#include "VMProfile.h"
+#include <stdbool.h>
+
+//This header file contains the profiles used for profile guided optimization
+//
+//A profile is recorded by running a program with the VM profiler. It holds how many times each function was called, and how many
+//times each call site ran. A call site is the caller, the callee, and which call to that callee in the caller it is (counting from 0
+//in the order the calls are made), so call sites line up between the bytecode the profile was recorded from and the AST the next
+//build works on. Each file gets its own profile in the profile directory, named by a hash of its source, so a file that changes
+//starts over with a new profile instead of being optimized for code that isn't there anymore. Every run adds its counts to the profile
+//that is already there, so it keeps getting better the more a program is run
+//
+//The profile is used by the next build in three places:
+//  The inliner inlines calls that ran a lot even when the callee is bigger than it would normally take, with a separate budget, and
+//  never inlines calls that didn't run at all, since that would only make the code bigger
+//  The code of the functions goes into the image hottest first, so the code that runs the most sits together and the functions
+//  that never ran are out of the way at the end
+//  The tiered runner compiles functions that the profile says are hot on their first call, instead of running them from the tree
+//  until they have been called enough
+//
+//The language doesn't have branches or loops yet, so there is nothing to record about which way a branch goes or how many times a
+//loop runs. Those would be added to the profile the same way as the call sites, keyed by which branch or loop in the function it is
+//
+//The file is plain text, with one thing on each line:
+//  pgo <version>
+//  runs <how many runs were added up>
+//  function <name> <calls>
+//  call <caller> <callee> <which> <count>
+//with - as the name of the top level statements
+
+#define PGO_VERSION 1
+#define PGO_MAX_NAME 256
+#define PGO_MAX_PATH 4096
+//A call site that ran at least this percent as many times as the call site that ran the most is hot
+#define PGO_HOT_PERCENT 10
+//The largest callee (in AST nodes) that the inliner takes for a hot call site
+#define PGO_HOT_CALLEE_SIZE 96
+//How many nodes a single function is allowed to grow by from inlining hot call sites, on top of the normal budget
+#define PGO_HOT_BUDGET 1024
+
+typedef struct PGO_Function {
+	char name[PGO_MAX_NAME];
+	long long calls;
+} PGO_Function;
+
+typedef struct PGO_Call {
+	//Indices into the functions of the profile
+	int caller;
+	int callee;
+	int which;
+	long long count;
+} PGO_Call;
+
+typedef struct PGO_Profile {
+	int runs;
+	PGO_Function* functions;
+	int numFunctions;
+	int __functionsSize;
+	PGO_Call* calls;
+	int numCalls;
+	int __callsSize;
+	//Open addressing from a call site to its index in calls plus 1, with 0 for an empty slot. The size is always a power of 2
+	int* table;
+	int tableSize;
+	//The count of the call site that ran the most
+	long long maxCount;
+} PGO_Profile;
+
+void pgo_init(PGO_Profile* profile) {
+	profile->runs = 0;
+	profile->numFunctions = 0;
+	profile->__functionsSize = 8;
+	profile->functions = (PGO_Function*)mem_alloc(profile->__functionsSize * sizeof(PGO_Function));
+	profile->numCalls = 0;
+	profile->__callsSize = 8;
+	profile->calls = (PGO_Call*)mem_alloc(profile->__callsSize * sizeof(PGO_Call));
+	profile->tableSize = 16;
+	profile->table = (int*)mem_calloc(profile->tableSize, sizeof(int));
+	profile->maxCount = 0;
+
+	if (profile->functions == NULL || profile->calls == NULL || profile->table == NULL) {
+		printf("Failed to allocate memory in pgo_init\n");
+		exit(-1);
+	}
+}
+
+void pgo_destroy(PGO_Profile* profile) {
+	mem_free(profile->functions);
+	mem_free(profile->calls);
+	mem_free(profile->table);
+	profile->functions = NULL;
+	profile->calls = NULL;
+	profile->table = NULL;
+	profile->numFunctions = 0;
+	profile->numCalls = 0;
+}
+
+//Returns the index of the function with the given name, or -1 if the profile doesn't have it
+int pgo_find_function(PGO_Profile* profile, char* name) {
+	for (int i = 0; i < profile->numFunctions; i++) {
+		if (strcmp(profile->functions[i].name, name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+//Returns the index of the function with the given name, adding it if the profile doesn't have it yet
+int pgo_add_function(PGO_Profile* profile, char* name) {
+	int index = pgo_find_function(profile, name);
+	if (index != -1) {
+		return index;
+	}
+
+	if (profile->numFunctions + 1 >= profile->__functionsSize) {
+		profile->__functionsSize *= 2;
+		PGO_Function* temp = (PGO_Function*)mem_realloc(profile->functions, profile->__functionsSize * sizeof(PGO_Function));
+		if (temp == NULL) {
+			printf("Failed to allocate memory in pgo_add_function\n");
+			exit(-1);
+		}
+		profile->functions = temp;
+	}
+
+	PGO_Function* fn = &profile->functions[profile->numFunctions];
+	snprintf(fn->name, sizeof(fn->name), "%s", name);
+	fn->calls = 0;
+	profile->numFunctions++;
+	return profile->numFunctions - 1;
+}
+
+unsigned int pgo_hash_call(int caller, int callee, int which) {
+	unsigned int hash = 2166136261u;
+	hash = (hash ^ (unsigned int)caller) * 16777619u;
+	hash = (hash ^ (unsigned int)callee) * 16777619u;
+	hash = (hash ^ (unsigned int)which) * 16777619u;
+	return hash;
+}
+
+//Returns the slot of the table that the call site is in, or the empty slot it would go in
+int pgo_find_slot(PGO_Profile* profile, int caller, int callee, int which) {
+	int mask = profile->tableSize - 1;
+	int slot = pgo_hash_call(caller, callee, which) & mask;
+	while (profile->table[slot] != 0) {
+		PGO_Call* call = &profile->calls[profile->table[slot] - 1];
+		if (call->caller == caller && call->callee == callee && call->which == which) {
+			break;
+		}
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+//Returns the call site, or NULL if the profile doesn't have it
+PGO_Call* pgo_find_call(PGO_Profile* profile, int caller, int callee, int which) {
+	int slot = pgo_find_slot(profile, caller, callee, which);
+	return profile->table[slot] == 0 ? NULL : &profile->calls[profile->table[slot] - 1];
+}
+
+//Adds count to the call site, adding the call site if the profile doesn't have it yet
+void pgo_add_call(PGO_Profile* profile, int caller, int callee, int which, long long count) {
+	PGO_Call* found = pgo_find_call(profile, caller, callee, which);
+	if (found != NULL) {
+		found->count += count;
+		profile->maxCount = found->count > profile->maxCount ? found->count : profile->maxCount;
+		return;
+	}
+
+	//The table is kept at most half full, and is rebuilt from the call sites when it grows
+	if ((profile->numCalls + 1) * 2 > profile->tableSize) {
+		mem_free(profile->table);
+		profile->tableSize *= 2;
+		profile->table = (int*)mem_calloc(profile->tableSize, sizeof(int));
+		if (profile->table == NULL) {
+			printf("Failed to allocate memory in pgo_add_call\n");
+			exit(-1);
+		}
+		for (int i = 0; i < profile->numCalls; i++) {
+			PGO_Call* call = &profile->calls[i];
+			profile->table[pgo_find_slot(profile, call->caller, call->callee, call->which)] = i + 1;
+		}
+	}
+
+	if (profile->numCalls + 1 >= profile->__callsSize) {
+		profile->__callsSize *= 2;
+		PGO_Call* temp = (PGO_Call*)mem_realloc(profile->calls, profile->__callsSize * sizeof(PGO_Call));
+		if (temp == NULL) {
+			printf("Failed to allocate memory in pgo_add_call\n");
+			exit(-1);
+		}
+		profile->calls = temp;
+	}
+
+	profile->calls[profile->numCalls] = (PGO_Call){ .caller = caller, .callee = callee, .which = which, .count = count };
+	profile->numCalls++;
+	profile->table[pgo_find_slot(profile, caller, callee, which)] = profile->numCalls;
+	profile->maxCount = count > profile->maxCount ? count : profile->maxCount;
+}
+
+//The name a function has in a profile, which is its own name or - for the top level statements
+void pgo_function_name(tokenList* list, int token_index, char* out, int size) {
+	if (token_index == -1) {
+		snprintf(out, size, "-");
+	}
+	else {
+		token_to_text(list->tokens[token_index], out, size);
+	}
+}
+
+//Returns how many times the call site ran, or -1 if the profile doesn't know about the caller at all. A caller the profile knows
+//about that never made the call gives 0
+long long pgo_call_count(PGO_Profile* profile, char* caller, char* callee, int which) {
+	int callerIndex = pgo_find_function(profile, caller);
+	if (callerIndex == -1) {
+		return -1;
+	}
+
+	int calleeIndex = pgo_find_function(profile, callee);
+	PGO_Call* call = calleeIndex == -1 ? NULL : pgo_find_call(profile, callerIndex, calleeIndex, which);
+	return call == NULL ? 0 : call->count;
+}
+
+//Returns true if a call site that ran count times is one of the hot ones
+int pgo_is_hot(PGO_Profile* profile, long long count) {
+	return count > 0 && count * 100 >= profile->maxCount * PGO_HOT_PERCENT;
+}
+
+//Returns how many times the function was called in an average run, or -1 if the profile doesn't have it
+long long pgo_calls_per_run(PGO_Profile* profile, char* name) {
+	int index = pgo_find_function(profile, name);
+	if (index == -1 || profile->runs == 0) {
+		return -1;
+	}
+	return profile->functions[index].calls / profile->runs;
+}
+
+void pgo_path(char* dir, unsigned long long key, char* out, int size) {
+	snprintf(out, size, "%s%c%016llx.pgo", dir, PATH_SEPARATOR, key);
+}
+
+//Reads the profile at path into an empty profile. Returns false if there isn't one, or it is from another version, in which case the
+//profile is left empty
+int pgo_load(PGO_Profile* profile, char* path) {
+	FILE* fptr = fopen(path, "rb");
+	if (fptr == NULL) {
+		return false;
+	}
+
+	char line[PGO_MAX_NAME * 2 + 64];
+	char first[PGO_MAX_NAME];
+	char second[PGO_MAX_NAME];
+	int version = 0;
+	if (fgets(line, sizeof(line), fptr) == NULL || sscanf(line, "pgo %d", &version) != 1 || version != PGO_VERSION) {
+		fclose(fptr);
+		return false;
+	}
+
+	while (fgets(line, sizeof(line), fptr) != NULL) {
+		long long count;
+		int which;
+		if (sscanf(line, "runs %d", &profile->runs) == 1) {
+			continue;
+		}
+		//Adding a function can move the functions, so the index has to be found before the array is used
+		if (sscanf(line, "function %255s %lld", first, &count) == 2) {
+			int index = pgo_add_function(profile, first);
+			profile->functions[index].calls += count;
+		}
+		else if (sscanf(line, "call %255s %255s %d %lld", first, second, &which, &count) == 4) {
+			int caller = pgo_add_function(profile, first);
+			int callee = pgo_add_function(profile, second);
+			pgo_add_call(profile, caller, callee, which, count);
+		}
+	}
+
+	fclose(fptr);
+	return true;
+}
+
+//Writes the profile to path. Returns false if the file couldn't be written
+int pgo_save(PGO_Profile* profile, char* path) {
+	FILE* fptr = fopen(path, "wb");
+	if (fptr == NULL) {
+		return false;
+	}
+
+	fprintf(fptr, "pgo %d\nruns %d\n", PGO_VERSION, profile->runs);
+	for (int i = 0; i < profile->numFunctions; i++) {
+		fprintf(fptr, "function %s %lld\n", profile->functions[i].name, profile->functions[i].calls);
+	}
+	for (int i = 0; i < profile->numCalls; i++) {
+		PGO_Call* call = &profile->calls[i];
+		fprintf(fptr, "call %s %s %d %lld\n", profile->functions[call->caller].name, profile->functions[call->callee].name, call->which,
+			call->count);
+	}
+
+	fclose(fptr);
+	return true;
+}
+
+//Adds the counts of a run of the image to the profile
+void pgo_record(PGO_Profile* profile, VM_Profile* counts, Image* image) {
+	int* which = (int*)mem_calloc(counts->numFunctions + 1, sizeof(int));
+	int* indices = (int*)mem_alloc((counts->numFunctions + 1) * sizeof(int));
+
+	if (which == NULL || indices == NULL) {
+		printf("Failed to allocate memory in pgo_record\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < counts->numFunctions; i++) {
+		int name = image->functions[i].name;
+		indices[i] = pgo_add_function(profile, name == -1 ? "-" : image_string(image, name));
+		profile->functions[indices[i]].calls += counts->functions[i].calls;
+	}
+
+	for (int i = 0; i < counts->numFunctions; i++) {
+		int* code = image_function_code(image, i);
+		memset(which, 0, counts->numFunctions * sizeof(int));
+
+		for (int j = 0; j < image->functions[i].codeLen; j += 1 + bytecode_operands[code[j]]) {
+			if (code[j] != BC_CALL) {
+				continue;
+			}
+
+			int callee = code[j + 1];
+			pgo_add_call(profile, indices[i], indices[callee], which[callee], counts->functions[i].counts[j]);
+			which[callee]++;
+		}
+	}
+
+	profile->runs++;
+	mem_free(which);
+	mem_free(indices);
+}
+
+//Sets the layout of the program to the order its functions should go into an image in, which is the most called first. Functions
+//the profile doesn't have go after the ones it does, in the order they are in
+void pgo_layout(PGO_Profile* profile, Program* program, tokenList* list) {
+	VM_Profile_Row* rows = (VM_Profile_Row*)mem_alloc((program->numFunctions + 1) * sizeof(VM_Profile_Row));
+
+	if (rows == NULL) {
+		printf("Failed to allocate memory in pgo_layout\n");
+		exit(-1);
+	}
+
+	char name[PGO_MAX_NAME];
+	for (int i = 0; i < program->numFunctions; i++) {
+		pgo_function_name(list, program->functions[i].token_index, name, sizeof(name));
+		int index = pgo_find_function(profile, name);
+		rows[i] = (VM_Profile_Row){ .index = i, .key = index == -1 ? -1 : profile->functions[index].calls };
+	}
+	qsort(rows, program->numFunctions, sizeof(VM_Profile_Row), vm_profile_compare_rows);
+
+	program->layout.len = 0;
+	for (int i = 0; i < program->numFunctions; i++) {
+		Vector_Int_Append(&program->layout, rows[i].index);
+	}
+	mem_free(rows);
+}
+
+#endif
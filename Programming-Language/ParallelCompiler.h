@@ -0,0 +1,137 @@
+#ifndef PARALLELCOMPILER_H
+#define PARALLELCOMPILER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Lexer.h"
+#include "Parser.h"
+#include "TypeChecker.h"
+#include "Bytecode.h"
+#include "ThreadPool.h"
+#include "Arena.h"
+#include "Diagnostics.h"
+
+//This header file contains the driver that parses, type checks, and compiles the functions of a program in parallel
+//
+//Once the parser has found the function headers, every function body is an independent range of tokens, so each one becomes a
+//task on the thread pool. It runs in two rounds. The first round parses the bodies, and the second round type checks and compiles
+//them. The rounds are kept apart because type checking a call looks at the parameters of the function being called, which can't
+//be done safely while another thread might still be adding nodes to that function
+//
+//Each function keeps its own errors, and they are printed afterwards in the order the functions appear in the file, so the output
+//is the same no matter how the threads were scheduled
+
+typedef struct Compile_Task {
+	tokenList* tokens;
+	AST** ast;
+	Program* program;
+	//The index of the function in the program, and its definition node (or the root node for function 0)
+	int index;
+	AST* node;
+} Compile_Task;
+
+void compile_task_parse(void* arg, int worker) {
+	Compile_Task* task = (Compile_Task*)arg;
+	Function* fn = &task->program->functions[task->index];
+
+	AST_arena = &task->program->arenas[worker];
+	diagnostics_buffer = &fn->diagnostics;
+
+	fn->numErrors += parser_function_body(task->tokens, task->node);
+
+	AST_arena = NULL;
+	diagnostics_buffer = NULL;
+}
+
+void compile_task_compile(void* arg, int worker) {
+	Compile_Task* task = (Compile_Task*)arg;
+	Function* fn = &task->program->functions[task->index];
+
+	//The code of an imported function is compiled as part of the module it comes from
+	if (task->node->type == AST_FUNCTION_IMPORT) {
+		return;
+	}
+
+	AST_arena = &task->program->arenas[worker];
+	diagnostics_buffer = &fn->diagnostics;
+
+	//A function with syntax errors isn't checked any further, since the statements with errors were already thrown out
+	if (fn->numErrors == 0) {
+		fn->numErrors += typechecker_function(task->tokens, task->ast, task->index == 0 ? NULL : task->node);
+	}
+
+	if (fn->numErrors == 0) {
+		compiler_function(task->tokens, task->program, task->index, task->node);
+	}
+
+	AST_arena = NULL;
+	diagnostics_buffer = NULL;
+}
+
+//Same as compiler_parallel, except that when arenas isn't NULL the program borrows those (one for every worker of the pool) instead
+//of making its own. They are reset first, so whatever blocks they already have get used again. Borrowed arenas still belong to the
+//caller, so program->arenas has to be set back to NULL before the program is destroyed
+int compiler_parallel_arenas(tokenList* list, AST** ast, Program* program, ThreadPool* pool, Arena* arenas) {
+	program_init(program, list, ast);
+
+	program->numArenas = pool->numWorkers;
+	program->arenas = arenas != NULL ? arenas : (Arena*)mem_alloc(pool->numWorkers * sizeof(Arena));
+	Compile_Task* tasks = (Compile_Task*)mem_alloc(program->numFunctions * sizeof(Compile_Task));
+
+	if (program->arenas == NULL || tasks == NULL) {
+		printf("Failed to allocate memory in compiler_parallel\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < pool->numWorkers; i++) {
+		if (arenas != NULL) {
+			arena_reset(&program->arenas[i]);
+		}
+		else {
+			arena_init(&program->arenas[i]);
+		}
+	}
+
+	tasks[0] = (Compile_Task){ .tokens = list, .ast = ast, .program = program, .index = 0, .node = *ast };
+	int index = 1;
+	for (int i = 0; i < (**ast).list.len; i++) {
+		AST* node = &((AST*)(**ast).list.arr)[i];
+		if (node->type == AST_FUNCTION_DEFINITION || node->type == AST_FUNCTION_IMPORT || node->type == AST_FUNCTION_EXTERN) {
+			tasks[index] = (Compile_Task){ .tokens = list, .ast = ast, .program = program, .index = index, .node = node };
+			index++;
+		}
+	}
+
+	//The top level statements were already parsed by parser, so function 0 only takes part in the second round
+	profiler_begin(PHASE_PARSE_BODIES);
+	for (int i = 1; i < program->numFunctions; i++) {
+		threadpool_submit(pool, compile_task_parse, &tasks[i]);
+	}
+	threadpool_wait(pool);
+
+	profiler_begin(PHASE_COMPILE);
+	for (int i = 0; i < program->numFunctions; i++) {
+		threadpool_submit(pool, compile_task_compile, &tasks[i]);
+	}
+	threadpool_wait(pool);
+	profiler_end();
+
+	int errors = 0;
+	for (int i = 0; i < program->numFunctions; i++) {
+		if (program->functions[i].diagnostics.str != NULL) {
+			printf("%s", program->functions[i].diagnostics.str);
+		}
+		errors += program->functions[i].numErrors;
+	}
+
+	mem_free(tasks);
+	return errors;
+}
+
+//Compiles the whole program using the workers of the pool. This expects parser to have already run so the function headers are
+//known. Returns the number of errors found
+int compiler_parallel(tokenList* list, AST** ast, Program* program, ThreadPool* pool) {
+	return compiler_parallel_arenas(list, ast, program, pool, NULL);
+}
+
+#endif
@@ -4,7 +4,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "Lexer.h"
-#include <Windows.h>
+#include "Arena.h"
+#include "Diagnostics.h"
 #include <stdbool.h>
 
 enum UP_RELATION_CONSTANTS {
@@ -19,6 +20,10 @@ enum UP_RELATION_CONSTANTS {
 	UREL_ROOT = 5,
 };
 
+#define NUM_UP_RELATIONS 6
+
+char* AST_relation_names[] = { "BODY", "CONDITION", "IF BODY", "ELSE BODY", "IRRELEVENT", "ROOT" };
+
 enum AST_TYPES {
 	AST_ASSIGN = 0,
 	AST_LOOP_WHILE = 1,
@@ -32,8 +37,52 @@ enum AST_TYPES {
 	AST_FUNCTION_PARAMETER = 8,
 	AST_IDENTIFIER_VARIABLE = 9,
 	AST_IDENTIFIER_FUNCTION = 10,
+	//The list of a function call node holds the argument expressions in the order they were passed
+	AST_FUNCTION_CALL = 11,
+	//The list of a function definition node holds the AST_FUNCTION_PARAMETER nodes followed by the statements of the body,
+	//which are marked with UREL_BODY
+	AST_FUNCTION_DEFINITION = 12,
+	AST_RETURN = 13,
+	AST_LITERAL = 14,
+	//Placeholder for the body of a function that hasn't been parsed yet. The token_index is the index of the opening brace, and the
+	//node gets swapped out for the statements of the body by parser_function_body the first time the body is needed
+	AST_UNPARSED_BODY = 15,
+	//An import statement. The token_index is the index of the string literal holding the path of the imported file
+	AST_IMPORT = 16,
+	//A function defined in an imported module. It looks like a function definition without a body, and the tokens it points to
+	//are copies of the header of the function that were added to the end of the token list of the importing module
+	AST_FUNCTION_IMPORT = 17,
+	//A function from a C library, declared with extern. It looks like a function definition without a body, and the token_index is
+	//the name of the function. The token before the return type is the string literal with the path of the library, if it was given
+	AST_FUNCTION_EXTERN = 18,
+};
+
+#define NUM_AST_TYPES 19
+
+char* AST_type_names[] = { "ASSIGN", "LOOP WHILE", "LOOP FOR", "ADD", "SUBTRACT", "MULTIPLY", "DIVIDE", "ROOT", "FUNCTION PARAMETER",
+	"IDENTIFIER VARIABLE", "IDENTIFIER FUNCTION", "FUNCTION CALL", "FUNCTION DEFINITION", "RETURN", "LITERAL", "UNPARSED BODY", "IMPORT",
+	"FUNCTION IMPORT", "FUNCTION EXTERN" };
+
+//The specialized operations the type checker picks for the arithmetic nodes, so that whatever ends up executing the AST knows
+//exactly what kind of operation to perform without having to look at the types of the operands
+enum AST_OPS {
+	OP_NONE = 0,
+	OP_INT_ADD = 1,
+	OP_INT_SUBTRACT = 2,
+	OP_INT_MULTIPLY = 3,
+	OP_INT_DIVIDE = 4,
+	OP_FLOAT_ADD = 5,
+	OP_FLOAT_SUBTRACT = 6,
+	OP_FLOAT_MULTIPLY = 7,
+	OP_FLOAT_DIVIDE = 8,
+	OP_STRING_CONCAT = 9,
 };
 
+#define NUM_AST_OPS 10
+
+char* AST_op_names[] = { "NONE", "INT ADD", "INT SUBTRACT", "INT MULTIPLY", "INT DIVIDE", "FLOAT ADD", "FLOAT SUBTRACT", "FLOAT MULTIPLY",
+	"FLOAT DIVIDE", "STRING CONCAT" };
+
 typedef struct AST_List {
 	//This has to be a void pointer because for some reason visual studio doesn't recognize the AST struct as existing
 	//yet since it doesn't come before this struct, and if I place the AST struct before this one then the visual studio
@@ -42,8 +91,14 @@ typedef struct AST_List {
 	void* arr;
 	int len;
 	int __size;
+	//The arena arr was allocated from, or NULL if it was allocated with malloc
+	Arena* __arena;
 } AST_List;
 
+//When this is set, every AST list initialized on the current thread allocates from this arena instead of the heap. This lets the
+//threads parsing different functions at the same time each use their own arena
+THREAD_LOCAL Arena* AST_arena = NULL;
+
 // The abstract syntax tree used to determine the semantics of the string of tokens output by the lexer
 // Every single node should be treated as a pointer in order for the functions to work properly, even the root node
 // Example decleration of an AST would be AST* ast; AST_init(&ast);
@@ -64,26 +119,37 @@ typedef struct AST {
 	void* prevNode;
 	//The location of the AST node in the list of AST nodes
 	int position;
+	//The type of the value the node produces as an index into the keywords list (the same way identifiers store their type
+	//in mdata), or -1 if it hasn't been resolved by the type checker yet
+	int valueType;
+	//The specialized operation from AST_OPS chosen by the type checker, or OP_NONE
+	int op;
 } AST;
 
 void AST_List_init(AST_List* list) {
 	list->len = 0;
 	list->__size = 1;
 	list->arr = NULL;
+	list->__arena = AST_arena;
 }
 
 void AST_init(AST** ast) {
-	*ast = (AST*)malloc(sizeof(AST));
+	*ast = (AST*)mem_alloc(sizeof(AST));
 	AST_List_init(&(*ast)->list);
 	(*ast)->token_index = -1;
 	(*ast)->type = AST_ROOT;
 	(*ast)->upRelation = UREL_IRRELEVENT;
 	(*ast)->prevNode = NULL;
 	(*ast)->position = 0;
+	(*ast)->valueType = -1;
+	(*ast)->op = OP_NONE;
 }
 
 void AST_List_destroy(AST_List* list) {
-	free(list->arr);
+	//Memory from an arena is freed all at once when the arena is destroyed
+	if (list->__arena == NULL) {
+		mem_free(list->arr);
+	}
 	list->len = 0;
 	list->__size = 1;
 	list->arr = NULL;
@@ -93,14 +159,26 @@ void AST_List_append(AST_List* list, AST node) {
 	if (list->len + 1 >= list->__size) {
 		list->__size *= 2;
 
-		AST* test = (AST*)realloc(list->arr, list->__size * sizeof(AST));
-
-		if (test == NULL) {
-			printf("Failed to allocate memory in AST_List_append\n");
-			exit(-1);
+		if (list->__arena != NULL) {
+			//Arenas can't grow an allocation in place, so the list gets moved to a bigger spot and the old one is left behind.
+			//Since the size doubles each time, the space left behind never adds up to more than the size of the list itself
+			AST* test = (AST*)arena_alloc(list->__arena, list->__size * sizeof(AST));
+			if (list->len > 0) {
+				memcpy(test, list->arr, list->len * sizeof(AST));
+			}
+			list->arr = test;
 		}
+		else {
+			profile_alloc(list->arr, list->__size * sizeof(AST));
+			AST* test = (AST*)mem_realloc(list->arr, list->__size * sizeof(AST));
 
-		list->arr = test;
+			if (test == NULL) {
+				printf("Failed to allocate memory in AST_List_append\n");
+				exit(-1);
+			}
+
+			list->arr = test;
+		}
 	}
 
 	node.position = list->len;
@@ -109,7 +187,8 @@ void AST_List_append(AST_List* list, AST node) {
 }
 
 void AST_List_pop(AST_List* list) {
-	if (list->len - 1 <= list->__size / 2) {
+	//Lists in an arena never shrink since the memory couldn't be given back anyway
+	if (list->len - 1 <= list->__size / 2 && list->__arena == NULL) {
 		list->__size /= 2;
 
 		//Due to rounding, list->__size could end up with the value 0, which would cause this function to break
@@ -117,7 +196,7 @@ void AST_List_pop(AST_List* list) {
 			list->__size = 1;
 		}
 
-		AST* test = (AST*)realloc(list->arr, list->__size * sizeof(AST));
+		AST* test = (AST*)mem_realloc(list->arr, list->__size * sizeof(AST));
 
 		if (test == NULL) {
 			printf("Failed to allocate memory in AST_List_pop\n");
@@ -166,63 +245,725 @@ void AST_pop(AST** ast) {
 	AST_List_pop(&(**ast).list);
 }
 
-void AST_print(tokenList* list, AST** ast) {
-	tokenList_print_individual(list->tokens[(**ast).token_index]);
-	switch ((**ast).upRelation) {
-	case UREL_BODY:
-		printf("UREL: BODY\n");
-		break;
-	case UREL_CONDITION:
-		printf("UREL: CONDITION\n");
-		break;
-	case UREL_IF_BODY:
-		printf("UREL: IF BODY\n");
-		break;
-	case UREL_ELSE_BODY:
-		printf("UREL: ELSE BODY\n");
+//What a visit function returns to tell the walk what to do next
+enum AST_VISIT_RESULTS {
+	VISIT_CONTINUE = 0,
+	//Don't go into the children of the node. In a post-order walk the children have already been visited, so this is the same as
+	//VISIT_CONTINUE
+	VISIT_SKIP_CHILDREN = 1,
+	//End the walk right away
+	VISIT_STOP = 2,
+};
+
+enum AST_VISIT_ORDERS {
+	//Every node is visited before its children
+	VISIT_PRE_ORDER = 0,
+	//Every node is visited after its children
+	VISIT_POST_ORDER = 1,
+	//Every node at one depth is visited before any of the nodes one deeper
+	VISIT_LEVEL_ORDER = 2,
+};
+
+typedef struct AST_Visitor AST_Visitor;
+
+//Returns one of AST_VISIT_RESULTS
+typedef int (*AST_Visit_Function)(AST_Visitor* visitor, AST* node);
+
+typedef struct AST_Visit_Entry {
+	AST* node;
+	//The index of the next child to go into, only used by post-order walks
+	int next;
+	int depth;
+} AST_Visit_Entry;
+
+//Walks the AST without recursion, keeping the nodes still to be visited on a stack (or queue for level-order walks) on the heap.
+//That way deeply nested expressions can't overflow the call stack, and a pass only has to write what it does with each node
+//
+//Each type of node can have its own visit function, and the fallback is used for any type that doesn't. Nodes with neither are
+//still walked through, they just aren't handed to anything. The stack is kept between walks, so reusing a visitor doesn't
+//allocate again
+struct AST_Visitor {
+	AST_Visit_Function callbacks[NUM_AST_TYPES];
+	AST_Visit_Function fallback;
+	//Whatever the visit functions need, since they only get the visitor and the node
+	void* data;
+	//How far below the node the walk started from the node being visited is
+	int depth;
+	//The node that returned VISIT_STOP, or NULL if the last walk went through the whole tree
+	AST* stoppedAt;
+	AST_Visit_Entry* stack;
+	int len;
+	int __size;
+};
+
+void AST_visitor_init(AST_Visitor* visitor, AST_Visit_Function fallback, void* data) {
+	for (int i = 0; i < NUM_AST_TYPES; i++) {
+		visitor->callbacks[i] = NULL;
+	}
+	visitor->fallback = fallback;
+	visitor->data = data;
+	visitor->depth = 0;
+	visitor->stoppedAt = NULL;
+	visitor->stack = NULL;
+	visitor->len = 0;
+	visitor->__size = 1;
+}
+
+//Sets the function that visits every node of the given type instead of the fallback
+void AST_visitor_on(AST_Visitor* visitor, int type, AST_Visit_Function visit) {
+	visitor->callbacks[type] = visit;
+}
+
+void AST_visitor_push(AST_Visitor* visitor, AST* node, int depth) {
+	if (visitor->len + 1 >= visitor->__size) {
+		//Starts off big enough for most expressions so small walks only allocate once
+		visitor->__size = visitor->__size < 32 ? 32 : visitor->__size * 2;
+
+		profile_alloc(visitor->stack, visitor->__size * sizeof(AST_Visit_Entry));
+		AST_Visit_Entry* test = (AST_Visit_Entry*)mem_realloc(visitor->stack, visitor->__size * sizeof(AST_Visit_Entry));
+
+		if (test == NULL) {
+			printf("Failed to allocate memory in AST_visitor_push\n");
+			exit(-1);
+		}
+
+		visitor->stack = test;
+	}
+
+	visitor->stack[visitor->len] = (AST_Visit_Entry){ .node = node, .next = 0, .depth = depth };
+	visitor->len++;
+}
+
+static inline int AST_visitor_call(AST_Visitor* visitor, AST* node, int depth) {
+	AST_Visit_Function visit = node->type >= 0 && node->type < NUM_AST_TYPES && visitor->callbacks[node->type] != NULL
+		? visitor->callbacks[node->type] : visitor->fallback;
+	if (visit == NULL) {
+		return VISIT_CONTINUE;
+	}
+
+	visitor->depth = depth;
+	int result = visit(visitor, node);
+	if (result == VISIT_STOP) {
+		visitor->stoppedAt = node;
+		visitor->len = 0;
+	}
+	return result;
+}
+
+//Walks the subtree starting at node (node included) in the given order. Returns false if a visit function stopped the walk early
+int AST_visit(AST_Visitor* visitor, AST* node, int order) {
+	visitor->len = 0;
+	visitor->stoppedAt = NULL;
+	AST_visitor_push(visitor, node, 0);
+
+	switch (order) {
+	case VISIT_PRE_ORDER:
+		while (visitor->len > 0) {
+			AST_Visit_Entry entry = visitor->stack[--visitor->len];
+			int result = AST_visitor_call(visitor, entry.node, entry.depth);
+			if (result == VISIT_STOP) {
+				return false;
+			}
+
+			//The children are pushed backwards so that the first one is on top of the stack
+			if (result != VISIT_SKIP_CHILDREN) {
+				for (int i = entry.node->list.len - 1; i >= 0; i--) {
+					AST_visitor_push(visitor, &((AST*)entry.node->list.arr)[i], entry.depth + 1);
+				}
+			}
+		}
 		break;
-	case UREL_IRRELEVENT:
-		printf("UREL: IRRELEVENT\n");
+	case VISIT_POST_ORDER:
+		while (visitor->len > 0) {
+			AST_Visit_Entry* entry = &visitor->stack[visitor->len - 1];
+			if (entry->next < entry->node->list.len) {
+				//The push can move the stack, so entry can't be used after it
+				AST* child = &((AST*)entry->node->list.arr)[entry->next];
+				entry->next++;
+				AST_visitor_push(visitor, child, entry->depth + 1);
+				continue;
+			}
+
+			visitor->len--;
+			if (AST_visitor_call(visitor, entry->node, entry->depth) == VISIT_STOP) {
+				return false;
+			}
+		}
 		break;
-	case UREL_ROOT:
-		printf("UREL: ROOT\n");
+	case VISIT_LEVEL_ORDER: {
+		//The stack is used as a queue here, with everything before head already visited
+		int head = 0;
+		while (head < visitor->len) {
+			AST_Visit_Entry entry = visitor->stack[head];
+			head++;
+			int result = AST_visitor_call(visitor, entry.node, entry.depth);
+			if (result == VISIT_STOP) {
+				return false;
+			}
+
+			if (result != VISIT_SKIP_CHILDREN) {
+				for (int i = 0; i < entry.node->list.len; i++) {
+					AST_visitor_push(visitor, &((AST*)entry.node->list.arr)[i], entry.depth + 1);
+				}
+			}
+		}
+		visitor->len = 0;
 		break;
-	default:
+	}
+	}
+
+	return true;
+}
+
+void AST_visitor_destroy(AST_Visitor* visitor) {
+	mem_free(visitor->stack);
+	visitor->stack = NULL;
+	visitor->len = 0;
+	visitor->__size = 1;
+}
+
+int AST_relink_visit(AST_Visitor* visitor, AST* node) {
+	(void)visitor;
+	for (int i = 0; i < node->list.len; i++) {
+		AST* child = &((AST*)node->list.arr)[i];
+		child->prevNode = node;
+		child->position = i;
+	}
+	return VISIT_CONTINUE;
+}
+
+//Since the nodes are stored by value inside of the lists of their parents, any realloc of a list or copy of a node leaves the
+//prevNode pointers of the children pointing at the old location. This walks the subtree and points every child back at its
+//actual parent
+void AST_relink(AST* node) {
+	AST_Visitor visitor;
+	AST_visitor_init(&visitor, AST_relink_visit, NULL);
+	AST_visit(&visitor, node, VISIT_PRE_ORDER);
+	AST_visitor_destroy(&visitor);
+}
+
+int AST_destroy_visit(AST_Visitor* visitor, AST* node) {
+	(void)visitor;
+	AST_List_destroy(&node->list);
+	return VISIT_CONTINUE;
+}
+
+//Frees the lists of every node below the given node, but not the node itself since it lives inside of the list of its parent
+void AST_destroy_children(AST* node) {
+	//The children have to be visited first since their lists are inside of the list of their parent
+	AST_Visitor visitor;
+	AST_visitor_init(&visitor, AST_destroy_visit, NULL);
+	AST_visit(&visitor, node, VISIT_POST_ORDER);
+	AST_visitor_destroy(&visitor);
+}
+
+//The state of a copy being built by a pre-order walk. A pre-order walk goes through the whole subtree of a node before moving on to
+//the next node at the same depth, so the node one depth up from the one being visited is always the last one that was copied there
+typedef struct AST_Copy {
+	AST* dest;
+	//The last copy made at each depth
+	AST** parents;
+	int __size;
+} AST_Copy;
+
+void AST_copy_init(AST_Copy* copy, AST* dest) {
+	copy->dest = dest;
+	copy->parents = NULL;
+	copy->__size = 0;
+}
+
+void AST_copy_destroy(AST_Copy* copy) {
+	mem_free(copy->parents);
+	copy->parents = NULL;
+	copy->__size = 0;
+}
+
+//Copies src without its children to where it goes in the copy, which is dest for the node the walk started from and the end of the
+//list of its parent for anything under it. Returns the copy
+AST* AST_copy_place(AST_Copy* copy, AST* src, int depth) {
+	if (depth >= copy->__size) {
+		copy->__size = copy->__size < 16 ? 16 : copy->__size * 2;
+		while (copy->__size <= depth) {
+			copy->__size *= 2;
+		}
+
+		AST** test = (AST**)mem_realloc(copy->parents, copy->__size * sizeof(AST*));
+
+		if (test == NULL) {
+			printf("Failed to allocate memory in AST_copy_place\n");
+			exit(-1);
+		}
+
+		copy->parents = test;
+	}
+
+	AST* node = copy->dest;
+	if (depth > 0) {
+		//Only the parent list grows here, and nothing points into it other than the entry for this depth, which is being replaced
+		AST* parent = copy->parents[depth - 1];
+		AST_List_append(&parent->list, (AST){ .token_index = 0 });
+		node = &((AST*)parent->list.arr)[parent->list.len - 1];
+	}
+
+	node->token_index = src->token_index;
+	node->upRelation = src->upRelation;
+	node->type = src->type;
+	node->valueType = src->valueType;
+	node->op = src->op;
+	AST_List_init(&node->list);
+	copy->parents[depth] = node;
+	return node;
+}
+
+int AST_copy_visit(AST_Visitor* visitor, AST* node) {
+	AST_copy_place((AST_Copy*)visitor->data, node, visitor->depth);
+	return VISIT_CONTINUE;
+}
+
+//Makes a deep copy of src into dest. dest is treated as uninitialized, so anything it was holding onto should be freed beforehand.
+//The prevNode and position of dest are left for the caller to set since they depend on where the copy ends up, and AST_relink
+//has to be called on the copy once it is in its final spot
+void AST_copy(AST* dest, AST* src) {
+	AST_Copy copy;
+	AST_copy_init(&copy, dest);
+	AST_Visitor visitor;
+	AST_visitor_init(&visitor, AST_copy_visit, &copy);
+	AST_visit(&visitor, src, VISIT_PRE_ORDER);
+	AST_visitor_destroy(&visitor);
+	AST_copy_destroy(&copy);
+}
+
+int AST_count_visit(AST_Visitor* visitor, AST* node) {
+	(void)node;
+	(*(int*)visitor->data)++;
+	return VISIT_CONTINUE;
+}
+
+int AST_count_nodes(AST* node) {
+	int count = 0;
+	AST_Visitor visitor;
+	AST_visitor_init(&visitor, AST_count_visit, &count);
+	AST_visit(&visitor, node, VISIT_PRE_ORDER);
+	AST_visitor_destroy(&visitor);
+	return count;
+}
+
+void AST_print(tokenList* list, AST** ast) {
+	//The root node doesn't come from a token
+	if ((**ast).token_index >= 0 && (**ast).token_index < list->len) {
+		tokenList_print_individual(list->tokens[(**ast).token_index]);
+	}
+	else {
+		printf("TYPE: ERROR\nTOKEN: ERROR\nMDATA: NONE\n");
+	}
+
+	if ((**ast).upRelation >= 0 && (**ast).upRelation < NUM_UP_RELATIONS) {
+		printf("UREL: %s\n", AST_relation_names[(**ast).upRelation]);
+	}
+	else {
 		printf("UREL: ERROR\n");
 	}
 
-	switch ((**ast).type) {
-	case AST_ASSIGN:
-		printf("AST TYPE: ASSIGN\n");
-		break;
-	case AST_LOOP_WHILE:
-		printf("AST TYPE: LOOP WHILE\n");
-		break;
-	case AST_LOOP_FOR:
-		printf("AST TYPE: LOOP FOR\n");
-		break;
-	case AST_ADD:
-		printf("AST TYPE: ADD\n");
-		break;
-	case AST_SUBTRACT:
-		printf("AST TYPE: SUBTRACT\n");
-		break;
-	case AST_MULTIPLY:
-		printf("AST TYPE: MULTIPLY\n");
-		break;
-	case AST_DIVIDE:
-		printf("AST TYPE: DIVIDE\n");
-		break;
-	case AST_ROOT:
-		printf("AST TYPE: ROOT\n");
-		break;
-	default:
+	if ((**ast).type >= 0 && (**ast).type < NUM_AST_TYPES) {
+		printf("AST TYPE: %s\n", AST_type_names[(**ast).type]);
+	}
+	else {
 		printf("AST TYPE: ERROR\n");
 	}
+
+	if ((**ast).valueType != -1) {
+		printf("VALUE TYPE: %s\n", keywords[(**ast).valueType].str);
+	}
+
+	if ((**ast).op > OP_NONE && (**ast).op < NUM_AST_OPS) {
+		printf("OP: %s\n", AST_op_names[(**ast).op]);
+	}
+}
+
+typedef struct Parser {
+	tokenList* tokens;
+	//The index of the token currently being looked at
+	int index;
+	int num_errors;
+} Parser;
+
+//Returns a node that isn't attached to anything yet. AST_relink takes care of the prevNode pointers once the node is in place
+AST parser_node(int type, int token_index, int upRelation) {
+	AST node;
+	AST_List_init(&node.list);
+	node.token_index = token_index;
+	node.upRelation = upRelation;
+	node.type = type;
+	node.prevNode = NULL;
+	node.position = 0;
+	node.valueType = -1;
+	node.op = OP_NONE;
+	profile_count(&profiler.nodes, 1);
+	return node;
+}
+
+//Returns true if the token at the given index has the given type and value
+int parser_token_is(Parser* p, int index, enum TYPE type, long long val) {
+	return index < p->tokens->len && p->tokens->tokens[index].type == type && p->tokens->tokens[index].val == val;
+}
+
+int parser_at(Parser* p, enum TYPE type, long long val) {
+	return parser_token_is(p, p->index, type, val);
+}
+
+void parser_error(Parser* p, char* message) {
+	diagnostics_error(p->tokens, "Syntax", p->index, message);
+	p->num_errors++;
+}
+
+//Consumes the expected punctuator, or reports an error if it isn't there
+int parser_expect(Parser* p, int punctuator, char* message) {
+	if (parser_at(p, PUNCTUATOR, punctuator)) {
+		p->index++;
+		return true;
+	}
+	parser_error(p, message);
+	return false;
+}
+
+//Returns true if a function definition starts at the given index, which is a variable type keyword followed by an identifier with
+//the function bit set and then an opening parentheses
+int parser_is_function_header(tokenList* list, int index) {
+	return index + 2 < list->len
+		&& list->tokens[index].type == KEYWORD && is_keyword_variable_type(list->tokens[index].val)
+		&& token_is_function(list->tokens[index + 1])
+		&& list->tokens[index + 2].type == PUNCTUATOR && list->tokens[index + 2].val == PUNCTUATOR_OPEN_PAREN;
+}
+
+//Returns the index of the brace that closes the one at open_index, or -1 if it is never closed. This only looks at the punctuator
+//tokens, so skipping a function body this way is far cheaper than parsing it
+int parser_match_brace(tokenList* list, int open_index) {
+	int depth = 0;
+	for (int i = open_index; i < list->len; i++) {
+		if (list->tokens[i].type != PUNCTUATOR) {
+			continue;
+		}
+
+		if (list->tokens[i].val == PUNCTUATOR_OPEN_BRACE) {
+			depth++;
+		}
+		else if (list->tokens[i].val == PUNCTUATOR_CLOSE_BRACE) {
+			depth--;
+			if (depth == 0) {
+				return i;
+			}
+		}
+	}
+	return -1;
+}
+
+AST parser_expression(Parser* p);
+
+AST parser_primary(Parser* p) {
+	if (p->index >= p->tokens->len) {
+		parser_error(p, "Expected an expression but reached the end of the file");
+		return parser_node(AST_LITERAL, p->tokens->len - 1, UREL_IRRELEVENT);
+	}
+
+	token tok = p->tokens->tokens[p->index];
+
+	if (tok.type == LITERAL) {
+		p->index++;
+		return parser_node(AST_LITERAL, p->index - 1, UREL_IRRELEVENT);
+	}
+
+	if (tok.type == IDENTIFIER && token_is_function(tok) && parser_token_is(p, p->index + 1, PUNCTUATOR, PUNCTUATOR_OPEN_PAREN)) {
+		AST call = parser_node(AST_FUNCTION_CALL, p->index, UREL_IRRELEVENT);
+		p->index += 2;
+
+		while (!parser_at(p, PUNCTUATOR, PUNCTUATOR_CLOSE_PAREN) && p->index < p->tokens->len) {
+			AST_List_append(&call.list, parser_expression(p));
+
+			if (!parser_at(p, PUNCTUATOR, PUNCTUATOR_COMMA)) {
+				break;
+			}
+			p->index++;
+		}
+
+		parser_expect(p, PUNCTUATOR_CLOSE_PAREN, "Expected ) after the arguments of a function call");
+		return call;
+	}
+
+	if (tok.type == IDENTIFIER) {
+		p->index++;
+		return parser_node(AST_IDENTIFIER_VARIABLE, p->index - 1, UREL_IRRELEVENT);
+	}
+
+	if (parser_at(p, PUNCTUATOR, PUNCTUATOR_OPEN_PAREN)) {
+		p->index++;
+		AST expr = parser_expression(p);
+		parser_expect(p, PUNCTUATOR_CLOSE_PAREN, "Expected ) to close the parentheses");
+		return expr;
+	}
+
+	parser_error(p, "Expected an expression");
+	p->index++;
+	return parser_node(AST_LITERAL, p->index - 1, UREL_IRRELEVENT);
+}
+
+//Parses a chain of binary operators that all have the same precedence. The operands are parsed by next, and operator_a and
+//operator_b (with ast_a and ast_b being their node types) are the operators that belong to this level of precedence
+AST parser_binary(Parser* p, AST(*next)(Parser*), int operator_a, int ast_a, int operator_b, int ast_b) {
+	AST left = next(p);
+
+	while (parser_at(p, OPERATOR, operator_a) || parser_at(p, OPERATOR, operator_b)) {
+		int type = parser_at(p, OPERATOR, operator_a) ? ast_a : ast_b;
+		AST node = parser_node(type, p->index, UREL_IRRELEVENT);
+		p->index++;
+
+		AST right = next(p);
+		AST_List_append(&node.list, left);
+		AST_List_append(&node.list, right);
+		left = node;
+	}
+
+	return left;
 }
 
+AST parser_term(Parser* p) {
+	return parser_binary(p, parser_primary, OPERATOR_MULTIPLY, AST_MULTIPLY, OPERATOR_DIVIDE, AST_DIVIDE);
+}
+
+AST parser_expression(Parser* p) {
+	AST expr = parser_binary(p, parser_term, OPERATOR_ADD, AST_ADD, OPERATOR_SUBTRACT, AST_SUBTRACT);
+
+	if (parser_at(p, OPERATOR, OPERATOR_LESS) || parser_at(p, OPERATOR, OPERATOR_GREATER)) {
+		parser_error(p, "Comparison operators are not supported yet");
+		p->index++;
+		AST right = parser_expression(p);
+		AST_destroy_children(&right);
+	}
+
+	return expr;
+}
+
+//Skips ahead to just past the next semicolon so that one bad statement doesn't cause errors for every statement after it. This
+//stops at a closing brace so that the end of the function body is never skipped over
+void parser_recover(Parser* p) {
+	while (p->index < p->tokens->len && !parser_at(p, PUNCTUATOR, PUNCTUATOR_CLOSE_BRACE)) {
+		p->index++;
+		if (parser_token_is(p, p->index - 1, PUNCTUATOR, PUNCTUATOR_SEMICOLON)) {
+			return;
+		}
+	}
+}
+
+//Parses a single statement and appends it to the list of the parent node
+void parser_statement(Parser* p, AST* parent, int upRelation) {
+	int errors = p->num_errors;
+	AST statement;
+
+	if (p->tokens->tokens[p->index].type == KEYWORD && is_keyword_variable_type(p->tokens->tokens[p->index].val)) {
+		//Variable declaration, which is either a plain declaration or a declaration with an assignment
+		p->index++;
+		if (p->index >= p->tokens->len || p->tokens->tokens[p->index].type != IDENTIFIER) {
+			parser_error(p, "Expected an identifier after the variable type");
+			parser_recover(p);
+			return;
+		}
+
+		AST variable = parser_node(AST_IDENTIFIER_VARIABLE, p->index, UREL_IRRELEVENT);
+		p->index++;
+
+		if (parser_at(p, OPERATOR, OPERATOR_ASSIGN)) {
+			statement = parser_node(AST_ASSIGN, p->index, upRelation);
+			p->index++;
+			AST_List_append(&statement.list, variable);
+			AST_List_append(&statement.list, parser_expression(p));
+		}
+		else {
+			statement = variable;
+			statement.upRelation = upRelation;
+		}
+	}
+	else if (parser_at(p, KEYWORD, KEYWORD_RETURN)) {
+		statement = parser_node(AST_RETURN, p->index, upRelation);
+		p->index++;
+
+		if (!parser_at(p, PUNCTUATOR, PUNCTUATOR_SEMICOLON)) {
+			AST_List_append(&statement.list, parser_expression(p));
+		}
+	}
+	else if (p->tokens->tokens[p->index].type == IDENTIFIER && parser_token_is(p, p->index + 1, OPERATOR, OPERATOR_ASSIGN)) {
+		statement = parser_node(AST_ASSIGN, p->index + 1, upRelation);
+		AST_List_append(&statement.list, parser_node(AST_IDENTIFIER_VARIABLE, p->index, UREL_IRRELEVENT));
+		p->index += 2;
+		AST_List_append(&statement.list, parser_expression(p));
+	}
+	else {
+		statement = parser_expression(p);
+		statement.upRelation = upRelation;
+	}
+
+	parser_expect(p, PUNCTUATOR_SEMICOLON, "Expected ; at the end of the statement");
+
+	//Statements with errors in them are thrown away instead of being added to the AST, so later passes never see them
+	if (p->num_errors != errors) {
+		AST_destroy_children(&statement);
+		parser_recover(p);
+		return;
+	}
+
+	AST_List_append(&parent->list, statement);
+}
+
+//Parses the parameters of a function header into def, starting right after the opening parentheses and ending after the closing one
+void parser_function_params(Parser* p, AST* def) {
+	while (!parser_at(p, PUNCTUATOR, PUNCTUATOR_CLOSE_PAREN) && p->index + 1 < p->tokens->len) {
+		if (p->tokens->tokens[p->index].type != KEYWORD || !is_keyword_variable_type(p->tokens->tokens[p->index].val)
+			|| p->tokens->tokens[p->index + 1].type != IDENTIFIER) {
+			parser_error(p, "Expected a parameter type followed by a name");
+			break;
+		}
+
+		AST_List_append(&def->list, parser_node(AST_FUNCTION_PARAMETER, p->index + 1, UREL_IRRELEVENT));
+		p->index += 2;
+
+		if (!parser_at(p, PUNCTUATOR, PUNCTUATOR_COMMA)) {
+			break;
+		}
+		p->index++;
+	}
+
+	parser_expect(p, PUNCTUATOR_CLOSE_PAREN, "Expected ) after the parameters of the function");
+}
+
+//Parses the header of a function definition and appends it to the root node. The body is skipped over by matching braces and left
+//as an AST_UNPARSED_BODY node for parser_function_body to fill in later
+void parser_function_header(Parser* p, AST* root) {
+	AST def = parser_node(AST_FUNCTION_DEFINITION, p->index + 1, UREL_ROOT);
+	p->index += 3;
+	parser_function_params(p, &def);
+
+	if (!parser_at(p, PUNCTUATOR, PUNCTUATOR_OPEN_BRACE)) {
+		parser_error(p, "Expected { to start the body of the function");
+		AST_destroy_children(&def);
+		parser_recover(p);
+		return;
+	}
+
+	int close = parser_match_brace(p->tokens, p->index);
+	if (close == -1) {
+		parser_error(p, "The body of the function is never closed with a }");
+		AST_destroy_children(&def);
+		p->index = p->tokens->len;
+		return;
+	}
+
+	AST_List_append(&def.list, parser_node(AST_UNPARSED_BODY, p->index, UREL_BODY));
+	AST_List_append(&root->list, def);
+	p->index = close + 1;
+}
+
+//Parses an extern declaration, which is extern, then the path of the library as a string if it isn't in the program already, and then
+//the header of the function ending with a ; instead of a body
+void parser_extern(Parser* p, AST* root) {
+	p->index++;
+	if (p->index < p->tokens->len && p->tokens->tokens[p->index].type == LITERAL && p->tokens->tokens[p->index].mdata == STRING_LITERAL) {
+		p->index++;
+	}
+
+	if (!parser_is_function_header(p->tokens, p->index)) {
+		parser_error(p, "Expected the return type, name, and parameters of the extern function");
+		parser_recover(p);
+		return;
+	}
+
+	AST def = parser_node(AST_FUNCTION_EXTERN, p->index + 1, UREL_ROOT);
+	p->index += 3;
+	parser_function_params(p, &def);
+
+	if (!parser_expect(p, PUNCTUATOR_SEMICOLON, "Expected ; after the extern function, since it can't have a body")) {
+		AST_destroy_children(&def);
+		parser_recover(p);
+		return;
+	}
+	AST_List_append(&root->list, def);
+}
+
+//Parses the body of a function definition if that hasn't been done yet. Returns the number of syntax errors found in the body
+int parser_function_body(tokenList* list, AST* def) {
+	if (def->type != AST_FUNCTION_DEFINITION || def->list.len == 0) {
+		return 0;
+	}
+
+	AST* last = &((AST*)def->list.arr)[def->list.len - 1];
+	if (last->type != AST_UNPARSED_BODY) {
+		return 0;
+	}
+
+	Parser p = { .tokens = list, .index = last->token_index + 1, .num_errors = 0 };
+	AST_List_pop(&def->list);
+
+	while (p.index < list->len && !parser_at(&p, PUNCTUATOR, PUNCTUATOR_CLOSE_BRACE)) {
+		parser_statement(&p, def, UREL_BODY);
+	}
+
+	AST_relink(def);
+	return p.num_errors;
+}
+
+//Parses every function body that hasn't been parsed yet. Returns the number of syntax errors found
+int parser_all_bodies(tokenList* list, AST** ast) {
+	profiler_begin(PHASE_PARSE_BODIES);
+	int errors = 0;
+	for (int i = 0; i < (**ast).list.len; i++) {
+		errors += parser_function_body(list, &((AST*)(**ast).list.arr)[i]);
+	}
+	profiler_end();
+	return errors;
+}
+
+//Parses a single top level item, which is a statement, an import, an extern function, or a function definition, and appends whatever
+//it produces to the root node. An item with an error in it might not produce anything
+void parser_item(Parser* p, AST* root) {
+	if (parser_is_function_header(p->tokens, p->index)) {
+		parser_function_header(p, root);
+	}
+	else if (parser_at(p, KEYWORD, KEYWORD_EXTERN)) {
+		parser_extern(p, root);
+	}
+	else if (parser_at(p, KEYWORD, KEYWORD_IMPORT)) {
+		//Imports are only allowed at the top level, and are resolved by the build driver in Module.h
+		p->index++;
+		if (p->index < p->tokens->len && p->tokens->tokens[p->index].type == LITERAL && p->tokens->tokens[p->index].mdata == STRING_LITERAL) {
+			AST_List_append(&root->list, parser_node(AST_IMPORT, p->index, UREL_ROOT));
+			p->index++;
+			parser_expect(p, PUNCTUATOR_SEMICOLON, "Expected ; after the import");
+		}
+		else {
+			parser_error(p, "Expected the path of the file to import as a string");
+			parser_recover(p);
+		}
+	}
+	else if (parser_at(p, PUNCTUATOR, PUNCTUATOR_CLOSE_BRACE)) {
+		parser_error(p, "Unexpected }");
+		p->index++;
+	}
+	else {
+		parser_statement(p, root, UREL_ROOT);
+	}
+}
+
+//Builds the AST from the tokens output by the lexer. Only the top level statements and the headers of function definitions are
+//parsed here, and function bodies are left to be parsed the first time they are actually needed, so the time it takes to get
+//started depends on the code that actually runs instead of the size of the file. Returns the number of syntax errors found
 int parser(tokenList* list, AST** ast) {
+	profiler_begin(PHASE_PARSE);
+	Parser p = { .tokens = list, .index = 0, .num_errors = 0 };
+
+	while (p.index < list->len) {
+		parser_item(&p, *ast);
+	}
 
+	AST_relink(*ast);
+	profiler_end();
+	return p.num_errors;
 }
 
-#endif
\ No newline at end of file
+#endif
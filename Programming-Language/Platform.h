@@ -0,0 +1,223 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+//This header file contains the small differences between compilers and operating systems that the rest of the code needs
+//
+//On Linux the POSIX functions used here (realpath, clock_gettime, etc.) are hidden by the standard headers when compiling in strict
+//c17 mode, so every file with a main function defines _DEFAULT_SOURCE before including anything
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <direct.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <limits.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <dlfcn.h>
+#endif
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+#ifdef _WIN32
+#define PATH_SEPARATOR '\\'
+#else
+#define PATH_SEPARATOR '/'
+#endif
+
+//Returns the time in nanoseconds from a clock that never goes backwards. It doesn't start from anything meaningful, so it is only
+//useful for measuring how long something took
+long long platform_time_ns() {
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER now;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+	//Split up so that the multiplication can't overflow
+	return now.QuadPart / frequency.QuadPart * 1000000000LL + now.QuadPart % frequency.QuadPart * 1000000000LL / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+//Writes the absolute, normalized version of path into out. Returns false if the file doesn't exist
+int platform_full_path(char* path, char* out, int size) {
+#ifdef _WIN32
+	if (_fullpath(out, path, size) == NULL) {
+		return false;
+	}
+	FILE* fptr = fopen(out, "rb");
+	if (fptr == NULL) {
+		return false;
+	}
+	fclose(fptr);
+	return true;
+#else
+	char buffer[PATH_MAX];
+	if (realpath(path, buffer) == NULL) {
+		return false;
+	}
+	snprintf(out, size, "%s", buffer);
+	return true;
+#endif
+}
+
+//Creates the directory if it doesn't already exist. Returns false if it doesn't exist and couldn't be created
+int platform_make_directory(char* path) {
+#ifdef _WIN32
+	_mkdir(path);
+#else
+	mkdir(path, 0755);
+#endif
+	struct stat info;
+	return stat(path, &info) == 0 && (info.st_mode & S_IFDIR);
+}
+
+//Maps a whole file into memory as read only. Returns NULL if the file can't be opened or is empty, otherwise size is set to the size
+//of the file. Nothing is read from the file until the memory is actually touched, and then only the pages that are touched
+void* platform_map_file(char* path, long long* size) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return NULL;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) {
+		return NULL;
+	}
+
+	//The view keeps the mapping alive on its own, so the handle can be closed right away
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	*size = fileSize.QuadPart;
+	return data;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		return NULL;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+
+	void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return NULL;
+	}
+
+	*size = info.st_size;
+	return data;
+#endif
+}
+
+void platform_unmap_file(void* data, long long size) {
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
+//Opens a file for writing, creating it or emptying it first. Returns the file descriptor, or -1 if it couldn't be opened
+int platform_open_write(char* path) {
+#ifdef _WIN32
+	return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+	return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+}
+
+//Writes all len bytes of data to the file descriptor, even if it takes more than one call. Returns false if the write failed
+int platform_write(int fd, void* data, long long len) {
+	char* bytes = (char*)data;
+	while (len > 0) {
+#ifdef _WIN32
+		int written = _write(fd, bytes, len > 0x40000000 ? 0x40000000 : (unsigned int)len);
+#else
+		long long written = write(fd, bytes, len);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+#endif
+		if (written <= 0) {
+			return false;
+		}
+		bytes += written;
+		len -= written;
+	}
+	return true;
+}
+
+void platform_close(int fd) {
+#ifdef _WIN32
+	_close(fd);
+#else
+	close(fd);
+#endif
+}
+
+//Opens a shared library, or the C standard library if path is NULL. Returns NULL if it couldn't be opened
+//
+//On POSIX a NULL path opens the program itself along with every library it was linked with, which includes the C library. On Windows
+//the program only exports what it declares itself, so the C runtime is opened by name instead, with the older msvcrt.dll as a fallback
+//for systems without the universal one
+void* platform_open_library(char* path) {
+#ifdef _WIN32
+	if (path == NULL) {
+		HMODULE crt = LoadLibraryA("ucrtbase.dll");
+		return crt != NULL ? (void*)crt : (void*)LoadLibraryA("msvcrt.dll");
+	}
+	return (void*)LoadLibraryA(path);
+#else
+	return dlopen(path, RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+//Returns the address of the function with the given name in a library opened by platform_open_library, or NULL if it doesn't have one
+void* platform_find_symbol(void* library, char* name) {
+#ifdef _WIN32
+	return (void*)GetProcAddress((HMODULE)library, name);
+#else
+	return dlsym(library, name);
+#endif
+}
+
+void platform_close_library(void* library) {
+#ifdef _WIN32
+	FreeLibrary((HMODULE)library);
+#else
+	dlclose(library);
+#endif
+}
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Platform.h"
+#include <stdbool.h>
+
+//This header file contains the profiler for the phases of the compiler
+//
+//The profiler is off until profiler_enable is called, and while it is off every hook is a single check of a flag, so it can be
+//left in the code all the time. While it is on, each phase records how long it took using a clock that never goes backwards, and
+//the append functions of the containers (strings, vectors, token lists, AST lists, etc.) report every malloc and realloc they do
+//so that it gets charged to whatever phase is running at the time
+//
+//Only the thread that turned the profiler on records anything, so the counters never need locking. When a phase hands work off to
+//the thread pool, its time still covers the whole thing since the thread that started it waits for the workers, but the
+//allocations done by the workers aren't counted
+
+enum PROFILE_PHASES {
+	//Anything that happens outside of the phases below
+	PHASE_OTHER = 0,
+	PHASE_LOAD = 1,
+	//Taking out carriage returns and turning tabs into spaces before lexing
+	PHASE_NORMALIZE = 2,
+	//The first stage of the lexer, which splits the text into tokens
+	PHASE_LEX_SCAN = 3,
+	//The second stage of the lexer, which finds every declaration
+	PHASE_LEX_DECLARATIONS = 4,
+	//The last stage of the lexer, which turns the rest of the undefined tokens into identifiers and numbers
+	PHASE_LEX_RESOLVE = 5,
+	PHASE_PARSE = 6,
+	PHASE_PARSE_BODIES = 7,
+	PHASE_TYPECHECK = 8,
+	PHASE_INLINE = 9,
+	PHASE_COMPILE = 10,
+	PHASE_IMAGE = 11,
+	PHASE_RUN = 12,
+};
+
+#define NUM_PROFILE_PHASES 13
+
+char* profile_phase_names[] = { "other", "load", "normalize", "lex-scan", "lex-declarations", "lex-resolve", "parse", "parse-bodies",
+	"typecheck", "inline", "compile", "image", "run" };
+
+typedef struct Profile_Phase {
+	long long ns;
+	//How many times the phase was run
+	int runs;
+	long long mallocs;
+	long long reallocs;
+	long long bytes;
+} Profile_Phase;
+
+typedef struct Profiler {
+	//The phase allocations are charged to right now
+	int current;
+	//When the current phase started
+	long long start;
+	Profile_Phase phases[NUM_PROFILE_PHASES];
+	long long sourceBytes;
+	long long tokens;
+	long long nodes;
+} Profiler;
+
+Profiler profiler = { 0 };
+//Whether the profiler is on for the current thread
+THREAD_LOCAL int profiler_active = false;
+
+void profiler_enable() {
+	profiler = (Profiler){ 0 };
+	profiler.current = PHASE_OTHER;
+	profiler_active = true;
+}
+
+void profiler_disable() {
+	profiler_active = false;
+}
+
+//Starts timing a phase. Phases don't nest, so starting one while another is running just ends the other one first
+void profiler_begin(int phase) {
+	if (!profiler_active) {
+		return;
+	}
+
+	long long now = platform_time_ns();
+	if (profiler.current != PHASE_OTHER) {
+		profiler.phases[profiler.current].ns += now - profiler.start;
+	}
+	profiler.current = phase;
+	profiler.phases[phase].runs++;
+	profiler.start = now;
+}
+
+void profiler_end() {
+	if (!profiler_active || profiler.current == PHASE_OTHER) {
+		return;
+	}
+
+	profiler.phases[profiler.current].ns += platform_time_ns() - profiler.start;
+	profiler.current = PHASE_OTHER;
+}
+
+//Called by the containers right before they allocate. old is the memory being reallocated, or NULL if this is a new allocation
+static inline void profile_alloc(void* old, long long bytes) {
+	if (profiler_active) {
+		Profile_Phase* phase = &profiler.phases[profiler.current];
+		if (old == NULL) {
+			phase->mallocs++;
+		}
+		else {
+			phase->reallocs++;
+		}
+		phase->bytes += bytes;
+	}
+}
+
+static inline void profile_count(long long* counter, long long amount) {
+	if (profiler_active) {
+		*counter += amount;
+	}
+}
+
+//Returns how many of count happened per second over the given time, or 0 if no time was recorded
+double profile_rate(long long count, long long ns) {
+	return ns > 0 ? (double)count * 1000000000.0 / (double)ns : 0.0;
+}
+
+void profiler_report_text(FILE* out) {
+	long long totalNs = 0;
+	long long lexNs = profiler.phases[PHASE_NORMALIZE].ns + profiler.phases[PHASE_LEX_SCAN].ns + profiler.phases[PHASE_LEX_DECLARATIONS].ns
+		+ profiler.phases[PHASE_LEX_RESOLVE].ns;
+	long long parseNs = profiler.phases[PHASE_PARSE].ns + profiler.phases[PHASE_PARSE_BODIES].ns;
+
+	fprintf(out, "%-18s %6s %12s %10s %10s %14s\n", "phase", "runs", "ms", "mallocs", "reallocs", "bytes");
+	for (int i = 0; i < NUM_PROFILE_PHASES; i++) {
+		Profile_Phase* phase = &profiler.phases[i];
+		if (phase->runs == 0 && phase->mallocs == 0 && phase->reallocs == 0) {
+			continue;
+		}
+
+		fprintf(out, "%-18s %6d %12.3f %10lld %10lld %14lld\n", profile_phase_names[i], phase->runs, phase->ns / 1000000.0,
+			phase->mallocs, phase->reallocs, phase->bytes);
+		totalNs += phase->ns;
+	}
+
+	fprintf(out, "total: %.3f ms\n", totalNs / 1000000.0);
+	fprintf(out, "source: %lld bytes, %lld tokens, %lld nodes\n", profiler.sourceBytes, profiler.tokens, profiler.nodes);
+	fprintf(out, "lexer: %.0f tokens/sec, %.0f bytes/sec\n", profile_rate(profiler.tokens, lexNs), profile_rate(profiler.sourceBytes, lexNs));
+	fprintf(out, "parser: %.0f nodes/sec\n", profile_rate(profiler.nodes, parseNs));
+}
+
+//Same as profiler_report_text, but as a single JSON object for anything that wants to read the numbers
+void profiler_report_json(FILE* out) {
+	long long totalNs = 0;
+	long long lexNs = profiler.phases[PHASE_NORMALIZE].ns + profiler.phases[PHASE_LEX_SCAN].ns + profiler.phases[PHASE_LEX_DECLARATIONS].ns
+		+ profiler.phases[PHASE_LEX_RESOLVE].ns;
+	long long parseNs = profiler.phases[PHASE_PARSE].ns + profiler.phases[PHASE_PARSE_BODIES].ns;
+
+	fprintf(out, "{\"phases\":[");
+	for (int i = 0; i < NUM_PROFILE_PHASES; i++) {
+		Profile_Phase* phase = &profiler.phases[i];
+		fprintf(out, "%s{\"name\":\"%s\",\"runs\":%d,\"ns\":%lld,\"mallocs\":%lld,\"reallocs\":%lld,\"bytes\":%lld}", i == 0 ? "" : ",",
+			profile_phase_names[i], phase->runs, phase->ns, phase->mallocs, phase->reallocs, phase->bytes);
+		totalNs += phase->ns;
+	}
+
+	fprintf(out, "],\"total_ns\":%lld,\"source_bytes\":%lld,\"tokens\":%lld,\"nodes\":%lld,", totalNs, profiler.sourceBytes, profiler.tokens,
+		profiler.nodes);
+	fprintf(out, "\"tokens_per_sec\":%.0f,\"nodes_per_sec\":%.0f}\n", profile_rate(profiler.tokens, lexNs), profile_rate(profiler.nodes, parseNs));
+}
+
+#endif
@@ -0,0 +1,563 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Platform.h"
+#include "Memory.h"
+#include "ThreadPool.h"
+#include "Driver.h"
+#include <stdbool.h>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
+
+//This header file contains the compile server, which keeps a batch driver running in the background so that it doesn't have to be
+//started up again for every build
+//
+//The server listens on a Unix domain socket. The driver it keeps holds the thread pool, the arenas of the workers, and the cache
+//(when one is given), so after the first request a build only costs whatever actually has to be compiled. The keyword tables of
+//the lexer are globals, so they stay loaded along with everything else
+//
+//The client just sends its working directory and its arguments, which are the same ones --batch takes, and prints whatever comes
+//back. Every client gets its own thread on the server, so any number of them can be connected at once and none of them has to wait
+//to be accepted. The compiles themselves take turns though, since they share the driver (and a compile uses every worker anyway).
+//While a request is being compiled the output of the server is pointed at the socket of its client, which means anything the
+//compiler prints, including runtime errors, goes back to the client without the compiler needing to know about the server at all
+//
+//A request that runs programs (anything that turns on --run) is handled in a child process with a driver of its own instead, since
+//a program can crash the process it runs in (an extern function can do anything at all). A crash then only ends that request, and
+//the client is told which signal it died of. The child starts with a fresh thread pool and doesn't use the cache, so only requests
+//that just compile get the warm driver
+//
+//A request is the magic number, the number of strings, and then every string as its length followed by its characters. The first
+//string is the working directory of the client. The reply is everything the compiler printed, followed by the exit code as the
+//last 4 bytes before the server closes the connection. Everything is in the byte order of the machine, since the socket is local
+
+#define SERVER_MAGIC 0x50534C50
+//Limits on the size of a request, so a bad client can't make the server allocate as much as it wants
+#define SERVER_MAX_ARGS 4096
+#define SERVER_MAX_ARG_LEN 65536
+
+//Sent by the client instead of any files to stop the server
+#define SERVER_SHUTDOWN "--shutdown"
+
+#ifndef _WIN32
+
+typedef struct Server {
+	Driver driver;
+	int fd;
+	char cwd[MODULE_MAX_PATH];
+	//Held while a request is being compiled, since there is only one driver
+	tp_mutex compileLock;
+	//Protects active and stopping
+	tp_mutex stateLock;
+	tp_cond idle;
+	//A byte is written to wake[1] to wake up the loop accepting connections, which waits on wake[0] along with the socket
+	int wake[2];
+	//How many connections have a thread that hasn't finished yet
+	int active;
+	int stopping;
+	long long requests;
+} Server;
+
+typedef struct Server_Connection {
+	Server* server;
+	int fd;
+} Server_Connection;
+
+//Both of these loop until all of the bytes have gone through, since a socket can split them up however it wants. They return false
+//if the other side closed the connection first
+int server_write_all(int fd, void* data, int len) {
+	char* bytes = (char*)data;
+	while (len > 0) {
+		int written = (int)write(fd, bytes, len);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			return false;
+		}
+		bytes += written;
+		len -= written;
+	}
+	return true;
+}
+
+int server_read_all(int fd, void* data, int len) {
+	char* bytes = (char*)data;
+	while (len > 0) {
+		int got = (int)read(fd, bytes, len);
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got <= 0) {
+			return false;
+		}
+		bytes += got;
+		len -= got;
+	}
+	return true;
+}
+
+int server_write_string(int fd, char* str) {
+	int len = (int)strlen(str);
+	return server_write_all(fd, &len, sizeof(int)) && server_write_all(fd, str, len);
+}
+
+void server_free_args(char** args, int count) {
+	for (int i = 0; i < count; i++) {
+		mem_free(args[i]);
+	}
+	mem_free(args);
+}
+
+//Reads a request. Returns the strings of the request (which have to be freed with server_free_args) and sets count to how many there
+//are, or returns NULL if the request is broken
+char** server_read_request(int fd, int* count) {
+	int header[2];
+	if (!server_read_all(fd, header, sizeof(header)) || header[0] != SERVER_MAGIC || header[1] < 1 || header[1] > SERVER_MAX_ARGS) {
+		return NULL;
+	}
+
+	char** args = (char**)mem_calloc(header[1], sizeof(char*));
+
+	if (args == NULL) {
+		printf("Failed to allocate memory in server_read_request\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < header[1]; i++) {
+		int len;
+		if (!server_read_all(fd, &len, sizeof(int)) || len < 0 || len > SERVER_MAX_ARG_LEN) {
+			server_free_args(args, i);
+			return NULL;
+		}
+
+		args[i] = (char*)mem_alloc(len + 1);
+
+		if (args[i] == NULL) {
+			printf("Failed to allocate memory in server_read_request\n");
+			exit(-1);
+		}
+
+		if (!server_read_all(fd, args[i], len)) {
+			server_free_args(args, i + 1);
+			return NULL;
+		}
+		args[i][len] = '\0';
+	}
+
+	*count = header[1];
+	return args;
+}
+
+//Compiles and runs a request in a child process, with the output of the process already going to the client. Returns the exit code
+//for the client
+int server_run_isolated(Server* server, Driver_Options* options, int argc, char** argv) {
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid == -1) {
+		printf("The compile server could not start a process to run the programs in: %s\n", strerror(errno));
+		return 1;
+	}
+
+	if (pid == 0) {
+		//Only this thread exists in the child, so nothing of the driver of the server can be used, since its workers are gone and
+		//its locks could have been held by them
+		Driver driver;
+		options->workers = server->driver.pool.numWorkers;
+		options->cacheDir = NULL;
+		driver_init(&driver, options);
+		int result = driver_compile_args(&driver, argc, argv);
+		driver_destroy(&driver);
+		fflush(stdout);
+		_exit(result);
+	}
+
+	int status;
+	while (waitpid(pid, &status, 0) == -1) {
+		if (errno != EINTR) {
+			printf("The compile server lost track of the process running the programs\n");
+			return 1;
+		}
+	}
+
+	if (WIFSIGNALED(status)) {
+		printf("The programs crashed with signal %d (%s)\n", WTERMSIG(status), strsignal(WTERMSIG(status)));
+		return 1;
+	}
+	return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+//Compiles one request with the output of the process going to the client. Has to be called with the compile lock held. Returns the
+//exit code for the client
+int server_compile(Server* server, int fd, int argc, char** argv) {
+	fflush(stdout);
+	int savedStdout = dup(1);
+	dup2(fd, 1);
+
+	//Only the options that are about the files come from the request. The pool and the cache belong to the server
+	Driver_Options options = { .run = false, .quiet = false, .workers = 0, .cacheDir = NULL, .profile = false, .sampleUs = 0,
+		.collapsedPath = NULL, .tiered = false, .tierThreshold = TIER_DEFAULT_THRESHOLD, .pgoRecordDir = NULL, .pgoUseDir = NULL,
+		.heapLimit = 0, .gcStats = false, .peephole = true, .imageDir = NULL, .runImage = false, .printGlobals = false };
+	int numInputs = driver_parse_options(argc - 1, &argv[1], &options);
+	int result = 1;
+
+	if (numInputs <= 0) {
+		driver_usage();
+	}
+	else if (chdir(argv[0]) != 0) {
+		printf("The compile server could not change to the directory %s\n", argv[0]);
+	}
+	else if (options.run) {
+		result = server_run_isolated(server, &options, argc - 1, &argv[1]);
+
+		if (chdir(server->cwd) != 0) {
+			printf("The compile server could not change back to the directory %s\n", server->cwd);
+		}
+	}
+	else {
+		server->driver.options.run = options.run;
+		server->driver.options.quiet = options.quiet;
+		server->driver.options.profile = options.profile;
+		server->driver.options.sampleUs = options.sampleUs;
+		server->driver.options.collapsedPath = options.collapsedPath;
+		server->driver.options.tiered = options.tiered;
+		server->driver.options.tierThreshold = options.tierThreshold;
+		server->driver.options.pgoRecordDir = options.pgoRecordDir;
+		server->driver.options.pgoUseDir = options.pgoUseDir;
+		server->driver.options.heapLimit = options.heapLimit;
+		server->driver.options.gcStats = options.gcStats;
+		server->driver.options.peephole = options.peephole;
+		server->driver.options.imageDir = options.imageDir;
+		server->driver.options.runImage = options.runImage;
+		server->driver.options.printGlobals = options.printGlobals;
+		memset(&server->driver.stats, 0, sizeof(Driver_Stats));
+		result = driver_compile_args(&server->driver, argc - 1, &argv[1]);
+
+		if (chdir(server->cwd) != 0) {
+			printf("The compile server could not change back to the directory %s\n", server->cwd);
+		}
+	}
+
+	fflush(stdout);
+	dup2(savedStdout, 1);
+	close(savedStdout);
+	return result;
+}
+
+void* server_connection(void* arg) {
+	Server_Connection* connection = (Server_Connection*)arg;
+	Server* server = connection->server;
+	int fd = connection->fd;
+	mem_free(connection);
+
+	int count;
+	char** args = server_read_request(fd, &count);
+
+	if (args != NULL) {
+		int result = 0;
+		if (count == 2 && strcmp(args[1], SERVER_SHUTDOWN) == 0) {
+			tp_mutex_lock(&server->stateLock);
+			server->stopping = true;
+			tp_mutex_unlock(&server->stateLock);
+			//Wakes up the loop in server_main, which then sees that the server is stopping
+			char wake = 1;
+			server_write_all(server->wake[1], &wake, 1);
+		}
+		else {
+			tp_mutex_lock(&server->compileLock);
+			result = server_compile(server, fd, count, args);
+			server->requests++;
+			tp_mutex_unlock(&server->compileLock);
+		}
+
+		server_write_all(fd, &result, sizeof(int));
+		server_free_args(args, count);
+	}
+
+	close(fd);
+
+	tp_mutex_lock(&server->stateLock);
+	server->active--;
+	tp_cond_broadcast(&server->idle);
+	tp_mutex_unlock(&server->stateLock);
+	return NULL;
+}
+
+//Fills in the address for the socket at path. Returns false if the path is too long for one
+int server_address(char* path, struct sockaddr_un* address) {
+	memset(address, 0, sizeof(struct sockaddr_un));
+	address->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address->sun_path)) {
+		printf("The socket path %s is too long\n", path);
+		return false;
+	}
+	snprintf(address->sun_path, sizeof(address->sun_path), "%s", path);
+	return true;
+}
+
+#endif
+
+void server_usage() {
+	printf("Usage: --serve <socket> [--workers <n>] [--cache <dir>]\n");
+	printf("       --client <socket> [--batch options] [files...]\n");
+	printf("       --client <socket> %s\n", SERVER_SHUTDOWN);
+}
+
+//The entry point for --serve. The first argument is the path of the socket, and the rest are the options of the driver. Returns
+//once a client asks the server to shut down
+int server_main(int argc, char** argv) {
+#ifdef _WIN32
+	printf("The compile server needs Unix domain sockets, which aren't supported on this platform yet\n");
+	return 1;
+#else
+	if (argc < 1) {
+		server_usage();
+		return 1;
+	}
+
+	Driver_Options options = { .run = false, .quiet = false, .workers = 0, .cacheDir = NULL, .profile = false, .sampleUs = 0,
+		.collapsedPath = NULL, .tiered = false, .tierThreshold = TIER_DEFAULT_THRESHOLD, .pgoRecordDir = NULL, .pgoUseDir = NULL,
+		.heapLimit = 0, .gcStats = false, .peephole = true, .imageDir = NULL, .runImage = false, .printGlobals = false };
+	if (driver_parse_options(argc - 1, &argv[1], &options) < 0) {
+		server_usage();
+		return 1;
+	}
+
+	struct sockaddr_un address;
+	if (!server_address(argv[0], &address)) {
+		return 1;
+	}
+
+	Server* server = (Server*)mem_alloc(sizeof(Server));
+
+	if (server == NULL) {
+		printf("Failed to allocate memory in server_main\n");
+		exit(-1);
+	}
+
+	if (getcwd(server->cwd, sizeof(server->cwd)) == NULL) {
+		printf("Could not find the working directory of the compile server\n");
+		mem_free(server);
+		return 1;
+	}
+
+	//Requests change the working directory while they compile, so the cache has to be found without it
+	char cacheDir[MODULE_MAX_PATH * 2];
+	if (options.cacheDir != NULL && options.cacheDir[0] != '/') {
+		snprintf(cacheDir, sizeof(cacheDir), "%s/%s", server->cwd, options.cacheDir);
+		options.cacheDir = cacheDir;
+	}
+
+	//A socket file left behind by a server that is still running is left alone, but one left behind by a server that crashed is
+	//in the way of bind and has to be removed
+	server->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server->fd != -1 && connect(server->fd, (struct sockaddr*)&address, sizeof(address)) == 0) {
+		printf("A compile server is already running at %s\n", argv[0]);
+		close(server->fd);
+		mem_free(server);
+		return 1;
+	}
+	if (server->fd != -1) {
+		close(server->fd);
+	}
+	unlink(argv[0]);
+
+	server->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server->fd == -1 || bind(server->fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(server->fd, 64) != 0) {
+		printf("Could not listen on %s: %s\n", argv[0], strerror(errno));
+		if (server->fd != -1) {
+			close(server->fd);
+		}
+		mem_free(server);
+		return 1;
+	}
+
+	fcntl(server->fd, F_SETFL, fcntl(server->fd, F_GETFL) | O_NONBLOCK);
+	if (pipe(server->wake) != 0) {
+		printf("Could not make the pipe that stops the compile server: %s\n", strerror(errno));
+		close(server->fd);
+		unlink(argv[0]);
+		mem_free(server);
+		return 1;
+	}
+
+	//Writing to a client that hung up would kill the whole server otherwise
+	signal(SIGPIPE, SIG_IGN);
+
+	driver_init(&server->driver, &options);
+	tp_mutex_init(&server->compileLock);
+	tp_mutex_init(&server->stateLock);
+	tp_cond_init(&server->idle);
+	server->active = 0;
+	server->stopping = false;
+	server->requests = 0;
+
+	//Nothing else gets printed until the server stops, since the output belongs to whichever client is being compiled
+	printf("Compile server listening on %s with %d workers\n", argv[0], server->driver.pool.numWorkers);
+	fflush(stdout);
+
+	while (true) {
+		//accept can't be woken up from another thread everywhere, so it is only called once poll says a client is waiting
+		struct pollfd waiting[2] = { { .fd = server->fd, .events = POLLIN }, { .fd = server->wake[0], .events = POLLIN } };
+		if (poll(waiting, 2, -1) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+
+		tp_mutex_lock(&server->stateLock);
+		int stopping = server->stopping;
+		tp_mutex_unlock(&server->stateLock);
+
+		if (stopping || (waiting[1].revents & POLLIN)) {
+			break;
+		}
+		if (!(waiting[0].revents & POLLIN)) {
+			continue;
+		}
+
+		//The client could have given up between the poll and here, which is why the socket doesn't block. Some systems hand the
+		//connection that flag too, and the connection threads expect to block
+		int client = accept(server->fd, NULL, NULL);
+		if (client == -1) {
+			continue;
+		}
+		fcntl(client, F_SETFL, fcntl(client, F_GETFL) & ~O_NONBLOCK);
+
+		Server_Connection* connection = (Server_Connection*)mem_alloc(sizeof(Server_Connection));
+
+		if (connection == NULL) {
+			printf("Failed to allocate memory in server_main\n");
+			exit(-1);
+		}
+
+		connection->server = server;
+		connection->fd = client;
+
+		tp_mutex_lock(&server->stateLock);
+		server->active++;
+		tp_mutex_unlock(&server->stateLock);
+
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, server_connection, connection) != 0) {
+			close(client);
+			mem_free(connection);
+			tp_mutex_lock(&server->stateLock);
+			server->active--;
+			tp_mutex_unlock(&server->stateLock);
+			continue;
+		}
+		pthread_detach(thread);
+	}
+
+	//Clients that are already connected still get their answers
+	tp_mutex_lock(&server->stateLock);
+	while (server->active > 0) {
+		tp_cond_wait(&server->idle, &server->stateLock);
+	}
+	tp_mutex_unlock(&server->stateLock);
+
+	close(server->fd);
+	close(server->wake[0]);
+	close(server->wake[1]);
+	unlink(argv[0]);
+	printf("Compile server stopped after %lld requests\n", server->requests);
+
+	driver_destroy(&server->driver);
+	tp_cond_destroy(&server->idle);
+	tp_mutex_destroy(&server->stateLock);
+	tp_mutex_destroy(&server->compileLock);
+	mem_free(server);
+
+	//Only prints anything in builds with MEMORY_TRACKING defined
+	memory_report(stdout);
+	return 0;
+#endif
+}
+
+//The entry point for --client. Sends the rest of the arguments to the server at the socket path given by the first one, and prints
+//whatever comes back. Returns the exit code the server sent
+int server_client(int argc, char** argv) {
+#ifdef _WIN32
+	printf("The compile server needs Unix domain sockets, which aren't supported on this platform yet\n");
+	return 1;
+#else
+	if (argc < 2) {
+		server_usage();
+		return 1;
+	}
+
+	struct sockaddr_un address;
+	if (!server_address(argv[0], &address)) {
+		return 1;
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1 || connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+		printf("Could not connect to the compile server at %s: %s\n", argv[0], strerror(errno));
+		if (fd != -1) {
+			close(fd);
+		}
+		return 1;
+	}
+
+	char cwd[MODULE_MAX_PATH];
+	if (getcwd(cwd, sizeof(cwd)) == NULL) {
+		printf("Could not find the working directory\n");
+		close(fd);
+		return 1;
+	}
+
+	//The socket path is swapped out for the working directory, and the rest of the arguments go as they are
+	int header[2] = { SERVER_MAGIC, argc };
+	int sent = server_write_all(fd, header, sizeof(header)) && server_write_string(fd, cwd);
+	for (int i = 1; i < argc && sent; i++) {
+		sent = server_write_string(fd, argv[i]);
+	}
+
+	//The last 4 bytes are the exit code, so they are held back until the server closes the connection and it is certain that
+	//they really are the last ones
+	char buffer[65536 + sizeof(int)];
+	int pending = 0;
+	while (sent) {
+		int got = (int)read(fd, buffer + pending, sizeof(buffer) - pending);
+		if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		if (got <= 0) {
+			break;
+		}
+		pending += got;
+
+		if (pending > (int)sizeof(int)) {
+			fwrite(buffer, 1, pending - sizeof(int), stdout);
+			memmove(buffer, buffer + pending - sizeof(int), sizeof(int));
+			pending = sizeof(int);
+		}
+	}
+	close(fd);
+	fflush(stdout);
+
+	if (pending != sizeof(int)) {
+		printf("The compile server closed the connection before answering\n");
+		return 1;
+	}
+
+	int result;
+	memcpy(&result, buffer, sizeof(int));
+	return result;
+#endif
+}
+
+#endif
@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include "Profiler.h"
+#include "Memory.h"
 
 typedef struct string {
 	char* str;
@@ -28,7 +30,8 @@ int string_init(string* str, char* init) {
 		}
 		// Add one to account for null terminator at the end of the string for easy compliance with c functions, like printf
 		str->__size = str->len + 1;
-		str->str = (char*)malloc(str->__size * sizeof(char));
+		profile_alloc(NULL, str->__size * sizeof(char));
+		str->str = (char*)mem_alloc(str->__size * sizeof(char));
 
 		if (str->str == NULL) {
 			printf("Failed to allocate memory for initialization of string\n");
@@ -57,7 +60,7 @@ int string_list_init(string_list* list) {
 
 int string_set(string* str, char* set) {
 	if (set != NULL) {
-		free(str->str);
+		mem_free(str->str);
 
 		str->len = 0;
 		for (int i = 0; set[i] != '\0'; i++) {
@@ -65,7 +68,8 @@ int string_set(string* str, char* set) {
 		}
 
 		str->__size = str->len + 1;
-		str->str = (char*)malloc(str->__size * sizeof(char));
+		profile_alloc(NULL, str->__size * sizeof(char));
+		str->str = (char*)mem_alloc(str->__size * sizeof(char));
 
 		for (int i = 0; i < str->len; i++) {
 			str->str[i] = set[i];
@@ -82,10 +86,11 @@ int string_set(string* str, char* set) {
 }
 
 int string_copy(string* dest, string* src) {
-	free(dest->str);
+	mem_free(dest->str);
 	dest->len = src->len;
 	dest->__size = src->__size;
-	dest->str = (char*)malloc(dest->__size * sizeof(char));
+	profile_alloc(NULL, dest->__size * sizeof(char));
+	dest->str = (char*)mem_alloc(dest->__size * sizeof(char));
 
 	if (dest->str == NULL) {
 		printf("Failed to allocate memory in string_copy function\n");
@@ -102,7 +107,8 @@ int string_copy(string* dest, string* src) {
 int string_concat(string* firstHalf, string* secondHalf) {
 	// Double the size of the array in memory to reduce calls to realloc
 	if (firstHalf->__size < firstHalf->len + secondHalf->len + 1) {
-		char* test = (char*)realloc(firstHalf->str, 2 * (firstHalf->len + secondHalf->len + 1) * sizeof(char));
+		profile_alloc(firstHalf->str, 2 * (firstHalf->len + secondHalf->len + 1) * sizeof(char));
+		char* test = (char*)mem_realloc(firstHalf->str, 2 * (firstHalf->len + secondHalf->len + 1) * sizeof(char));
 
 		if (test == NULL) {
 			printf("Failed to reallocate memory for string_concat function\n");
@@ -133,10 +139,11 @@ int string_load_file(char* path, string* str) {
 	fsize = ftell(fptr) / sizeof(char);
 	fseek(fptr, 0L, SEEK_SET);
 
-	free(str->str);
+	mem_free(str->str);
 	str->len = fsize;
 	str->__size = str->len + 1;
-	str->str = (char*)malloc(str->__size * sizeof(char));
+	profile_alloc(NULL, str->__size * sizeof(char));
+	str->str = (char*)mem_alloc(str->__size * sizeof(char));
 
 	if (str->str == NULL) {
 		printf("Failed to allocate memory for string_load_file\n");
@@ -156,7 +163,8 @@ int string_substr(string* dest, string* src, int from, int to) {
 	}
 
 	if (dest->__size < to - from + 1) {
-		char* test = (char*)realloc(dest->str, 2 * (to - from + 1) * sizeof(char));
+		profile_alloc(dest->str, 2 * (to - from + 1) * sizeof(char));
+		char* test = (char*)mem_realloc(dest->str, 2 * (to - from + 1) * sizeof(char));
 
 		if (test == NULL) {
 			printf("Failed to Reallocate memory in string_substr\n");
@@ -217,7 +225,8 @@ int string_find(string* dest, string* find) {
 
 int string_find_replace(string* dest, string* find, string* replace) {
 	if (dest->__size < dest->len - find->len + replace->len + 1) {
-		char* test = (char*)realloc(dest->str, 2 * (dest->len - find->len + replace->len + 1) * sizeof(char));
+		profile_alloc(dest->str, 2 * (dest->len - find->len + replace->len + 1) * sizeof(char));
+		char* test = (char*)mem_realloc(dest->str, 2 * (dest->len - find->len + replace->len + 1) * sizeof(char));
 
 		if (test == NULL) {
 			printf("Failed to Reallocate memory in string_find_replace\n");
@@ -282,7 +291,7 @@ int string_find_replace(string* dest, string* find, string* replace) {
 }
 
 int string_destroy(string* input) {
-	free(input->str);
+	mem_free(input->str);
 	input->str = NULL;
 	input->len = 0;
 	input->__size = 1;
@@ -319,7 +328,8 @@ int string_substr_cmp(string* large, int start, string* small) {
 int string_append(string* str, char letter) {
 	if (str->len + 2 >= str->__size) {
 		str->__size *= 2;
-		char* test = (char*)realloc(str->str, str->__size * sizeof(char));
+		profile_alloc(str->str, str->__size * sizeof(char));
+		char* test = (char*)mem_realloc(str->str, str->__size * sizeof(char));
 
 		if (test == NULL) {
 			printf("string_append failed to allocate memory\n");
@@ -339,7 +349,8 @@ int string_list_append(string_list* list, string str) {
 	if (list->len + 1 >= list->__size) {
 		list->__size *= 2;
 
-		string* test = (string*)realloc(list->strings, list->__size * sizeof(string));
+		profile_alloc(list->strings, list->__size * sizeof(string));
+		string* test = (string*)mem_realloc(list->strings, list->__size * sizeof(string));
 
 		if (test == NULL) {
 			printf("Failed to allocate memory in string_list_append function\n");
@@ -363,7 +374,7 @@ int string_list_pop(string_list* list) {
 			list->__size = 1;
 		}
 
-		string* test = (string*)realloc(list->strings, list->__size * sizeof(string));
+		string* test = (string*)mem_realloc(list->strings, list->__size * sizeof(string));
 
 		if (test == NULL) {
 			printf("Failed to allocate memory in string_list_pop\n");
@@ -381,7 +392,7 @@ int string_list_destroy(string_list* list) {
 	for (int i = 0; i < list->len; i++) {
 		string_destroy(&list->strings[i]);
 	}
-	free(list->strings);
+	mem_free(list->strings);
 	return 0;
 }
 
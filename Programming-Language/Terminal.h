@@ -0,0 +1,226 @@
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Platform.h"
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <conio.h>
+#else
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#endif
+
+//This header file contains the keyboard input for the debugging tools
+//
+//Reading a key blocks until one is pressed, so a tool that is just sitting there waiting doesn't use any CPU. On Windows this is
+//_getch, and everywhere else the terminal is put into raw mode (no line buffering and no echo) and stdin is waited on with poll.
+//The arrow keys show up as escape sequences in raw mode, so after an escape the reader waits a moment for the rest of a sequence,
+//and if nothing else comes then it was just the escape key
+//
+//Printable keys are returned as the character itself, and everything else as one of the values below, which are all out of the
+//range of a char
+
+enum TERMINAL_KEYS {
+	KEY_NONE = 256,
+	KEY_UP = 257,
+	KEY_DOWN = 258,
+	KEY_LEFT = 259,
+	KEY_RIGHT = 260,
+	KEY_ENTER = 261,
+	KEY_ESCAPE = 262,
+	KEY_BACKSPACE = 263,
+	KEY_PAGE_UP = 264,
+	KEY_PAGE_DOWN = 265,
+	KEY_HOME = 266,
+	KEY_END = 267,
+};
+
+//How long to wait for the rest of an escape sequence before deciding it was just the escape key
+#define TERMINAL_ESCAPE_WAIT_MS 30
+
+//terminal_begin and terminal_end can be nested, so a tool can call another one and only the outermost pair changes the terminal
+int terminal_depth = 0;
+
+#ifndef _WIN32
+struct termios terminal_saved;
+
+void terminal_restore() {
+	tcsetattr(0, TCSAFLUSH, &terminal_saved);
+}
+
+//Returns the next byte from stdin, or -1 if none came within timeout milliseconds (-1 waits forever)
+int terminal_read_byte(int timeout) {
+	struct pollfd fd = { .fd = 0, .events = POLLIN };
+	while (true) {
+		int ready = poll(&fd, 1, timeout);
+		if (ready < 0 && errno == EINTR) {
+			continue;
+		}
+		if (ready <= 0) {
+			return -1;
+		}
+
+		unsigned char c;
+		if (read(0, &c, 1) != 1) {
+			return -1;
+		}
+		return c;
+	}
+}
+#endif
+
+void terminal_begin() {
+	if (terminal_depth++ > 0) {
+		return;
+	}
+
+#ifndef _WIN32
+	if (!isatty(0) || tcgetattr(0, &terminal_saved) != 0) {
+		return;
+	}
+
+	//The terminal is put back if the program exits while a tool is open, since otherwise the shell would be left in raw mode
+	static int registered = false;
+	if (!registered) {
+		atexit(terminal_restore);
+		registered = true;
+	}
+
+	struct termios raw = terminal_saved;
+	raw.c_lflag &= ~(ICANON | ECHO);
+	raw.c_cc[VMIN] = 1;
+	raw.c_cc[VTIME] = 0;
+	tcsetattr(0, TCSAFLUSH, &raw);
+#endif
+}
+
+void terminal_end() {
+	if (terminal_depth == 0 || --terminal_depth > 0) {
+		return;
+	}
+
+#ifndef _WIN32
+	if (isatty(0)) {
+		terminal_restore();
+	}
+#endif
+}
+
+//Returns how many rows of text fit on the screen, or 24 if that can't be found out (when the output isn't a terminal, for example)
+int terminal_rows() {
+#ifdef _WIN32
+	CONSOLE_SCREEN_BUFFER_INFO info;
+	if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+		return info.srWindow.Bottom - info.srWindow.Top + 1;
+	}
+#else
+	struct winsize size;
+	if (ioctl(1, TIOCGWINSZ, &size) == 0 && size.ws_row > 0) {
+		return size.ws_row;
+	}
+#endif
+	return 24;
+}
+
+//Blocks until a key is pressed and returns it. Returns KEY_ESCAPE if stdin is closed, so a tool reading from it always gets a way out
+int terminal_read_key() {
+	//Anything printed before waiting has to actually show up on the screen first
+	fflush(stdout);
+
+#ifdef _WIN32
+	int c = _getch();
+	//The arrow keys and the rest of the special keys come in two parts
+	if (c == 0 || c == 0xE0) {
+		switch (_getch()) {
+		case 72:
+			return KEY_UP;
+		case 80:
+			return KEY_DOWN;
+		case 75:
+			return KEY_LEFT;
+		case 77:
+			return KEY_RIGHT;
+		case 73:
+			return KEY_PAGE_UP;
+		case 81:
+			return KEY_PAGE_DOWN;
+		case 71:
+			return KEY_HOME;
+		case 79:
+			return KEY_END;
+		default:
+			return KEY_NONE;
+		}
+	}
+#else
+	int c = terminal_read_byte(-1);
+	if (c == -1) {
+		return KEY_ESCAPE;
+	}
+
+	if (c == 27) {
+		int next = terminal_read_byte(TERMINAL_ESCAPE_WAIT_MS);
+		if (next != '[' && next != 'O') {
+			return KEY_ESCAPE;
+		}
+
+		//Either a letter right away, or a number followed by ~ for the keys like page up
+		int code = terminal_read_byte(TERMINAL_ESCAPE_WAIT_MS);
+		int number = 0;
+		while (code >= '0' && code <= '9') {
+			number = number * 10 + code - '0';
+			code = terminal_read_byte(TERMINAL_ESCAPE_WAIT_MS);
+		}
+
+		switch (code) {
+		case 'A':
+			return KEY_UP;
+		case 'B':
+			return KEY_DOWN;
+		case 'C':
+			return KEY_RIGHT;
+		case 'D':
+			return KEY_LEFT;
+		case 'H':
+			return KEY_HOME;
+		case 'F':
+			return KEY_END;
+		case '~':
+			switch (number) {
+			case 1:
+			case 7:
+				return KEY_HOME;
+			case 4:
+			case 8:
+				return KEY_END;
+			case 5:
+				return KEY_PAGE_UP;
+			case 6:
+				return KEY_PAGE_DOWN;
+			}
+			return KEY_NONE;
+		default:
+			return KEY_NONE;
+		}
+	}
+#endif
+
+	switch (c) {
+	case 27:
+		return KEY_ESCAPE;
+	case '\r':
+	case '\n':
+		return KEY_ENTER;
+	case 8:
+	case 127:
+		return KEY_BACKSPACE;
+	}
+	return c;
+}
+
+#endif
@@ -0,0 +1,430 @@
+#ifndef TESTS_H
+#define TESTS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Strings.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "TypeChecker.h"
+#include "Inliner.h"
+#include "Bytecode.h"
+#include "GC.h"
+#include "Image.h"
+#include "Incremental.h"
+#include "Diagnostics.h"
+#include <stdbool.h>
+
+//This header file contains the tests that are run with --test
+//
+//Each test is a function that returns how many of its checks failed, and tests_main runs all of them (or just the ones named on the
+//command line) and prints which ones failed. The programs the tests compile are kept in strings right next to the checks, and their
+//errors are collected with diagnostics_buffer instead of printed, so the only output is the result of each test
+
+typedef int (*Test_Function)(void);
+
+typedef struct Test {
+	char* name;
+	Test_Function run;
+} Test;
+
+//A program compiled by a test, up to and including the type checker unless that is turned off
+typedef struct Test_Source {
+	string text;
+	tokenList tokens;
+	AST* ast;
+	int errors;
+	//The errors that would have been printed
+	string diagnostics;
+} Test_Source;
+
+void test_source_open(Test_Source* src, char* text, int check) {
+	string_init(&src->text, text);
+	string_init(&src->diagnostics, NULL);
+	tokenList_init(&src->tokens);
+	AST_init(&src->ast);
+
+	diagnostics_buffer = &src->diagnostics;
+	lexer(&src->tokens, &src->text);
+	src->errors = parser(&src->tokens, &src->ast);
+	src->errors += parser_all_bodies(&src->tokens, &src->ast);
+	if (src->errors == 0 && check) {
+		src->errors += typechecker(&src->tokens, &src->ast);
+	}
+	diagnostics_buffer = NULL;
+}
+
+void test_source_close(Test_Source* src) {
+	AST_destroy_children(src->ast);
+	mem_free(src->ast);
+	tokenList_destroy_all(&src->tokens);
+	string_destroy(&src->text);
+	string_destroy(&src->diagnostics);
+}
+
+//Returns true if the diagnostics of the program have the given message in them
+int test_source_reported(Test_Source* src, char* message) {
+	return src->diagnostics.str != NULL && strstr(src->diagnostics.str, message) != NULL;
+}
+
+//Prints what was being checked if it didn't hold, and adds it to the number of failed checks
+void test_check(int* failed, int ok, char* what) {
+	if (!ok) {
+		printf("    failed: %s\n", what);
+		(*failed)++;
+	}
+}
+
+//Compiles text and checks whether it had errors
+void test_compiles(int* failed, char* text, int expectErrors, char* what) {
+	Test_Source src;
+	test_source_open(&src, text, true);
+	test_check(failed, (src.errors > 0) == expectErrors, what);
+	test_source_close(&src);
+}
+
+int test_missing_return(void) {
+	int failed = 0;
+	Test_Source src;
+	test_source_open(&src, "string q() {\n\tint k = 1;\n}\nstring w = q() + \"x\";", true);
+	test_check(&failed, src.errors > 0, "a string function without a return is rejected");
+	test_check(&failed, test_source_reported(&src, "Not all paths of the function return a value"), "the missing return is what gets reported");
+	test_source_close(&src);
+
+	test_compiles(&failed, "float f(float a) {\n\ta + 1.0;\n}\nfloat x = f(2.0);", true, "a float function without a return is rejected");
+	test_compiles(&failed, "int f(int a) {\n\tint b = a + 1;\n\treturn b;\n}\nint x = f(2);", false, "a function ending in a return is fine");
+	test_compiles(&failed, "void f(int a) {\n\tint b = a + 1;\n}\nf(2);", false, "a void function doesn't need a return");
+	return failed;
+}
+
+//Only void functions get a return added at the end of their code, and without the type checker the compiler still turns away a
+//function that would fall off the end
+int test_trailing_return(void) {
+	int failed = 0;
+	Test_Source src;
+	test_source_open(&src, "int f(int a) {\n\treturn a;\n\tint b = 2;\n}\nvoid g() {\n\tint c = 1;\n}\nint x = f(1);\ng();", true);
+	test_check(&failed, src.errors == 0, "the program compiles");
+
+	Program program;
+	diagnostics_buffer = &src.diagnostics;
+	test_check(&failed, compiler(&src.tokens, &src.ast, &program) == 0, "the program has no compile errors");
+	diagnostics_buffer = NULL;
+	Vector_Int* f = &program.functions[1].code;
+	Vector_Int* g = &program.functions[2].code;
+	test_check(&failed, f->len > 0 && f->vec[f->len - 1] == BC_RETURN, "a function ends at its return");
+	test_check(&failed, g->len > 0 && g->vec[g->len - 1] == BC_RETURN_VOID, "a void function returns nothing at the end");
+	program_destroy(&program);
+	test_source_close(&src);
+
+	test_source_open(&src, "string q() {\n\tint k = 1;\n}\nstring w = q() + \"x\";", false);
+	diagnostics_buffer = &src.diagnostics;
+	test_check(&failed, compiler(&src.tokens, &src.ast, &program) > 0, "the compiler rejects a string function without a return");
+	diagnostics_buffer = NULL;
+	program_destroy(&program);
+	test_source_close(&src);
+	return failed;
+}
+
+//Compiles text, runs the inliner over it, and checks how many calls were inlined
+void test_inlines(int* failed, char* text, int expected, char* what) {
+	Test_Source src;
+	test_source_open(&src, text, true);
+	test_check(failed, src.errors == 0 && inliner(&src.tokens, &src.ast) == expected, what);
+	test_source_close(&src);
+}
+
+//Inlining moves each argument to wherever its parameter is used, so a call whose arguments have side effects is only inlined if they
+//still happen in the order they were passed in
+int test_inline_order(void) {
+	int failed = 0;
+	test_inlines(&failed, "extern int putchar(int c);\nint f(int a, int b) {\n\treturn b - a;\n}\nint x = f(putchar(65), putchar(66));", 0,
+		"arguments with side effects that are used out of order aren't inlined");
+	test_inlines(&failed, "extern int putchar(int c);\nint f(int a, int b) {\n\treturn a - b;\n}\nint x = f(putchar(65), putchar(66));", 1,
+		"arguments with side effects that are used in order are inlined");
+	test_inlines(&failed, "extern int putchar(int c);\nint f(int a, int b) {\n\treturn b - a;\n}\nint x = f(putchar(65), 2);", 1,
+		"a literal argument can be used anywhere");
+	test_inlines(&failed, "extern int putchar(int c);\nint y = 1;\nint f(int a, int b) {\n\treturn b - a;\n}\nint x = f(y, putchar(66));", 0,
+		"a variable argument can't be read after an argument with side effects");
+	test_inlines(&failed, "extern int putchar(int c);\nint f(int a) {\n\treturn putchar(66) + a;\n}\nint y = 1;\nint x = f(y);", 0,
+		"an argument can't be read after a call in the body");
+	test_inlines(&failed, "int f(int a, int b) {\n\treturn b - a;\n}\nint y = 1;\nint x = f(y, 2);", 1,
+		"arguments without side effects can be used in any order");
+	return failed;
+}
+
+//Every kind of value comes back out of its box the same as it went in, and is only ever taken for its own kind
+int test_value_boxing(void) {
+	int failed = 0;
+	string str;
+	string_init(&str, "x");
+	Value values[5] = { value_from_int(-7), value_from_float(-2.5), value_from_string(&str), value_from_function(42), VALUE_VOID };
+
+	test_check(&failed, value_as_int(values[0]) == -7, "an int comes back out");
+	test_check(&failed, value_as_float(values[1]) == -2.5, "a float comes back out");
+	test_check(&failed, value_as_string(values[2]) == &str, "a string comes back out");
+	test_check(&failed, value_as_function(values[3]) == 42, "a function comes back out");
+	for (int i = 0; i < 5; i++) {
+		int kinds = value_is_int(values[i]) + value_is_float(values[i]) + value_is_string(values[i]) + value_is_function(values[i])
+			+ value_is_void(values[i]);
+		test_check(&failed, kinds == 1, "a value is only one kind");
+	}
+	test_check(&failed, value_is_float(value_from_float(0.0 / 0.0)), "a NaN is still a float");
+
+	string_destroy(&str);
+	return failed;
+}
+
+//A program that keeps more strings alive than the heap limit allows can't have a full collection on every allocation after it goes
+//over, but the strings it lets go of still have to be freed once it gets back under
+int test_heap_limit(void) {
+	int failed = 0;
+	GC gc;
+	gc_init(&gc);
+	gc_set_heap_limit(&gc, 16 * 1024);
+
+	int count = 4000;
+	int len = 0;
+	Value* roots = (Value*)mem_alloc(count * sizeof(Value));
+	if (roots == NULL) {
+		printf("Failed to allocate memory in test_heap_limit\n");
+		exit(-1);
+	}
+	gc_add_roots(&gc, &roots, &len);
+
+	char text[100];
+	memset(text, 'x', sizeof(text));
+	for (int i = 0; i < count; i++) {
+		roots[len] = gc_string_new(&gc, text, sizeof(text));
+		len++;
+	}
+	test_check(&failed, gc.stats.bytesLive > gc.heapLimit, "the strings that are still in use are over the limit");
+	test_check(&failed, gc.stats.numFreed == 0, "nothing that is still in use gets freed");
+	test_check(&failed, gc.stats.numForced > 0 && gc.stats.numForced < 16, "going over the limit doesn't collect on every allocation");
+
+	len = 0;
+	for (int i = 0; i < count; i++) {
+		gc_string_new(&gc, text, sizeof(text));
+	}
+	test_check(&failed, gc.stats.numFreed >= count, "the strings that were let go of get freed");
+	test_check(&failed, gc.limit == gc.heapLimit, "the limit goes back down once the heap is under it again");
+
+	gc_destroy(&gc);
+	mem_free(roots);
+	return failed;
+}
+
+//An image opens as long as everything in it points inside of it, and a string or the name of a global that points outside of it is
+//caught when it is opened
+int test_image_validate(void) {
+	int failed = 0;
+	Test_Source src;
+	test_source_open(&src, "string s = \"hi\";\nint x = 1;", true);
+	Program program;
+	test_check(&failed, src.errors == 0 && compiler(&src.tokens, &src.ast, &program) == 0, "the program compiles");
+
+	Image_Builder builder;
+	image_builder_init(&builder);
+	test_check(&failed, image_build(&builder, &program, &src.tokens), "the program builds into an image");
+	Image image;
+	test_check(&failed, image_from_data(&image, builder.data, builder.len, false), "the image opens");
+
+	Image_Header* header = (Image_Header*)builder.data;
+	Image_String* strings = (Image_String*)(builder.data + header->strings);
+	int* globals = (int*)(builder.data + header->globals);
+
+	strings[0].len += 1000;
+	test_check(&failed, !image_from_data(&image, builder.data, builder.len, false), "a string that runs past the end is caught");
+	strings[0].len -= 1000;
+	strings[0].offset = -1;
+	test_check(&failed, !image_from_data(&image, builder.data, builder.len, false), "a string that starts before the characters is caught");
+	strings[0].offset = 0;
+	test_check(&failed, image_from_data(&image, builder.data, builder.len, false), "the image opens again once it is put back");
+	globals[1] = header->numStrings;
+	test_check(&failed, !image_from_data(&image, builder.data, builder.len, false), "a global named by a string that isn't there is caught");
+
+	mem_free(builder.data);
+	program_destroy(&program);
+	test_source_close(&src);
+	return failed;
+}
+
+//Every edit of a document has to leave it with the same tokens and AST as lexing and parsing its text from scratch would, including
+//edits that add tokens in front of other items, change what a name resolves to, or open a string that swallows the rest of the file
+int test_incremental(void) {
+	int failed = 0;
+	Document doc;
+	document_open(&doc, "int square(int a) {\n\treturn a * a;\n}\n\nint x = square(3) + 2;\nstring s = \"hi\";\n");
+	test_check(&failed, document_matches_full(&doc), "a document that was just opened matches");
+
+	document_edit(&doc, 0, 0, "int z = 4;\n");
+	test_check(&failed, document_matches_full(&doc), "adding an item at the start moves the items after it");
+	document_edit(&doc, doc.text.len, 0, "int w = z + x;\n");
+	test_check(&failed, document_matches_full(&doc), "adding an item at the end");
+	document_edit(&doc, 15, 6, "sq");
+	test_check(&failed, doc.numErrors > 0 && document_matches_full(&doc), "renaming a function leaves its call unresolved");
+	document_edit(&doc, 15, 2, "square");
+	test_check(&failed, doc.numErrors == 0 && document_matches_full(&doc), "naming it back resolves the call again");
+	document_edit(&doc, 11, 0, "\"");
+	test_check(&failed, document_matches_full(&doc), "an open quote swallows the rest of the file");
+	document_edit(&doc, 11, 1, "");
+	test_check(&failed, doc.numErrors == 0 && document_matches_full(&doc), "closing it again");
+
+	//Several edits in a row before the AST is looked at again, which is when the items after them are left behind
+	document_edit(&doc, 30, 0, "int k; ");
+	document_edit(&doc, 30, 0, "int j; ");
+	document_edit(&doc, 11, 0, "int m = 1;\n");
+	test_check(&failed, document_matches_full(&doc), "items that were left behind by several edits are caught up");
+
+	document_destroy(&doc);
+	return failed;
+}
+
+//What a walk in test_visitor saw, and the labels of the nodes it should skip the children of or stop at
+typedef struct Test_Walk {
+	char seen[64];
+	int len;
+	int skip;
+	int stop;
+} Test_Walk;
+
+int test_walk_visit(AST_Visitor* visitor, AST* node) {
+	Test_Walk* walk = (Test_Walk*)visitor->data;
+	walk->len += snprintf(walk->seen + walk->len, sizeof(walk->seen) - walk->len, "%s%d", walk->len > 0 ? " " : "", node->token_index);
+	if (node->token_index == walk->stop) {
+		return VISIT_STOP;
+	}
+	return node->token_index == walk->skip ? VISIT_SKIP_CHILDREN : VISIT_CONTINUE;
+}
+
+//Walks the tree in the given order and checks the nodes came out in the expected order (by the token index each one is labelled with).
+//Returns what AST_visit returned
+int test_walk(int* failed, AST* root, int order, int skip, int stop, char* expected, char* what) {
+	Test_Walk walk = { .seen = "", .len = 0, .skip = skip, .stop = stop };
+	AST_Visitor visitor;
+	AST_visitor_init(&visitor, test_walk_visit, &walk);
+	int finished = AST_visit(&visitor, root, order);
+	test_check(failed, strcmp(walk.seen, expected) == 0, what);
+	test_check(failed, finished == (stop == -1) && (finished || visitor.stoppedAt->token_index == stop), what);
+	AST_visitor_destroy(&visitor);
+	return finished;
+}
+
+//The order each kind of walk visits the nodes in, and what VISIT_SKIP_CHILDREN and VISIT_STOP do to it. The tree is
+//    0
+//    +-- 1
+//    |   +-- 3
+//    |   +-- 4
+//    +-- 2
+//        +-- 5
+int test_visitor(void) {
+	int failed = 0;
+	AST left = parser_node(AST_ROOT, 1, UREL_IRRELEVENT);
+	AST_List_append(&left.list, parser_node(AST_ROOT, 3, UREL_IRRELEVENT));
+	AST_List_append(&left.list, parser_node(AST_ROOT, 4, UREL_IRRELEVENT));
+	AST right = parser_node(AST_ROOT, 2, UREL_IRRELEVENT);
+	AST_List_append(&right.list, parser_node(AST_ROOT, 5, UREL_IRRELEVENT));
+	AST root = parser_node(AST_ROOT, 0, UREL_IRRELEVENT);
+	AST_List_append(&root.list, left);
+	AST_List_append(&root.list, right);
+	AST_relink(&root);
+
+	test_walk(&failed, &root, VISIT_PRE_ORDER, -1, -1, "0 1 3 4 2 5", "pre-order visits a node before its children");
+	test_walk(&failed, &root, VISIT_POST_ORDER, -1, -1, "3 4 1 5 2 0", "post-order visits a node after its children");
+	test_walk(&failed, &root, VISIT_LEVEL_ORDER, -1, -1, "0 1 2 3 4 5", "level-order visits one depth at a time");
+
+	test_walk(&failed, &root, VISIT_PRE_ORDER, 1, -1, "0 1 2 5", "pre-order skips the children of a node");
+	test_walk(&failed, &root, VISIT_LEVEL_ORDER, 1, -1, "0 1 2 5", "level-order skips the children of a node");
+	test_walk(&failed, &root, VISIT_POST_ORDER, 1, -1, "3 4 1 5 2 0", "post-order has already been through the children");
+
+	test_walk(&failed, &root, VISIT_PRE_ORDER, -1, 4, "0 1 3 4", "pre-order stops right away");
+	test_walk(&failed, &root, VISIT_POST_ORDER, -1, 1, "3 4 1", "post-order stops right away");
+	test_walk(&failed, &root, VISIT_LEVEL_ORDER, -1, 2, "0 1 2", "level-order stops right away");
+
+	AST_destroy_children(&root);
+	return failed;
+}
+
+//A long chain of operators parses into a tree as deep as the chain is long. The passes walk it with AST_Visitor instead of recursion,
+//so it can be checked, inlined, and copied without running out of call stack
+int test_deep_nesting(void) {
+	int failed = 0;
+	int terms = 200000;
+	char* head = "int f(int a) {\n\treturn a;\n}\nint x = f(1)";
+	int headLen = (int)strlen(head);
+	char* text = (char*)mem_alloc(headLen + terms * 7 + 2);
+	if (text == NULL) {
+		printf("Failed to allocate memory in test_deep_nesting\n");
+		exit(-1);
+	}
+
+	memcpy(text, head, headLen);
+	int len = headLen;
+	for (int i = 1; i < terms; i++) {
+		memcpy(text + len, " + f(1)", 7);
+		len += 7;
+	}
+	memcpy(text + len, ";", 2);
+
+	Test_Source src;
+	test_source_open(&src, text, true);
+	mem_free(text);
+	test_check(&failed, src.errors == 0, "the program type checks");
+	test_check(&failed, inliner(&src.tokens, &src.ast) == terms, "every call is inlined");
+
+	AST* statement = &((AST*)src.ast->list.arr)[src.ast->list.len - 1];
+	AST copy;
+	AST_copy(&copy, statement);
+	test_check(&failed, AST_count_nodes(&copy) == AST_count_nodes(statement) && AST_count_nodes(&copy) == 2 * terms + 1,
+		"the copy has every node");
+	AST_destroy_children(&copy);
+
+	test_source_close(&src);
+	return failed;
+}
+
+Test tests[] = {
+	{ "missing-return", test_missing_return },
+	{ "trailing-return", test_trailing_return },
+	{ "inline-order", test_inline_order },
+	{ "value-boxing", test_value_boxing },
+	{ "heap-limit", test_heap_limit },
+	{ "image-validate", test_image_validate },
+	{ "incremental", test_incremental },
+	{ "visitor", test_visitor },
+	{ "deep-nesting", test_deep_nesting },
+};
+
+#define NUM_TESTS ((int)(sizeof(tests) / sizeof(tests[0])))
+
+//The entry point for --test. Runs every test, or only the ones named in argv. Returns 0 if they all passed
+int tests_main(int argc, char** argv) {
+	int ran = 0;
+	int failures = 0;
+
+	for (int i = 0; i < NUM_TESTS; i++) {
+		int selected = argc == 0;
+		for (int k = 0; k < argc; k++) {
+			selected |= strcmp(argv[k], tests[i].name) == 0;
+		}
+		if (!selected) {
+			continue;
+		}
+
+		int failed = tests[i].run();
+		printf("%s %s\n", failed == 0 ? "ok  " : "FAIL", tests[i].name);
+		failures += failed > 0;
+		ran++;
+	}
+
+	if (ran == 0) {
+		printf("No test is named that\n");
+		return 1;
+	}
+	printf("\n%d / %d tests passed\n", ran - failures, ran);
+	//Only prints anything in builds with MEMORY_TRACKING defined, which is how the tests catch leaks
+	memory_report(stdout);
+	return failures > 0 ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,320 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Memory.h"
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+//This header file contains a work stealing thread pool
+//
+//Every worker has its own queue of tasks. A worker takes tasks from the back of its own queue, and when that runs dry it steals
+//from the front of the queues of the other workers, so the work evens itself out even when some tasks take much longer than others
+//
+//Tasks are given the index of the worker running them, which is what lets each task use per worker state (like an arena) without
+//any locking
+
+#ifdef _WIN32
+typedef SRWLOCK tp_mutex;
+typedef CONDITION_VARIABLE tp_cond;
+typedef HANDLE tp_thread;
+
+void tp_mutex_init(tp_mutex* mutex) { InitializeSRWLock(mutex); }
+void tp_mutex_destroy(tp_mutex* mutex) {}
+void tp_mutex_lock(tp_mutex* mutex) { AcquireSRWLockExclusive(mutex); }
+void tp_mutex_unlock(tp_mutex* mutex) { ReleaseSRWLockExclusive(mutex); }
+void tp_cond_init(tp_cond* cond) { InitializeConditionVariable(cond); }
+void tp_cond_destroy(tp_cond* cond) {}
+void tp_cond_wait(tp_cond* cond, tp_mutex* mutex) { SleepConditionVariableSRW(cond, mutex, INFINITE, 0); }
+void tp_cond_broadcast(tp_cond* cond) { WakeAllConditionVariable(cond); }
+void tp_cond_signal(tp_cond* cond) { WakeConditionVariable(cond); }
+#else
+typedef pthread_mutex_t tp_mutex;
+typedef pthread_cond_t tp_cond;
+typedef pthread_t tp_thread;
+
+void tp_mutex_init(tp_mutex* mutex) { pthread_mutex_init(mutex, NULL); }
+void tp_mutex_destroy(tp_mutex* mutex) { pthread_mutex_destroy(mutex); }
+void tp_mutex_lock(tp_mutex* mutex) { pthread_mutex_lock(mutex); }
+void tp_mutex_unlock(tp_mutex* mutex) { pthread_mutex_unlock(mutex); }
+void tp_cond_init(tp_cond* cond) { pthread_cond_init(cond, NULL); }
+void tp_cond_destroy(tp_cond* cond) { pthread_cond_destroy(cond); }
+void tp_cond_wait(tp_cond* cond, tp_mutex* mutex) { pthread_cond_wait(cond, mutex); }
+void tp_cond_broadcast(tp_cond* cond) { pthread_cond_broadcast(cond); }
+void tp_cond_signal(tp_cond* cond) { pthread_cond_signal(cond); }
+#endif
+
+typedef struct ThreadPool_Task {
+	void (*fn)(void* arg, int worker);
+	void* arg;
+} ThreadPool_Task;
+
+//A double ended queue stored as a growable ring buffer
+typedef struct ThreadPool_Queue {
+	ThreadPool_Task* tasks;
+	int head;
+	int len;
+	int __size;
+	tp_mutex lock;
+} ThreadPool_Queue;
+
+typedef struct ThreadPool {
+	tp_thread* threads;
+	ThreadPool_Queue* queues;
+	int numWorkers;
+	//Which queue the next submitted task goes into
+	int nextQueue;
+	//Everything below is protected by lock
+	tp_mutex lock;
+	//Signaled when a task is submitted or the pool is shutting down
+	tp_cond workAvailable;
+	//Signaled when the last unfinished task completes
+	tp_cond workDone;
+	int queued;
+	int unfinished;
+	int shutdown;
+	long long numSteals;
+} ThreadPool;
+
+typedef struct ThreadPool_Worker {
+	ThreadPool* pool;
+	int index;
+} ThreadPool_Worker;
+
+//Returns the number of processors, which is a good default for the number of workers
+int threadpool_default_workers() {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (int)count : 1;
+#endif
+}
+
+void threadpool_queue_push(ThreadPool_Queue* queue, ThreadPool_Task task) {
+	tp_mutex_lock(&queue->lock);
+
+	if (queue->len + 1 >= queue->__size) {
+		int newSize = queue->__size * 2;
+		ThreadPool_Task* test = (ThreadPool_Task*)mem_alloc(newSize * sizeof(ThreadPool_Task));
+
+		if (test == NULL) {
+			printf("Failed to allocate memory in threadpool_queue_push\n");
+			exit(-1);
+		}
+
+		//The ring buffer gets unwrapped into the start of the new buffer
+		for (int i = 0; i < queue->len; i++) {
+			test[i] = queue->tasks[(queue->head + i) % queue->__size];
+		}
+
+		mem_free(queue->tasks);
+		queue->tasks = test;
+		queue->head = 0;
+		queue->__size = newSize;
+	}
+
+	queue->tasks[(queue->head + queue->len) % queue->__size] = task;
+	queue->len++;
+
+	tp_mutex_unlock(&queue->lock);
+}
+
+//Takes a task from either the back (the owner of the queue) or the front (a worker stealing from the queue)
+int threadpool_queue_take(ThreadPool_Queue* queue, ThreadPool_Task* task, int fromBack) {
+	int found = false;
+	tp_mutex_lock(&queue->lock);
+
+	if (queue->len > 0) {
+		if (fromBack) {
+			*task = queue->tasks[(queue->head + queue->len - 1) % queue->__size];
+		}
+		else {
+			*task = queue->tasks[queue->head];
+			queue->head = (queue->head + 1) % queue->__size;
+		}
+		queue->len--;
+		found = true;
+	}
+
+	tp_mutex_unlock(&queue->lock);
+	return found;
+}
+
+//Looks for a task in the worker's own queue first, and then tries to steal one from every other worker
+int threadpool_find_task(ThreadPool* pool, int index, ThreadPool_Task* task) {
+	if (threadpool_queue_take(&pool->queues[index], task, true)) {
+		return true;
+	}
+
+	for (int i = 1; i < pool->numWorkers; i++) {
+		if (threadpool_queue_take(&pool->queues[(index + i) % pool->numWorkers], task, false)) {
+			tp_mutex_lock(&pool->lock);
+			pool->numSteals++;
+			tp_mutex_unlock(&pool->lock);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+#ifdef _WIN32
+DWORD WINAPI threadpool_worker(LPVOID arg) {
+#else
+void* threadpool_worker(void* arg) {
+#endif
+	ThreadPool_Worker* worker = (ThreadPool_Worker*)arg;
+	ThreadPool* pool = worker->pool;
+	int index = worker->index;
+	mem_free(worker);
+
+	while (true) {
+		ThreadPool_Task task;
+
+		if (threadpool_find_task(pool, index, &task)) {
+			tp_mutex_lock(&pool->lock);
+			pool->queued--;
+			tp_mutex_unlock(&pool->lock);
+
+			task.fn(task.arg, index);
+
+			tp_mutex_lock(&pool->lock);
+			pool->unfinished--;
+			if (pool->unfinished == 0) {
+				tp_cond_broadcast(&pool->workDone);
+			}
+			tp_mutex_unlock(&pool->lock);
+			continue;
+		}
+
+		//queued is only changed while holding the lock, so checking it here before sleeping means a task submitted after the
+		//search above can't be missed
+		tp_mutex_lock(&pool->lock);
+		while (pool->queued == 0 && !pool->shutdown) {
+			tp_cond_wait(&pool->workAvailable, &pool->lock);
+		}
+		int shouldExit = pool->shutdown && pool->queued == 0;
+		tp_mutex_unlock(&pool->lock);
+
+		if (shouldExit) {
+			break;
+		}
+	}
+
+	return 0;
+}
+
+void threadpool_init(ThreadPool* pool, int numWorkers) {
+	if (numWorkers <= 0) {
+		numWorkers = threadpool_default_workers();
+	}
+
+	pool->numWorkers = numWorkers;
+	pool->nextQueue = 0;
+	pool->queued = 0;
+	pool->unfinished = 0;
+	pool->shutdown = false;
+	pool->numSteals = 0;
+	tp_mutex_init(&pool->lock);
+	tp_cond_init(&pool->workAvailable);
+	tp_cond_init(&pool->workDone);
+
+	pool->threads = (tp_thread*)mem_alloc(numWorkers * sizeof(tp_thread));
+	pool->queues = (ThreadPool_Queue*)mem_alloc(numWorkers * sizeof(ThreadPool_Queue));
+
+	if (pool->threads == NULL || pool->queues == NULL) {
+		printf("Failed to allocate memory in threadpool_init\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < numWorkers; i++) {
+		pool->queues[i].tasks = NULL;
+		pool->queues[i].head = 0;
+		pool->queues[i].len = 0;
+		pool->queues[i].__size = 1;
+		tp_mutex_init(&pool->queues[i].lock);
+	}
+
+	for (int i = 0; i < numWorkers; i++) {
+		ThreadPool_Worker* worker = (ThreadPool_Worker*)mem_alloc(sizeof(ThreadPool_Worker));
+
+		if (worker == NULL) {
+			printf("Failed to allocate memory in threadpool_init\n");
+			exit(-1);
+		}
+
+		worker->pool = pool;
+		worker->index = i;
+#ifdef _WIN32
+		pool->threads[i] = CreateThread(NULL, 0, threadpool_worker, worker, 0, NULL);
+		if (pool->threads[i] == NULL) {
+#else
+		if (pthread_create(&pool->threads[i], NULL, threadpool_worker, worker) != 0) {
+#endif
+			printf("Failed to create thread in threadpool_init\n");
+			exit(-1);
+		}
+	}
+}
+
+//Adds a task to the pool. Tasks are spread over the queues of the workers in turn, and stealing evens things out from there
+void threadpool_submit(ThreadPool* pool, void (*fn)(void* arg, int worker), void* arg) {
+	tp_mutex_lock(&pool->lock);
+	int index = pool->nextQueue;
+	pool->nextQueue = (pool->nextQueue + 1) % pool->numWorkers;
+	pool->unfinished++;
+	tp_mutex_unlock(&pool->lock);
+
+	threadpool_queue_push(&pool->queues[index], (ThreadPool_Task) { .fn = fn, .arg = arg });
+
+	tp_mutex_lock(&pool->lock);
+	pool->queued++;
+	tp_cond_signal(&pool->workAvailable);
+	tp_mutex_unlock(&pool->lock);
+}
+
+//Blocks until every task submitted so far has finished
+void threadpool_wait(ThreadPool* pool) {
+	tp_mutex_lock(&pool->lock);
+	while (pool->unfinished > 0) {
+		tp_cond_wait(&pool->workDone, &pool->lock);
+	}
+	tp_mutex_unlock(&pool->lock);
+}
+
+//Finishes any remaining tasks, then stops the workers and frees the pool
+void threadpool_destroy(ThreadPool* pool) {
+	tp_mutex_lock(&pool->lock);
+	pool->shutdown = true;
+	tp_cond_broadcast(&pool->workAvailable);
+	tp_mutex_unlock(&pool->lock);
+
+	for (int i = 0; i < pool->numWorkers; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(pool->threads[i], INFINITE);
+		CloseHandle(pool->threads[i]);
+#else
+		pthread_join(pool->threads[i], NULL);
+#endif
+		mem_free(pool->queues[i].tasks);
+		tp_mutex_destroy(&pool->queues[i].lock);
+	}
+
+	mem_free(pool->threads);
+	mem_free(pool->queues);
+	tp_cond_destroy(&pool->workAvailable);
+	tp_cond_destroy(&pool->workDone);
+	tp_mutex_destroy(&pool->lock);
+}
+
+#endif
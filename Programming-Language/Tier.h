@@ -0,0 +1,474 @@
+#ifndef TIER_H
+#define TIER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Strings.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "TypeChecker.h"
+#include "Bytecode.h"
+#include "Image.h"
+#include "GC.h"
+#include "VM.h"
+#include "PGO.h"
+#include <stdbool.h>
+
+//This header file contains the tiered runner, which runs a program without compiling all of it up front
+//
+//Compiling every function before anything runs is wasted work for a function that only runs once, or never. So every function starts
+//out in the AST tier, where its body isn't even parsed until the first time it is called, and it is then run straight from the tree.
+//Once a function has been called threshold times it is compiled to bytecode (with the peephole pass) and installed into the VM, and
+//every call after that runs the bytecode. The top level statements only ever run once, so they always run from the tree
+//
+//Both tiers share one VM, with its stack, globals, and collector. The AST tier keeps its values on the stack of the VM the same way the
+//bytecode does (the locals first, then whatever is being worked on), so every value is somewhere the collector can see it and the tiers
+//can call each other freely. A call from bytecode to a function that hasn't been compiled comes back here through vm->call, and a call
+//from the tree to a compiled function goes into the VM through vm_call
+//
+//Since a body is only checked the first time it runs, errors are only found in code that actually runs, and they stop the program
+//when they are found instead of before it starts
+//
+//There are no loops in the language yet, so the only way for a function to get hot is to be called, and a call that is already running
+//never needs to move to the bytecode part way through (on-stack replacement). Once there are loops their back edges should count towards
+//the threshold as well, and a function that gets hot inside of a loop will need its frame moved over while it is running. There is also
+//no tier past the bytecode, since nothing in here can make machine code yet
+//
+//With a profile from earlier runs, the functions that it says get called more than threshold times in a run are compiled the first time
+//they are called, since they are going to end up compiled anyway
+
+//How many calls a function runs from the tree before it is compiled
+#define TIER_DEFAULT_THRESHOLD 2
+
+enum TIER_LEVELS {
+	//The body hasn't been parsed yet
+	TIER_UNPARSED = 0,
+	TIER_AST = 1,
+	TIER_BYTECODE = 2,
+};
+
+typedef struct Tier_Stats {
+	//How many function bodies were parsed, and how many of those were compiled
+	int parsed;
+	int compiled;
+	//Calls run from the tree, and AST nodes run by those calls and the top level statements
+	long long astCalls;
+	long long astNodes;
+} Tier_Stats;
+
+typedef struct Tier {
+	tokenList* tokens;
+	AST** ast;
+	Program* program;
+	//Made from the program before anything is compiled, so it only has the names of things and the parameters of the functions
+	Image image;
+	VM vm;
+	int threshold;
+	//For every function, its definition (or the root node for function 0), how many times it has been called, and its level
+	AST** nodes;
+	int* calls;
+	int* levels;
+	//Set for the functions that a profile says are going to get hot
+	int* hot;
+	//Filled in the first time each token is needed. The string made for a string literal, and the function a call calls (-2 until
+	//it is looked up)
+	Value* literals;
+	int* targets;
+	Value emptyString;
+	Tier_Stats stats;
+} Tier;
+
+//A call that is running from the tree
+typedef struct Tier_Frame {
+	//Only its locals and its program are used, so that names are resolved exactly the way the compiler resolves them
+	Compiler c;
+	int base;
+} Tier_Frame;
+
+int tier_vm_call(VM* vm, int index);
+
+//Sets up the runner for a program that has been through parser. Returns false if the program can't be run this way, which is the case
+//for programs that import other files
+int tier_init(Tier* tier, tokenList* list, AST** ast, Program* program, int threshold) {
+	tier->tokens = list;
+	tier->ast = ast;
+	tier->program = program;
+	tier->threshold = threshold;
+	memset(&tier->stats, 0, sizeof(Tier_Stats));
+
+	program_init(program, list, ast);
+	if (!image_from_program(&tier->image, program, list)) {
+		program_destroy(program);
+		return false;
+	}
+
+	tier->nodes = (AST**)mem_alloc(program->numFunctions * sizeof(AST*));
+	tier->calls = (int*)mem_calloc(program->numFunctions, sizeof(int));
+	tier->levels = (int*)mem_calloc(program->numFunctions, sizeof(int));
+	tier->hot = (int*)mem_calloc(program->numFunctions, sizeof(int));
+	tier->literals = (Value*)mem_calloc(list->len + 1, sizeof(Value));
+	tier->targets = (int*)mem_alloc((list->len + 1) * sizeof(int));
+
+	if (tier->nodes == NULL || tier->calls == NULL || tier->levels == NULL || tier->hot == NULL || tier->literals == NULL || tier->targets == NULL) {
+		printf("Failed to allocate memory in tier_init\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < list->len; i++) {
+		tier->targets[i] = -2;
+	}
+
+	vm_init(&tier->vm, &tier->image);
+	tier->vm.call = tier_vm_call;
+	tier->vm.callData = tier;
+	tier->emptyString = gc_string_literal(&tier->vm.gc, &bytecode_empty_string);
+
+	//The image was made before anything was compiled, so the VM only gets the number of parameters of each function from here
+	tier->nodes[0] = *ast;
+	tier->levels[0] = TIER_AST;
+	int index = 1;
+	for (int i = 0; i < (**ast).list.len; i++) {
+		AST* node = &((AST*)(**ast).list.arr)[i];
+		if (node->type != AST_FUNCTION_DEFINITION && node->type != AST_FUNCTION_IMPORT && node->type != AST_FUNCTION_EXTERN) {
+			continue;
+		}
+
+		tier->nodes[index] = node;
+		for (int j = 0; j < node->list.len; j++) {
+			tier->vm.functions[index].numParams += ((AST*)node->list.arr)[j].type == AST_FUNCTION_PARAMETER;
+		}
+		index++;
+	}
+	return true;
+}
+
+void tier_destroy(Tier* tier) {
+	vm_destroy(&tier->vm);
+	image_close(&tier->image);
+	mem_free(tier->nodes);
+	mem_free(tier->calls);
+	mem_free(tier->levels);
+	mem_free(tier->hot);
+	mem_free(tier->literals);
+	mem_free(tier->targets);
+	tier->nodes = NULL;
+	tier->calls = NULL;
+	tier->levels = NULL;
+	tier->hot = NULL;
+	tier->literals = NULL;
+	tier->targets = NULL;
+}
+
+int tier_push(Tier* tier, Value val) {
+	VM* vm = &tier->vm;
+	if (vm->sp >= VM_STACK_SIZE) {
+		vm_error(vm, "Stack overflow");
+		return false;
+	}
+	vm->stack[vm->sp++] = val;
+	return true;
+}
+
+int tier_call(Tier* tier, int index);
+
+//Runs an expression and pushes its value. Returns false if a runtime error stopped the program
+int tier_expression(Tier* tier, Tier_Frame* frame, AST* node) {
+	VM* vm = &tier->vm;
+	tier->stats.astNodes++;
+
+	switch (node->type) {
+	case AST_LITERAL: {
+		Value val = value_from_token(tier->tokens->tokens[node->token_index]);
+		if (value_is_string(val)) {
+			if (tier->literals[node->token_index] == 0) {
+				tier->literals[node->token_index] = gc_string_literal(&vm->gc, value_as_string(val));
+			}
+			val = tier->literals[node->token_index];
+		}
+		return tier_push(tier, val);
+	}
+	case AST_IDENTIFIER_VARIABLE: {
+		int global;
+		int slot = compiler_resolve(&frame->c, node->token_index, &global);
+		if (slot == -1) {
+			diagnostics_error(tier->tokens, "Compile", node->token_index, "Use of an undeclared variable");
+			return false;
+		}
+
+		Value val = global ? vm->globals[slot] : vm->stack[frame->base + slot];
+		gc_write_barrier(&vm->gc, val);
+		return tier_push(tier, val);
+	}
+	case AST_FUNCTION_CALL: {
+		if (tier->targets[node->token_index] == -2) {
+			tier->targets[node->token_index] = program_find_function(tier->program, tier->tokens, node->token_index);
+		}
+		int index = tier->targets[node->token_index];
+		if (index == -1) {
+			diagnostics_error(tier->tokens, "Compile", node->token_index, "Call to a function that has no definition");
+			return false;
+		}
+
+		for (int i = 0; i < node->list.len; i++) {
+			if (!tier_expression(tier, frame, &((AST*)node->list.arr)[i])) {
+				return false;
+			}
+		}
+		return tier_call(tier, index);
+	}
+	case AST_ADD:
+	case AST_SUBTRACT:
+	case AST_MULTIPLY:
+	case AST_DIVIDE: {
+		if (node->list.len != 2 || node->op < OP_INT_ADD || node->op > OP_STRING_CONCAT) {
+			diagnostics_error(tier->tokens, "Compile", node->token_index, "Operator has no type");
+			return false;
+		}
+		if (!tier_expression(tier, frame, &((AST*)node->list.arr)[0]) || !tier_expression(tier, frame, &((AST*)node->list.arr)[1])) {
+			return false;
+		}
+
+		//Both operands stay on the stack until the result exists, the same as in the VM, since a concat can run the collector
+		Value* a = &vm->stack[vm->sp - 2];
+		Value b = vm->stack[vm->sp - 1];
+		switch (node->op) {
+		case OP_INT_ADD:
+			*a = value_int_add(*a, b);
+			break;
+		case OP_INT_SUBTRACT:
+			*a = value_int_subtract(*a, b);
+			break;
+		case OP_INT_MULTIPLY:
+			*a = value_int_multiply(*a, b);
+			break;
+		case OP_INT_DIVIDE:
+			*a = value_int_divide(*a, b);
+			break;
+		case OP_FLOAT_ADD:
+			*a = value_float_add(*a, b);
+			break;
+		case OP_FLOAT_SUBTRACT:
+			*a = value_float_subtract(*a, b);
+			break;
+		case OP_FLOAT_MULTIPLY:
+			*a = value_float_multiply(*a, b);
+			break;
+		case OP_FLOAT_DIVIDE:
+			*a = value_float_divide(*a, b);
+			break;
+		case OP_STRING_CONCAT: {
+			Value result = gc_string_concat(&vm->gc, *a, b);
+			vm->stack[vm->sp - 2] = result;
+			break;
+		}
+		}
+		vm->sp--;
+		return true;
+	}
+	default:
+		diagnostics_error(tier->tokens, "Compile", node->token_index, "Node can't be run as an expression");
+		return false;
+	}
+}
+
+//Stores the value on top of the stack in the variable at token_index, declaring it first if that is where it gets declared. The slot of
+//a new local is always the one right above the rest of the locals, which is where the value already is, so it just stays there
+int tier_store(Tier* tier, Tier_Frame* frame, int token_index) {
+	VM* vm = &tier->vm;
+	if (frame->c.function->token_index != -1 && bytecode_is_declaration(tier->tokens, token_index)) {
+		Vector_Int_Append(&frame->c.locals, token_index);
+		return true;
+	}
+
+	int global;
+	int slot = compiler_resolve(&frame->c, token_index, &global);
+	if (slot == -1) {
+		diagnostics_error(tier->tokens, "Compile", token_index, "Assignment to an undeclared variable");
+		return false;
+	}
+
+	Value val = vm->stack[--vm->sp];
+	gc_write_barrier(&vm->gc, val);
+	if (global) {
+		vm->globals[slot] = val;
+	}
+	else {
+		vm->stack[frame->base + slot] = val;
+	}
+	return true;
+}
+
+//Runs a statement. Sets returned and leaves the return value on the stack if it was a return. Returns false if a runtime error stopped
+//the program
+int tier_statement(Tier* tier, Tier_Frame* frame, AST* node, int* returned) {
+	tier->stats.astNodes++;
+
+	switch (node->type) {
+	case AST_ASSIGN:
+		return tier_expression(tier, frame, &((AST*)node->list.arr)[1]) && tier_store(tier, frame, ((AST*)node->list.arr)[0].token_index);
+	case AST_IDENTIFIER_VARIABLE:
+		//A declaration without a value starts out with the zero value for its type
+		if (bytecode_is_declaration(tier->tokens, node->token_index)) {
+			int type = token_identifier_type(tier->tokens->tokens[node->token_index]);
+			Value val = type == KEYWORD_FLOAT ? value_from_float(0.0) : type == KEYWORD_STRING ? tier->emptyString : value_from_int(0);
+			return tier_push(tier, val) && tier_store(tier, frame, node->token_index);
+		}
+		break;
+	case AST_RETURN:
+		*returned = true;
+		if (node->list.len > 0) {
+			return tier_expression(tier, frame, &((AST*)node->list.arr)[0]);
+		}
+		return tier_push(tier, VALUE_VOID);
+	case AST_FUNCTION_DEFINITION:
+	case AST_FUNCTION_PARAMETER:
+	case AST_FUNCTION_IMPORT:
+	case AST_FUNCTION_EXTERN:
+	case AST_IMPORT:
+		return true;
+	}
+
+	//Anything else is an expression whose value isn't used
+	if (!tier_expression(tier, frame, node)) {
+		return false;
+	}
+	tier->vm.sp--;
+	return true;
+}
+
+//Runs a function from the tree, with its arguments on top of the stack. Leaves the return value in place of the arguments, except for
+//the top level statements, which leave nothing. Returns false if a runtime error stopped the program
+int tier_run_tree(Tier* tier, int index) {
+	VM* vm = &tier->vm;
+	AST* def = tier->nodes[index];
+
+	if (vm->numFrames >= VM_MAX_FRAMES) {
+		vm_error(vm, "Stack overflow");
+		return false;
+	}
+
+	Tier_Frame frame = { .c = { .tokens = tier->tokens, .program = tier->program, .function = &tier->program->functions[index], .origin = -1 },
+		.base = vm->sp - vm->functions[index].numParams };
+	Vector_Int_Init(&frame.c.locals);
+	vm->frames[vm->numFrames] = (VM_Frame){ .function = index, .ip = 0, .base = frame.base };
+	vm->numFrames++;
+	tier->stats.astCalls++;
+
+	int ok = true;
+	int returned = false;
+	for (int i = 0; i < def->list.len && ok && !returned; i++) {
+		AST* child = &((AST*)def->list.arr)[i];
+		if (child->type == AST_FUNCTION_PARAMETER) {
+			Vector_Int_Append(&frame.c.locals, child->token_index);
+		}
+		else {
+			ok = tier_statement(tier, &frame, child, &returned);
+		}
+	}
+
+	//The same as compiler_function, only the top level statements and void functions can fall off the end
+	if (ok && !returned && index != 0 && token_identifier_type(tier->tokens->tokens[def->token_index]) != KEYWORD_VOID) {
+		vm_error(vm, "Function ended without returning a value");
+		ok = false;
+	}
+
+	//Frames are left where they are after an error, so that vm_error can show where it happened
+	if (ok) {
+		Value val = returned ? vm->stack[vm->sp - 1] : VALUE_VOID;
+		gc_write_barrier(&vm->gc, val);
+		vm->sp = frame.base;
+		vm->numFrames--;
+		if (index != 0) {
+			vm->stack[vm->sp++] = val;
+		}
+	}
+
+	Vector_Int_Destroy(&frame.c.locals);
+	return ok;
+}
+
+//Compiles a function and hands its code to the VM. Returns false if it couldn't be compiled
+int tier_compile(Tier* tier, int index) {
+	Function* fn = &tier->program->functions[index];
+	compiler_function(tier->tokens, tier->program, index, tier->nodes[index]);
+	if (fn->numErrors > 0) {
+		return false;
+	}
+
+	if (!vm_install_function(&tier->vm, index, fn)) {
+		vm_error(&tier->vm, "Compiled code of the function is damaged");
+		return false;
+	}
+	tier->stats.compiled++;
+	tier->levels[index] = TIER_BYTECODE;
+	return true;
+}
+
+//Parses and checks the body of a function the first time it is called. Returns false if it has errors
+int tier_prepare(Tier* tier, int index) {
+	AST* def = tier->nodes[index];
+	//There is nothing of an extern function to run on the tree, so it goes straight to the VM
+	if (def->type == AST_FUNCTION_EXTERN) {
+		return typechecker_function(tier->tokens, tier->ast, def) == 0 && tier_compile(tier, index);
+	}
+	if (def->type != AST_FUNCTION_DEFINITION) {
+		diagnostics_error(tier->tokens, "Compile", def->token_index, "Only functions defined in this file can be run");
+		return false;
+	}
+
+	int errors = parser_function_body(tier->tokens, def);
+	if (errors == 0) {
+		errors += typechecker_function(tier->tokens, tier->ast, def);
+	}
+	tier->stats.parsed++;
+	tier->levels[index] = TIER_AST;
+	return errors == 0;
+}
+
+//Calls the function whose arguments are on top of the stack in whichever tier it is in, moving it up a tier first if it is time to
+int tier_call(Tier* tier, int index) {
+	tier->calls[index]++;
+
+	if (tier->levels[index] == TIER_UNPARSED && !tier_prepare(tier, index)) {
+		return false;
+	}
+	if (tier->levels[index] == TIER_AST && (tier->calls[index] > tier->threshold || tier->hot[index]) && !tier_compile(tier, index)) {
+		return false;
+	}
+
+	if (tier->levels[index] == TIER_BYTECODE) {
+		return vm_call(&tier->vm, index);
+	}
+	return tier_run_tree(tier, index);
+}
+
+int tier_vm_call(VM* vm, int index) {
+	return tier_call((Tier*)vm->callData, index);
+}
+
+//Checks and runs the top level statements, which sets every global. Returns false if there were errors or a runtime error stopped the
+//program
+int tier_run(Tier* tier) {
+	if (typechecker_function(tier->tokens, tier->ast, NULL) > 0) {
+		return false;
+	}
+	return tier_run_tree(tier, 0);
+}
+
+//Marks the functions that the profile says get called more than threshold times in a run, so they are compiled on their first call
+void tier_use_profile(Tier* tier, PGO_Profile* profile) {
+	char name[PGO_MAX_NAME];
+	for (int i = 1; i < tier->program->numFunctions; i++) {
+		pgo_function_name(tier->tokens, tier->program->functions[i].token_index, name, sizeof(name));
+		tier->hot[i] = pgo_calls_per_run(profile, name) > tier->threshold;
+	}
+}
+
+void tier_print_stats(Tier* tier) {
+	printf("Tiers: %d / %d functions parsed, %d compiled, %lld calls and %lld nodes run from the tree, %lld VM instructions\n",
+		tier->stats.parsed, tier->program->numFunctions - 1, tier->stats.compiled, tier->stats.astCalls, tier->stats.astNodes,
+		tier->vm.instructions);
+}
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef TYPECHECKER_H
+#define TYPECHECKER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Lexer.h"
+#include "Parser.h"
+#include "Diagnostics.h"
+#include <stdbool.h>
+
+//This header file contains the type checking pass. It resolves the type of every expression in the AST, reports any mismatches,
+//and picks the specialized operation for every arithmetic node so that nothing has to check types while the program runs
+//
+//Types are stored as indices into the keywords list, which is the same way the lexer stores the type of identifiers in mdata.
+//There are no implicit conversions, so an int and a float can't be mixed in the same operation
+
+typedef struct TypeChecker {
+	tokenList* tokens;
+	AST* root;
+	//The function definition whose body is currently being checked, or NULL for top level statements
+	AST* function;
+	int num_errors;
+	AST_Visitor visitor;
+} TypeChecker;
+
+//Prints out a type error along with the index of the token it happened at, and what that token is
+void typechecker_error(TypeChecker* tc, int token_index, char* message) {
+	diagnostics_error(tc->tokens, "Type", token_index, message);
+	tc->num_errors++;
+}
+
+//Returns the function definition in the root node with the same name as the identifier at token_index, or NULL if there isn't one
+AST* typechecker_find_function(TypeChecker* tc, int token_index) {
+	for (int i = 0; i < tc->root->list.len; i++) {
+		AST* node = &((AST*)tc->root->list.arr)[i];
+		if ((node->type == AST_FUNCTION_DEFINITION || node->type == AST_FUNCTION_IMPORT || node->type == AST_FUNCTION_EXTERN)
+			&& token_name_equal(tc->tokens, node->token_index, token_index)) {
+			return node;
+		}
+	}
+	return NULL;
+}
+
+//Picks the specialized operation for an arithmetic node based on the type of its operands, or returns OP_NONE if the operation
+//isn't defined for that type
+int typechecker_select_op(int ast_type, int value_type) {
+	if (value_type == KEYWORD_INT) {
+		switch (ast_type) {
+		case AST_ADD:
+			return OP_INT_ADD;
+		case AST_SUBTRACT:
+			return OP_INT_SUBTRACT;
+		case AST_MULTIPLY:
+			return OP_INT_MULTIPLY;
+		case AST_DIVIDE:
+			return OP_INT_DIVIDE;
+		}
+	}
+	else if (value_type == KEYWORD_FLOAT) {
+		switch (ast_type) {
+		case AST_ADD:
+			return OP_FLOAT_ADD;
+		case AST_SUBTRACT:
+			return OP_FLOAT_SUBTRACT;
+		case AST_MULTIPLY:
+			return OP_FLOAT_MULTIPLY;
+		case AST_DIVIDE:
+			return OP_FLOAT_DIVIDE;
+		}
+	}
+	else if (value_type == KEYWORD_STRING && ast_type == AST_ADD) {
+		return OP_STRING_CONCAT;
+	}
+
+	return OP_NONE;
+}
+
+void typechecker_check_call(TypeChecker* tc, AST* node) {
+	AST* def = typechecker_find_function(tc, node->token_index);
+
+	node->valueType = token_identifier_type(tc->tokens->tokens[node->token_index]);
+
+	if (def == NULL) {
+		typechecker_error(tc, node->token_index, "Call to a function that has no definition");
+		return;
+	}
+
+	int num_params = 0;
+	for (int i = 0; i < def->list.len; i++) {
+		AST* param = &((AST*)def->list.arr)[i];
+		if (param->type != AST_FUNCTION_PARAMETER) {
+			continue;
+		}
+
+		if (num_params < node->list.len) {
+			AST* arg = &((AST*)node->list.arr)[num_params];
+			if (arg->valueType != -1 && arg->valueType != token_identifier_type(tc->tokens->tokens[param->token_index])) {
+				typechecker_error(tc, arg->token_index, "Argument type does not match the type of the parameter");
+			}
+		}
+		num_params++;
+	}
+
+	if (num_params != node->list.len) {
+		typechecker_error(tc, node->token_index, "Wrong number of arguments passed to function");
+	}
+}
+
+//Returns true if running the body of a function always reaches a return. There is no control flow inside of a body yet, so that is the
+//same as the body having a return in it. A body that hasn't been parsed yet is given the benefit of the doubt
+int typechecker_always_returns(AST* def) {
+	for (int i = 0; i < def->list.len; i++) {
+		int type = ((AST*)def->list.arr)[i].type;
+		if (type == AST_RETURN || type == AST_UNPARSED_BODY) {
+			return true;
+		}
+	}
+	return false;
+}
+
+//Checks a single node. The walk is post-order since the type of almost every node depends on the types of the nodes below it
+int typechecker_visit_node(AST_Visitor* visitor, AST* node) {
+	TypeChecker* tc = (TypeChecker*)visitor->data;
+	AST* left = node->list.len > 0 ? &((AST*)node->list.arr)[0] : NULL;
+	AST* right = node->list.len > 1 ? &((AST*)node->list.arr)[1] : NULL;
+	token tok = node->token_index >= 0 ? tc->tokens->tokens[node->token_index] : (token) { .val = 0, .type = TYPE_UNDEFINED, .mdata = -1 };
+
+	switch (node->type) {
+	case AST_LITERAL:
+		if (tok.mdata == INT_LITERAL) {
+			node->valueType = KEYWORD_INT;
+		}
+		else if (tok.mdata == FLOAT_LITERAL) {
+			node->valueType = KEYWORD_FLOAT;
+		}
+		else {
+			node->valueType = KEYWORD_STRING;
+		}
+		break;
+	case AST_IDENTIFIER_VARIABLE:
+	case AST_FUNCTION_PARAMETER:
+		if (tok.type != IDENTIFIER) {
+			typechecker_error(tc, node->token_index, "Use of an undeclared identifier");
+		}
+		else {
+			node->valueType = token_identifier_type(tok);
+		}
+		break;
+	case AST_FUNCTION_DEFINITION:
+		node->valueType = token_identifier_type(tok);
+		if (node->valueType != KEYWORD_VOID && !typechecker_always_returns(node)) {
+			typechecker_error(tc, node->token_index, "Not all paths of the function return a value");
+		}
+		break;
+	case AST_FUNCTION_EXTERN:
+		//A C function can't be given nothing as an argument
+		for (int i = 0; i < node->list.len; i++) {
+			AST* param = &((AST*)node->list.arr)[i];
+			if (param->valueType == KEYWORD_VOID) {
+				typechecker_error(tc, param->token_index, "Parameters of an extern function can't be void");
+			}
+		}
+		node->valueType = token_identifier_type(tok);
+		break;
+	case AST_FUNCTION_CALL:
+		typechecker_check_call(tc, node);
+		break;
+	case AST_ADD:
+	case AST_SUBTRACT:
+	case AST_MULTIPLY:
+	case AST_DIVIDE:
+		if (left == NULL || right == NULL || left->valueType == -1 || right->valueType == -1) {
+			//An error was already reported further down, so reporting another one here would just be noise
+			break;
+		}
+
+		if (left->valueType != right->valueType) {
+			typechecker_error(tc, node->token_index, "Operands of arithmetic operator have different types");
+			break;
+		}
+
+		node->valueType = left->valueType;
+		node->op = typechecker_select_op(node->type, left->valueType);
+		if (node->op == OP_NONE) {
+			typechecker_error(tc, node->token_index, "Operator is not defined for this type");
+		}
+		break;
+	case AST_ASSIGN:
+		if (left != NULL && right != NULL && left->valueType != -1 && right->valueType != -1 && left->valueType != right->valueType) {
+			typechecker_error(tc, node->token_index, "Assigned value does not match the type of the variable");
+		}
+		node->valueType = left != NULL ? left->valueType : -1;
+		break;
+	case AST_RETURN:
+		if (tc->function == NULL) {
+			typechecker_error(tc, node->token_index, "Return statement outside of a function");
+		}
+		else {
+			int returnType = token_identifier_type(tc->tokens->tokens[tc->function->token_index]);
+			int valueType = left != NULL ? left->valueType : KEYWORD_VOID;
+
+			if (left != NULL && left->valueType == -1) {
+				break;
+			}
+
+			if (valueType != returnType) {
+				typechecker_error(tc, node->token_index, "Returned value does not match the return type of the function");
+			}
+			node->valueType = valueType;
+		}
+		break;
+	}
+	return VISIT_CONTINUE;
+}
+
+//Checks node and everything under it. Functions can only be defined at the top level, so the function a return is in is known
+//before the walk starts
+void typechecker_visit(TypeChecker* tc, AST* node) {
+	tc->function = node->type == AST_FUNCTION_DEFINITION ? node : NULL;
+	AST_visit(&tc->visitor, node, VISIT_POST_ORDER);
+	tc->function = NULL;
+}
+
+void typechecker_init(TypeChecker* tc, tokenList* list, AST** ast) {
+	tc->tokens = list;
+	tc->root = *ast;
+	tc->function = NULL;
+	tc->num_errors = 0;
+	AST_visitor_init(&tc->visitor, typechecker_visit_node, tc);
+}
+
+void typechecker_destroy(TypeChecker* tc) {
+	AST_visitor_destroy(&tc->visitor);
+}
+
+//Checks a single function definition, or all of the top level statements if def is NULL. Only the nodes of that function are
+//changed, so different functions can be checked on different threads at the same time. Returns the number of errors found
+int typechecker_function(tokenList* list, AST** ast, AST* def) {
+	TypeChecker tc;
+	typechecker_init(&tc, list, ast);
+
+	if (def != NULL) {
+		typechecker_visit(&tc, def);
+	}
+	else {
+		for (int i = 0; i < (**ast).list.len; i++) {
+			AST* node = &((AST*)(**ast).list.arr)[i];
+			if (node->type != AST_FUNCTION_DEFINITION && node->type != AST_FUNCTION_EXTERN) {
+				typechecker_visit(&tc, node);
+			}
+		}
+	}
+
+	typechecker_destroy(&tc);
+	return tc.num_errors;
+}
+
+//Runs the type checker over the whole AST. Returns the number of errors found
+int typechecker(tokenList* list, AST** ast) {
+	profiler_begin(PHASE_TYPECHECK);
+	TypeChecker tc;
+	typechecker_init(&tc, list, ast);
+
+	for (int i = 0; i < (**ast).list.len; i++) {
+		typechecker_visit(&tc, &((AST*)(**ast).list.arr)[i]);
+	}
+
+	typechecker_destroy(&tc);
+	profiler_end();
+	return tc.num_errors;
+}
+
+#endif
@@ -0,0 +1,628 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Value.h"
+#include "GC.h"
+#include "Bytecode.h"
+#include "Image.h"
+#include "VMProfile.h"
+#include "FFI.h"
+#include <stdbool.h>
+
+//This header file contains the virtual machine that runs the bytecode of an image
+//
+//The machine has a single stack of values. When a function is called its arguments are already on top of the stack, and they
+//become the first of its local slots, with the rest of the locals right above them and then the values the function works with.
+//Returning pops everything the function put on the stack and leaves just the return value where the arguments used to be
+//
+//Functions are loaded the first time they are called. Loading checks the code of the function and turns its string constants into
+//strings the collector knows about, so a function that is never called is never read from the image at all
+//
+//Whatever is running the program can also hand the VM code for a function itself with vm_install_function, which is how the tiered
+//runner in Tier.h moves a function onto the VM once it has been called enough. When call is set, calling a function that hasn't been
+//loaded goes to call instead of to the image, and vm_call lets whoever that is call back into the VM
+//
+//An extern function is a single FOREIGN instruction. The first time one runs, its library is opened, the C function is looked up by the
+//name of the function, and the call stub for its signature is picked (see FFI.h). All three are kept, so later calls go straight to the stub
+
+#define VM_STACK_SIZE (1024 * 1024)
+#define VM_MAX_FRAMES 4096
+
+typedef struct VM_Frame {
+	int function;
+	//Index into the code of the function of the next instruction to run
+	int ip;
+	//Index into the stack of the first local slot
+	int base;
+} VM_Frame;
+
+typedef struct VM VM;
+
+//Runs the function whose arguments are on top of the stack and leaves its return value in their place. Returns false if a runtime
+//error stopped the program
+typedef int (*VM_Call)(VM* vm, int index);
+
+//What the VM runs a function from. For a function from the image the code points into the image and the constants are the constant
+//pool of the image, with the strings made as they are loaded. An installed function has its own code and constants instead
+typedef struct VM_Function {
+	int* code;
+	int codeLen;
+	Value* constants;
+	int numConstants;
+	int numParams;
+	int numLocals;
+	int maxStack;
+	//Whether code and constants were allocated by vm_install_function
+	int installed;
+} VM_Function;
+
+//The C function an extern function calls, and the stub that calls it. stub is NULL until the function has been called once
+typedef struct VM_Foreign {
+	void* symbol;
+	FFI_Stub stub;
+} VM_Foreign;
+
+struct VM {
+	Image* image;
+	Value* stack;
+	int sp;
+	Value* globals;
+	int numGlobals;
+	VM_Frame* frames;
+	int numFrames;
+	//Whether each function has been loaded yet
+	unsigned char* loaded;
+	int numLoaded;
+	//The string made for each entry of the string pool of the image, or 0 if it hasn't been made yet
+	Value* strings;
+	GC gc;
+	long long instructions;
+	//Set this after vm_init to profile the program, or leave it NULL
+	VM_Profile* profile;
+	VM_Function* functions;
+	//The constant pool of the image with the string constants turned into strings, filled in as functions are loaded
+	Value* constants;
+	//Set after vm_init to run the functions that aren't loaded some other way, along with whatever that needs
+	VM_Call call;
+	void* callData;
+	VM_Foreign* foreign;
+	FFI_Libraries libraries;
+};
+
+void vm_init(VM* vm, Image* image) {
+	vm->image = image;
+	vm->sp = 0;
+	vm->numGlobals = image->header->numGlobals;
+	vm->numFrames = 0;
+	vm->numLoaded = 0;
+	vm->instructions = 0;
+	vm->profile = NULL;
+	vm->call = NULL;
+	vm->callData = NULL;
+
+	vm->stack = (Value*)mem_alloc(VM_STACK_SIZE * sizeof(Value));
+	vm->globals = (Value*)mem_alloc((vm->numGlobals + 1) * sizeof(Value));
+	vm->frames = (VM_Frame*)mem_alloc(VM_MAX_FRAMES * sizeof(VM_Frame));
+	vm->loaded = (unsigned char*)mem_calloc(image->header->numFunctions, sizeof(unsigned char));
+	vm->strings = (Value*)mem_calloc(image->header->numStrings + 1, sizeof(Value));
+	vm->functions = (VM_Function*)mem_alloc((image->header->numFunctions + 1) * sizeof(VM_Function));
+	vm->constants = (Value*)mem_calloc(image->header->numConstants + 1, sizeof(Value));
+	vm->foreign = (VM_Foreign*)mem_calloc(image->header->numFunctions + 1, sizeof(VM_Foreign));
+
+	if (vm->stack == NULL || vm->globals == NULL || vm->frames == NULL || vm->loaded == NULL || vm->strings == NULL || vm->functions == NULL
+		|| vm->constants == NULL || vm->foreign == NULL) {
+		printf("Failed to allocate memory in vm_init\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < image->header->numFunctions; i++) {
+		Image_Function* fn = &image->functions[i];
+		vm->functions[i] = (VM_Function){ .code = image_function_code(image, i), .codeLen = fn->codeLen, .constants = vm->constants,
+			.numConstants = image->header->numConstants, .numParams = fn->numParams, .numLocals = fn->numLocals, .maxStack = fn->maxStack,
+			.installed = false };
+	}
+
+	for (int i = 0; i < vm->numGlobals; i++) {
+		vm->globals[i] = VALUE_VOID;
+	}
+
+	ffi_libraries_init(&vm->libraries);
+	gc_init(&vm->gc);
+	gc_add_roots(&vm->gc, &vm->stack, &vm->sp);
+	gc_add_roots(&vm->gc, &vm->globals, &vm->numGlobals);
+}
+
+void vm_error(VM* vm, char* message) {
+	printf("Runtime Error: %s\n", message);
+	for (int i = vm->numFrames - 1; i >= 0; i--) {
+		int name = vm->image->functions[vm->frames[i].function].name;
+		printf("    in %s\n", name == -1 ? "<top level>" : image_string(vm->image, name));
+	}
+}
+
+//Checks that every instruction of the function and its operands are in range. constants are the values its constant operands point
+//at as they are in the image or the program, before any strings are made. Returns false if the code is damaged
+int vm_check_function(VM* vm, VM_Function* fn, Value* constants) {
+	int* code = fn->code;
+	int depth = 0;
+
+	for (int i = 0; i < fn->codeLen; i += 1 + bytecode_operands[code[i]]) {
+		if (code[i] < 0 || code[i] >= NUM_BYTECODES || i + bytecode_operands[code[i]] >= fn->codeLen) {
+			return false;
+		}
+
+		for (int k = 0; k < bytecode_operands[code[i]]; k++) {
+			int operand = code[i + 1 + k];
+			switch (bytecode_operand_kinds[code[i]][k]) {
+			case OPERAND_CONSTANT:
+				if (operand < 0 || operand >= fn->numConstants) {
+					return false;
+				}
+				//Only CONST pushes a string constant, so no other instruction can be given one, other than the library of FOREIGN
+				if (value_is_string(constants[operand]) && code[i] != BC_CONST && !(code[i] == BC_FOREIGN && k == 1)) {
+					return false;
+				}
+				break;
+			case OPERAND_LOCAL:
+				if (operand < 0 || operand >= fn->numLocals) {
+					return false;
+				}
+				break;
+			case OPERAND_GLOBAL:
+				if (operand < 0 || operand >= vm->numGlobals) {
+					return false;
+				}
+				break;
+			case OPERAND_FUNCTION:
+				if (operand < 0 || operand >= vm->image->header->numFunctions) {
+					return false;
+				}
+				break;
+			case OPERAND_ARGUMENTS:
+				//The function is always the operand right before this one, so it was already checked
+				if (operand != vm->functions[code[i + k]].numParams) {
+					return false;
+				}
+				break;
+			}
+		}
+
+		//The stub is picked from the signature, so it has to be one there is a stub for, and the stub reads the parameters from the locals
+		if (code[i] == BC_FOREIGN) {
+			Value signature = constants[code[i + 1]];
+			if (!value_is_int(signature) || !value_is_string(constants[code[i + 2]]) || ffi_stub(value_as_int(signature)) == NULL
+				|| bytecode_signature_params(value_as_int(signature)) != fn->numParams) {
+				return false;
+			}
+		}
+
+		//The stack has to stay inside of what the function said it needs, which is what vm_push_frame checks for room against
+		depth += image_stack_effect(code + i);
+		if (depth < 0 || depth > fn->maxStack) {
+			return false;
+		}
+	}
+
+	//Every function ends with a return, so running off the end of the code can't happen
+	if (fn->codeLen == 0 || (code[fn->codeLen - 1] != BC_RETURN && code[fn->codeLen - 1] != BC_RETURN_VOID)) {
+		return false;
+	}
+	return true;
+}
+
+//Checks the code of a function of the image and makes the strings its constants need. Returns false if the code is damaged
+int vm_load_function(VM* vm, int index) {
+	Image* image = vm->image;
+	VM_Function* fn = &vm->functions[index];
+	if (!vm_check_function(vm, fn, image->constants)) {
+		return false;
+	}
+
+	for (int i = 0; i < fn->codeLen; i += 1 + bytecode_operands[fn->code[i]]) {
+		for (int k = 0; k < bytecode_operands[fn->code[i]]; k++) {
+			if (bytecode_operand_kinds[fn->code[i]][k] != OPERAND_CONSTANT) {
+				continue;
+			}
+
+			int operand = fn->code[i + 1 + k];
+			Value val = image->constants[operand];
+			if (value_is_string(val)) {
+				int str = image_constant_string_index(val);
+				if (str < 0 || str >= image->header->numStrings) {
+					return false;
+				}
+
+				if (vm->strings[str] == 0) {
+					string literal = { .str = image_string(image, str), .len = image->strings[str].len, .__size = image->strings[str].len + 1 };
+					vm->strings[str] = gc_string_literal(&vm->gc, &literal);
+				}
+				val = vm->strings[str];
+			}
+			vm->constants[operand] = val;
+		}
+	}
+
+	vm->loaded[index] = true;
+	vm->numLoaded++;
+	return true;
+}
+
+//Gives the VM compiled code to run for a function instead of the code in the image. The code and constants are copied, so the function
+//can be destroyed afterwards. Returns false if the code is damaged
+int vm_install_function(VM* vm, int index, Function* compiled) {
+	VM_Function fn = { .codeLen = compiled->code.len, .numConstants = compiled->constants.len, .numParams = compiled->numParams,
+		.numLocals = compiled->numLocals, .maxStack = image_max_stack(compiled), .installed = true };
+	fn.code = (int*)mem_alloc((fn.codeLen + 1) * sizeof(int));
+	fn.constants = (Value*)mem_alloc((fn.numConstants + 1) * sizeof(Value));
+
+	if (fn.code == NULL || fn.constants == NULL) {
+		printf("Failed to allocate memory in vm_install_function\n");
+		exit(-1);
+	}
+
+	memcpy(fn.code, compiled->code.vec, fn.codeLen * sizeof(int));
+	if (!vm_check_function(vm, &fn, compiled->constants.values)) {
+		mem_free(fn.code);
+		mem_free(fn.constants);
+		return false;
+	}
+
+	//The strings of the program belong to its token list, so they are copied into pinned strings the same way the image strings are
+	for (int i = 0; i < fn.numConstants; i++) {
+		Value val = compiled->constants.values[i];
+		fn.constants[i] = value_is_string(val) ? gc_string_literal(&vm->gc, value_as_string(val)) : val;
+	}
+
+	if (vm->functions[index].installed) {
+		mem_free(vm->functions[index].code);
+		mem_free(vm->functions[index].constants);
+	}
+	vm->functions[index] = fn;
+	if (!vm->loaded[index]) {
+		vm->loaded[index] = true;
+		vm->numLoaded++;
+	}
+	return true;
+}
+
+//Opens the library of an extern function and finds the C function it calls. Returns false if either can't be found
+int vm_resolve_foreign(VM* vm, int index, Value signature, Value library) {
+	char message[512];
+	string* path = value_as_string(library);
+	void* handle = ffi_open(&vm->libraries, path);
+	if (handle == NULL) {
+		snprintf(message, sizeof(message), "Couldn't open the library \"%s\"", path->str);
+		vm_error(vm, message);
+		return false;
+	}
+
+	int name = vm->image->functions[index].name;
+	void* symbol = name == -1 ? NULL : platform_find_symbol(handle, image_string(vm->image, name));
+	if (symbol == NULL) {
+		snprintf(message, sizeof(message), "Couldn't find the extern function %s", name == -1 ? "<top level>" : image_string(vm->image, name));
+		vm_error(vm, message);
+		return false;
+	}
+
+	vm->foreign[index] = (VM_Foreign){ .symbol = symbol, .stub = ffi_stub(value_as_int(signature)) };
+	return true;
+}
+
+//Sets up a frame for the function whose arguments are on top of the stack. Returns false if the function can't be called
+int vm_push_frame(VM* vm, int index) {
+	VM_Function* fn = &vm->functions[index];
+
+	if (!vm->loaded[index] && !vm_load_function(vm, index)) {
+		vm_error(vm, "Function in the image is damaged");
+		return false;
+	}
+
+	if (vm->numFrames >= VM_MAX_FRAMES || vm->sp + fn->numLocals + fn->maxStack >= VM_STACK_SIZE) {
+		vm_error(vm, "Stack overflow");
+		return false;
+	}
+
+	int base = vm->sp - fn->numParams;
+	for (int i = fn->numParams; i < fn->numLocals; i++) {
+		vm->stack[vm->sp++] = VALUE_VOID;
+	}
+
+	vm->frames[vm->numFrames] = (VM_Frame){ .function = index, .ip = 0, .base = base };
+	vm->numFrames++;
+	return true;
+}
+
+//Runs the frame on top until it returns, which is when there are only stop frames left. Returns false if a runtime error stopped the
+//program
+int vm_execute(VM* vm, int stop) {
+	//The state of the current frame is kept in locals while it runs, and only written back to the frame when calling another function
+	VM_Frame* frame = &vm->frames[vm->numFrames - 1];
+	int* code = vm->functions[frame->function].code;
+	Value* constants = vm->functions[frame->function].constants;
+	int ip = frame->ip;
+	Value* locals = vm->stack + frame->base;
+	Value a;
+	Value b;
+
+	while (true) {
+		vm->instructions++;
+		if (vm->profile != NULL) {
+			vm_profile_instruction(vm->profile, frame->function, ip, code[ip]);
+		}
+
+		switch (code[ip]) {
+		case BC_CONST:
+			vm->stack[vm->sp++] = constants[code[ip + 1]];
+			ip += 2;
+			break;
+		case BC_LOAD_LOCAL:
+			a = locals[code[ip + 1]];
+			gc_write_barrier(&vm->gc, a);
+			vm->stack[vm->sp++] = a;
+			ip += 2;
+			break;
+		case BC_STORE_LOCAL:
+			a = vm->stack[--vm->sp];
+			gc_write_barrier(&vm->gc, a);
+			locals[code[ip + 1]] = a;
+			ip += 2;
+			break;
+		case BC_LOAD_GLOBAL:
+			a = vm->globals[code[ip + 1]];
+			gc_write_barrier(&vm->gc, a);
+			vm->stack[vm->sp++] = a;
+			ip += 2;
+			break;
+		case BC_STORE_GLOBAL:
+			a = vm->stack[--vm->sp];
+			gc_write_barrier(&vm->gc, a);
+			vm->globals[code[ip + 1]] = a;
+			ip += 2;
+			break;
+		case BC_INT_ADD:
+			b = vm->stack[--vm->sp];
+			vm->stack[vm->sp - 1] = value_int_add(vm->stack[vm->sp - 1], b);
+			ip++;
+			break;
+		case BC_INT_SUBTRACT:
+			b = vm->stack[--vm->sp];
+			vm->stack[vm->sp - 1] = value_int_subtract(vm->stack[vm->sp - 1], b);
+			ip++;
+			break;
+		case BC_INT_MULTIPLY:
+			b = vm->stack[--vm->sp];
+			vm->stack[vm->sp - 1] = value_int_multiply(vm->stack[vm->sp - 1], b);
+			ip++;
+			break;
+		case BC_INT_DIVIDE:
+			b = vm->stack[--vm->sp];
+			vm->stack[vm->sp - 1] = value_int_divide(vm->stack[vm->sp - 1], b);
+			ip++;
+			break;
+		case BC_FLOAT_ADD:
+			b = vm->stack[--vm->sp];
+			vm->stack[vm->sp - 1] = value_float_add(vm->stack[vm->sp - 1], b);
+			ip++;
+			break;
+		case BC_FLOAT_SUBTRACT:
+			b = vm->stack[--vm->sp];
+			vm->stack[vm->sp - 1] = value_float_subtract(vm->stack[vm->sp - 1], b);
+			ip++;
+			break;
+		case BC_FLOAT_MULTIPLY:
+			b = vm->stack[--vm->sp];
+			vm->stack[vm->sp - 1] = value_float_multiply(vm->stack[vm->sp - 1], b);
+			ip++;
+			break;
+		case BC_FLOAT_DIVIDE:
+			b = vm->stack[--vm->sp];
+			vm->stack[vm->sp - 1] = value_float_divide(vm->stack[vm->sp - 1], b);
+			ip++;
+			break;
+		case BC_STRING_CONCAT:
+			//Both strings stay on the stack until the new one exists, since making it can run the collector
+			a = gc_string_concat(&vm->gc, vm->stack[vm->sp - 2], vm->stack[vm->sp - 1]);
+			vm->sp--;
+			vm->stack[vm->sp - 1] = a;
+			ip++;
+			break;
+		case BC_CALL:
+			frame->ip = ip + 3;
+			//The frames never move, so frame and code are still good after running the call somewhere else
+			if (!vm->loaded[code[ip + 1]] && vm->call != NULL) {
+				if (!vm->call(vm, code[ip + 1])) {
+					return false;
+				}
+				ip += 3;
+				break;
+			}
+
+			if (!vm_push_frame(vm, code[ip + 1])) {
+				return false;
+			}
+
+			frame = &vm->frames[vm->numFrames - 1];
+			code = vm->functions[frame->function].code;
+			constants = vm->functions[frame->function].constants;
+			ip = 0;
+			locals = vm->stack + frame->base;
+			if (vm->profile != NULL) {
+				vm_profile_enter(vm->profile, frame->function);
+			}
+			break;
+		case BC_RETURN:
+		case BC_RETURN_VOID:
+			a = code[ip] == BC_RETURN ? vm->stack[vm->sp - 1] : VALUE_VOID;
+			gc_write_barrier(&vm->gc, a);
+			vm->sp = frame->base;
+			vm->numFrames--;
+			if (vm->profile != NULL) {
+				vm_profile_leave(vm->profile);
+			}
+
+			//Returning from the top level statements is the end of the program, and it leaves nothing on the stack. Any other function
+			//can be called with no frames under it once the program has finished, which is how other modules call into this one
+			if (vm->numFrames == 0 && frame->function == 0) {
+				return true;
+			}
+
+			vm->stack[vm->sp++] = a;
+			if (vm->numFrames == stop) {
+				return true;
+			}
+
+			frame = &vm->frames[vm->numFrames - 1];
+			code = vm->functions[frame->function].code;
+			constants = vm->functions[frame->function].constants;
+			ip = frame->ip;
+			locals = vm->stack + frame->base;
+			break;
+		case BC_POP:
+			vm->sp--;
+			ip++;
+			break;
+		case BC_INT_ADD_CONST:
+			vm->stack[vm->sp - 1] = value_int_add(vm->stack[vm->sp - 1], constants[code[ip + 1]]);
+			ip += 2;
+			break;
+		case BC_INT_SUBTRACT_CONST:
+			vm->stack[vm->sp - 1] = value_int_subtract(vm->stack[vm->sp - 1], constants[code[ip + 1]]);
+			ip += 2;
+			break;
+		case BC_INT_MULTIPLY_CONST:
+			vm->stack[vm->sp - 1] = value_int_multiply(vm->stack[vm->sp - 1], constants[code[ip + 1]]);
+			ip += 2;
+			break;
+		case BC_INT_DIVIDE_CONST:
+			vm->stack[vm->sp - 1] = value_int_divide(vm->stack[vm->sp - 1], constants[code[ip + 1]]);
+			ip += 2;
+			break;
+		case BC_FLOAT_ADD_CONST:
+			vm->stack[vm->sp - 1] = value_float_add(vm->stack[vm->sp - 1], constants[code[ip + 1]]);
+			ip += 2;
+			break;
+		case BC_FLOAT_SUBTRACT_CONST:
+			vm->stack[vm->sp - 1] = value_float_subtract(vm->stack[vm->sp - 1], constants[code[ip + 1]]);
+			ip += 2;
+			break;
+		case BC_FLOAT_MULTIPLY_CONST:
+			vm->stack[vm->sp - 1] = value_float_multiply(vm->stack[vm->sp - 1], constants[code[ip + 1]]);
+			ip += 2;
+			break;
+		case BC_FLOAT_DIVIDE_CONST:
+			vm->stack[vm->sp - 1] = value_float_divide(vm->stack[vm->sp - 1], constants[code[ip + 1]]);
+			ip += 2;
+			break;
+		case BC_LOAD_LOCAL_2:
+			a = locals[code[ip + 1]];
+			b = locals[code[ip + 2]];
+			gc_write_barrier(&vm->gc, a);
+			gc_write_barrier(&vm->gc, b);
+			vm->stack[vm->sp] = a;
+			vm->stack[vm->sp + 1] = b;
+			vm->sp += 2;
+			ip += 3;
+			break;
+		case BC_LOAD_GLOBAL_2:
+			a = vm->globals[code[ip + 1]];
+			b = vm->globals[code[ip + 2]];
+			gc_write_barrier(&vm->gc, a);
+			gc_write_barrier(&vm->gc, b);
+			vm->stack[vm->sp] = a;
+			vm->stack[vm->sp + 1] = b;
+			vm->sp += 2;
+			ip += 3;
+			break;
+		//These two only ever work on ints, which the collector doesn't need to hear about
+		case BC_LOCAL_INT_ADD_CONST:
+			vm->stack[vm->sp++] = value_int_add(locals[code[ip + 1]], constants[code[ip + 2]]);
+			ip += 3;
+			break;
+		case BC_INCREMENT_LOCAL:
+			locals[code[ip + 1]] = value_int_add(locals[code[ip + 1]], constants[code[ip + 2]]);
+			ip += 3;
+			break;
+		case BC_STORE_LOCAL_KEEP:
+			a = vm->stack[vm->sp - 1];
+			gc_write_barrier(&vm->gc, a);
+			locals[code[ip + 1]] = a;
+			ip += 2;
+			break;
+		case BC_STORE_GLOBAL_KEEP:
+			a = vm->stack[vm->sp - 1];
+			gc_write_barrier(&vm->gc, a);
+			vm->globals[code[ip + 1]] = a;
+			ip += 2;
+			break;
+		//The arguments are the locals of the extern function, so they stay on the stack while a string the stub returns is made
+		case BC_FOREIGN:
+			if (vm->foreign[frame->function].stub == NULL
+				&& !vm_resolve_foreign(vm, frame->function, constants[code[ip + 1]], constants[code[ip + 2]])) {
+				return false;
+			}
+			a = vm->foreign[frame->function].stub(&vm->gc, vm->foreign[frame->function].symbol, locals);
+			vm->stack[vm->sp++] = a;
+			ip += 3;
+			break;
+		}
+	}
+}
+
+//Calls the function whose arguments are on top of the stack and runs it until it returns, leaving its return value in place of the
+//arguments. Returns false if a runtime error stopped the program
+int vm_call(VM* vm, int index) {
+	int stop = vm->numFrames;
+	if (!vm_push_frame(vm, index)) {
+		return false;
+	}
+	if (vm->profile != NULL) {
+		vm_profile_enter(vm->profile, index);
+	}
+	return vm_execute(vm, stop);
+}
+
+//Runs the top level statements of the image, which sets every global. Returns false if a runtime error stopped the program
+int vm_run(VM* vm) {
+	return vm_call(vm, 0);
+}
+
+//Prints the value of every global variable, which is the only output a program has for now
+void vm_print_globals(VM* vm) {
+	for (int i = 0; i < vm->numGlobals; i++) {
+		printf("%s = ", image_string(vm->image, vm->image->globals[i]));
+		value_print(vm->globals[i]);
+		printf("\n");
+	}
+}
+
+void vm_destroy(VM* vm) {
+	gc_destroy(&vm->gc);
+	mem_free(vm->stack);
+	mem_free(vm->globals);
+	mem_free(vm->frames);
+	mem_free(vm->loaded);
+	mem_free(vm->strings);
+	for (int i = 0; i < vm->image->header->numFunctions; i++) {
+		if (vm->functions[i].installed) {
+			mem_free(vm->functions[i].code);
+			mem_free(vm->functions[i].constants);
+		}
+	}
+	mem_free(vm->functions);
+	mem_free(vm->constants);
+	mem_free(vm->foreign);
+	ffi_libraries_destroy(&vm->libraries);
+	vm->functions = NULL;
+	vm->constants = NULL;
+	vm->foreign = NULL;
+	vm->stack = NULL;
+	vm->globals = NULL;
+	vm->frames = NULL;
+	vm->loaded = NULL;
+	vm->strings = NULL;
+}
+
+#endif
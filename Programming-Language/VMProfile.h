@@ -0,0 +1,534 @@
+#ifndef VMPROFILE_H
+#define VMPROFILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "Platform.h"
+#include "Strings.h"
+#include "Lexer.h"
+#include "Bytecode.h"
+#include "Image.h"
+#include <stdbool.h>
+
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+//This header file contains the profiler for programs running on the virtual machine (Profiler.h is the one for the compiler)
+//
+//A VM only profiles when it is given a VM_Profile, and otherwise the only cost is a check of a pointer on every instruction. While
+//profiling, every instruction that runs is counted, both by its opcode and by the opcode that ran right before it, and by where it
+//is in the code of its function so that the counts can be added up by source line afterwards. Every call records when it started,
+//and when it returns the time is added to the function it called. The time of a call without the time of the calls it made in turn
+//is its self time, and the self time of every call is also added to the stack of functions it was called through, which is what
+//the collapsed stack file is made out of
+//
+//Sampling is optional. A SIGPROF timer goes off every so often while the process is using the CPU, and the signal handler only sets
+//a flag, since almost nothing is safe to do inside of a signal handler. The next instruction to run sees the flag and charges the
+//sample to itself, its line, and the stack of functions it is in. Samples are the only way to get time per line, since reading the
+//clock on every instruction would cost more than running the instructions does. Windows doesn't have SIGPROF, so there it can only
+//count and time calls
+//
+//A function that calls itself has the time of the inner calls counted in its total time more than once, the same as in gprof
+
+//How many rows of each table the flat profile prints
+#define VM_PROFILE_TOP 20
+
+//Set by the SIGPROF handler, and cleared when the sample is taken
+volatile sig_atomic_t vm_profile_sample_due = 0;
+
+typedef struct VM_Profile_Function {
+	long long calls;
+	long long selfNs;
+	long long totalNs;
+	long long instructions;
+	long long samples;
+	//For every int of the code of the function, how many times the instruction starting there ran and how many samples it got
+	long long* counts;
+	long long* sampleCounts;
+	int codeLen;
+} VM_Profile_Function;
+
+//A call that hasn't returned yet
+typedef struct VM_Profile_Frame {
+	int function;
+	long long entered;
+	//The total time of the calls it made that already returned
+	long long childNs;
+} VM_Profile_Frame;
+
+//One stack of functions for the collapsed stack file
+typedef struct VM_Profile_Stack {
+	unsigned long long hash;
+	//Where the functions of the stack start in stackFunctions, from the outermost call in
+	int offset;
+	int depth;
+	long long samples;
+	long long selfNs;
+} VM_Profile_Stack;
+
+typedef struct VM_Profile {
+	long long opcodes[NUM_BYTECODES];
+	long long pairs[NUM_BYTECODES][NUM_BYTECODES];
+	//The opcode of the last instruction that ran, or -1 before the first one
+	int lastOpcode;
+	long long instructions;
+	long long samples;
+	//How often to take a sample in microseconds, or 0 to not take samples
+	int sampleUs;
+	long long startNs;
+	long long ns;
+	VM_Profile_Function* functions;
+	int numFunctions;
+	VM_Profile_Frame* frames;
+	int numFrames;
+	int __framesSize;
+	VM_Profile_Stack* stacks;
+	int numStacks;
+	int __stacksSize;
+	Vector_Int stackFunctions;
+	//Open addressing table of indices into stacks, with -1 for an empty slot. Always a power of 2 in size
+	int* table;
+	int tableSize;
+#ifndef _WIN32
+	struct sigaction savedAction;
+#endif
+} VM_Profile;
+
+void vm_profile_init(VM_Profile* profile, Image* image, int sampleUs) {
+	memset(profile, 0, sizeof(VM_Profile));
+	profile->lastOpcode = -1;
+	profile->sampleUs = sampleUs;
+	profile->numFunctions = image->header->numFunctions;
+	profile->functions = (VM_Profile_Function*)mem_calloc(profile->numFunctions + 1, sizeof(VM_Profile_Function));
+	profile->__framesSize = 16;
+	profile->frames = (VM_Profile_Frame*)mem_alloc(profile->__framesSize * sizeof(VM_Profile_Frame));
+	profile->__stacksSize = 16;
+	profile->stacks = (VM_Profile_Stack*)mem_alloc(profile->__stacksSize * sizeof(VM_Profile_Stack));
+	profile->tableSize = 64;
+	profile->table = (int*)mem_alloc(profile->tableSize * sizeof(int));
+	Vector_Int_Init(&profile->stackFunctions);
+
+	if (profile->functions == NULL || profile->frames == NULL || profile->stacks == NULL || profile->table == NULL) {
+		printf("Failed to allocate memory in vm_profile_init\n");
+		exit(-1);
+	}
+
+	for (int i = 0; i < profile->tableSize; i++) {
+		profile->table[i] = -1;
+	}
+
+	for (int i = 0; i < profile->numFunctions; i++) {
+		VM_Profile_Function* fn = &profile->functions[i];
+		fn->codeLen = image->functions[i].codeLen;
+		fn->counts = (long long*)mem_calloc(fn->codeLen + 1, sizeof(long long));
+		fn->sampleCounts = (long long*)mem_calloc(fn->codeLen + 1, sizeof(long long));
+
+		if (fn->counts == NULL || fn->sampleCounts == NULL) {
+			printf("Failed to allocate memory in vm_profile_init\n");
+			exit(-1);
+		}
+	}
+}
+
+void vm_profile_destroy(VM_Profile* profile) {
+	for (int i = 0; i < profile->numFunctions; i++) {
+		mem_free(profile->functions[i].counts);
+		mem_free(profile->functions[i].sampleCounts);
+	}
+	mem_free(profile->functions);
+	mem_free(profile->frames);
+	mem_free(profile->stacks);
+	mem_free(profile->table);
+	Vector_Int_Destroy(&profile->stackFunctions);
+	profile->functions = NULL;
+	profile->numFunctions = 0;
+}
+
+#ifndef _WIN32
+void vm_profile_signal(int signal) {
+	(void)signal;
+	vm_profile_sample_due = 1;
+}
+#endif
+
+//Starts the clock, and the sampling timer if there is one
+void vm_profile_start(VM_Profile* profile) {
+	profile->startNs = platform_time_ns();
+	vm_profile_sample_due = 0;
+
+	if (profile->sampleUs <= 0) {
+		return;
+	}
+
+#ifdef _WIN32
+	printf("Sampling needs SIGPROF, which Windows doesn't have, so only the counts and the times of calls will be profiled\n");
+	profile->sampleUs = 0;
+#else
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = vm_profile_signal;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGPROF, &action, &profile->savedAction);
+
+	struct itimerval timer;
+	timer.it_interval.tv_sec = profile->sampleUs / 1000000;
+	timer.it_interval.tv_usec = profile->sampleUs % 1000000;
+	timer.it_value = timer.it_interval;
+	setitimer(ITIMER_PROF, &timer, NULL);
+#endif
+}
+
+//Adds the sample or the self time to the stack of functions that are running right now
+void vm_profile_add_stack(VM_Profile* profile, long long samples, long long selfNs) {
+	//FNV-1a over the function indices
+	unsigned long long hash = 14695981039346656037ULL;
+	for (int i = 0; i < profile->numFrames; i++) {
+		hash = (hash ^ (unsigned long long)profile->frames[i].function) * 1099511628211ULL;
+	}
+
+	int mask = profile->tableSize - 1;
+	int slot = (int)(hash & mask);
+	while (profile->table[slot] != -1) {
+		VM_Profile_Stack* stack = &profile->stacks[profile->table[slot]];
+		if (stack->hash == hash && stack->depth == profile->numFrames) {
+			int same = true;
+			for (int i = 0; i < stack->depth && same; i++) {
+				same = profile->stackFunctions.vec[stack->offset + i] == profile->frames[i].function;
+			}
+			if (same) {
+				stack->samples += samples;
+				stack->selfNs += selfNs;
+				return;
+			}
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	if (profile->numStacks + 1 >= profile->__stacksSize) {
+		profile->__stacksSize *= 2;
+		VM_Profile_Stack* temp = (VM_Profile_Stack*)mem_realloc(profile->stacks, profile->__stacksSize * sizeof(VM_Profile_Stack));
+		if (temp == NULL) {
+			printf("Failed to allocate memory in vm_profile_add_stack\n");
+			exit(-1);
+		}
+		profile->stacks = temp;
+	}
+
+	VM_Profile_Stack* stack = &profile->stacks[profile->numStacks];
+	stack->hash = hash;
+	stack->offset = profile->stackFunctions.len;
+	stack->depth = profile->numFrames;
+	stack->samples = samples;
+	stack->selfNs = selfNs;
+	for (int i = 0; i < profile->numFrames; i++) {
+		Vector_Int_Append(&profile->stackFunctions, profile->frames[i].function);
+	}
+	profile->table[slot] = profile->numStacks;
+	profile->numStacks++;
+
+	//The table is kept at most half full, and rebuilt twice as big when it gets there
+	if (profile->numStacks * 2 >= profile->tableSize) {
+		mem_free(profile->table);
+		profile->tableSize *= 2;
+		profile->table = (int*)mem_alloc(profile->tableSize * sizeof(int));
+		if (profile->table == NULL) {
+			printf("Failed to allocate memory in vm_profile_add_stack\n");
+			exit(-1);
+		}
+
+		mask = profile->tableSize - 1;
+		for (int i = 0; i < profile->tableSize; i++) {
+			profile->table[i] = -1;
+		}
+		for (int i = 0; i < profile->numStacks; i++) {
+			slot = (int)(profile->stacks[i].hash & mask);
+			while (profile->table[slot] != -1) {
+				slot = (slot + 1) & mask;
+			}
+			profile->table[slot] = i;
+		}
+	}
+}
+
+//Called by the VM right after it pushes the frame of a call
+void vm_profile_enter(VM_Profile* profile, int function) {
+	if (profile->numFrames + 1 >= profile->__framesSize) {
+		profile->__framesSize *= 2;
+		VM_Profile_Frame* temp = (VM_Profile_Frame*)mem_realloc(profile->frames, profile->__framesSize * sizeof(VM_Profile_Frame));
+		if (temp == NULL) {
+			printf("Failed to allocate memory in vm_profile_enter\n");
+			exit(-1);
+		}
+		profile->frames = temp;
+	}
+
+	profile->functions[function].calls++;
+	profile->frames[profile->numFrames] = (VM_Profile_Frame){ .function = function, .entered = platform_time_ns(), .childNs = 0 };
+	profile->numFrames++;
+}
+
+//Called by the VM right before it pops the frame of a call
+void vm_profile_leave(VM_Profile* profile) {
+	VM_Profile_Frame* frame = &profile->frames[profile->numFrames - 1];
+	long long totalNs = platform_time_ns() - frame->entered;
+	long long selfNs = totalNs - frame->childNs;
+
+	profile->functions[frame->function].totalNs += totalNs;
+	profile->functions[frame->function].selfNs += selfNs;
+	vm_profile_add_stack(profile, 0, selfNs);
+
+	profile->numFrames--;
+	if (profile->numFrames > 0) {
+		profile->frames[profile->numFrames - 1].childNs += totalNs;
+	}
+}
+
+//Called by the VM before it runs each instruction
+static inline void vm_profile_instruction(VM_Profile* profile, int function, int ip, int opcode) {
+	VM_Profile_Function* fn = &profile->functions[function];
+	profile->instructions++;
+	profile->opcodes[opcode]++;
+	if (profile->lastOpcode != -1) {
+		profile->pairs[profile->lastOpcode][opcode]++;
+	}
+	profile->lastOpcode = opcode;
+	fn->instructions++;
+	fn->counts[ip]++;
+
+	if (vm_profile_sample_due) {
+		vm_profile_sample_due = 0;
+		profile->samples++;
+		fn->samples++;
+		fn->sampleCounts[ip]++;
+		vm_profile_add_stack(profile, 1, 0);
+	}
+}
+
+//Stops the sampling timer and the clock. Calls that never returned because of a runtime error are ended here
+void vm_profile_stop(VM_Profile* profile) {
+#ifndef _WIN32
+	if (profile->sampleUs > 0) {
+		struct itimerval timer;
+		memset(&timer, 0, sizeof(timer));
+		setitimer(ITIMER_PROF, &timer, NULL);
+		sigaction(SIGPROF, &profile->savedAction, NULL);
+	}
+#endif
+
+	while (profile->numFrames > 0) {
+		vm_profile_leave(profile);
+	}
+	profile->ns = platform_time_ns() - profile->startNs;
+}
+
+char* vm_profile_function_name(Image* image, int function) {
+	int name = image->functions[function].name;
+	return name == -1 ? "<top level>" : image_string(image, name);
+}
+
+typedef struct VM_Profile_Row {
+	int index;
+	long long key;
+} VM_Profile_Row;
+
+//Biggest first, and in index order when they are the same
+int vm_profile_compare_rows(const void* a, const void* b) {
+	const VM_Profile_Row* x = (const VM_Profile_Row*)a;
+	const VM_Profile_Row* y = (const VM_Profile_Row*)b;
+	if (x->key != y->key) {
+		return x->key > y->key ? -1 : 1;
+	}
+	return x->index - y->index;
+}
+
+//Makes a row for every index with a key that isn't 0 and sorts them. Returns how many rows there are
+int vm_profile_sort_rows(VM_Profile_Row* rows, long long* keys, int len) {
+	int numRows = 0;
+	for (int i = 0; i < len; i++) {
+		if (keys[i] != 0) {
+			rows[numRows] = (VM_Profile_Row){ .index = i, .key = keys[i] };
+			numRows++;
+		}
+	}
+	qsort(rows, numRows, sizeof(VM_Profile_Row), vm_profile_compare_rows);
+	return numRows;
+}
+
+//Prints the instructions and samples of each source line. The lines come from the statement every instruction was compiled from,
+//so this needs the program the image was made from, the positions of its tokens from lexer_scan, and the source they point into
+void vm_profile_print_lines(VM_Profile* profile, Program* program, tokenList* list, Vector_Int* positions, string* source) {
+	if (positions->len != list->len * 2) {
+		printf("Lines: the positions of the tokens aren't known\n");
+		return;
+	}
+
+	int numLines = 1;
+	for (int i = 0; i < source->len; i++) {
+		numLines += source->str[i] == '\n';
+	}
+
+	//The line of every token (from 0), and where every line starts. The tokens are in the order they are in the source, so a single
+	//pass over both works
+	int* tokenLines = (int*)mem_alloc((list->len + 1) * sizeof(int));
+	int* lineStarts = (int*)mem_alloc((numLines + 1) * sizeof(int));
+	long long* counts = (long long*)mem_calloc(numLines + 1, sizeof(long long));
+	long long* samples = (long long*)mem_calloc(numLines + 1, sizeof(long long));
+	VM_Profile_Row* rows = (VM_Profile_Row*)mem_alloc((numLines + 1) * sizeof(VM_Profile_Row));
+
+	if (tokenLines == NULL || lineStarts == NULL || counts == NULL || samples == NULL || rows == NULL) {
+		printf("Failed to allocate memory in vm_profile_print_lines\n");
+		exit(-1);
+	}
+
+	int line = 0;
+	int pos = 0;
+	lineStarts[0] = 0;
+	for (int i = 0; i < list->len; i++) {
+		for (; pos < positions->vec[i * 2] && pos < source->len; pos++) {
+			if (source->str[pos] == '\n') {
+				line++;
+				lineStarts[line] = pos + 1;
+			}
+		}
+		tokenLines[i] = line;
+	}
+	for (; pos < source->len; pos++) {
+		if (source->str[pos] == '\n') {
+			line++;
+			lineStarts[line] = pos + 1;
+		}
+	}
+
+	int known = true;
+	for (int i = 0; i < profile->numFunctions && i < program->numFunctions; i++) {
+		Function* fn = &program->functions[i];
+		VM_Profile_Function* counted = &profile->functions[i];
+		if (counted->instructions == 0) {
+			continue;
+		}
+		if (fn->origins.len != fn->code.len || fn->code.len != counted->codeLen) {
+			known = false;
+			continue;
+		}
+
+		for (int j = 0; j < fn->code.len; j += 1 + bytecode_operands[fn->code.vec[j]]) {
+			int origin = fn->origins.vec[j];
+			//The return at the end of a function counts as the line the function starts on
+			if (origin == -1) {
+				origin = fn->token_index;
+			}
+			int at = origin >= 0 && origin < list->len ? tokenLines[origin] : numLines;
+			counts[at] += counted->counts[j];
+			samples[at] += counted->sampleCounts[j];
+		}
+	}
+
+	int numRows = vm_profile_sort_rows(rows, counts, numLines);
+	printf("\nLines%s\n", known ? "" : " (some functions were missing where their code came from)");
+	printf("  %6s %14s %9s  %s\n", "line", "instructions", "samples", "source");
+	for (int i = 0; i < numRows && i < VM_PROFILE_TOP; i++) {
+		int at = rows[i].index;
+		int start = lineStarts[at];
+		int end = start;
+		while (end < source->len && source->str[end] != '\n') {
+			end++;
+		}
+		while (start < end && source->str[start] == ' ') {
+			start++;
+		}
+		int len = end - start > 60 ? 60 : end - start;
+		printf("  %6d %14lld %9lld  %.*s\n", at + 1, counts[at], samples[at], len, source->str + start);
+	}
+	if (counts[numLines] > 0) {
+		printf("  %6s %14lld %9lld\n", "?", counts[numLines], samples[numLines]);
+	}
+
+	mem_free(tokenLines);
+	mem_free(lineStarts);
+	mem_free(counts);
+	mem_free(samples);
+	mem_free(rows);
+}
+
+//Prints the flat profile. If program is NULL the lines are left out
+void vm_profile_print(VM_Profile* profile, Image* image, char* title, Program* program, tokenList* list, Vector_Int* positions,
+	string* source) {
+	printf("\nProfile of %s: %lld instructions in %.3f ms", title, profile->instructions, profile->ns / 1000000.0);
+	if (profile->sampleUs > 0) {
+		printf(", %lld samples every %d us", profile->samples, profile->sampleUs);
+	}
+	printf("\n");
+
+	int numRows = profile->numFunctions > NUM_BYTECODES * NUM_BYTECODES ? profile->numFunctions : NUM_BYTECODES * NUM_BYTECODES;
+	VM_Profile_Row* rows = (VM_Profile_Row*)mem_alloc(numRows * sizeof(VM_Profile_Row));
+	long long* keys = (long long*)mem_alloc(numRows * sizeof(long long));
+
+	if (rows == NULL || keys == NULL) {
+		printf("Failed to allocate memory in vm_profile_print\n");
+		exit(-1);
+	}
+
+	//Functions by self time
+	for (int i = 0; i < profile->numFunctions; i++) {
+		keys[i] = profile->functions[i].calls > 0 ? profile->functions[i].selfNs + 1 : 0;
+	}
+	numRows = vm_profile_sort_rows(rows, keys, profile->numFunctions);
+	printf("\nFunctions\n");
+	printf("  %-24s %10s %10s %10s %14s %9s\n", "name", "calls", "self ms", "total ms", "instructions", "samples");
+	for (int i = 0; i < numRows && i < VM_PROFILE_TOP; i++) {
+		VM_Profile_Function* fn = &profile->functions[rows[i].index];
+		printf("  %-24.24s %10lld %10.3f %10.3f %14lld %9lld\n", vm_profile_function_name(image, rows[i].index), fn->calls,
+			fn->selfNs / 1000000.0, fn->totalNs / 1000000.0, fn->instructions, fn->samples);
+	}
+
+	if (program != NULL) {
+		vm_profile_print_lines(profile, program, list, positions, source);
+	}
+
+	numRows = vm_profile_sort_rows(rows, profile->opcodes, NUM_BYTECODES);
+	printf("\nOpcodes\n");
+	for (int i = 0; i < numRows; i++) {
+		printf("  %-24s %14lld %6.1f%%\n", bytecode_names[rows[i].index], rows[i].key, 100.0 * rows[i].key / profile->instructions);
+	}
+
+	long long pairs = profile->instructions > 1 ? profile->instructions - 1 : 1;
+	numRows = vm_profile_sort_rows(rows, &profile->pairs[0][0], NUM_BYTECODES * NUM_BYTECODES);
+	printf("\nOpcode pairs\n");
+	for (int i = 0; i < numRows && i < VM_PROFILE_TOP; i++) {
+		int first = rows[i].index / NUM_BYTECODES;
+		int second = rows[i].index % NUM_BYTECODES;
+		printf("  %-20s %-20s %14lld %6.1f%%\n", bytecode_names[first], bytecode_names[second], rows[i].key, 100.0 * rows[i].key / pairs);
+	}
+
+	mem_free(rows);
+	mem_free(keys);
+}
+
+//Writes every stack in the collapsed format the flame graph tools read, which is one line per stack with the functions from the
+//outermost call in separated by semicolons, then a space and a weight. The weight is the number of samples when there are samples,
+//and otherwise the self time in microseconds. Every stack starts with root, so the stacks of several programs can go in one file
+void vm_profile_write_collapsed(VM_Profile* profile, Image* image, char* root, FILE* fptr) {
+	int useSamples = profile->samples > 0;
+	for (int i = 0; i < profile->numStacks; i++) {
+		VM_Profile_Stack* stack = &profile->stacks[i];
+		long long weight = useSamples ? stack->samples : stack->selfNs / 1000;
+		if (weight <= 0) {
+			continue;
+		}
+
+		//A space or a semicolon in the root would be read as the end of the stack or of a function
+		for (int j = 0; root[j] != '\0'; j++) {
+			fputc(root[j] == ' ' || root[j] == ';' ? '_' : root[j], fptr);
+		}
+		for (int j = 0; j < stack->depth; j++) {
+			fprintf(fptr, ";%s", vm_profile_function_name(image, profile->stackFunctions.vec[stack->offset + j]));
+		}
+		fprintf(fptr, " %lld\n", weight);
+	}
+}
+
+#endif
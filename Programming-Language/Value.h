@@ -0,0 +1,176 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Strings.h"
+#include "Lexer.h"
+#include <stdbool.h>
+
+//This header file contains the representation of values while a program is running
+//
+//Every value fits into a single 64 bit integer using NaN-boxing. A double is stored as is, and since a quiet NaN only needs
+//a few of the bits of a double to be set, the rest of the bits of a quiet NaN are free to hold everything else. The top bits
+//after the quiet NaN bits hold a tag saying what kind of value it is, and the bottom 48 bits hold the payload, which is enough
+//for an int, a pointer on any current 64 bit platform, or an index into the function table
+//
+//Layout of a boxed (non float) value:
+//  bit 63      | bits 62-50     | bits 49-48 | bits 47-0
+//  always 1    | quiet NaN bits | tag        | payload
+//
+//The tags are 0 for an int, 1 for a string, 2 for a function, and 3 for void
+typedef unsigned long long Value;
+
+#define VALUE_QNAN ((Value)0xFFFC000000000000ULL)
+#define VALUE_TAG_MASK ((Value)0xFFFF000000000000ULL)
+#define VALUE_PAYLOAD_MASK ((Value)0x0000FFFFFFFFFFFFULL)
+
+#define VALUE_TAG_INT ((Value)0x0000000000000000ULL)
+#define VALUE_TAG_STRING ((Value)0x0001000000000000ULL)
+#define VALUE_TAG_FUNCTION ((Value)0x0002000000000000ULL)
+#define VALUE_TAG_VOID ((Value)0x0003000000000000ULL)
+
+//Since the sign bit is part of the boxed tag, any NaN a float operation produces could look like a boxed value, so every NaN is
+//replaced with this one, which has the sign bit clear
+#define VALUE_CANONICAL_NAN ((Value)0x7FF8000000000000ULL)
+
+#define VALUE_VOID (VALUE_QNAN | VALUE_TAG_VOID)
+
+static inline int value_is_float(Value val) {
+	return (val & VALUE_QNAN) != VALUE_QNAN;
+}
+
+static inline int value_is_int(Value val) {
+	return (val & VALUE_TAG_MASK) == (VALUE_QNAN | VALUE_TAG_INT);
+}
+
+static inline int value_is_string(Value val) {
+	return (val & VALUE_TAG_MASK) == (VALUE_QNAN | VALUE_TAG_STRING);
+}
+
+static inline int value_is_function(Value val) {
+	return (val & VALUE_TAG_MASK) == (VALUE_QNAN | VALUE_TAG_FUNCTION);
+}
+
+static inline int value_is_void(Value val) {
+	return val == VALUE_VOID;
+}
+
+static inline Value value_from_float(double num) {
+	Value val;
+	if (num != num) {
+		return VALUE_CANONICAL_NAN;
+	}
+	memcpy(&val, &num, sizeof(double));
+	return val;
+}
+
+//ints are 32 bits, which means they are stored sign extended into the payload so that getting them back out is just a cast
+static inline Value value_from_int(int num) {
+	return VALUE_QNAN | VALUE_TAG_INT | ((Value)(long long)num & VALUE_PAYLOAD_MASK);
+}
+
+static inline Value value_from_string(string* str) {
+	return VALUE_QNAN | VALUE_TAG_STRING | ((Value)str & VALUE_PAYLOAD_MASK);
+}
+
+//Function values are indices into the function table of whatever is running the program
+static inline Value value_from_function(int index) {
+	return VALUE_QNAN | VALUE_TAG_FUNCTION | ((Value)index & VALUE_PAYLOAD_MASK);
+}
+
+static inline double value_as_float(Value val) {
+	double num;
+	memcpy(&num, &val, sizeof(double));
+	return num;
+}
+
+static inline int value_as_int(Value val) {
+	return (int)(val & 0xFFFFFFFFULL);
+}
+
+static inline string* value_as_string(Value val) {
+	return (string*)(val & VALUE_PAYLOAD_MASK);
+}
+
+static inline int value_as_function(Value val) {
+	return (int)(val & VALUE_PAYLOAD_MASK);
+}
+
+//These are the fast paths for when the type checker already knows the type of both operands, so they do no checks at all
+//Int arithmetic wraps around the same way it would for a 32 bit int in c
+static inline Value value_int_add(Value a, Value b) {
+	return value_from_int((int)((unsigned int)value_as_int(a) + (unsigned int)value_as_int(b)));
+}
+
+static inline Value value_int_subtract(Value a, Value b) {
+	return value_from_int((int)((unsigned int)value_as_int(a) - (unsigned int)value_as_int(b)));
+}
+
+static inline Value value_int_multiply(Value a, Value b) {
+	return value_from_int((int)((unsigned int)value_as_int(a) * (unsigned int)value_as_int(b)));
+}
+
+//Division by zero gives 0 instead of crashing the whole program, since there is no way to report runtime errors yet
+static inline Value value_int_divide(Value a, Value b) {
+	if (value_as_int(b) == 0 || (value_as_int(a) == -2147483647 - 1 && value_as_int(b) == -1)) {
+		return value_from_int(0);
+	}
+	return value_from_int(value_as_int(a) / value_as_int(b));
+}
+
+static inline Value value_float_add(Value a, Value b) {
+	return value_from_float(value_as_float(a) + value_as_float(b));
+}
+
+static inline Value value_float_subtract(Value a, Value b) {
+	return value_from_float(value_as_float(a) - value_as_float(b));
+}
+
+static inline Value value_float_multiply(Value a, Value b) {
+	return value_from_float(value_as_float(a) * value_as_float(b));
+}
+
+static inline Value value_float_divide(Value a, Value b) {
+	return value_from_float(value_as_float(a) / value_as_float(b));
+}
+
+//Turns a literal token from the lexer into a value. String literals point directly at the string owned by the token
+Value value_from_token(token tok) {
+	if (tok.type != LITERAL) {
+		return VALUE_VOID;
+	}
+
+	switch (tok.mdata) {
+	case INT_LITERAL:
+		return value_from_int((int)tok.val);
+	case FLOAT_LITERAL:
+		//The lexer stores the bits of the double directly in val, which is exactly how a float value is stored
+		return value_from_float(value_as_float((Value)tok.val));
+	case STRING_LITERAL:
+		return value_from_string((string*)tok.val);
+	default:
+		return VALUE_VOID;
+	}
+}
+
+void value_print(Value val) {
+	if (value_is_float(val)) {
+		printf("%lf", value_as_float(val));
+	}
+	else if (value_is_int(val)) {
+		printf("%d", value_as_int(val));
+	}
+	else if (value_is_string(val)) {
+		printf("%s", value_as_string(val)->str != NULL ? value_as_string(val)->str : "");
+	}
+	else if (value_is_function(val)) {
+		printf("<function %d>", value_as_function(val));
+	}
+	else {
+		printf("void");
+	}
+}
+
+#endif
@@ -3,6 +3,9 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include "Profiler.h"
+#include "Memory.h"
 
 typedef struct Vector_Int {
 	int* vec;
@@ -21,7 +24,8 @@ int Vector_Int_Append(Vector_Int* vec, int num) {
 	if (vec->len + 1 >= vec->__size) {
 		vec->__size *= 2;
 
-		int* test = (int*)realloc(vec->vec, vec->__size * sizeof(int));
+		profile_alloc(vec->vec, vec->__size * sizeof(int));
+		int* test = (int*)mem_realloc(vec->vec, vec->__size * sizeof(int));
 
 		if (test == NULL) {
 			printf("Failed to allocate memory in Vector_Int_Append\n");
@@ -46,7 +50,7 @@ int Vector_Int_Pop(Vector_Int* vec) {
 			vec->__size = 1;
 		}
 
-		int* test = (int*)realloc(vec->vec, vec->__size * sizeof(int));
+		int* test = (int*)mem_realloc(vec->vec, vec->__size * sizeof(int));
 
 		if (test == NULL) {
 			printf("Failed to allocate memory in Vector_Int_Pop\n");
@@ -60,8 +64,37 @@ int Vector_Int_Pop(Vector_Int* vec) {
 	return 0;
 }
 
+//Replaces the removeCount ints starting at index with the insertCount ints in insert
+int Vector_Int_Splice(Vector_Int* vec, int index, int removeCount, int* insert, int insertCount) {
+	int newLen = vec->len - removeCount + insertCount;
+	if (newLen + 1 >= vec->__size) {
+		while (newLen + 1 >= vec->__size) {
+			vec->__size *= 2;
+		}
+
+		profile_alloc(vec->vec, vec->__size * sizeof(int));
+		int* test = (int*)mem_realloc(vec->vec, vec->__size * sizeof(int));
+
+		if (test == NULL) {
+			printf("Failed to allocate memory in Vector_Int_Splice\n");
+			exit(-1);
+		}
+
+		vec->vec = test;
+	}
+
+	if (removeCount != insertCount) {
+		memmove(&vec->vec[index + insertCount], &vec->vec[index + removeCount], (vec->len - index - removeCount) * sizeof(int));
+	}
+	if (insertCount > 0) {
+		memcpy(&vec->vec[index], insert, insertCount * sizeof(int));
+	}
+	vec->len = newLen;
+	return 0;
+}
+
 int Vector_Int_Destroy(Vector_Int* vec) {
-	free(vec->vec);
+	mem_free(vec->vec);
 	vec->vec = NULL;
 	vec->len = 0;
 	vec->__size = 1;
@@ -1,3 +1,8 @@
+//POSIX functions are hidden by the standard headers on Linux unless this is defined before anything is included
+#ifndef _WIN32
+#define _DEFAULT_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,24 +12,108 @@
 #include "DynamicArray.h"
 #include "Lexer.h"
 #include "Parser.h"
+#include "Inliner.h"
+#include "TypeChecker.h"
 #include "DbgTools.h"
+#include "Benchmark.h"
+#include "Dump.h"
+#include "Driver.h"
+#include "Server.h"
+#include "Incremental.h"
+#include "Tests.h"
+
+int main(int argc, char** argv) {
+	//--profile prints how long each phase of the compiler took, and --profile-json prints the same thing as JSON
+	int profile = 0;
+	//--dump <verbose|compact|binary> writes the tokens and the AST in that format (to the file given by --dump-file, or stdout)
+	//instead of printing the source and the tokens and opening the debug navigator
+	int dump = -1;
+	char* dumpPath = NULL;
+	for (int i = 1; i < argc; i++) {
+		//--bench runs the lexer and parser benchmarks instead, and everything after it is passed along to them
+		if (strcmp(argv[i], "--bench") == 0) {
+			return bench_main(argc - i - 1, &argv[i + 1]);
+		}
+		//--test runs the tests, or only the ones named after it
+		else if (strcmp(argv[i], "--test") == 0) {
+			return tests_main(argc - i - 1, &argv[i + 1]);
+		}
+		//--batch compiles every file after it (or in a manifest) in this one process, instead of the single hardcoded file
+		else if (strcmp(argv[i], "--batch") == 0) {
+			return driver_main(argc - i - 1, &argv[i + 1]);
+		}
+		//--serve <socket> keeps a batch driver running in the background, and --client <socket> sends everything after it to one
+		else if (strcmp(argv[i], "--serve") == 0) {
+			return server_main(argc - i - 1, &argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--client") == 0) {
+			return server_client(argc - i - 1, &argv[i + 1]);
+		}
+		//--edit <file> <script> replays the edits in the script on the file with the incremental lexer and parser
+		else if (strcmp(argv[i], "--edit") == 0) {
+			return document_main(argc - i - 1, &argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--profile") == 0) {
+			profile = 1;
+		}
+		else if (strcmp(argv[i], "--profile-json") == 0) {
+			profile = 2;
+		}
+		else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+			dump = dump_find_format(argv[++i]);
+			if (dump == -1) {
+				printf("Unknown dump format %s\n", argv[i]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "--dump-file") == 0 && i + 1 < argc) {
+			dumpPath = argv[++i];
+		}
+	}
+	if (profile) {
+		profiler_enable();
+	}
 
-int main(void) {
 	string s1;
 	string_init(&s1, NULL);
+	profiler_begin(PHASE_LOAD);
 	string_load_file("C:\\Users\\colec\\C Programs\\Assembly\\text.txt", &s1);
+	profiler_end();
 	tokenList list;
 	tokenList_init(&list);
 
+	if (dump == -1) {
+		printf("%s\n\n", s1.str);
+	}
 	lexer(&list, &s1);
-	tokenList_print(&list);
+	if (dump == -1) {
+		tokenList_print(&list);
+	}
 
 	AST* ast;
 	AST_init(&ast);
 
 	parser(&list, &ast);
-	
+	//The debug navigator shows the whole tree, so every function body gets parsed up front instead of when it is first needed
+	parser_all_bodies(&list, &ast);
+	typechecker(&list, &ast);
+	inliner(&list, &ast);
+
+	if (profile == 1) {
+		profiler_report_text(stdout);
+	}
+	else if (profile == 2) {
+		profiler_report_json(stdout);
+	}
+
+	if (dump != -1) {
+		return dump_to_file(dumpPath, &list, ast, dump) ? 0 : 1;
+	}
+
 	Debug_navigator(&list, &ast);
 
+	//Only prints anything in builds with MEMORY_TRACKING defined
+	memory_report(stdout);
+
 	return 0;
 }